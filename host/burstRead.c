@@ -0,0 +1,180 @@
+/********************************************************************************
+  * @file    burstRead.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Extractor de rafagas del ADC triple intercalado. Lee un stream
+  	  	  	 de tramas CAPTURE_RAFAGA de src/capture.h (o un archivo crudo
+  	  	  	 u16) y escribe las muestras como u16 crudo, el formato -b u16
+  	  	  	 de freqRes e iirStream. Opcionalmente recalibra offset y
+  	  	  	 ganancia entre ADC con el mismo src/interleave.c del firmware,
+  	  	  	 e informa el desajuste y la espuria de offset en Fs/3.
+
+  * COMPILACION:
+  	  *	gcc -O2 -o burstRead burstRead.c captureRead.c ../src/interleave.c -lm
+
+  * USO:
+  	  *	burstRead -c captura.bin | -i rafaga.u16  [-o salida.u16]
+  	  	          [-n largo] [-a] [-f fs]
+  	  	Con -a la calibracion se estima en la primera rafaga de largo -n
+  	  	(por defecto todo el archivo) y se aplica a todas.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "captureRead.h"
+#include "../src/interleave.h"
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+static void ERROR_FATAL(const char* pMsj, const char* pArg)
+{
+	fprintf(stderr, "burstRead: %s%s%s\n", pMsj, pArg ? " " : "", pArg ? pArg : "");
+	exit(1);
+}
+
+static void USO(void)
+{
+	fprintf(stderr,
+		"uso: burstRead -c captura.bin | -i rafaga.u16 [-o salida.u16]\n"
+		"               [-n largo] [-a] [-f fs]\n");
+	exit(2);
+}
+
+/*Muestras de las tramas CAPTURE_RAFAGA de un stream de captura:*/
+static uint16_t* LEER_STREAM(const char* pRuta, size_t* pN)
+{
+	CAPTURE_READER rd;
+	CAPTURE_FRAME_VIEW frame;
+	size_t n = 0, cap = 1 << 16;
+	uint16_t* pDatos = malloc(cap * sizeof(uint16_t));
+
+	if (!pDatos) ERROR_FATAL("sin memoria", NULL);
+	if (CAPTURE_READER_OPEN(&rd, pRuta) < 0) ERROR_FATAL("no se puede abrir", pRuta);
+
+	while (CAPTURE_READER_NEXT(&rd, &frame)) {
+		if (frame.tipo != CAPTURE_RAFAGA) continue;
+		if (n + frame.nValores > cap) {
+			cap *= 2;
+			pDatos = realloc(pDatos, cap * sizeof(uint16_t));
+			if (!pDatos) ERROR_FATAL("sin memoria", NULL);
+		}
+		for (uint32_t k = 0; k < frame.nValores; k++)
+			pDatos[n++] = CAPTURE_VALOR(&frame, k);
+	}
+
+	/*Una trama perdida corre el orden de los ADC en el resto de la rafaga:*/
+	fprintf(stderr, "burstRead: %u tramas, %u perdidas, %u errores de CRC\n",
+			rd.tramasOk, rd.tramasPerdidas, rd.erroresCrc);
+	CAPTURE_READER_CLOSE(&rd);
+
+	*pN = n;
+	return pDatos;
+}
+
+/*Archivo u16 crudo completo:*/
+static uint16_t* LEER_CRUDO(const char* pRuta, size_t* pN)
+{
+	FILE* pArch = fopen(pRuta, "rb");
+	if (!pArch) ERROR_FATAL("no se puede abrir", pRuta);
+
+	fseek(pArch, 0, SEEK_END);
+	size_t n = (size_t)ftell(pArch) / sizeof(uint16_t);
+	fseek(pArch, 0, SEEK_SET);
+
+	uint16_t* pDatos = malloc(n * sizeof(uint16_t) + 1);
+	if (!pDatos) ERROR_FATAL("sin memoria", NULL);
+	if (fread(pDatos, sizeof(uint16_t), n, pArch) != n) ERROR_FATAL("lectura incompleta", pRuta);
+	fclose(pArch);
+
+	*pN = n;
+	return pDatos;
+}
+
+/*Amplitud [dBFS] de la componente en Fs/3 (espuria del offset entre ADC),
+  por DFT directa de una rafaga:*/
+static double ESPURIA_FS3(const uint16_t* pDatos, size_t n)
+{
+	double re = 0.0, im = 0.0;
+
+	n -= n % INTERLEAVE_ADCS;
+	for (size_t i = 0; i < n; i++) {
+		double fase = 2.0 * M_PI * (double)(i % INTERLEAVE_ADCS) / INTERLEAVE_ADCS;
+		re += pDatos[i] * cos(fase);
+		im -= pDatos[i] * sin(fase);
+	}
+	return 20.0 * log10(2.0 * hypot(re, im) / n / 2048.0 + 1e-12);
+}
+
+static void INFORMAR(const char* pTitulo, const uint16_t* pDatos, size_t n)
+{
+	INTERLEAVE_CAL cal;
+
+	INTERLEAVE_CALIBRAR(&cal, pDatos, (uint32_t)n);
+	fprintf(stderr, "%s:\n", pTitulo);
+	for (uint32_t k = 0; k < INTERLEAVE_ADCS; k++)
+		fprintf(stderr, "  ADC%u  offset %+8.3f LSB  ganancia %.5f\n",
+				k + 1, cal.offset[k], 1.0 / cal.ganancia[k]);
+	fprintf(stderr, "  espuria en Fs/3: %.1f dBFS\n", ESPURIA_FS3(pDatos, n));
+}
+
+/*------------------------------------------------------------------------------
+MAIN:
+------------------------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	const char* pRutaStream = NULL;
+	const char* pRutaIn = NULL;
+	const char* pRutaOut = NULL;
+	size_t largo = 0;
+	int recalibrar = 0;
+	double fs = 4500000.0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c:i:o:n:af:")) != -1) {
+		switch (opt) {
+		case 'c': pRutaStream = optarg; break;
+		case 'i': pRutaIn = optarg; break;
+		case 'o': pRutaOut = optarg; break;
+		case 'n': largo = (size_t)atol(optarg); break;
+		case 'a': recalibrar = 1; break;
+		case 'f': fs = atof(optarg); break;
+		default: USO();
+		}
+	}
+	if (!pRutaStream == !pRutaIn || fs <= 0.0) USO();
+
+	size_t n;
+	uint16_t* pDatos = pRutaStream ? LEER_STREAM(pRutaStream, &n) : LEER_CRUDO(pRutaIn, &n);
+	if (largo == 0 || largo > n) largo = n;
+	if (largo < 2 * INTERLEAVE_ADCS) ERROR_FATAL("rafaga demasiado corta", NULL);
+
+	fprintf(stderr, "burstRead: %zu muestras, %zu rafagas de %zu (%.3f ms a %.3f MHz)\n",
+			n, n / largo, largo, largo / fs * 1e3, fs / 1e6);
+	INFORMAR("primera rafaga", pDatos, largo);
+
+	/*Cada rafaga empieza por ADC1, asi la calibracion se aplica por rafaga:*/
+	if (recalibrar) {
+		INTERLEAVE_CAL cal;
+		INTERLEAVE_CALIBRAR(&cal, pDatos, (uint32_t)largo);
+		for (size_t r = 0; r + largo <= n; r += largo)
+			INTERLEAVE_CORREGIR(&cal, &pDatos[r], (uint32_t)largo, &pDatos[r]);
+		INFORMAR("recalibrada", pDatos, largo);
+	}
+
+	if (pRutaOut) {
+		FILE* pArch = fopen(pRutaOut, "wb");
+		if (!pArch) ERROR_FATAL("no se puede crear", pRutaOut);
+		if (fwrite(pDatos, sizeof(uint16_t), n, pArch) != n) ERROR_FATAL("escritura incompleta", pRutaOut);
+		fclose(pArch);
+	}
+
+	free(pDatos);
+	return 0;
+}
@@ -0,0 +1,161 @@
+/********************************************************************************
+  * @file    captureRead.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Lector de capturas en el formato de src/capture.h. Mapea el
+  	  	  	 archivo en memoria y entrega vistas de cada trama valida sin
+  	  	  	 copiar la carga; se resincroniza ante basura o errores de CRC y
+  	  	  	 contabiliza las tramas perdidas por saltos de secuencia.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "captureRead.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+static uint32_t crcTabla[256];
+
+/*Tabla del CRC-32 MSB primero (polinomio 0x04C11DB7):*/
+static void CRC_TABLA_INIT(void)
+{
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t c = i << 24;
+		for (uint32_t b = 0; b < 8; b++)
+			c = (c & 0x80000000) ? (c << 1) ^ 0x04C11DB7 : (c << 1);
+		crcTabla[i] = c;
+	}
+}
+
+/*Mismo CRC que la unidad CRC, por tabla y sobre bytes sin alinear: cada
+  palabra little endian se procesa desde su byte mas significativo:*/
+static uint32_t CRC_PALABRAS(const uint8_t* p, uint32_t nWords)
+{
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (uint32_t i = 0; i < nWords; i++, p += 4)
+		for (int32_t b = 3; b >= 0; b--)
+			crc = (crc << 8) ^ crcTabla[(crc >> 24) ^ p[b]];
+	return crc;
+}
+
+static inline uint32_t LEER_U32(const uint8_t* p)
+{
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+/*****************************************************************************
+CAPTURE_READER_OPEN
+
+	* @author	A. Riedinger.
+	* @brief	Abre y mapea un archivo de captura.
+	* @returns
+		- 0 si se pudo abrir, -1 en otro caso.
+	* @param
+		- pRd		Estado del lector.
+		- pRuta		Archivo grabado desde el puerto serie.
+	* @ej
+		- CAPTURE_READER_OPEN(&rd, "captura.bin");
+******************************************************************************/
+int CAPTURE_READER_OPEN(CAPTURE_READER* pRd, const char* pRuta)
+{
+	struct stat st;
+	int fd = open(pRuta, O_RDONLY);
+
+	memset(pRd, 0, sizeof(*pRd));
+	pRd->secuenciaPrevia = -1;
+	if (crcTabla[1] == 0) CRC_TABLA_INIT();
+
+	if (fd < 0) return -1;
+	if (fstat(fd, &st) < 0 || st.st_size == 0) { close(fd); return -1; }
+
+	pRd->largo = (size_t)st.st_size;
+	pRd->pMapa = mmap(NULL, pRd->largo, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (pRd->pMapa == MAP_FAILED) { pRd->pMapa = NULL; return -1; }
+
+	madvise((void*)pRd->pMapa, pRd->largo, MADV_SEQUENTIAL);
+	return 0;
+}
+
+/*****************************************************************************
+CAPTURE_READER_NEXT
+
+	* @author	A. Riedinger.
+	* @brief	Busca la proxima trama valida (sync, largo y CRC correctos).
+	* @returns
+		- 1 si entrego una trama, 0 al final del archivo.
+	* @param
+		- pRd		Estado del lector.
+		- pFrame	Vista de la trama encontrada.
+	* @ej
+		- while (CAPTURE_READER_NEXT(&rd, &frame)) ...
+******************************************************************************/
+int CAPTURE_READER_NEXT(CAPTURE_READER* pRd, CAPTURE_FRAME_VIEW* pFrame)
+{
+	while (pRd->pos + (CAPTURE_HEADER_WORDS + 1) * 4 <= pRd->largo) {
+		const uint8_t* p = pRd->pMapa + pRd->pos;
+		uint32_t h0 = LEER_U32(p);
+		uint32_t h1 = LEER_U32(p + 4);
+		uint16_t nValores = (uint16_t)(h1 >> 16);
+		uint32_t nWords = CAPTURE_HEADER_WORDS + CAPTURE_PAYLOAD_BYTES(nValores) / 4 + 1;
+
+		/*Sincronismo, version y largo coherente:*/
+		if ((h0 & 0xFFFF) != CAPTURE_SYNC || (h0 >> 24) != CAPTURE_VERSION ||
+			nValores == 0 || (nValores & 7) != 0) {
+			pRd->pos++;
+			pRd->bytesDescartados++;
+			continue;
+		}
+		if (pRd->pos + (size_t)nWords * 4 > pRd->largo)
+			break;
+
+		if (CRC_PALABRAS(p, nWords - 1) != LEER_U32(p + (nWords - 1) * 4)) {
+			pRd->erroresCrc++;
+			pRd->pos++;
+			pRd->bytesDescartados++;
+			continue;
+		}
+
+		pFrame->tipo = (uint8_t)(h0 >> 16);
+		pFrame->secuencia = (uint16_t)h1;
+		pFrame->nValores = nValores;
+		pFrame->pCarga = p + CAPTURE_HEADER_WORDS * 4;
+		pFrame->perdidasPrevias = 0;
+
+		if (pRd->secuenciaPrevia >= 0)
+			pFrame->perdidasPrevias = (uint16_t)(pFrame->secuencia - (uint16_t)pRd->secuenciaPrevia - 1);
+		pRd->tramasPerdidas += pFrame->perdidasPrevias;
+		pRd->secuenciaPrevia = pFrame->secuencia;
+
+		pRd->tramasOk++;
+		pRd->pos += (size_t)nWords * 4;
+		return 1;
+	}
+	return 0;
+}
+
+/*****************************************************************************
+CAPTURE_READER_CLOSE
+
+	* @author	A. Riedinger.
+	* @brief	Libera el mapeo del archivo de captura.
+	* @returns	void
+	* @param
+		- pRd		Estado del lector.
+	* @ej
+		- CAPTURE_READER_CLOSE(&rd);
+******************************************************************************/
+void CAPTURE_READER_CLOSE(CAPTURE_READER* pRd)
+{
+	if (pRd->pMapa) munmap((void*)pRd->pMapa, pRd->largo);
+	pRd->pMapa = NULL;
+}
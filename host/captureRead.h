@@ -0,0 +1,48 @@
+/* Definicion del header:*/
+#ifndef captureRead_H
+#define captureRead_H
+
+/* Librerias:*/
+#include <stddef.h>
+#include <stdint.h>
+#include "../src/capture.h"
+
+/* Estructuras:*/
+typedef struct
+{
+	const uint8_t* pMapa;						/*Archivo de captura mapeado.*/
+	size_t   largo;
+	size_t   pos;								/*Proximo byte a examinar.*/
+	int32_t  secuenciaPrevia;					/*-1 antes de la primera trama.*/
+	uint32_t tramasOk;
+	uint32_t tramasPerdidas;					/*Saltos de secuencia.*/
+	uint32_t erroresCrc;
+	size_t   bytesDescartados;					/*Basura entre tramas validas.*/
+} CAPTURE_READER;
+
+/*Vista de una trama valida, apuntando dentro del archivo mapeado:*/
+typedef struct
+{
+	uint8_t  tipo;
+	uint16_t secuencia;
+	uint16_t nValores;
+	uint16_t perdidasPrevias;					/*Tramas perdidas antes de esta.*/
+	const uint8_t* pCarga;
+} CAPTURE_FRAME_VIEW;
+
+/* Declaracion funciones:*/
+int CAPTURE_READER_OPEN(CAPTURE_READER* pRd, const char* pRuta);
+int CAPTURE_READER_NEXT(CAPTURE_READER* pRd, CAPTURE_FRAME_VIEW* pFrame);
+void CAPTURE_READER_CLOSE(CAPTURE_READER* pRd);
+
+/*Valor k de 12 bits de la carga de una trama:*/
+static inline uint16_t CAPTURE_VALOR(const CAPTURE_FRAME_VIEW* pFrame, uint32_t k)
+{
+	const uint8_t* p = pFrame->pCarga + (k >> 1) * 3;
+
+	if ((k & 1) == 0) return (uint16_t)(p[0] | ((p[1] & 0x0F) << 8));
+	else              return (uint16_t)((p[1] >> 4) | (p[2] << 4));
+}
+
+/* Cierre del header:*/
+#endif
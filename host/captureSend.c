@@ -0,0 +1,131 @@
+/********************************************************************************
+  * @file    captureSend.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Emisor de capturas en el host: arma las tramas con el mismo
+  	  	  	 src/capture.c del firmware (CRC por software) y las escribe en
+  	  	  	 una pseudo-terminal, para probar el lado del host sin la placa.
+
+  * COMPILACION:
+  	  *	gcc -O2 -o captureSend captureSend.c ../src/capture.c -lm
+
+  * USO:
+  	  *	captureSend [-n muestras] [-f fs] [-r] [-e tasa_error]
+  	  	Imprime el nombre del esclavo (/dev/pts/N); -r respeta el tiempo
+  	  	real de fs y -e corrompe al azar esa fraccion de tramas.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/capture.h"
+
+/*------------------------------------------------------------------------------
+VARIABLES GLOBALES:
+------------------------------------------------------------------------------*/
+static int fdMaster = -1;
+static double tasaError = 0.0;
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Transporte: escritura bloqueante en el maestro de la pseudo-terminal:*/
+static uint8_t PTY_SEND(const void* pFrame, uint32_t nBytes)
+{
+	uint8_t copia[CAPTURE_FRAME_BYTES];
+	const uint8_t* p = pFrame;
+
+	/*Corrupcion opcional para ejercitar la resincronizacion del lector:*/
+	if (tasaError > 0.0 && rand() < tasaError * RAND_MAX) {
+		memcpy(copia, pFrame, nBytes);
+		copia[rand() % nBytes] ^= 0x10;
+		p = copia;
+	}
+
+	while (nBytes) {
+		ssize_t w = write(fdMaster, p, nBytes);
+		if (w <= 0) return 0;
+		p += w;
+		nBytes -= (uint32_t)w;
+	}
+	return 1;
+}
+
+/*------------------------------------------------------------------------------
+MAIN:
+------------------------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	uint64_t nMuestras = 20000 * 10ULL;
+	double fs = 20000.0;
+	int tiempoReal = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:f:re:")) != -1) {
+		switch (opt) {
+		case 'n': nMuestras = strtoull(optarg, NULL, 10); break;
+		case 'f': fs = atof(optarg); break;
+		case 'r': tiempoReal = 1; break;
+		case 'e': tasaError = atof(optarg); break;
+		default:
+			fprintf(stderr, "uso: captureSend [-n muestras] [-f fs] [-r] [-e tasa_error]\n");
+			return 2;
+		}
+	}
+
+	/*Apertura de la pseudo-terminal en modo crudo:*/
+	struct termios tio;
+	fdMaster = posix_openpt(O_RDWR | O_NOCTTY);
+	if (fdMaster < 0 || grantpt(fdMaster) < 0 || unlockpt(fdMaster) < 0) {
+		perror("posix_openpt");
+		return 1;
+	}
+	if (tcgetattr(fdMaster, &tio) == 0) {
+		cfmakeraw(&tio);
+		tcsetattr(fdMaster, TCSANOW, &tio);
+	}
+	printf("%s\n", ptsname(fdMaster));
+	fflush(stdout);
+
+	/*Espera a que el lector abra el esclavo:*/
+	fprintf(stderr, "captureSend: Enter para comenzar...\n");
+	getchar();
+
+	/*Senal de prueba: tono util de 1 kHz mas interferente de 5 kHz; la salida
+	  es la entrada sin el interferente:*/
+	CAPTURE capture;
+	CAPTURE_INIT(&capture, CAPTURE_AMBAS, PTY_SEND);
+
+	/*Espera por trama, partida en segundos y nanosegundos (con fs bajo pasa
+	  de 1 s y tv_nsec debe quedar por debajo de 1e9):*/
+	double espera = (double)CAPTURE_VALORES / 2.0 / fs;
+	struct timespec periodo;
+	periodo.tv_sec = (time_t)espera;
+	periodo.tv_nsec = (long)((espera - (double)periodo.tv_sec) * 1e9);
+	for (uint64_t k = 0; k < nMuestras; k++) {
+		double util = 600.0 * sin(2.0 * M_PI * 1000.0 * k / fs);
+		double inter = 400.0 * sin(2.0 * M_PI * 5000.0 * k / fs);
+		uint16_t in  = (uint16_t)lrint(2048.0 + util + inter);
+		uint16_t out = (uint16_t)lrint(2048.0 + util);
+
+		CAPTURE_PUSH(&capture, in, out);
+		if (tiempoReal && capture.valores == 0) nanosleep(&periodo, NULL);
+	}
+
+	fprintf(stderr, "captureSend: %u tramas enviadas, %u perdidas\n",
+			capture.tramasEnviadas, capture.tramasPerdidas);
+
+	/*Margen para que el lector vacie la pseudo-terminal antes de cerrarla:*/
+	sleep(1);
+	close(fdMaster);
+	return 0;
+}
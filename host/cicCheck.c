@@ -0,0 +1,153 @@
+/********************************************************************************
+  * @file    cicCheck.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Verificacion en el host del decimador CIC de src/cic.c: bits
+  	  	  	 efectivos que agrega sobremuestrear por R y decimar (un tono
+  	  	  	 con ruido de ADC, contra el mismo tono muestreado a FS sin
+  	  	  	 decimar) y rizado de la banda compensada con CIC_GANANCIA. Sale
+  	  	  	 con 1 si algun R se aparta de lo esperado.
+
+  * COMPILACION:
+  	  *	gcc -O2 -I../src -o cicCheck cicCheck.c ../src/cic.c -lm
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "cic.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+#define FS			20000.0
+#define N_SALIDA	20000						/*1 s a la Fs de salida.*/
+#define TRANSITORIO	32							/*Muestras de salida descartadas.*/
+#define BLOQUE		64
+
+/*Tono de prueba (en codigos, alrededor de 2048) y ruido del ADC [LSB rms]:*/
+#define TONO_FREQ	1000.0
+#define TONO_AMP	1600.0
+#define RUIDO_LSB	0.5
+
+/*Tolerancias: bits agregados contra 0.5*log2(R) y desvio maximo de 0 dB
+  en la banda [dB]:*/
+#define TOL_BITS	0.15
+#define TOL_RIZADO	0.1
+
+static uint16_t codigos[CIC_R_MAX * BLOQUE];
+static float salida[N_SALIDA];
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Ruido gaussiano reproducible (Box-Muller):*/
+static double GAUSS(void)
+{
+	double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+	double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/*Codigo del ADC de 12 bits en la muestra k a la frecuencia Fs:*/
+static uint16_t CODIGO(uint64_t k, double Fs)
+{
+	double v = 2048.0 + TONO_AMP * sin(2.0 * M_PI * TONO_FREQ * k / Fs) + RUIDO_LSB * GAUSS();
+	long c = lround(v);
+	return (uint16_t)(c < 0 ? 0 : c > 4095 ? 4095 : c);
+}
+
+/*SNR [dB] de x[ini, fin): ajuste por cuadrados minimos de continua, seno
+  y coseno a la frecuencia del tono (f en fracciones de la Fs de x); el
+  residuo es el ruido en toda la banda de x:*/
+static double SNR_DB(const float* x, uint32_t ini, uint32_t fin, double f)
+{
+	double M[3][4] = {{0}};
+
+	for (uint32_t k = ini; k < fin; k++) {
+		double v[3] = {1.0, cos(2.0 * M_PI * f * k), sin(2.0 * M_PI * f * k)};
+		for (uint32_t i = 0; i < 3; i++) {
+			for (uint32_t j = 0; j < 3; j++) M[i][j] += v[i] * v[j];
+			M[i][3] += v[i] * x[k];
+		}
+	}
+	for (uint32_t i = 0; i < 3; i++) {
+		for (uint32_t r = 0; r < 3; r++) {
+			if (r == i) continue;
+			double factor = M[r][i] / M[i][i];
+			for (uint32_t c = i; c < 4; c++) M[r][c] -= factor * M[i][c];
+		}
+	}
+	double a[3] = {M[0][3] / M[0][0], M[1][3] / M[1][1], M[2][3] / M[2][2]};
+
+	double ruido = 0.0;
+	for (uint32_t k = ini; k < fin; k++) {
+		double e = x[k] - (a[0] + a[1] * cos(2.0 * M_PI * f * k) + a[2] * sin(2.0 * M_PI * f * k));
+		ruido += e * e;
+	}
+	ruido /= fin - ini;
+	return 10.0 * log10(0.5 * (a[1] * a[1] + a[2] * a[2]) / ruido);
+}
+
+/*------------------------------------------------------------------------------
+MAIN:
+------------------------------------------------------------------------------*/
+int main(void)
+{
+	static const uint32_t R[] = {4, 16, 64};
+	CIC_DECIM cic;
+	int falla = 0;
+
+	srand(1);
+
+	/*Referencia: el mismo tono muestreado a FS, sin decimar:*/
+	for (uint32_t k = 0; k < N_SALIDA; k++)
+		salida[k] = (float)(((int32_t)CODIGO(k, FS) - 2048) / 4096.0);
+	double snrBase = SNR_DB(salida, TRANSITORIO, N_SALIDA, TONO_FREQ / FS);
+	double bitsBase = (snrBase - 1.76) / 6.02;
+
+	printf("TONO %.0f Hz a %.0f Hz, ruido del ADC %.2f LSB rms:\n", TONO_FREQ, FS, RUIDO_LSB);
+	printf("  sin decimar : SNR %6.2f dB, %5.2f bits efectivos\n", snrBase, bitsBase);
+
+	/*1) Bits efectivos despues del CIC y su compensador:*/
+	for (uint32_t r = 0; r < sizeof(R) / sizeof(R[0]); r++) {
+		uint32_t n = 0;
+		uint64_t k = 0;
+
+		CIC_INIT(&cic, R[r]);
+		while (n < N_SALIDA) {
+			for (uint32_t i = 0; i < R[r] * BLOQUE; i++) codigos[i] = CODIGO(k++, FS * R[r]);
+			n += CIC_DECIMATE(&cic, codigos, R[r] * BLOQUE, &salida[n]);
+		}
+
+		double snr = SNR_DB(salida, TRANSITORIO, N_SALIDA, TONO_FREQ / FS);
+		double bits = (snr - 1.76) / 6.02 - bitsBase;
+		double esperado = 0.5 * log2(R[r]);
+		int ok = fabs(bits - esperado) <= TOL_BITS;
+		falla |= !ok;
+		printf("  R = %2u      : SNR %6.2f dB, %+5.2f bits (esperado %+.1f) %s\n",
+			   R[r], snr, bits, esperado, ok ? "ok" : "FALLA");
+	}
+
+	/*2) Rizado de CIC + compensador en [0, CIC_FIR_BANDA]:*/
+	printf("\nRIZADO DE LA BANDA COMPENSADA (0 a %.2f Fs):\n", CIC_FIR_BANDA);
+	for (uint32_t r = 0; r < sizeof(R) / sizeof(R[0]); r++) {
+		double gMin = 1e30, gMax = -1e30;
+
+		CIC_INIT(&cic, R[r]);
+		for (uint32_t g = 0; g <= 1000; g++) {
+			double dB = 20.0 * log10(CIC_GANANCIA(&cic, CIC_FIR_BANDA * g / 1000.0f));
+			if (dB < gMin) gMin = dB;
+			if (dB > gMax) gMax = dB;
+		}
+		double desvio = fmax(gMax, -gMin);
+		int ok = desvio <= TOL_RIZADO;
+		falla |= !ok;
+		printf("  R = %2u      : %+.3f a %+.3f dB, rizado +-%.3f dB (%.3f pico a pico) %s\n",
+			   R[r], gMin, gMax, desvio, gMax - gMin, ok ? "ok" : "FALLA");
+	}
+
+	return falla;
+}
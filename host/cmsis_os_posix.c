@@ -0,0 +1,353 @@
+/********************************************************************************
+  * @file    cmsis_os_posix.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Port de la API CMSIS-RTOS (Libraries/CMSIS/RTOS/cmsis_os.h)
+  	  	  	 sobre pthreads, para correr en el host el mismo codigo en hilos
+  	  	  	 del firmware (src/hilos.c). Cubre kernel, hilos, senales,
+  	  	  	 demora y colas de mensajes. Las prioridades se mapean a
+  	  	  	 SCHED_FIFO si el proceso tiene permiso (root o CAP_SYS_NICE);
+  	  	  	 si no, los hilos corren con la politica normal y la prioridad
+  	  	  	 solo se informa.
+
+  * COMPILACION:
+  	  *	junto con el programa, con -I../Libraries/CMSIS/RTOS -pthread
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmsis_os.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Bloque de control de un hilo: senales con su mutex y condicion:*/
+struct os_thread_cb
+{
+	pthread_t hilo;
+	const osThreadDef_t* pDef;
+	void* pArg;
+	osPriority prioridad;
+	int32_t senales;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+/*Cola circular de mensajes de 32 bits:*/
+struct os_messageQ_cb
+{
+	uint32_t* pDatos;
+	uint32_t largo;
+	uint32_t lectura;
+	uint32_t cuenta;
+	pthread_mutex_t mutex;
+	pthread_cond_t noVacia;
+	pthread_cond_t noLlena;
+};
+
+/*------------------------------------------------------------------------------
+VARIABLES LOCALES:
+------------------------------------------------------------------------------*/
+static __thread struct os_thread_cb* pHiloActual = NULL;
+static int32_t kernelCorriendo = 0;
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Plazo absoluto para pthread_cond_timedwait (reloj monotonico):*/
+static struct timespec PLAZO(uint32_t Milisegundos)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	t.tv_sec += Milisegundos / 1000;
+	t.tv_nsec += (long)(Milisegundos % 1000) * 1000000L;
+	if (t.tv_nsec >= 1000000000L) {
+		t.tv_sec++;
+		t.tv_nsec -= 1000000000L;
+	}
+	return t;
+}
+
+static void COND_INIT(pthread_cond_t* pCond)
+{
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(pCond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+/*Espera con plazo: 0 espera lo que haya, osWaitForever sin plazo. Devuelve
+  0 si se cumplio la condicion, ETIMEDOUT si no:*/
+static int ESPERAR(pthread_cond_t* pCond, pthread_mutex_t* pMutex, const struct timespec* pPlazo)
+{
+	if (pPlazo == NULL) return pthread_cond_wait(pCond, pMutex);
+	return pthread_cond_timedwait(pCond, pMutex, pPlazo);
+}
+
+static struct os_thread_cb* HILO_CB_NUEVO(void)
+{
+	struct os_thread_cb* pCb = calloc(1, sizeof(*pCb));
+
+	if (pCb) {
+		pthread_mutex_init(&pCb->mutex, NULL);
+		COND_INIT(&pCb->cond);
+		pCb->prioridad = osPriorityNormal;
+	}
+	return pCb;
+}
+
+static void* HILO_ENTRADA(void* pArg)
+{
+	struct os_thread_cb* pCb = pArg;
+
+	pHiloActual = pCb;
+	pCb->pDef->pthread(pCb->pArg);
+	return NULL;
+}
+
+/*------------------------------------------------------------------------------
+KERNEL:
+------------------------------------------------------------------------------*/
+osStatus osKernelInitialize(void)
+{
+	/*main pasa a ser un hilo mas (osFeature_MainThread):*/
+	if (pHiloActual == NULL) {
+		pHiloActual = HILO_CB_NUEVO();
+		if (pHiloActual == NULL) return osErrorNoMemory;
+		pHiloActual->hilo = pthread_self();
+	}
+	return osOK;
+}
+
+osStatus osKernelStart(void)
+{
+	kernelCorriendo = 1;
+	return osOK;
+}
+
+int32_t osKernelRunning(void)
+{
+	return kernelCorriendo;
+}
+
+/*Ticks de osKernelSysTickFrequency (100 MHz, 10 ns):*/
+uint32_t osKernelSysTick(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint32_t)((uint64_t)t.tv_sec * osKernelSysTickFrequency + (uint64_t)t.tv_nsec / 10);
+}
+
+/*------------------------------------------------------------------------------
+HILOS:
+------------------------------------------------------------------------------*/
+osThreadId osThreadCreate(const osThreadDef_t* thread_def, void* argument)
+{
+	pthread_attr_t attr;
+	struct sched_param param;
+	struct os_thread_cb* pCb;
+
+	if (thread_def == NULL) return NULL;
+	pCb = HILO_CB_NUEVO();
+	if (pCb == NULL) return NULL;
+	pCb->pDef = thread_def;
+	pCb->pArg = argument;
+	pCb->prioridad = thread_def->tpriority;
+
+	/*Prioridad de tiempo real, de osPriorityIdle (-3) a osPriorityRealtime (+3),
+	  centrada en la mitad del rango de SCHED_FIFO:*/
+	pthread_attr_init(&attr);
+	if (thread_def->stacksize > PTHREAD_STACK_MIN)
+		pthread_attr_setstacksize(&attr, thread_def->stacksize);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	param.sched_priority = (sched_get_priority_min(SCHED_FIFO) + sched_get_priority_max(SCHED_FIFO)) / 2
+						 + (int)thread_def->tpriority;
+	pthread_attr_setschedparam(&attr, &param);
+
+	if (pthread_create(&pCb->hilo, &attr, HILO_ENTRADA, pCb) != 0) {
+		/*Sin permiso para SCHED_FIFO: politica normal:*/
+		pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+		if (pthread_create(&pCb->hilo, &attr, HILO_ENTRADA, pCb) != 0) {
+			pthread_attr_destroy(&attr);
+			free(pCb);
+			return NULL;
+		}
+	}
+	pthread_attr_destroy(&attr);
+	pthread_detach(pCb->hilo);
+	return pCb;
+}
+
+osThreadId osThreadGetId(void)
+{
+	return pHiloActual;
+}
+
+osStatus osThreadTerminate(osThreadId thread_id)
+{
+	if (thread_id == NULL) return osErrorParameter;
+	if (thread_id == pHiloActual) pthread_exit(NULL);
+	return pthread_cancel(thread_id->hilo) == 0 ? osOK : osErrorResource;
+}
+
+osStatus osThreadYield(void)
+{
+	sched_yield();
+	return osOK;
+}
+
+osPriority osThreadGetPriority(osThreadId thread_id)
+{
+	return thread_id ? thread_id->prioridad : osPriorityError;
+}
+
+osStatus osDelay(uint32_t millisec)
+{
+	struct timespec t = {millisec / 1000, (long)(millisec % 1000) * 1000000L};
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, 0, &t, &t) == EINTR);
+	return osEventTimeout;
+}
+
+/*------------------------------------------------------------------------------
+SENALES:
+------------------------------------------------------------------------------*/
+int32_t osSignalSet(osThreadId thread_id, int32_t signals)
+{
+	int32_t previas;
+
+	if (thread_id == NULL) return (int32_t)0x80000000;
+	pthread_mutex_lock(&thread_id->mutex);
+	previas = thread_id->senales;
+	thread_id->senales |= signals;
+	pthread_cond_signal(&thread_id->cond);
+	pthread_mutex_unlock(&thread_id->mutex);
+	return previas;
+}
+
+int32_t osSignalClear(osThreadId thread_id, int32_t signals)
+{
+	int32_t previas;
+
+	if (thread_id == NULL) return (int32_t)0x80000000;
+	pthread_mutex_lock(&thread_id->mutex);
+	previas = thread_id->senales;
+	thread_id->senales &= ~signals;
+	pthread_mutex_unlock(&thread_id->mutex);
+	return previas;
+}
+
+/*Con signals = 0 despierta con cualquier senal; si no, con todas las pedidas:*/
+osEvent osSignalWait(int32_t signals, uint32_t millisec)
+{
+	struct os_thread_cb* pCb = pHiloActual;
+	struct timespec plazo = PLAZO(millisec);
+	osEvent ev;
+
+	memset(&ev, 0, sizeof(ev));
+	if (pCb == NULL) {
+		ev.status = osErrorOS;
+		return ev;
+	}
+
+	pthread_mutex_lock(&pCb->mutex);
+	while (signals ? (pCb->senales & signals) != signals : pCb->senales == 0) {
+		if (millisec == 0 || ESPERAR(&pCb->cond, &pCb->mutex,
+									 millisec == osWaitForever ? NULL : &plazo) == ETIMEDOUT) {
+			ev.status = osEventTimeout;
+			pthread_mutex_unlock(&pCb->mutex);
+			return ev;
+		}
+	}
+	ev.status = osEventSignal;
+	ev.value.signals = pCb->senales;
+	pCb->senales &= signals ? ~signals : 0;
+	pthread_mutex_unlock(&pCb->mutex);
+	return ev;
+}
+
+/*------------------------------------------------------------------------------
+COLAS DE MENSAJES:
+------------------------------------------------------------------------------*/
+osMessageQId osMessageCreate(const osMessageQDef_t* queue_def, osThreadId thread_id)
+{
+	struct os_messageQ_cb* pQ;
+	(void)thread_id;
+
+	if (queue_def == NULL || queue_def->queue_sz == 0) return NULL;
+	pQ = calloc(1, sizeof(*pQ));
+	if (pQ == NULL) return NULL;
+	pQ->pDatos = calloc(queue_def->queue_sz, sizeof(uint32_t));
+	if (pQ->pDatos == NULL) {
+		free(pQ);
+		return NULL;
+	}
+	pQ->largo = queue_def->queue_sz;
+	pthread_mutex_init(&pQ->mutex, NULL);
+	COND_INIT(&pQ->noVacia);
+	COND_INIT(&pQ->noLlena);
+	return pQ;
+}
+
+osStatus osMessagePut(osMessageQId queue_id, uint32_t info, uint32_t millisec)
+{
+	struct timespec plazo = PLAZO(millisec);
+
+	if (queue_id == NULL) return osErrorParameter;
+	pthread_mutex_lock(&queue_id->mutex);
+	while (queue_id->cuenta == queue_id->largo) {
+		if (millisec == 0 || ESPERAR(&queue_id->noLlena, &queue_id->mutex,
+									 millisec == osWaitForever ? NULL : &plazo) == ETIMEDOUT) {
+			pthread_mutex_unlock(&queue_id->mutex);
+			return millisec ? osErrorTimeoutResource : osErrorResource;
+		}
+	}
+	queue_id->pDatos[(queue_id->lectura + queue_id->cuenta) % queue_id->largo] = info;
+	queue_id->cuenta++;
+	pthread_cond_signal(&queue_id->noVacia);
+	pthread_mutex_unlock(&queue_id->mutex);
+	return osOK;
+}
+
+osEvent osMessageGet(osMessageQId queue_id, uint32_t millisec)
+{
+	struct timespec plazo = PLAZO(millisec);
+	osEvent ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.def.message_id = queue_id;
+	if (queue_id == NULL) {
+		ev.status = osErrorParameter;
+		return ev;
+	}
+
+	pthread_mutex_lock(&queue_id->mutex);
+	while (queue_id->cuenta == 0) {
+		if (millisec == 0 || ESPERAR(&queue_id->noVacia, &queue_id->mutex,
+									 millisec == osWaitForever ? NULL : &plazo) == ETIMEDOUT) {
+			pthread_mutex_unlock(&queue_id->mutex);
+			ev.status = millisec ? osEventTimeout : osOK;
+			return ev;
+		}
+	}
+	ev.status = osEventMessage;
+	ev.value.v = queue_id->pDatos[queue_id->lectura];
+	queue_id->lectura = (queue_id->lectura + 1) % queue_id->largo;
+	queue_id->cuenta--;
+	pthread_cond_signal(&queue_id->noLlena);
+	pthread_mutex_unlock(&queue_id->mutex);
+	return ev;
+}
@@ -0,0 +1,235 @@
+/********************************************************************************
+  * @file    convCheck.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Verificacion en el host de las conversiones de muestras del
+  	  	  	 firmware (src/conv.c) contra una referencia en doble precision:
+  	  	  	 codigos de 12 bits, Q15 y Q31 hacia y desde float, con las
+  	  	  	 cuentas de saturacion. Las muestras son un barrido de todos los
+  	  	  	 codigos y de los puntos medios entre codigos (donde decide el
+  	  	  	 redondeo) mas muestras aleatorias de -2 a 2 fuera de escala.
+
+  	  	  	 Hacia los enteros la referencia redondea el valor exacto; en
+  	  	  	 float la suma del redondeo pierde bits, asi que un codigo
+  	  	  	 distinto solo se acepta a menos de una ulp de un empate (se
+  	  	  	 cuentan aparte). Las saturaciones deben coincidir una a una.
+
+  * COMPILACION:
+  	  *	gcc -O2 -I../src -o convCheck convCheck.c ../src/conv.c -lm
+
+  * USO:
+  	  *	convCheck [-n muestras aleatorias] [-s semilla]
+  	  	Sale con 1 si falla alguna verificacion.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "conv.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Muestras por bloque convertido:*/
+#define BLOQUE		1024
+
+/*Rango de las muestras aleatorias (fuera de escala en todos los formatos):*/
+#define RANGO		2.0
+
+/*Resultado de una conversion hacia enteros:*/
+typedef struct
+{
+	const char* pNombre;
+	long muestras;
+	long distintos;				/*Codigos distintos lejos de un empate.*/
+	long empates;				/*Codigos distintos a menos de una ulp de un empate.*/
+	long clipsRef;				/*Saturaciones de la referencia.*/
+	long clipsConv;				/*Saturaciones contadas por conv.c.*/
+	long clipsDistintos;		/*Muestras donde no coinciden.*/
+	double errorMax;			/*Error maximo fuera de los empates [LSB].*/
+} RESULTADO;
+
+/*------------------------------------------------------------------------------
+VARIABLES LOCALES:
+------------------------------------------------------------------------------*/
+static uint64_t semilla = 12345;
+static int fallas = 0;
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Uniforme en [-Rango, Rango) (xorshift64*):*/
+static float ALEATORIO(double Rango)
+{
+	semilla ^= semilla >> 12;
+	semilla ^= semilla << 25;
+	semilla ^= semilla >> 27;
+	uint64_t r = semilla * 2685821657736338717ull;
+	return (float)(((double)(r >> 11) / 9007199254740992.0 * 2.0 - 1.0) * Rango);
+}
+
+/*Compara un codigo con la referencia exacta Ref (antes de redondear):
+  Codigo y clip de conv.c contra el redondeo y la saturacion de Ref a
+  [Min, Max]. Ulp: resolucion de la suma de redondeo en float [LSB]:*/
+static void COMPARAR(RESULTADO* pRes, double Ref, double Min, double Max, double Ulp,
+					 double Codigo, uint32_t Clip, int HaciaCero)
+{
+	double r = HaciaCero ? trunc(Ref) : floor(Ref + 0.5);
+	double s = r < Min ? Min : r > Max ? Max : r;
+	int clipRef = (s != r);
+
+	pRes->muestras++;
+	pRes->clipsRef += clipRef;
+	pRes->clipsConv += Clip;
+	if ((uint32_t)clipRef != Clip) pRes->clipsDistintos++;
+
+	if (Codigo == s) return;
+	double frac = Ref - floor(Ref);
+	double aEmpate = HaciaCero ? fmin(frac, 1.0 - frac) : fabs(frac - 0.5);
+	if (aEmpate <= Ulp && fabs(Codigo - s) <= 1.0) {
+		pRes->empates++;
+		return;
+	}
+	pRes->distintos++;
+	if (fabs(Codigo - Ref) > pRes->errorMax) pRes->errorMax = fabs(Codigo - Ref);
+}
+
+static void INFORMAR(const RESULTADO* pRes)
+{
+	int ok = pRes->distintos == 0 && pRes->clipsDistintos == 0;
+
+	printf("%-10s %9ld muestras  %ld distintos  %ld empates  clips %ld/%ld (%ld distintos)%s\n",
+		   pRes->pNombre, pRes->muestras, pRes->distintos, pRes->empates,
+		   pRes->clipsConv, pRes->clipsRef, pRes->clipsDistintos, ok ? "" : "  FALLA");
+	if (pRes->distintos)
+		printf("           error maximo %.3f LSB\n", pRes->errorMax);
+	if (!ok) fallas++;
+}
+
+/*------------------------------------------------------------------------------
+PRUEBAS:
+------------------------------------------------------------------------------*/
+/*Enteros a float: exactos salvo Q31 (24 bits de mantisa, media ulp):*/
+static void PROBAR_A_FLOAT(void)
+{
+	static uint16_t i12[4096];
+	static int16_t q15[65536];
+	static float y[65536];
+	int32_t q31[BLOQUE];
+	long distintos = 0;
+	double errorQ31 = 0.0;
+
+	for (uint32_t k = 0; k < 4096; k++) i12[k] = (uint16_t)k;
+	CONV_I12_F32(i12, y, 4096);
+	for (uint32_t k = 0; k < 4096; k++) {
+		double ref = ((double)k - 2048.0) / 4096.0;
+		distintos += (y[k] != ref) + (CONV_I12_A_F32((int32_t)k) != ref);
+	}
+	printf("%-10s %9d codigos   %ld distintos (bloque y muestra a muestra)\n", "I12->F32", 4096, distintos);
+	if (distintos) fallas++;
+
+	distintos = 0;
+	for (uint32_t k = 0; k < 65536; k++) q15[k] = (int16_t)(k - 32768);
+	CONV_Q15_F32(q15, y, 65536);
+	for (uint32_t k = 0; k < 65536; k++)
+		distintos += (y[k] != (double)q15[k] / 32768.0);
+	printf("%-10s %9d codigos   %ld distintos\n", "Q15->F32", 65536, distintos);
+	if (distintos) fallas++;
+
+	for (uint32_t k = 0; k < BLOQUE; k++)
+		q31[k] = (int32_t)(ALEATORIO(1.0) * 2147483648.0);
+	q31[0] = INT32_MIN;
+	q31[1] = INT32_MAX;
+	CONV_Q31_F32(q31, y, BLOQUE);
+	for (uint32_t k = 0; k < BLOQUE; k++) {
+		double e = fabs(y[k] - (double)q31[k] / 2147483648.0);
+		if (e > errorQ31) errorQ31 = e;
+	}
+	printf("%-10s %9d muestras  error maximo %.3g (limite 2^-25)\n", "Q31->F32", BLOQUE, errorQ31);
+	if (errorQ31 > ldexp(1.0, -25)) fallas++;
+}
+
+/*Float a enteros: barrido de codigos y puntos medios, y aleatorias:*/
+static void PROBAR_DESDE_FLOAT(long Aleatorias)
+{
+	RESULTADO i12 = {.pNombre = "F32->I12"}, q15 = {.pNombre = "F32->Q15"}, q31 = {.pNombre = "F32->Q31"};
+	float x[BLOQUE];
+	uint16_t c12[BLOQUE];
+	int16_t c15[BLOQUE];
+	int32_t c31[BLOQUE];
+	long barrido = 4 * 4096 + 4 * 65536;
+	long total = barrido + Aleatorias;
+
+	for (long base = 0; base < total; base += BLOQUE) {
+		uint32_t n = (uint32_t)(total - base < BLOQUE ? total - base : BLOQUE);
+
+		/*Barrido: cada codigo y +-un cuarto y el medio hacia el siguiente,
+		  primero en la escala del DAC y despues en la de Q15:*/
+		for (uint32_t k = 0; k < n; k++) {
+			long m = base + k;
+			if (m < 4 * 4096)
+				x[k] = (float)(((double)(m / 4) - 2048.0 + 0.25 * (double)(m % 4)) / 4096.0);
+			else if (m < barrido)
+				x[k] = (float)(((double)((m - 4 * 4096) / 4) - 32768.0 + 0.25 * (double)(m % 4)) / 32768.0);
+			else
+				x[k] = ALEATORIO(RANGO);
+		}
+
+		/*Bloque y muestra a muestra deben dar lo mismo:*/
+		uint32_t clipBloque = CONV_F32_I12(x, c12, n), clipMuestra = 0;
+		for (uint32_t k = 0; k < n; k++) {
+			uint32_t clip = 0;
+			uint16_t c = CONV_F32_A_I12(x[k], &clip);
+			clipMuestra += clip;
+			if (c != c12[k]) i12.distintos++;
+			COMPARAR(&i12, (double)x[k] * 4096.0 + 2048.0, 0.0, 4095.0, ldexp(1.0, -10), c, clip, 0);
+		}
+		if (clipBloque != clipMuestra) i12.clipsDistintos++;
+
+		/*Q15: cada muestra por separado para tener su clip:*/
+		for (uint32_t k = 0; k < n; k++) {
+			uint32_t clip = CONV_F32_Q15(&x[k], &c15[k], 1);
+			COMPARAR(&q15, (double)x[k] * 32768.0, -32768.0, 32767.0, ldexp(1.0, -7), c15[k], clip, 0);
+		}
+
+		/*Q31: truncado, con x >= 1 y x < -1 saturados:*/
+		for (uint32_t k = 0; k < n; k++) {
+			uint32_t clip = CONV_F32_Q31(&x[k], &c31[k], 1);
+			COMPARAR(&q31, (double)x[k] * 2147483648.0, -2147483648.0, 2147483647.0, 0.0, c31[k], clip, 1);
+		}
+	}
+
+	INFORMAR(&i12);
+	INFORMAR(&q15);
+	INFORMAR(&q31);
+}
+
+/*------------------------------------------------------------------------------
+MAIN:
+------------------------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	long aleatorias = 2000000;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+		switch (opt) {
+		case 'n': aleatorias = atol(optarg); break;
+		case 's': semilla = strtoull(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "uso: convCheck [-n muestras aleatorias] [-s semilla]\n");
+			return 2;
+		}
+	}
+	if (semilla == 0) semilla = 1;
+
+	PROBAR_A_FLOAT();
+	PROBAR_DESDE_FLOAT(aleatorias);
+
+	printf("conv.c: %s\n", fallas ? "FALLA" : "ok");
+	return fallas ? 1 : 0;
+}
@@ -0,0 +1,11 @@
+/********************************************************************************
+  * @file    core_cm4_simd.h
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Intrinsics SIMD del Cortex-M4 para el firmware compilado en el
+  	  	  	 host (host/stm32Emu.c): el firmware no las usa, este header solo
+  	  	  	 reemplaza al de CMSIS, que es ensamblador ARM.
+********************************************************************************/
+#ifndef __CORE_CM4_SIMD_H
+#define __CORE_CM4_SIMD_H
+
+#endif /* __CORE_CM4_SIMD_H */
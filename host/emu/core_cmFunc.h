@@ -0,0 +1,47 @@
+/********************************************************************************
+  * @file    core_cmFunc.h
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Registros especiales del core (CMSIS) para el firmware compilado
+  	  	  	 en el host sobre el emulador de perifericos (host/stm32Emu.c).
+  	  	  	 PRIMASK y BASEPRI son del emulador, que los respeta al entregar
+  	  	  	 interrupciones; los stack pointers, CONTROL y FPSCR no tienen
+  	  	  	 equivalente y leen 0.
+********************************************************************************/
+#ifndef __CORE_CMFUNC_H
+#define __CORE_CMFUNC_H
+
+/*Mascaras e IPSR, en host/stm32Emu.c:*/
+void EMU_PRIMASK(uint32_t Valor);
+uint32_t EMU_GET_PRIMASK(void);
+void EMU_BASEPRI(uint32_t Valor);
+uint32_t EMU_GET_BASEPRI(void);
+uint32_t EMU_IPSR(void);
+
+static inline void __enable_irq(void)  { EMU_PRIMASK(0); }
+static inline void __disable_irq(void) { EMU_PRIMASK(1); }
+static inline uint32_t __get_PRIMASK(void) { return EMU_GET_PRIMASK(); }
+static inline void __set_PRIMASK(uint32_t priMask) { EMU_PRIMASK(priMask & 1); }
+
+/*FAULTMASK se trata como PRIMASK (no hay fallas emuladas):*/
+static inline void __enable_fault_irq(void)  { EMU_PRIMASK(0); }
+static inline void __disable_fault_irq(void) { EMU_PRIMASK(1); }
+static inline uint32_t __get_FAULTMASK(void) { return EMU_GET_PRIMASK(); }
+static inline void __set_FAULTMASK(uint32_t faultMask) { EMU_PRIMASK(faultMask & 1); }
+
+static inline uint32_t __get_BASEPRI(void) { return EMU_GET_BASEPRI(); }
+static inline void __set_BASEPRI(uint32_t basePri) { EMU_BASEPRI(basePri & 0xFF); }
+
+static inline uint32_t __get_IPSR(void) { return EMU_IPSR(); }
+static inline uint32_t __get_xPSR(void) { return EMU_IPSR(); }
+static inline uint32_t __get_APSR(void) { return 0; }
+
+static inline uint32_t __get_CONTROL(void) { return 0; }
+static inline void __set_CONTROL(uint32_t control) { (void)control; }
+static inline uint32_t __get_PSP(void) { return 0; }
+static inline void __set_PSP(uint32_t topOfProcStack) { (void)topOfProcStack; }
+static inline uint32_t __get_MSP(void) { return 0; }
+static inline void __set_MSP(uint32_t topOfMainStack) { (void)topOfMainStack; }
+static inline uint32_t __get_FPSCR(void) { return 0; }
+static inline void __set_FPSCR(uint32_t fpscr) { (void)fpscr; }
+
+#endif /* __CORE_CMFUNC_H */
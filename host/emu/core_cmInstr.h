@@ -0,0 +1,78 @@
+/********************************************************************************
+  * @file    core_cmInstr.h
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Instrucciones del core (CMSIS) para el firmware compilado en el
+  	  	  	 host sobre el emulador de perifericos (host/stm32Emu.c). Este
+  	  	  	 directorio va antes que Libraries/CMSIS/Include en la busqueda
+  	  	  	 de headers, asi core_cm4.h toma esta version en lugar del
+  	  	  	 ensamblador ARM. WFI/WFE duermen en tiempo virtual hasta la
+  	  	  	 proxima interrupcion; el resto son equivalentes en C.
+********************************************************************************/
+#ifndef __CORE_CMINSTR_H
+#define __CORE_CMINSTR_H
+
+/*Sueno del core, en host/stm32Emu.c:*/
+void EMU_WFI(void);
+
+/*Hints y barreras: en un solo hilo alcanza con la barrera del compilador:*/
+static inline void __NOP(void) { }
+static inline void __WFI(void) { EMU_WFI(); }
+static inline void __WFE(void) { EMU_WFI(); }
+static inline void __SEV(void) { }
+static inline void __ISB(void) { __atomic_signal_fence(__ATOMIC_SEQ_CST); }
+static inline void __DSB(void) { __atomic_signal_fence(__ATOMIC_SEQ_CST); }
+static inline void __DMB(void) { __atomic_signal_fence(__ATOMIC_SEQ_CST); }
+
+#define __BKPT(value)	__builtin_trap()
+
+/*Orden de bytes y bits:*/
+static inline uint32_t __REV(uint32_t value) { return __builtin_bswap32(value); }
+
+static inline uint32_t __REV16(uint32_t value)
+{
+	return ((value & 0xFF00FF00u) >> 8) | ((value & 0x00FF00FFu) << 8);
+}
+
+static inline int32_t __REVSH(int32_t value)
+{
+	return (int16_t)__builtin_bswap16((uint16_t)value);
+}
+
+static inline uint32_t __ROR(uint32_t op1, uint32_t op2)
+{
+	op2 &= 31;
+	return op2 ? (op1 >> op2) | (op1 << (32 - op2)) : op1;
+}
+
+static inline uint32_t __RBIT(uint32_t value)
+{
+	uint32_t r = 0;
+	for (int k = 0; k < 32; k++, value >>= 1) r = (r << 1) | (value & 1);
+	return r;
+}
+
+static inline uint8_t __CLZ(uint32_t value) { return value ? (uint8_t)__builtin_clz(value) : 32; }
+
+/*Acceso exclusivo: un solo core y sin interrupciones entre LDREX y STREX
+  que no pasen por el emulador, el monitor es un flag:*/
+static int emuMonitor;
+
+static inline uint8_t  __LDREXB(volatile uint8_t*  addr) { emuMonitor = 1; return *addr; }
+static inline uint16_t __LDREXH(volatile uint16_t* addr) { emuMonitor = 1; return *addr; }
+static inline uint32_t __LDREXW(volatile uint32_t* addr) { emuMonitor = 1; return *addr; }
+
+#define EMU_STREX(value, addr)	(emuMonitor ? (*(addr) = (value), emuMonitor = 0, 0u) : 1u)
+static inline uint32_t __STREXB(uint8_t  value, volatile uint8_t*  addr) { return EMU_STREX(value, addr); }
+static inline uint32_t __STREXH(uint16_t value, volatile uint16_t* addr) { return EMU_STREX(value, addr); }
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t* addr) { return EMU_STREX(value, addr); }
+static inline void __CLREX(void) { emuMonitor = 0; }
+
+/*Saturacion (bits constante, como en el core):*/
+#define __SSAT(ARG1, ARG2)	__extension__ ({											\
+	int32_t __x = (ARG1), __max = (int32_t)((1u << ((ARG2) - 1)) - 1);				\
+	__x > __max ? __max : __x < -__max - 1 ? -__max - 1 : __x; })
+#define __USAT(ARG1, ARG2)	__extension__ ({											\
+	int32_t __x = (ARG1), __max = (int32_t)((1u << (ARG2)) - 1);					\
+	(uint32_t)(__x > __max ? __max : __x < 0 ? 0 : __x); })
+
+#endif /* __CORE_CMINSTR_H */
@@ -0,0 +1,52 @@
+/* Definicion del header:*/
+#ifndef formato_H
+#define formato_H
+
+/* Librerias:*/
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "../src/conv.h"
+
+/*------------------------------------------------------------------------------
+FORMATOS DE LAS MUESTRAS CRUDAS (-b DE LAS HERRAMIENTAS DEL HOST):
+
+	u16		Codigos de 12 bits del ADC/DAC, centro 2048, a -0.5..0.5 con
+			CONV_I12_A_F32, como en ADC_PROCESSING.
+	i16		Q15 (el PCM de 16 bits de un WAV), a -1..1: x/32768.
+	f32		Float, sin cambios.
+
+	La misma escala en todas las herramientas, asi la salida f32 de una se
+	puede pasar a otra sin reescalar.
+------------------------------------------------------------------------------*/
+typedef enum { FMT_U16, FMT_I16, FMT_F32 } FORMATO;
+
+/*Nombre de -b a formato; 0 si no es ninguno:*/
+static inline int FORMATO_DECODIFICAR(const char* pNombre, FORMATO* pFormato)
+{
+	if      (!strcmp(pNombre, "u16")) *pFormato = FMT_U16;
+	else if (!strcmp(pNombre, "i16")) *pFormato = FMT_I16;
+	else if (!strcmp(pNombre, "f32")) *pFormato = FMT_F32;
+	else return 0;
+	return 1;
+}
+
+/*Bytes por muestra:*/
+static inline size_t FORMATO_BYTES(FORMATO Formato)
+{
+	return Formato == FMT_F32 ? 4 : 2;
+}
+
+/*Muestra i de un buffer del formato, normalizada. Con Formato constante
+  el switch desaparece:*/
+static inline float FORMATO_MUESTRA(const void* pDatos, FORMATO Formato, size_t i)
+{
+	switch (Formato) {
+	case FMT_U16: return CONV_I12_A_F32(((const uint16_t*)pDatos)[i]);
+	case FMT_I16: return (float)((const int16_t*)pDatos)[i] * CONV_Q15_INV;
+	default:      return ((const float*)pDatos)[i];
+	}
+}
+
+/* Cierre del header:*/
+#endif
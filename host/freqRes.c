@@ -0,0 +1,487 @@
+/********************************************************************************
+  * @file    freqRes.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Analizador de respuesta en frecuencia para capturas largas de
+  	  	  	 entrada y salida del filtro. Estima H1 = Pxy/Pxx o H2 = Pyy/Pyx
+  	  	  	 por promediado de Welch (Hann, 50% de solapamiento) repartiendo
+  	  	  	 los segmentos entre todos los nucleos. Las capturas se mapean en
+  	  	  	 memoria, sin copiar los datos binarios.
+
+  * SALIDA:
+  	  *	CSV con columnas Freq,V_i,V_o (mismo formato que scopeMeasure.csv),
+  	  	listo para python/freqRes.py.
+
+  * COMPILACION:
+  	  *	gcc -O3 -march=native -pthread -o freqRes freqRes.c captureRead.c -lm
+
+  * USO:
+  	  *	freqRes -i entrada.bin -o salida.bin [-b u16|i16|f32] [-k columna]
+  	  	        [-f fs] [-n nfft] [-t hilos] [-e h1|h2] [-w archivo.csv]
+  	  *	freqRes -c captura.bin [...]
+  	  	Archivos terminados en .csv se leen como texto (una muestra por
+  	  	linea, columna -k); el resto como binario crudo del tipo -b. Con -c
+  	  	se lee un stream de tramas CAPTURE_AMBAS de src/capture.h.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "captureRead.h"
+#include "formato.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+#define MAX_HILOS 256
+
+typedef struct { float re, im; } CPLX;
+
+/*Captura abierta: datos binarios mapeados o texto ya convertido a float:*/
+typedef struct
+{
+	const void* pDatos;
+	size_t      nMuestras;
+	FORMATO     formato;
+	void*       pMapa;
+	size_t      largoMapa;
+	float*      pTexto;
+} CAPTURA;
+
+/*Trabajo de cada hilo de Welch:*/
+typedef struct
+{
+	const CAPTURA* pIn;
+	const CAPTURA* pOut;
+	uint32_t nfft;
+	size_t   segIni;
+	size_t   segFin;
+	const float* pVentana;
+	const CPLX*  pTwiddle;
+	double* pXX;
+	double* pYY;
+	double* pXYre;
+	double* pXYim;
+} TRABAJO_WELCH;
+
+/*Trabajo de cada hilo de conversion de texto:*/
+typedef struct
+{
+	const char* pIni;
+	const char* pFin;
+	uint32_t columna;
+	float*   pDst;
+	size_t   nMuestras;
+} TRABAJO_CSV;
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+static void ERROR_FATAL(const char* pMsj, const char* pArg)
+{
+	fprintf(stderr, "freqRes: %s%s%s\n", pMsj, pArg ? " " : "", pArg ? pArg : "");
+	exit(1);
+}
+
+/*Muestra i de una captura, en la escala de formato.h (se cancela en H):*/
+static inline float MUESTRA(const CAPTURA* pCap, size_t i)
+{
+	if (pCap->pTexto) return pCap->pTexto[i];
+	return FORMATO_MUESTRA(pCap->pDatos, pCap->formato, i);
+}
+
+/*Conversion acotada de un numero decimal, sin depender de un '\0' final:*/
+static const char* PARSE_FLOAT(const char* p, const char* pFin, float* pValor, int* pOk)
+{
+	double mant = 0.0, frac = 0.1;
+	int signo = 1, exp = 0, signoExp = 1, digitos = 0;
+
+	if (p < pFin && (*p == '-' || *p == '+')) signo = (*p++ == '-') ? -1 : 1;
+	while (p < pFin && *p >= '0' && *p <= '9') { mant = mant * 10.0 + (*p++ - '0'); digitos++; }
+	if (p < pFin && *p == '.') {
+		p++;
+		while (p < pFin && *p >= '0' && *p <= '9') { mant += (*p++ - '0') * frac; frac *= 0.1; digitos++; }
+	}
+	if (digitos && p < pFin && (*p == 'e' || *p == 'E')) {
+		p++;
+		if (p < pFin && (*p == '-' || *p == '+')) signoExp = (*p++ == '-') ? -1 : 1;
+		while (p < pFin && *p >= '0' && *p <= '9') exp = exp * 10 + (*p++ - '0');
+	}
+
+	*pOk = digitos > 0;
+	*pValor = (float)(signo * mant * pow(10.0, signoExp * exp));
+	return p;
+}
+
+/*Recorre las lineas de [pIni, pFin): cuenta (pDst == NULL) o convierte:*/
+static size_t PARSE_LINEAS(const char* pIni, const char* pFin, uint32_t Columna, float* pDst)
+{
+	size_t n = 0;
+	const char* p = pIni;
+
+	while (p < pFin) {
+		const char* pEol = memchr(p, '\n', pFin - p);
+		if (!pEol) pEol = pFin;
+
+		/*Avanzar hasta la columna pedida:*/
+		uint32_t col = 0;
+		while (col < Columna && p < pEol) if (*p++ == ',') col++;
+		while (p < pEol && (*p == ' ' || *p == '\t')) p++;
+
+		float valor;
+		int ok;
+		PARSE_FLOAT(p, pEol, &valor, &ok);
+		if (ok && col == Columna) {
+			if (pDst) pDst[n] = valor;
+			n++;
+		}
+		p = pEol + 1;
+	}
+	return n;
+}
+
+static void* HILO_CSV_CONTAR(void* pArg)
+{
+	TRABAJO_CSV* t = pArg;
+	t->nMuestras = PARSE_LINEAS(t->pIni, t->pFin, t->columna, NULL);
+	return NULL;
+}
+
+static void* HILO_CSV_CONVERTIR(void* pArg)
+{
+	TRABAJO_CSV* t = pArg;
+	PARSE_LINEAS(t->pIni, t->pFin, t->columna, t->pDst);
+	return NULL;
+}
+
+/*Convierte un CSV mapeado en paralelo: cortes en limites de linea, conteo y
+  suma prefija de posiciones, y conversion de cada tramo en su lugar:*/
+static void CSV_A_FLOAT(CAPTURA* pCap, const char* pTexto, size_t Largo, uint32_t Columna, uint32_t nHilos)
+{
+	pthread_t   hilos[MAX_HILOS];
+	TRABAJO_CSV trabajos[MAX_HILOS];
+	const char* pFin = pTexto + Largo;
+	const char* p = pTexto;
+
+	for (uint32_t h = 0; h < nHilos; h++) {
+		const char* pCorte = (h == nHilos - 1) ? pFin : pTexto + Largo * (h + 1) / nHilos;
+		if (pCorte < p) pCorte = p;
+		const char* pEol = memchr(pCorte, '\n', pFin - pCorte);
+		pCorte = pEol ? pEol + 1 : pFin;
+
+		trabajos[h].pIni = p;
+		trabajos[h].pFin = pCorte;
+		trabajos[h].columna = Columna;
+		p = pCorte;
+		pthread_create(&hilos[h], NULL, HILO_CSV_CONTAR, &trabajos[h]);
+	}
+
+	size_t total = 0;
+	for (uint32_t h = 0; h < nHilos; h++) {
+		pthread_join(hilos[h], NULL);
+		total += trabajos[h].nMuestras;
+	}
+
+	pCap->pTexto = malloc((total ? total : 1) * sizeof(float));
+	if (!pCap->pTexto) ERROR_FATAL("sin memoria para el CSV", NULL);
+	pCap->nMuestras = total;
+
+	size_t offset = 0;
+	for (uint32_t h = 0; h < nHilos; h++) {
+		trabajos[h].pDst = pCap->pTexto + offset;
+		offset += trabajos[h].nMuestras;
+		pthread_create(&hilos[h], NULL, HILO_CSV_CONVERTIR, &trabajos[h]);
+	}
+	for (uint32_t h = 0; h < nHilos; h++) pthread_join(hilos[h], NULL);
+}
+
+static void CAPTURA_ABRIR(CAPTURA* pCap, const char* pRuta, FORMATO Formato, uint32_t Columna, uint32_t nHilos)
+{
+	struct stat st;
+	int fd = open(pRuta, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) < 0) ERROR_FATAL("no se puede abrir", pRuta);
+	if (st.st_size == 0) ERROR_FATAL("captura vacia:", pRuta);
+
+	memset(pCap, 0, sizeof(*pCap));
+	pCap->largoMapa = (size_t)st.st_size;
+	pCap->pMapa = mmap(NULL, pCap->largoMapa, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (pCap->pMapa == MAP_FAILED) ERROR_FATAL("mmap fallo para", pRuta);
+	madvise(pCap->pMapa, pCap->largoMapa, MADV_SEQUENTIAL);
+
+	size_t largoRuta = strlen(pRuta);
+	if (largoRuta > 4 && strcmp(pRuta + largoRuta - 4, ".csv") == 0) {
+		CSV_A_FLOAT(pCap, pCap->pMapa, pCap->largoMapa, Columna, nHilos);
+		munmap(pCap->pMapa, pCap->largoMapa);
+		pCap->pMapa = NULL;
+	} else {
+		pCap->formato = Formato;
+		pCap->pDatos = pCap->pMapa;
+		pCap->nMuestras = pCap->largoMapa / FORMATO_BYTES(Formato);
+	}
+}
+
+/*Stream de tramas con entrada y salida intercaladas: se separa en dos
+  capturas en memoria (las tramas perdidas solo se reportan):*/
+static void CAPTURA_STREAM_ABRIR(CAPTURA* pIn, CAPTURA* pOut, const char* pRuta)
+{
+	CAPTURE_READER rd;
+	CAPTURE_FRAME_VIEW frame;
+	size_t capacidad, n = 0;
+
+	if (CAPTURE_READER_OPEN(&rd, pRuta) < 0) ERROR_FATAL("no se puede abrir", pRuta);
+
+	memset(pIn, 0, sizeof(*pIn));
+	memset(pOut, 0, sizeof(*pOut));
+	capacidad = rd.largo * 2 / 3 / 2 + 1;
+	pIn->pTexto  = malloc(capacidad * sizeof(float));
+	pOut->pTexto = malloc(capacidad * sizeof(float));
+	if (!pIn->pTexto || !pOut->pTexto) ERROR_FATAL("sin memoria para la captura", NULL);
+
+	while (CAPTURE_READER_NEXT(&rd, &frame)) {
+		if (frame.tipo != CAPTURE_AMBAS) continue;
+		for (uint32_t k = 0; k + 1 < frame.nValores && n < capacidad; k += 2, n++) {
+			pIn->pTexto[n]  = CAPTURE_VALOR(&frame, k);
+			pOut->pTexto[n] = CAPTURE_VALOR(&frame, k + 1);
+		}
+	}
+	pIn->nMuestras = pOut->nMuestras = n;
+
+	fprintf(stderr, "freqRes: %u tramas, %u perdidas, %u errores de CRC\n",
+			rd.tramasOk, rd.tramasPerdidas, rd.erroresCrc);
+	CAPTURE_READER_CLOSE(&rd);
+}
+
+static void CAPTURA_CERRAR(CAPTURA* pCap)
+{
+	if (pCap->pMapa) munmap(pCap->pMapa, pCap->largoMapa);
+	free(pCap->pTexto);
+}
+
+/*FFT compleja radix-2 en el lugar, con twiddles precalculados:*/
+static void FFT(CPLX* x, uint32_t N, const CPLX* pTw)
+{
+	for (uint32_t i = 1, j = 0; i < N; i++) {
+		uint32_t bit = N >> 1;
+		for (; j & bit; bit >>= 1) j ^= bit;
+		j ^= bit;
+		if (i < j) { CPLX t = x[i]; x[i] = x[j]; x[j] = t; }
+	}
+
+	for (uint32_t len = 2; len <= N; len <<= 1) {
+		uint32_t paso = N / len;
+		for (uint32_t i = 0; i < N; i += len) {
+			for (uint32_t k = 0; k < len / 2; k++) {
+				CPLX w = pTw[k * paso];
+				CPLX a = x[i + k];
+				CPLX b = x[i + k + len / 2];
+				CPLX t = { b.re * w.re - b.im * w.im, b.re * w.im + b.im * w.re };
+				x[i + k]           = (CPLX){ a.re + t.re, a.im + t.im };
+				x[i + k + len / 2] = (CPLX){ a.re - t.re, a.im - t.im };
+			}
+		}
+	}
+}
+
+/*Welch sobre los segmentos [segIni, segFin): la entrada va en la parte real y
+  la salida en la imaginaria, asi una sola FFT entrega ambos espectros:*/
+static void* HILO_WELCH(void* pArg)
+{
+	TRABAJO_WELCH* t = pArg;
+	uint32_t N = t->nfft;
+	uint32_t nBins = N / 2 + 1;
+	CPLX* z = malloc(N * sizeof(CPLX));
+	if (!z) ERROR_FATAL("sin memoria para la FFT", NULL);
+
+	for (size_t s = t->segIni; s < t->segFin; s++) {
+		size_t base = s * (N / 2);
+
+		/*Valor medio del segmento, para no volcar la continua en los bins bajos:*/
+		double mx = 0.0, my = 0.0;
+		for (uint32_t i = 0; i < N; i++) {
+			mx += MUESTRA(t->pIn,  base + i);
+			my += MUESTRA(t->pOut, base + i);
+		}
+		mx /= N;
+		my /= N;
+
+		for (uint32_t i = 0; i < N; i++) {
+			z[i].re = (MUESTRA(t->pIn,  base + i) - (float)mx) * t->pVentana[i];
+			z[i].im = (MUESTRA(t->pOut, base + i) - (float)my) * t->pVentana[i];
+		}
+		FFT(z, N, t->pTwiddle);
+
+		/*Separacion: X(k) = (Z(k) + Z*(N-k))/2, Y(k) = (Z(k) - Z*(N-k))/2j:*/
+		for (uint32_t k = 0; k < nBins; k++) {
+			CPLX a = z[k];
+			CPLX b = z[(N - k) & (N - 1)];
+			double xr = 0.5 * (a.re + b.re), xi = 0.5 * (a.im - b.im);
+			double yr = 0.5 * (a.im + b.im), yi = 0.5 * (b.re - a.re);
+
+			t->pXX[k]   += xr * xr + xi * xi;
+			t->pYY[k]   += yr * yr + yi * yi;
+			t->pXYre[k] += xr * yr + xi * yi;		/*conj(X)*Y*/
+			t->pXYim[k] += xr * yi - xi * yr;
+		}
+	}
+
+	free(z);
+	return NULL;
+}
+
+static void USO(void)
+{
+	fprintf(stderr,
+		"uso: freqRes -i entrada -o salida [-b u16|i16|f32] [-k columna]\n"
+		"     freqRes -c captura.bin\n"
+		"               [-f fs] [-n nfft] [-t hilos] [-e h1|h2] [-w archivo.csv]\n");
+	exit(2);
+}
+
+/*------------------------------------------------------------------------------
+MAIN:
+------------------------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	const char* pRutaIn = NULL;
+	const char* pRutaOut = NULL;
+	const char* pRutaCsv = NULL;
+	const char* pRutaStream = NULL;
+	FORMATO formato = FMT_U16;
+	uint32_t columna = 0;
+	double fs = 20000.0;
+	uint32_t nfft = 4096;
+	uint32_t nHilos = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+	int usarH2 = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "i:o:c:b:k:f:n:t:e:w:")) != -1) {
+		switch (opt) {
+		case 'i': pRutaIn = optarg; break;
+		case 'o': pRutaOut = optarg; break;
+		case 'c': pRutaStream = optarg; break;
+		case 'b':
+			if (!FORMATO_DECODIFICAR(optarg, &formato)) USO();
+			break;
+		case 'k': columna = (uint32_t)atoi(optarg); break;
+		case 'f': fs = atof(optarg); break;
+		case 'n': nfft = (uint32_t)atoi(optarg); break;
+		case 't': nHilos = (uint32_t)atoi(optarg); break;
+		case 'e':
+			if      (!strcmp(optarg, "h1")) usarH2 = 0;
+			else if (!strcmp(optarg, "h2")) usarH2 = 1;
+			else USO();
+			break;
+		case 'w': pRutaCsv = optarg; break;
+		default: USO();
+		}
+	}
+	if ((!pRutaStream && (!pRutaIn || !pRutaOut)) || fs <= 0.0) USO();
+	if (nfft < 16 || (nfft & (nfft - 1))) ERROR_FATAL("nfft debe ser potencia de 2 >= 16", NULL);
+	if (nHilos < 1) nHilos = 1;
+	if (nHilos > MAX_HILOS) nHilos = MAX_HILOS;
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	/*Apertura de las capturas:*/
+	CAPTURA capIn, capOut;
+	if (pRutaStream) {
+		CAPTURA_STREAM_ABRIR(&capIn, &capOut, pRutaStream);
+	} else {
+		CAPTURA_ABRIR(&capIn,  pRutaIn,  formato, columna, nHilos);
+		CAPTURA_ABRIR(&capOut, pRutaOut, formato, columna, nHilos);
+	}
+
+	size_t nMuestras = capIn.nMuestras < capOut.nMuestras ? capIn.nMuestras : capOut.nMuestras;
+	if (nMuestras < nfft) ERROR_FATAL("captura mas corta que nfft", NULL);
+	size_t nSeg = (nMuestras - nfft) / (nfft / 2) + 1;
+	if (nHilos > nSeg) nHilos = (uint32_t)nSeg;
+
+	/*Ventana de Hann y twiddles:*/
+	float* pVentana = malloc(nfft * sizeof(float));
+	CPLX*  pTwiddle = malloc(nfft / 2 * sizeof(CPLX));
+	double sumaVentana = 0.0;
+	for (uint32_t i = 0; i < nfft; i++) {
+		pVentana[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / nfft));
+		sumaVentana += pVentana[i];
+	}
+	for (uint32_t k = 0; k < nfft / 2; k++)
+		pTwiddle[k] = (CPLX){ (float)cos(-2.0 * M_PI * k / nfft), (float)sin(-2.0 * M_PI * k / nfft) };
+
+	/*Reparto de segmentos entre hilos, cada uno con sus acumuladores:*/
+	uint32_t nBins = nfft / 2 + 1;
+	pthread_t hilos[MAX_HILOS];
+	TRABAJO_WELCH trabajos[MAX_HILOS];
+	double* pAcum = calloc((size_t)nHilos * 4 * nBins, sizeof(double));
+	if (!pVentana || !pTwiddle || !pAcum) ERROR_FATAL("sin memoria", NULL);
+
+	for (uint32_t h = 0; h < nHilos; h++) {
+		TRABAJO_WELCH* t = &trabajos[h];
+		t->pIn = &capIn;
+		t->pOut = &capOut;
+		t->nfft = nfft;
+		t->segIni = nSeg * h / nHilos;
+		t->segFin = nSeg * (h + 1) / nHilos;
+		t->pVentana = pVentana;
+		t->pTwiddle = pTwiddle;
+		t->pXX   = pAcum + ((size_t)h * 4 + 0) * nBins;
+		t->pYY   = pAcum + ((size_t)h * 4 + 1) * nBins;
+		t->pXYre = pAcum + ((size_t)h * 4 + 2) * nBins;
+		t->pXYim = pAcum + ((size_t)h * 4 + 3) * nBins;
+		pthread_create(&hilos[h], NULL, HILO_WELCH, t);
+	}
+	for (uint32_t h = 0; h < nHilos; h++) pthread_join(hilos[h], NULL);
+
+	/*Reduccion de los acumuladores de todos los hilos en los del hilo 0:*/
+	for (uint32_t h = 1; h < nHilos; h++)
+		for (uint32_t k = 0; k < nBins; k++) {
+			trabajos[0].pXX[k]   += trabajos[h].pXX[k];
+			trabajos[0].pYY[k]   += trabajos[h].pYY[k];
+			trabajos[0].pXYre[k] += trabajos[h].pXYre[k];
+			trabajos[0].pXYim[k] += trabajos[h].pXYim[k];
+		}
+
+	/*Salida: V_i es la amplitud de entrada por bin y V_o = |H|*V_i, asi
+	  V_o/V_i reproduce el estimador elegido:*/
+	FILE* pCsv = pRutaCsv ? fopen(pRutaCsv, "w") : stdout;
+	if (!pCsv) ERROR_FATAL("no se puede escribir", pRutaCsv);
+	fprintf(pCsv, "Freq,V_i,V_o\n");
+
+	for (uint32_t k = 1; k < nBins; k++) {
+		double pxx = trabajos[0].pXX[k] / nSeg;
+		double pyy = trabajos[0].pYY[k] / nSeg;
+		double pxy = hypot(trabajos[0].pXYre[k], trabajos[0].pXYim[k]) / nSeg;
+		double mag;
+
+		if (pxx <= 0.0 || pxy <= 0.0) continue;
+		mag = usarH2 ? pyy / pxy : pxy / pxx;
+
+		double vi = 2.0 * sqrt(pxx) / sumaVentana;
+		fprintf(pCsv, "%.6g,%.9g,%.9g\n", k * fs / nfft, vi, mag * vi);
+	}
+	if (pCsv != stdout) fclose(pCsv);
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	double seg = (t1.tv_sec - t0.tv_sec) + 1e-9 * (t1.tv_nsec - t0.tv_nsec);
+	fprintf(stderr, "freqRes: %zu muestras, %zu segmentos, %u hilos, %.3f s (%.1f Mmuestras/s)\n",
+			nMuestras, nSeg, nHilos, seg, nMuestras / seg / 1e6);
+
+	free(pAcum);
+	free(pTwiddle);
+	free(pVentana);
+	CAPTURA_CERRAR(&capIn);
+	CAPTURA_CERRAR(&capOut);
+	return 0;
+}
@@ -0,0 +1,169 @@
+/********************************************************************************
+  * @file    hilosLoad.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Prueba de carga en el host de la cadena en hilos del firmware
+  	  	  	 (src/hilos.c) sobre el port pthreads de CMSIS-RTOS. Un hilo
+  	  	  	 hace de timer y despierta al DSP a Fs (o x veces Fs para
+  	  	  	 buscar el limite); la entrada es un tono util mas el
+  	  	  	 interferente en fs/4. Informa muestras perdidas por el DSP,
+  	  	  	 descartes de cada cola, latencia del disparo a la lectura y el
+  	  	  	 rechazo que midio el hilo de espectro.
+
+  * COMPILACION:
+  	  *	gcc -O2 -pthread -I../src -I../Libraries/CMSIS/RTOS -o hilosLoad
+  	  	    hilosLoad.c cmsis_os_posix.c ../src/hilos.c ../src/filtro.c
+  	  	    ../src/iir.c ../src/iirpar.c ../src/notch.c ../src/coef.c
+  	  	    ../src/goertzel.c ../src/capture.c ../src/conv.c -lm
+
+  * USO:
+  	  *	hilosLoad [-f fs] [-t segundos] [-x aceleracion] [-o captura.bin]
+  	  	Con -o las tramas de telemetria se escriben en el archivo (leible
+  	  	con captureRead); sin -o se descartan pero el hilo corre igual.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "hilos.h"
+#include "capture.h"
+
+/*------------------------------------------------------------------------------
+VARIABLES LOCALES:
+------------------------------------------------------------------------------*/
+static double fs = 20000.0;
+static double aceleracion = 1.0;
+static volatile int corriendo = 1;
+static FILE* pCaptura = NULL;
+
+/*Disparos del timer y latencia disparo -> lectura [ticks de 10 ns]:*/
+static volatile uint32_t disparos = 0;
+static volatile uint32_t tickDisparo = 0;
+static uint64_t latenciaSuma = 0;
+static uint32_t latenciaMax = 0;
+static uint32_t lecturas = 0;
+static uint64_t bytesTelemetria = 0;
+
+/*------------------------------------------------------------------------------
+ACCESO AL "HARDWARE":
+------------------------------------------------------------------------------*/
+static float LEER(void)
+{
+	uint32_t latencia = osKernelSysTick() - tickDisparo;
+	double n = (double)lecturas++;
+
+	latenciaSuma += latencia;
+	if (latencia > latenciaMax) latenciaMax = latencia;
+
+	/*Tono util en fs/20 e interferente en fs/4:*/
+	return (float)(0.15 * sin(2.0 * M_PI * n / 20.0) + 0.15 * sin(2.0 * M_PI * n / 4.0));
+}
+
+static void ESCRIBIR(float Muestra)
+{
+	(void)Muestra;
+}
+
+static uint8_t ENVIAR(const void* pFrame, uint32_t nBytes)
+{
+	bytesTelemetria += nBytes;
+	if (pCaptura) fwrite(pFrame, 1, nBytes, pCaptura);
+	return 1;
+}
+
+/*Timer de muestreo con plazos absolutos, como el TIM3:*/
+static void* TIMER(void* pArg)
+{
+	struct timespec t;
+	long periodo = (long)(1e9 / (fs * aceleracion));
+	(void)pArg;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	while (corriendo) {
+		t.tv_nsec += periodo;
+		while (t.tv_nsec >= 1000000000L) {
+			t.tv_sec++;
+			t.tv_nsec -= 1000000000L;
+		}
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL) == EINTR);
+
+		tickDisparo = osKernelSysTick();
+		disparos++;
+		HILOS_MUESTRA();
+	}
+	return NULL;
+}
+
+static void USO(void)
+{
+	fprintf(stderr, "uso: hilosLoad [-f fs] [-t segundos] [-x aceleracion] [-o captura.bin]\n");
+	exit(2);
+}
+
+/*------------------------------------------------------------------------------
+MAIN:
+------------------------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	double segundos = 5.0;
+	const char* pRutaOut = NULL;
+	pthread_t timer;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:t:x:o:")) != -1) {
+		switch (opt) {
+		case 'f': fs = atof(optarg); break;
+		case 't': segundos = atof(optarg); break;
+		case 'x': aceleracion = atof(optarg); break;
+		case 'o': pRutaOut = optarg; break;
+		default: USO();
+		}
+	}
+	if (fs <= 0.0 || segundos <= 0.0 || aceleracion <= 0.0) USO();
+
+	if (pRutaOut) {
+		pCaptura = fopen(pRutaOut, "wb");
+		if (!pCaptura) {
+			fprintf(stderr, "hilosLoad: no se puede crear %s\n", pRutaOut);
+			return 1;
+		}
+	}
+
+	HILOS_IO io = {LEER, ESCRIBIR, ENVIAR, NULL, CAPTURE_AMBAS, (float)fs};
+
+	osKernelInitialize();
+	if (HILOS_INIT(&io) != osOK) {
+		fprintf(stderr, "hilosLoad: no se pudieron crear los hilos\n");
+		return 1;
+	}
+	osKernelStart();
+
+	pthread_create(&timer, NULL, TIMER, NULL);
+	osDelay((uint32_t)(segundos * 1000.0));
+	corriendo = 0;
+	pthread_join(timer, NULL);
+	osDelay(50);
+
+	uint32_t procesadas = hilosEstado.muestras;
+	printf("fs %.0f Hz x%.2f, %.1f s\n", fs, aceleracion, segundos);
+	printf("disparos         %u\n", disparos);
+	printf("procesadas       %u (%u perdidas, %.3f %%)\n", procesadas, disparos - procesadas,
+		   disparos ? 100.0 * (disparos - procesadas) / disparos : 0.0);
+	printf("colas llenas     espectro %u  telemetria %u  control %u\n",
+		   hilosEstado.perdidasEspectro, hilosEstado.perdidasTelemetria, hilosEstado.perdidasControl);
+	printf("latencia         media %.1f us  max %.1f us\n",
+		   lecturas ? latenciaSuma / (double)lecturas / 100.0 : 0.0, latenciaMax / 100.0);
+	printf("espectro         %u bloques, rechazo %.1f dB\n", hilosEstado.bloques, hilosEstado.rechazoDb);
+	printf("telemetria       %llu bytes (%.0f bytes/s)\n", (unsigned long long)bytesTelemetria,
+		   bytesTelemetria / segundos);
+
+	if (pCaptura) fclose(pCaptura);
+	return 0;
+}
@@ -0,0 +1,352 @@
+/********************************************************************************
+  * @file    iirBatch.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Refiltrado por lotes de un directorio de capturas con el
+  	  	  	 elimina banda del firmware (coef_sos). Las capturas se agrupan
+  	  	  	 de a nCanales y cada grupo se filtra intercalado con
+  	  	  	 SOS_MULTI_F32 (AVX-512, AVX2 o escalar segun el CPU); los grupos
+  	  	  	 se reparten entre los hilos a medida que se liberan.
+
+  * SALIDA:
+  	  *	Un binario f32 por captura en el directorio de salida, con el mismo
+  	  	nombre mas ".f32" (legible con freqRes -b f32).
+
+  * COMPILACION:
+  	  *	gcc -O3 -pthread -I../src -o iirBatch iirBatch.c sosMulti.c
+  	  	    ../src/iir.c ../src/coef.c -lm
+
+  * USO:
+  	  *	iirBatch -d entrada/ -o salida/ [-b u16|i16|f32] [-t hilos]
+  	  	         [-c canales] [-e escalar|avx2|avx512] [-v]
+  	  	Escalas de -b en formato.h (u16 codigos del ADC como en
+  	  	ADC_PROCESSING, i16 Q15). -e fuerza una implementacion y -v compara cada
+  	  	salida contra IIR_SOS_F32 escalar.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <dirent.h>
+#include <fcntl.h>
+#include <immintrin.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "coef.h"
+#include "formato.h"
+#include "iir.h"
+#include "sosMulti.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+#define MAX_HILOS		256
+#define MAX_CANALES		64
+
+/*Muestras por canal de cada bloque intercalado:*/
+#define BLOQUE			1024
+
+
+/*Captura de entrada mapeada y su salida:*/
+typedef struct
+{
+	char*  pNombre;
+	const void* pEntrada;
+	size_t largoEntrada;
+	float* pSalida;
+	size_t nMuestras;
+} ARCHIVO;
+
+/*Lote completo, compartido por los hilos:*/
+typedef struct
+{
+	ARCHIVO* pArchivos;
+	uint32_t nArchivos;
+	uint32_t nCanales;
+	FORMATO  formato;
+	uint32_t proximoGrupo;						/*Cola de trabajo (atomica).*/
+} LOTE;
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+static void ERROR_FATAL(const char* pMsj, const char* pArg)
+{
+	fprintf(stderr, "iirBatch: %s%s%s\n", pMsj, pArg ? " " : "", pArg ? pArg : "");
+	exit(1);
+}
+
+static double AHORA(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+/*Muestra i convertida como en ADC_PROCESSING:*/
+static inline float MUESTRA(const ARCHIVO* pArch, FORMATO Formato, size_t i)
+{
+	return FORMATO_MUESTRA(pArch->pEntrada, Formato, i);
+}
+
+/*Copia n muestras desde k0 a pDst con paso Paso, completando con ceros lo
+  que queda fuera de la captura. El switch queda fuera del lazo:*/
+static void CONVERTIR(const ARCHIVO* pArch, FORMATO Formato, size_t k0, uint32_t n, float* pDst, uint32_t Paso)
+{
+	uint32_t nValidas = 0;
+	uint32_t k;
+
+	if (pArch && k0 < pArch->nMuestras)
+		nValidas = pArch->nMuestras - k0 < n ? (uint32_t)(pArch->nMuestras - k0) : n;
+
+	if (nValidas) switch (Formato) {
+	case FMT_U16:
+		for (k = 0; k < nValidas; k++) pDst[k * Paso] = FORMATO_MUESTRA(pArch->pEntrada, FMT_U16, k0 + k);
+		break;
+	case FMT_I16:
+		for (k = 0; k < nValidas; k++) pDst[k * Paso] = FORMATO_MUESTRA(pArch->pEntrada, FMT_I16, k0 + k);
+		break;
+	default:
+		for (k = 0; k < nValidas; k++) pDst[k * Paso] = FORMATO_MUESTRA(pArch->pEntrada, FMT_F32, k0 + k);
+		break;
+	}
+	for (k = nValidas; k < n; k++) pDst[k * Paso] = 0.0f;
+}
+
+static int COMPARAR_NOMBRES(const void* a, const void* b)
+{
+	return strcmp(((const ARCHIVO*)a)->pNombre, ((const ARCHIVO*)b)->pNombre);
+}
+
+/*Lista los archivos regulares del directorio, ordenados por nombre:*/
+static uint32_t LISTAR(const char* pDir, ARCHIVO** ppArchivos)
+{
+	DIR* d = opendir(pDir);
+	struct dirent* e;
+	uint32_t n = 0, cap = 64;
+	ARCHIVO* p = malloc(cap * sizeof(ARCHIVO));
+
+	if (!d) ERROR_FATAL("no se puede abrir", pDir);
+	if (!p) ERROR_FATAL("sin memoria", NULL);
+
+	while ((e = readdir(d)) != NULL) {
+		char ruta[4096];
+		struct stat st;
+
+		snprintf(ruta, sizeof(ruta), "%s/%s", pDir, e->d_name);
+		if (stat(ruta, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0) continue;
+
+		if (n == cap) {
+			cap *= 2;
+			p = realloc(p, cap * sizeof(ARCHIVO));
+			if (!p) ERROR_FATAL("sin memoria", NULL);
+		}
+		memset(&p[n], 0, sizeof(ARCHIVO));
+		p[n++].pNombre = strdup(e->d_name);
+	}
+	closedir(d);
+
+	qsort(p, n, sizeof(ARCHIVO), COMPARAR_NOMBRES);
+	*ppArchivos = p;
+	return n;
+}
+
+/*Mapea la entrada y crea la salida del mismo largo, tambien mapeada:*/
+static void ABRIR(ARCHIVO* pArch, const char* pDirIn, const char* pDirOut, FORMATO Formato)
+{
+	char ruta[4096];
+	struct stat st;
+	size_t tamMuestra = FORMATO_BYTES(Formato);
+
+	snprintf(ruta, sizeof(ruta), "%s/%s", pDirIn, pArch->pNombre);
+	int fd = open(ruta, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) ERROR_FATAL("no se puede abrir", ruta);
+	pArch->largoEntrada = (size_t)st.st_size;
+	pArch->nMuestras = pArch->largoEntrada / tamMuestra;
+	pArch->pEntrada = mmap(NULL, pArch->largoEntrada, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (pArch->pEntrada == MAP_FAILED) ERROR_FATAL("no se puede mapear", ruta);
+	close(fd);
+
+	snprintf(ruta, sizeof(ruta), "%s/%s.f32", pDirOut, pArch->pNombre);
+	size_t tamOut = pArch->nMuestras * sizeof(float);
+	fd = open(ruta, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 || ftruncate(fd, (off_t)tamOut) < 0) ERROR_FATAL("no se puede escribir", ruta);
+	pArch->pSalida = tamOut ? mmap(NULL, tamOut, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : NULL;
+	if (pArch->pSalida == MAP_FAILED) ERROR_FATAL("no se puede mapear", ruta);
+	close(fd);
+}
+
+static void CERRAR(ARCHIVO* pArch)
+{
+	munmap((void*)pArch->pEntrada, pArch->largoEntrada);
+	if (pArch->pSalida) munmap(pArch->pSalida, pArch->nMuestras * sizeof(float));
+	free(pArch->pNombre);
+}
+
+/*Cada hilo toma grupos de nCanales capturas hasta agotar la cola:*/
+static void* HILO_LOTE(void* pArg)
+{
+	LOTE* pLote = pArg;
+	uint32_t nC = pLote->nCanales;
+	float* pBloque = malloc((size_t)BLOQUE * nC * sizeof(float));
+	float* pState = malloc(2 * COEF_SECCIONES * nC * sizeof(float));
+	SOS_MULTI_F32_INST sos;
+
+	if (!pBloque || !pState) ERROR_FATAL("sin memoria", NULL);
+
+	/*Los canales de relleno y las colas de cada captura decaen hacia cero:
+	  sin flush-to-zero los subnormales multiplican el tiempo por ~10:*/
+	_mm_setcsr(_mm_getcsr() | 0x8040);
+
+	for (;;) {
+		uint32_t g = __atomic_fetch_add(&pLote->proximoGrupo, 1, __ATOMIC_RELAXED);
+		uint32_t a0 = g * nC;
+		if (a0 >= pLote->nArchivos) break;
+
+		ARCHIVO* pGrupo = &pLote->pArchivos[a0];
+		uint32_t nArch = pLote->nArchivos - a0 < nC ? pLote->nArchivos - a0 : nC;
+		size_t nMax = 0;
+		for (uint32_t c = 0; c < nArch; c++)
+			if (pGrupo[c].nMuestras > nMax) nMax = pGrupo[c].nMuestras;
+
+		SOS_MULTI_F32_INIT(&sos, COEF_SECCIONES, nC, coef_sos, pState);
+
+		for (size_t k0 = 0; k0 < nMax; k0 += BLOQUE) {
+			uint32_t n = k0 + BLOQUE < nMax ? BLOQUE : (uint32_t)(nMax - k0);
+
+			/*Intercalado: los canales sin captura o ya terminados van en cero:*/
+			for (uint32_t c = 0; c < nC; c++)
+				CONVERTIR(c < nArch ? &pGrupo[c] : NULL, pLote->formato, k0, n, &pBloque[c], nC);
+
+			SOS_MULTI_F32(&sos, pBloque, pBloque, n);
+
+			for (uint32_t c = 0; c < nArch; c++) {
+				ARCHIVO* pA = &pGrupo[c];
+				if (k0 >= pA->nMuestras) continue;
+				uint32_t nValidas = pA->nMuestras - k0 < n ? (uint32_t)(pA->nMuestras - k0) : n;
+				float* pOut = pA->pSalida + k0;
+				for (uint32_t k = 0; k < nValidas; k++) pOut[k] = pBloque[k * nC + c];
+			}
+		}
+	}
+
+	free(pBloque);
+	free(pState);
+	return NULL;
+}
+
+/*Maximo error de una salida contra IIR_SOS_F32 escalar:*/
+static double ERROR_ESCALAR(const ARCHIVO* pArch, FORMATO Formato)
+{
+	float state[2 * COEF_SECCIONES];
+	IIR_SOS_F32_INST sos;
+	float bloque[BLOQUE];
+	double error = 0.0;
+
+	IIR_SOS_F32_INIT(&sos, COEF_SECCIONES, coef_sos, state);
+	for (size_t k0 = 0; k0 < pArch->nMuestras; k0 += BLOQUE) {
+		size_t n = k0 + BLOQUE < pArch->nMuestras ? BLOQUE : pArch->nMuestras - k0;
+		for (size_t k = 0; k < n; k++) bloque[k] = MUESTRA(pArch, Formato, k0 + k);
+		IIR_SOS_F32(&sos, bloque, bloque, (uint32_t)n);
+		for (size_t k = 0; k < n; k++) {
+			double e = fabs((double)bloque[k] - pArch->pSalida[k0 + k]);
+			if (e > error) error = e;
+		}
+	}
+	return error;
+}
+
+static void USO(void)
+{
+	fprintf(stderr,
+		"uso: iirBatch -d entrada/ -o salida/ [-b u16|i16|f32] [-t hilos]\n"
+		"              [-c canales] [-e escalar|avx2|avx512] [-v]\n");
+	exit(2);
+}
+
+/*------------------------------------------------------------------------------
+MAIN:
+------------------------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	const char* pDirIn = NULL;
+	const char* pDirOut = NULL;
+	uint32_t nHilos = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t nCanales = 0;
+	int verificar = 0;
+	int opt;
+	LOTE lote = { .formato = FMT_U16 };
+
+	while ((opt = getopt(argc, argv, "d:o:b:t:c:e:v")) != -1) {
+		switch (opt) {
+		case 'd': pDirIn = optarg; break;
+		case 'o': pDirOut = optarg; break;
+		case 'b':
+			if (!FORMATO_DECODIFICAR(optarg, &lote.formato)) USO();
+			break;
+		case 't': nHilos = (uint32_t)atoi(optarg); break;
+		case 'c': nCanales = (uint32_t)atoi(optarg); break;
+		case 'e':
+			if      (!strcmp(optarg, "escalar")) SOS_MULTI_FORZAR(SOS_MULTI_ESCALAR);
+			else if (!strcmp(optarg, "avx2"))    SOS_MULTI_FORZAR(SOS_MULTI_AVX2);
+			else if (!strcmp(optarg, "avx512"))  SOS_MULTI_FORZAR(SOS_MULTI_AVX512);
+			else USO();
+			break;
+		case 'v': verificar = 1; break;
+		default: USO();
+		}
+	}
+	if (!pDirIn || !pDirOut) USO();
+	if (nHilos < 1) nHilos = 1;
+	if (nHilos > MAX_HILOS) nHilos = MAX_HILOS;
+
+	/*Por defecto, dos registros vectoriales por grupo (oculta la latencia
+	  de la cadena y*d1 de cada seccion):*/
+	if (!nCanales) nCanales = 2 * SOS_MULTI_ANCHO();
+	if (nCanales > MAX_CANALES) nCanales = MAX_CANALES;
+
+	lote.nCanales = nCanales;
+	lote.nArchivos = LISTAR(pDirIn, &lote.pArchivos);
+	if (!lote.nArchivos) ERROR_FATAL("directorio sin capturas", pDirIn);
+	mkdir(pDirOut, 0755);
+
+	size_t nTotal = 0;
+	for (uint32_t a = 0; a < lote.nArchivos; a++) {
+		ABRIR(&lote.pArchivos[a], pDirIn, pDirOut, lote.formato);
+		nTotal += lote.pArchivos[a].nMuestras;
+	}
+
+	uint32_t nGrupos = (lote.nArchivos + nCanales - 1) / nCanales;
+	if (nHilos > nGrupos) nHilos = nGrupos;
+
+	double t0 = AHORA();
+	pthread_t hilos[MAX_HILOS];
+	for (uint32_t h = 0; h < nHilos; h++) pthread_create(&hilos[h], NULL, HILO_LOTE, &lote);
+	for (uint32_t h = 0; h < nHilos; h++) pthread_join(hilos[h], NULL);
+	double t = AHORA() - t0;
+
+	fprintf(stderr, "%u capturas, %zu muestras en %.3f s (%.1f Mmuestras/s)\n",
+			lote.nArchivos, nTotal, t, nTotal / t * 1e-6);
+	fprintf(stderr, "%u hilos, grupos de %u canales, %u canales por instruccion\n",
+			nHilos, nCanales, SOS_MULTI_ANCHO());
+
+	if (verificar) {
+		double error = 0.0;
+		for (uint32_t a = 0; a < lote.nArchivos; a++) {
+			double e = ERROR_ESCALAR(&lote.pArchivos[a], lote.formato);
+			if (e > error) error = e;
+		}
+		fprintf(stderr, "error maximo contra IIR_SOS_F32 escalar: %.2e\n", error);
+	}
+
+	for (uint32_t a = 0; a < lote.nArchivos; a++) CERRAR(&lote.pArchivos[a]);
+	free(lote.pArchivos);
+	return 0;
+}
@@ -0,0 +1,237 @@
+/********************************************************************************
+  * @file    iirBench.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Banco de pruebas en el host de los nucleos de filtrado de src/:
+  	  	  	 costo por muestra de cada estructura y, para el notch
+  	  	  	 adaptativo, velocidad de enganche, seguimiento de un interferente
+  	  	  	 que deriva y cuanto de la senal util se lleva cada filtro.
+
+  * COMPILACION:
+  	  *	gcc -O2 -I../src -o iirBench iirBench.c ../src/iir.c ../src/iirpar.c
+  	  	    ../src/notch.c ../src/coef.c -lm
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "coef.h"
+#include "iir.h"
+#include "notch.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+#define FS			20000.0f
+#define N_BENCH		(1 << 20)
+#define BLOQUE		64
+#define REPETICIONES 8
+
+/*Parametros del notch adaptativo del firmware:*/
+#define NOTCH_RHO	0.98f
+#define NOTCH_MU	0.005f
+
+static float entrada[N_BENCH];
+static float salida[N_BENCH];
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+static double AHORA(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+/*Amplitud de un tono por correlacion en cuadratura sobre [ini, fin):*/
+static float AMPLITUD(const float* x, uint32_t ini, uint32_t fin, float Freq)
+{
+	double c = 0.0, s = 0.0;
+
+	for (uint32_t k = ini; k < fin; k++) {
+		c += x[k] * cos(2.0 * M_PI * Freq * k / FS);
+		s += x[k] * sin(2.0 * M_PI * Freq * k / FS);
+	}
+	return (float)(2.0 * hypot(c, s) / (fin - ini));
+}
+
+/*Ruido blanco uniforme reproducible:*/
+static float RUIDO(void)
+{
+	return (float)rand() / RAND_MAX - 0.5f;
+}
+
+/*Costo por muestra en ns, procesando en bloques de BLOQUE muestras:*/
+typedef void (*PROCESO)(void* S, const float* pSrc, float* pDst, uint32_t n);
+
+static double COSTO_NS_BLOQUE(PROCESO pfn, void* S, uint32_t Bloque)
+{
+	double mejor = 1e30;
+
+	for (uint32_t r = 0; r < REPETICIONES; r++) {
+		double t0 = AHORA();
+		for (uint32_t k = 0; k < N_BENCH; k += Bloque)
+			pfn(S, &entrada[k], &salida[k], Bloque);
+		double t = (AHORA() - t0) * 1e9 / N_BENCH;
+		if (t < mejor) mejor = t;
+	}
+	return mejor;
+}
+
+static double COSTO_NS(PROCESO pfn, void* S)
+{
+	return COSTO_NS_BLOQUE(pfn, S, BLOQUE);
+}
+
+static void PROC_DF1(void* S, const float* pSrc, float* pDst, uint32_t n)   { IIR_F32(S, pSrc, pDst, n); }
+static void PROC_DF2T(void* S, const float* pSrc, float* pDst, uint32_t n)  { IIR_DF2T_F32(S, pSrc, pDst, n); }
+static void PROC_SOS(void* S, const float* pSrc, float* pDst, uint32_t n)   { IIR_SOS_F32(S, pSrc, pDst, n); }
+static void PROC_PAR(void* S, const float* pSrc, float* pDst, uint32_t n)   { IIR_PAR_F32(S, pSrc, pDst, n); }
+static void PROC_NOTCH(void* S, const float* pSrc, float* pDst, uint32_t n) { NOTCH_F32(S, pSrc, pDst, n); }
+
+/*Referencia en doble precision (DF1) y error maximo de una estructura:*/
+static double ERROR_MAX(PROCESO pfn, void* S, uint32_t n)
+{
+	double xh[COEF_ORDEN] = {0}, yh[COEF_ORDEN] = {0};
+	double errMax = 0.0;
+
+	for (uint32_t k = 0; k < n; k += BLOQUE)
+		pfn(S, &entrada[k], &salida[k], BLOQUE);
+
+	for (uint32_t k = 0; k < n; k++) {
+		double y = coef_b[0] * (double)entrada[k];
+		for (uint32_t i = 0; i < COEF_ORDEN; i++)
+			y += coef_b[i+1] * xh[i] - coef_a[i+1] * yh[i];
+		for (uint32_t i = COEF_ORDEN - 1; i > 0; i--) { xh[i] = xh[i-1]; yh[i] = yh[i-1]; }
+		xh[0] = entrada[k];
+		yh[0] = y;
+		if (fabs(y - salida[k]) > errMax) errMax = fabs(y - salida[k]);
+	}
+	return errMax;
+}
+
+/*------------------------------------------------------------------------------
+MAIN:
+------------------------------------------------------------------------------*/
+int main(void)
+{
+	float stateIn[COEF_ORDEN], stateOut[COEF_ORDEN], state[COEF_ORDEN];
+	float parCoeffs[4 * COEF_SECCIONES], parDirecto;
+	int32_t parSecciones;
+	IIR_F32_INST iir;
+	IIR_PAR_F32_INST par;
+	IIR_DF2T_F32_INST df2t;
+	IIR_SOS_F32_INST sos;
+	NOTCH_F32_INST notch;
+
+	for (uint32_t k = 0; k < N_BENCH; k++) entrada[k] = RUIDO();
+
+	parSecciones = IIR_PAR_DESIGN(COEF_ORDEN, coef_b, coef_a, parCoeffs, &parDirecto);
+	if (parSecciones < 0) {
+		printf("IIR_PAR_DESIGN fallo\n");
+		return 1;
+	}
+
+	/*1) Costo por muestra:*/
+	printf("COSTO POR MUESTRA (%d muestras, bloques de %d):\n", N_BENCH, BLOQUE);
+	IIR_F32_INIT(&iir, COEF_ORDEN, coef_b, coef_a, stateIn, stateOut);
+	printf("  IIR_F32   DF1 orden %2d : %6.2f ns  (%d MACs)\n", COEF_ORDEN,
+		   COSTO_NS(PROC_DF1, &iir), 2 * COEF_ORDEN + 1);
+	IIR_DF2T_F32_INIT(&df2t, COEF_ORDEN, coef_b, coef_a, state);
+	printf("  IIR_DF2T  orden %2d     : %6.2f ns  (%d estados)\n", COEF_ORDEN,
+		   COSTO_NS(PROC_DF2T, &df2t), COEF_ORDEN);
+	IIR_SOS_F32_INIT(&sos, COEF_SECCIONES, coef_sos, state);
+	printf("  IIR_SOS   DF2T x %d     : %6.2f ns  (%d estados)\n", COEF_SECCIONES,
+		   COSTO_NS(PROC_SOS, &sos), 2 * COEF_SECCIONES);
+	IIR_PAR_F32_INIT(&par, (uint32_t)parSecciones, parCoeffs, parDirecto, state);
+	printf("  IIR_PAR   %d secciones  : %6.2f ns  (%d estados)\n", parSecciones,
+		   COSTO_NS(PROC_PAR, &par), 2 * parSecciones);
+	NOTCH_F32_INIT(&notch, FS, 5000.0f, NOTCH_RHO, NOTCH_MU);
+	printf("  NOTCH_F32 adaptativo   : %6.2f ns  (~10 MACs + 1 div)\n",
+		   COSTO_NS(PROC_NOTCH, &notch));
+
+	/*Latencia por muestra: una llamada por muestra, como en ADC_PROCESSING:*/
+	printf("\nLATENCIA POR MUESTRA (bloques de 1):\n");
+	IIR_F32_INIT(&iir, COEF_ORDEN, coef_b, coef_a, stateIn, stateOut);
+	printf("  DF1 %.2f ns   ", COSTO_NS_BLOQUE(PROC_DF1, &iir, 1));
+	IIR_DF2T_F32_INIT(&df2t, COEF_ORDEN, coef_b, coef_a, state);
+	printf("DF2T %.2f ns   ", COSTO_NS_BLOQUE(PROC_DF2T, &df2t, 1));
+	IIR_SOS_F32_INIT(&sos, COEF_SECCIONES, coef_sos, state);
+	printf("SOS %.2f ns   ", COSTO_NS_BLOQUE(PROC_SOS, &sos, 1));
+	IIR_PAR_F32_INIT(&par, (uint32_t)parSecciones, parCoeffs, parDirecto, state);
+	printf("PAR %.2f ns\n", COSTO_NS_BLOQUE(PROC_PAR, &par, 1));
+
+	/*Error contra la referencia en doble precision:*/
+	const uint32_t nError = 1 << 16;
+	printf("\nERROR MAXIMO CONTRA REFERENCIA DOUBLE (%u muestras de ruido):\n", nError);
+	IIR_F32_INIT(&iir, COEF_ORDEN, coef_b, coef_a, stateIn, stateOut);
+	printf("  DF1 %.2e   ", ERROR_MAX(PROC_DF1, &iir, nError));
+	IIR_DF2T_F32_INIT(&df2t, COEF_ORDEN, coef_b, coef_a, state);
+	printf("DF2T %.2e   ", ERROR_MAX(PROC_DF2T, &df2t, nError));
+	IIR_SOS_F32_INIT(&sos, COEF_SECCIONES, coef_sos, state);
+	printf("SOS %.2e   ", ERROR_MAX(PROC_SOS, &sos, nError));
+	IIR_PAR_F32_INIT(&par, (uint32_t)parSecciones, parCoeffs, parDirecto, state);
+	printf("PAR %.2e\n", ERROR_MAX(PROC_PAR, &par, nError));
+
+	/*2) Enganche: util de 1 kHz, interferente de 5.3 kHz y ruido, arrancando
+	     el notch en 5 kHz:*/
+	const float fInter = 5300.0f;
+	const uint32_t nEnganche = (uint32_t)FS;
+	for (uint32_t k = 0; k < nEnganche; k++)
+		entrada[k] = 0.2f * sinf(2.0f * (float)M_PI * 1000.0f * k / FS) +
+					 0.3f * sinf(2.0f * (float)M_PI * fInter * k / FS) + 0.01f * RUIDO();
+
+	NOTCH_F32_INIT(&notch, FS, 5000.0f, NOTCH_RHO, NOTCH_MU);
+	uint32_t kEnganche = 0;
+	for (uint32_t k = 0; k < nEnganche; k++) {
+		NOTCH_F32(&notch, &entrada[k], &salida[k], 1);
+		if (fabsf(NOTCH_F32_FREQ(&notch, FS) - fInter) > 20.0f) kEnganche = k + 1;
+	}
+	printf("\nENGANCHE 5000 -> %.0f Hz (error < 20 Hz): %u muestras (%.1f ms), f final %.1f Hz\n",
+		   fInter, kEnganche, 1e3f * kEnganche / FS, NOTCH_F32_FREQ(&notch, FS));
+	printf("  interferente residual: %.1f dB\n",
+		   20.0f * log10f(AMPLITUD(salida, nEnganche / 2, nEnganche, fInter) / 0.3f));
+
+	/*3) Seguimiento: interferente que deriva de 4.5 a 5.5 kHz en 2 s:*/
+	const uint32_t nDeriva = (uint32_t)(2 * FS);
+	double fase = 0.0, errMax = 0.0;
+	NOTCH_F32_INIT(&notch, FS, 4500.0f, NOTCH_RHO, NOTCH_MU);
+	for (uint32_t k = 0; k < nDeriva; k++) {
+		double f = 4500.0 + 1000.0 * k / nDeriva;
+		float x;
+		fase += 2.0 * M_PI * f / FS;
+		x = 0.3f * (float)sin(fase) + 0.2f * sinf(2.0f * (float)M_PI * 1000.0f * k / FS);
+		NOTCH_F32(&notch, &x, &salida[k], 1);
+		if (k > nDeriva / 10 && fabs(NOTCH_F32_FREQ(&notch, FS) - f) > errMax)
+			errMax = fabs(NOTCH_F32_FREQ(&notch, FS) - f);
+	}
+	printf("\nSEGUIMIENTO 4.5 -> 5.5 kHz en 2 s: error maximo %.1f Hz\n", errMax);
+
+	/*4) Senal util que se lleva cada filtro (tonos dentro de la banda
+	     eliminada del Cheby pero lejos del interferente en 5 kHz):*/
+	const float fUtil[] = { 1000.0f, 4200.0f, 4700.0f, 5800.0f };
+	printf("\nATENUACION DE SENAL UTIL (interferente fijo en 5 kHz):\n");
+	printf("  tono [Hz]   DF1 fijo [dB]   notch [dB]\n");
+	for (uint32_t t = 0; t < sizeof(fUtil) / sizeof(fUtil[0]); t++) {
+		for (uint32_t k = 0; k < nEnganche; k++)
+			entrada[k] = 0.2f * sinf(2.0f * (float)M_PI * fUtil[t] * k / FS) +
+						 0.3f * sinf(2.0f * (float)M_PI * 5000.0f * k / FS);
+
+		IIR_F32_INIT(&iir, COEF_ORDEN, coef_b, coef_a, stateIn, stateOut);
+		IIR_F32(&iir, entrada, salida, nEnganche);
+		float aFijo = AMPLITUD(salida, nEnganche / 2, nEnganche, fUtil[t]);
+
+		NOTCH_F32_INIT(&notch, FS, 5000.0f, NOTCH_RHO, NOTCH_MU);
+		NOTCH_F32(&notch, entrada, salida, nEnganche);
+		float aNotch = AMPLITUD(salida, nEnganche / 2, nEnganche, fUtil[t]);
+
+		printf("  %8.0f   %12.1f   %10.1f\n", fUtil[t],
+			   20.0f * log10f(aFijo / 0.2f), 20.0f * log10f(aNotch / 0.2f));
+	}
+
+	return 0;
+}
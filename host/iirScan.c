@@ -0,0 +1,430 @@
+/********************************************************************************
+  * @file    iirScan.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Elimina banda del firmware aplicado a grabaciones largas usando
+  	  	  	 todos los nucleos. La cascada SOS se escribe en espacio de
+  	  	  	 estados x(n+1) = A x(n) + B u(n) y la senal se parte en bloques
+  	  	  	 de L muestras:
+  	  	  	 1) cada bloque se filtra en paralelo desde estado cero
+  	  	  	    (respuesta a estado cero y estado final z_c),
+  	  	  	 2) los estados de frontera x_(c+1) = A^L x_c + z_c se obtienen
+  	  	  	    con un prefix scan en dos niveles (reduccion por hilo,
+  	  	  	    combinacion secuencial de un elemento por hilo, barrido local),
+  	  	  	 3) cada bloque suma en paralelo su respuesta a entrada cero desde
+  	  	  	    x_c, que decae y se corta en cuanto el estado es despreciable.
+  	  	  	 El resultado coincide con IIR_SOS_F32 secuencial dentro de la
+  	  	  	 tolerancia de float.
+
+  * SALIDA:
+  	  *	Binario f32 con la senal filtrada (legible con freqRes -b f32).
+
+  * COMPILACION:
+  	  *	gcc -O3 -march=native -pthread -I../src -o iirScan iirScan.c
+  	  	    ../src/iir.c ../src/coef.c -lm
+
+  * USO:
+  	  *	iirScan -i entrada.bin -o salida.f32 [-b u16|i16|f32] [-t hilos]
+  	  	        [-l largo_bloque] [-v]
+  	  *	iirScan [-n muestras] [-t hilos] [-l largo_bloque]
+  	  	Escalas de -b en formato.h (u16 codigos del ADC como en
+  	  	ADC_PROCESSING, i16 Q15); -v compara contra el filtro secuencial. Sin -i se
+  	  	mide el rendimiento con ruido sintetico para 1..hilos hilos.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "coef.h"
+#include "formato.h"
+#include "iir.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+#define MAX_HILOS	256
+
+/*Dimension del estado de la cascada: {d1, d2} por seccion:*/
+#define N_ESTADOS	(2*COEF_SECCIONES)
+
+/*Largo de bloque por defecto. Mucho mas largo que la respuesta a entrada
+  cero, asi la correccion de la fase 3 es una fraccion chica del bloque:*/
+#define LARGO_BLOQUE	65536
+
+/*Estado por debajo del cual la respuesta a entrada cero ya no suma:*/
+#define ZI_UMBRAL		1e-9f
+#define ZI_PASO			256
+
+
+/*Matriz de transicion del estado:*/
+typedef struct { double m[N_ESTADOS][N_ESTADOS]; } MATRIZ;
+
+/*Senal a filtrar y parametros comunes a todos los hilos:*/
+typedef struct
+{
+	const void* pDatos;
+	FORMATO formato;
+	float*  pSalida;
+	size_t  nMuestras;
+	size_t  largo;
+	size_t  nBloques;
+	const MATRIZ* pP;							/*A^L.*/
+	double (*pZ)[N_ESTADOS];					/*Estado final a estado cero de cada bloque.*/
+} SENAL;
+
+/*Trabajo de cada hilo: un rango contiguo de bloques y su elemento del scan:*/
+typedef struct
+{
+	const SENAL* pSenal;
+	size_t bloqueIni;
+	size_t bloqueFin;
+	MATRIZ M;									/*A^(L*k) del rango.*/
+	double v[N_ESTADOS];						/*Estado al salir del rango desde cero.*/
+	double xEntrada[N_ESTADOS];					/*Estado al entrar al rango.*/
+} TRABAJO_SCAN;
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+static void ERROR_FATAL(const char* pMsj, const char* pArg)
+{
+	fprintf(stderr, "iirScan: %s%s%s\n", pMsj, pArg ? " " : "", pArg ? pArg : "");
+	exit(1);
+}
+
+static double AHORA(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+/*Muestra i convertida como en ADC_PROCESSING:*/
+static inline float MUESTRA(const SENAL* pSen, size_t i)
+{
+	return FORMATO_MUESTRA(pSen->pDatos, pSen->formato, i);
+}
+
+/*C = A*B:*/
+static void MATRIZ_MULT(MATRIZ* pC, const MATRIZ* pA, const MATRIZ* pB)
+{
+	MATRIZ r;
+
+	for (uint32_t i = 0; i < N_ESTADOS; i++)
+		for (uint32_t j = 0; j < N_ESTADOS; j++) {
+			double acum = 0.0;
+			for (uint32_t k = 0; k < N_ESTADOS; k++) acum += pA->m[i][k] * pB->m[k][j];
+			r.m[i][j] = acum;
+		}
+	*pC = r;
+}
+
+/*C = A^e por cuadrados sucesivos:*/
+static void MATRIZ_POTENCIA(MATRIZ* pC, const MATRIZ* pA, size_t e)
+{
+	MATRIZ base = *pA;
+
+	memset(pC, 0, sizeof(*pC));
+	for (uint32_t i = 0; i < N_ESTADOS; i++) pC->m[i][i] = 1.0;
+
+	while (e) {
+		if (e & 1) MATRIZ_MULT(pC, pC, &base);
+		MATRIZ_MULT(&base, &base, &base);
+		e >>= 1;
+	}
+}
+
+/*y = A*x + z (y puede ser x):*/
+static void MATRIZ_AFIN(double* y, const MATRIZ* pA, const double* x, const double* z)
+{
+	double r[N_ESTADOS];
+
+	for (uint32_t i = 0; i < N_ESTADOS; i++) {
+		double acum = z ? z[i] : 0.0;
+		for (uint32_t k = 0; k < N_ESTADOS; k++) acum += pA->m[i][k] * x[k];
+		r[i] = acum;
+	}
+	memcpy(y, r, sizeof(r));
+}
+
+/*Un paso de la cascada en doble precision con entrada cero; al ser lineal,
+  aplicado a cada vector canonico da las columnas de A:*/
+static void SOS_PASO_CERO(const float* pSos, double* x)
+{
+	double u = 0.0;
+
+	for (uint32_t s = 0; s < COEF_SECCIONES; s++, pSos += 5) {
+		double y = pSos[0] * u + x[2*s];
+		x[2*s]   = pSos[1] * u - pSos[3] * y + x[2*s+1];
+		x[2*s+1] = pSos[2] * u - pSos[4] * y;
+		u = y;
+	}
+}
+
+static void MATRIZ_TRANSICION(MATRIZ* pA, const float* pSos)
+{
+	for (uint32_t j = 0; j < N_ESTADOS; j++) {
+		double x[N_ESTADOS] = {0};
+		x[j] = 1.0;
+		SOS_PASO_CERO(pSos, x);
+		for (uint32_t i = 0; i < N_ESTADOS; i++) pA->m[i][j] = x[i];
+	}
+}
+
+/*Suma a pDst la respuesta a entrada cero desde el estado pState (float,
+  destruido). Corta cuando el estado cae por debajo de ZI_UMBRAL:*/
+static void ZI_SUMAR(const float* pSos, float* pState, float* pDst, size_t Largo)
+{
+	for (size_t k0 = 0; k0 < Largo; k0 += ZI_PASO) {
+		size_t k1 = k0 + ZI_PASO < Largo ? k0 + ZI_PASO : Largo;
+		float maximo = 0.0f;
+
+		for (size_t k = k0; k < k1; k++) {
+			const float* pC = pSos;
+			float u = 0.0f;
+			for (uint32_t s = 0; s < COEF_SECCIONES; s++, pC += 5) {
+				float y = pC[0] * u + pState[2*s];
+				pState[2*s]   = pC[1] * u - pC[3] * y + pState[2*s+1];
+				pState[2*s+1] = pC[2] * u - pC[4] * y;
+				u = y;
+			}
+			pDst[k] += u;
+		}
+
+		for (uint32_t i = 0; i < N_ESTADOS; i++)
+			if (fabsf(pState[i]) > maximo) maximo = fabsf(pState[i]);
+		if (maximo < ZI_UMBRAL) return;
+	}
+}
+
+/*Fase 1: conversion, respuesta a estado cero de cada bloque y reduccion
+  del rango del hilo a un unico elemento (M, v) del scan:*/
+static void* HILO_ESTADO_CERO(void* pArg)
+{
+	TRABAJO_SCAN* t = pArg;
+	const SENAL* pSen = t->pSenal;
+	float state[N_ESTADOS];
+	IIR_SOS_F32_INST sos;
+
+	memset(t->v, 0, sizeof(t->v));
+
+	for (size_t c = t->bloqueIni; c < t->bloqueFin; c++) {
+		size_t ini = c * pSen->largo;
+		size_t n = ini + pSen->largo < pSen->nMuestras ? pSen->largo : pSen->nMuestras - ini;
+		float* pDst = pSen->pSalida + ini;
+
+		for (size_t k = 0; k < n; k++) pDst[k] = MUESTRA(pSen, ini + k);
+
+		IIR_SOS_F32_INIT(&sos, COEF_SECCIONES, coef_sos, state);
+		IIR_SOS_F32(&sos, pDst, pDst, (uint32_t)n);
+
+		for (uint32_t i = 0; i < N_ESTADOS; i++) pSen->pZ[c][i] = state[i];
+		MATRIZ_AFIN(t->v, pSen->pP, t->v, pSen->pZ[c]);
+	}
+
+	MATRIZ_POTENCIA(&t->M, pSen->pP, t->bloqueFin - t->bloqueIni);
+	return NULL;
+}
+
+/*Fase 3: barrido local del scan desde el estado de entrada del rango y
+  correccion a entrada cero de cada bloque:*/
+static void* HILO_ENTRADA_CERO(void* pArg)
+{
+	TRABAJO_SCAN* t = pArg;
+	const SENAL* pSen = t->pSenal;
+	double x[N_ESTADOS];
+	float state[N_ESTADOS];
+
+	memcpy(x, t->xEntrada, sizeof(x));
+
+	for (size_t c = t->bloqueIni; c < t->bloqueFin; c++) {
+		size_t ini = c * pSen->largo;
+		size_t n = ini + pSen->largo < pSen->nMuestras ? pSen->largo : pSen->nMuestras - ini;
+
+		for (uint32_t i = 0; i < N_ESTADOS; i++) state[i] = (float)x[i];
+		ZI_SUMAR(coef_sos, state, pSen->pSalida + ini, n);
+
+		MATRIZ_AFIN(x, pSen->pP, x, pSen->pZ[c]);
+	}
+	return NULL;
+}
+
+/*Filtra la senal completa con nHilos hilos:*/
+static void IIR_SCAN(SENAL* pSen, uint32_t nHilos)
+{
+	pthread_t hilos[MAX_HILOS];
+	TRABAJO_SCAN* trabajos;
+	MATRIZ A, P;
+
+	pSen->nBloques = (pSen->nMuestras + pSen->largo - 1) / pSen->largo;
+	if (nHilos > pSen->nBloques) nHilos = (uint32_t)pSen->nBloques;
+
+	MATRIZ_TRANSICION(&A, coef_sos);
+	MATRIZ_POTENCIA(&P, &A, pSen->largo);
+	pSen->pP = &P;
+
+	trabajos = calloc(nHilos, sizeof(TRABAJO_SCAN));
+	pSen->pZ = malloc(pSen->nBloques * sizeof(*pSen->pZ));
+	if (!trabajos || !pSen->pZ) ERROR_FATAL("sin memoria", NULL);
+
+	/*Fase 1:*/
+	for (uint32_t h = 0; h < nHilos; h++) {
+		trabajos[h].pSenal = pSen;
+		trabajos[h].bloqueIni = pSen->nBloques * h / nHilos;
+		trabajos[h].bloqueFin = pSen->nBloques * (h + 1) / nHilos;
+		if (pthread_create(&hilos[h], NULL, HILO_ESTADO_CERO, &trabajos[h]) != 0)
+			ERROR_FATAL("no se pudo crear un hilo", NULL);
+	}
+	for (uint32_t h = 0; h < nHilos; h++) pthread_join(hilos[h], NULL);
+
+	/*Fase 2: un elemento (M, v) por hilo, combinados en orden:*/
+	memset(trabajos[0].xEntrada, 0, sizeof(trabajos[0].xEntrada));
+	for (uint32_t h = 1; h < nHilos; h++)
+		MATRIZ_AFIN(trabajos[h].xEntrada, &trabajos[h-1].M, trabajos[h-1].xEntrada, trabajos[h-1].v);
+
+	/*Fase 3:*/
+	for (uint32_t h = 0; h < nHilos; h++)
+		if (pthread_create(&hilos[h], NULL, HILO_ENTRADA_CERO, &trabajos[h]) != 0)
+			ERROR_FATAL("no se pudo crear un hilo", NULL);
+	for (uint32_t h = 0; h < nHilos; h++) pthread_join(hilos[h], NULL);
+
+	free(pSen->pZ);
+	free(trabajos);
+	pSen->pP = NULL;
+}
+
+/*Maximo error contra IIR_SOS_F32 secuencial:*/
+static double ERROR_SECUENCIAL(const SENAL* pSen)
+{
+	float state[N_ESTADOS];
+	IIR_SOS_F32_INST sos;
+	float bloque[4096];
+	double error = 0.0;
+
+	IIR_SOS_F32_INIT(&sos, COEF_SECCIONES, coef_sos, state);
+	for (size_t k0 = 0; k0 < pSen->nMuestras; k0 += 4096) {
+		size_t n = k0 + 4096 < pSen->nMuestras ? 4096 : pSen->nMuestras - k0;
+		for (size_t k = 0; k < n; k++) bloque[k] = MUESTRA(pSen, k0 + k);
+		IIR_SOS_F32(&sos, bloque, bloque, (uint32_t)n);
+		for (size_t k = 0; k < n; k++) {
+			double e = fabs((double)bloque[k] - pSen->pSalida[k0 + k]);
+			if (e > error) error = e;
+		}
+	}
+	return error;
+}
+
+static void USO(void)
+{
+	fprintf(stderr,
+		"uso: iirScan -i entrada -o salida.f32 [-b u16|i16|f32] [-t hilos] [-l largo] [-v]\n"
+		"     iirScan [-n muestras] [-t hilos] [-l largo]\n");
+	exit(2);
+}
+
+/*------------------------------------------------------------------------------
+MAIN:
+------------------------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	const char* pRutaIn = NULL;
+	const char* pRutaOut = NULL;
+	FORMATO formato = FMT_U16;
+	size_t nSintetico = (size_t)1 << 24;
+	size_t largo = LARGO_BLOQUE;
+	uint32_t nHilos = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+	int verificar = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "i:o:b:t:l:n:v")) != -1) {
+		switch (opt) {
+		case 'i': pRutaIn = optarg; break;
+		case 'o': pRutaOut = optarg; break;
+		case 'b':
+			if (!FORMATO_DECODIFICAR(optarg, &formato)) USO();
+			break;
+		case 't': nHilos = (uint32_t)atoi(optarg); break;
+		case 'l': largo = (size_t)atol(optarg); break;
+		case 'n': nSintetico = (size_t)atol(optarg); break;
+		case 'v': verificar = 1; break;
+		default: USO();
+		}
+	}
+	if ((pRutaIn && !pRutaOut) || largo < 64) USO();
+	if (nHilos < 1) nHilos = 1;
+	if (nHilos > MAX_HILOS) nHilos = MAX_HILOS;
+
+	SENAL sen = { .largo = largo };
+
+	/*Sin archivo: rendimiento con ruido sintetico:*/
+	if (!pRutaIn) {
+		float* pRuido = malloc(nSintetico * sizeof(float));
+		sen.pSalida = malloc(nSintetico * sizeof(float));
+		if (!pRuido || !sen.pSalida || !nSintetico) ERROR_FATAL("sin memoria", NULL);
+
+		srand(1);
+		for (size_t k = 0; k < nSintetico; k++) pRuido[k] = (float)rand() / RAND_MAX - 0.5f;
+		sen.pDatos = pRuido;
+		sen.formato = FMT_F32;
+		sen.nMuestras = nSintetico;
+
+		printf("%zu muestras, bloques de %zu:\n", nSintetico, largo);
+		double base = 0.0;
+		for (uint32_t h = 1; h <= nHilos; h++) {
+			double t0 = AHORA();
+			IIR_SCAN(&sen, h);
+			double t = AHORA() - t0;
+			if (h == 1) base = t;
+			printf("  %3u hilos: %8.1f Mmuestras/s  (x%.2f)\n", h, nSintetico / t * 1e-6, base / t);
+		}
+		printf("error maximo contra IIR_SOS_F32 secuencial: %.2e\n", ERROR_SECUENCIAL(&sen));
+
+		free(pRuido);
+		free(sen.pSalida);
+		return 0;
+	}
+
+	/*Entrada mapeada en memoria y salida del mismo largo:*/
+	size_t tamMuestra = FORMATO_BYTES(formato);
+	struct stat st;
+	int fdIn = open(pRutaIn, O_RDONLY);
+	if (fdIn < 0 || fstat(fdIn, &st) < 0) ERROR_FATAL("no se puede abrir", pRutaIn);
+	sen.nMuestras = (size_t)st.st_size / tamMuestra;
+	if (!sen.nMuestras) ERROR_FATAL("archivo vacio", pRutaIn);
+	void* pMapaIn = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fdIn, 0);
+	if (pMapaIn == MAP_FAILED) ERROR_FATAL("no se puede mapear", pRutaIn);
+	sen.pDatos = pMapaIn;
+	sen.formato = formato;
+
+	size_t tamOut = sen.nMuestras * sizeof(float);
+	int fdOut = open(pRutaOut, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fdOut < 0 || ftruncate(fdOut, (off_t)tamOut) < 0) ERROR_FATAL("no se puede escribir", pRutaOut);
+	void* pMapaOut = mmap(NULL, tamOut, PROT_READ | PROT_WRITE, MAP_SHARED, fdOut, 0);
+	if (pMapaOut == MAP_FAILED) ERROR_FATAL("no se puede mapear", pRutaOut);
+	sen.pSalida = pMapaOut;
+
+	double t0 = AHORA();
+	IIR_SCAN(&sen, nHilos);
+	double t = AHORA() - t0;
+
+	fprintf(stderr, "%zu muestras en %.3f s con %u hilos (%.1f Mmuestras/s)\n",
+			sen.nMuestras, t, nHilos, sen.nMuestras / t * 1e-6);
+	if (verificar)
+		fprintf(stderr, "error maximo contra IIR_SOS_F32 secuencial: %.2e\n", ERROR_SECUENCIAL(&sen));
+
+	munmap(pMapaOut, tamOut);
+	munmap(pMapaIn, (size_t)st.st_size);
+	close(fdOut);
+	close(fdIn);
+	return 0;
+}
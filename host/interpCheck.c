@@ -0,0 +1,108 @@
+/********************************************************************************
+  * @file    interpCheck.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Verificacion en el host del interpolador polifasico de
+  	  	  	 src/interp.c para L = 2, 4 y 8: ganancia de la banda util
+  	  	  	 (tonos hasta 7 kHz a FS) y rechazo de las imagenes en
+  	  	  	 k*FS +- f, medidos sobre la salida de INTERP_F32 por
+  	  	  	 correlacion en cuadratura. Sale con 1 si algun valor se aparta
+  	  	  	 de lo esperado.
+
+  * COMPILACION:
+  	  *	gcc -O2 -I../src -o interpCheck interpCheck.c ../src/interp.c -lm
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <math.h>
+#include <stdio.h>
+#include "interp.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+#define FS			20000.0
+#define TRANSITORIO	(2 * INTERP_TAPS_FASE)		/*Muestras de entrada descartadas.*/
+#define N_MEDIDA	4000						/*200 ms a FS: periodos enteros de tonos e imagenes.*/
+#define N_ENTRADA	(TRANSITORIO + N_MEDIDA)
+#define AMP			0.5
+
+/*Tolerancias: ganancia de la banda util y rechazo minimo de imagenes [dB]:*/
+#define GAN_MIN		0.9995
+#define GAN_MAX		1.0005
+#define RECHAZO_MIN	60.0
+
+static float salida[INTERP_L_MAX * N_ENTRADA];
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Amplitud de un tono por correlacion en cuadratura sobre [ini, fin), f en
+  fracciones de la frecuencia de muestreo de x:*/
+static double AMPLITUD(const float* x, uint32_t ini, uint32_t fin, double f)
+{
+	double c = 0.0, s = 0.0;
+
+	for (uint32_t k = ini; k < fin; k++) {
+		c += x[k] * cos(2.0 * M_PI * f * k);
+		s += x[k] * sin(2.0 * M_PI * f * k);
+	}
+	return 2.0 * hypot(c, s) / (fin - ini);
+}
+
+/*------------------------------------------------------------------------------
+MAIN:
+------------------------------------------------------------------------------*/
+int main(void)
+{
+	static const uint32_t L[] = {2, 4, 8};
+	static const double tonos[] = {500.0, 1000.0, 3000.0, 5000.0, 7000.0};
+	const uint32_t nTonos = sizeof(tonos) / sizeof(tonos[0]);
+	INTERP_F32_INST interp;
+	int falla = 0;
+
+	printf("INTERP_F32, %u coeficientes por fase, tonos de amplitud %.1f a %.0f Hz:\n",
+		   INTERP_TAPS_FASE, AMP, FS);
+	for (uint32_t l = 0; l < sizeof(L) / sizeof(L[0]); l++) {
+		double gMin = 1e30, gMax = 0.0, rMin = 1e30, rMax = 0.0;
+
+		printf("\n  L = %u (salida a %.0f Hz):\n", L[l], L[l] * FS);
+		printf("    tono [Hz]   ganancia   peor imagen [Hz]   rechazo [dB]\n");
+		for (uint32_t t = 0; t < nTonos; t++) {
+			double fo = tonos[t] / (L[l] * FS);
+			uint32_t n = N_ENTRADA * L[l], ini = TRANSITORIO * L[l];
+
+			INTERP_F32_INIT(&interp, L[l]);
+			for (uint32_t k = 0; k < N_ENTRADA; k++)
+				INTERP_F32(&interp, (float)(AMP * sin(2.0 * M_PI * tonos[t] * k / FS)), &salida[k * L[l]]);
+
+			/*La ganancia sale del tono a la frecuencia alta; las imagenes
+			  estan en k*FS +- f hasta L*FS/2:*/
+			double g = AMPLITUD(salida, ini, n, fo) / AMP;
+			double peor = 0.0, fPeor = 0.0;
+			for (uint32_t k = 1; k <= L[l] / 2; k++) {
+				double img[2] = {k * FS - tonos[t], k * FS + tonos[t]};
+				for (uint32_t i = 0; i < 2; i++) {
+					if (img[i] > L[l] * FS / 2) continue;
+					double a = AMPLITUD(salida, ini, n, img[i] / (L[l] * FS));
+					if (a > peor) { peor = a; fPeor = img[i]; }
+				}
+			}
+			double rechazo = 20.0 * log10(g * AMP / peor);
+
+			printf("    %9.0f   %8.5f   %16.0f   %12.1f\n", tonos[t], g, fPeor, rechazo);
+			if (g < gMin) gMin = g;
+			if (g > gMax) gMax = g;
+			if (rechazo < rMin) rMin = rechazo;
+			if (rechazo > rMax) rMax = rechazo;
+		}
+
+		int ok = gMin >= GAN_MIN && gMax <= GAN_MAX && rMin >= RECHAZO_MIN;
+		falla |= !ok;
+		printf("    ganancia %.4f a %.4f, imagenes %.0f a %.0f dB abajo %s\n",
+			   gMin, gMax, rMin, rMax, ok ? "ok" : "FALLA");
+	}
+
+	return falla;
+}
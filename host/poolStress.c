@@ -0,0 +1,177 @@
+/********************************************************************************
+  * @file    poolStress.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Prueba de estres en el host del pool de bloques del firmware
+  	  	  	 (src/pool.c). Varios productores toman bloques, los marcan y
+  	  	  	 los comparten sin copiar con todos los consumidores (una
+  	  	  	 referencia por consumidor); cada consumidor verifica la marca
+  	  	  	 y suelta su referencia. Al final todos los bloques deben estar
+  	  	  	 libres, sin referencias colgadas, bloques duplicados en la
+  	  	  	 lista libre ni datos pisados.
+
+  * COMPILACION:
+  	  *	gcc -O2 -pthread -I../src -o poolStress poolStress.c ../src/pool.c
+
+  * USO:
+  	  *	poolStress [-p productores] [-c consumidores] [-n bloques por productor]
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pool.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+#define BLOQUES			16
+#define PALABRAS		64
+#define MAX_HILOS		16
+#define COLA			8
+
+POOL_DEF(pool, BLOQUES, PALABRAS * sizeof(uint32_t));
+
+/*Cola de punteros de cada consumidor, con mutex (lo que se prueba es el pool):*/
+typedef struct
+{
+	uint32_t* pBloque[COLA];
+	uint32_t lectura, cuenta;
+	pthread_mutex_t mutex;
+	pthread_cond_t noVacia, noLlena;
+} COLA_PTR;
+
+/*------------------------------------------------------------------------------
+VARIABLES LOCALES:
+------------------------------------------------------------------------------*/
+static int productores = 4, consumidores = 3;
+static long porProductor = 200000;
+static COLA_PTR colas[MAX_HILOS];
+static volatile long corruptos = 0, reintentos = 0;
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+static void PONER(COLA_PTR* pCola, uint32_t* pBloque)
+{
+	pthread_mutex_lock(&pCola->mutex);
+	while (pCola->cuenta == COLA) pthread_cond_wait(&pCola->noLlena, &pCola->mutex);
+	pCola->pBloque[(pCola->lectura + pCola->cuenta++) % COLA] = pBloque;
+	pthread_cond_signal(&pCola->noVacia);
+	pthread_mutex_unlock(&pCola->mutex);
+}
+
+static uint32_t* SACAR(COLA_PTR* pCola)
+{
+	pthread_mutex_lock(&pCola->mutex);
+	while (pCola->cuenta == 0) pthread_cond_wait(&pCola->noVacia, &pCola->mutex);
+	uint32_t* pBloque = pCola->pBloque[pCola->lectura];
+	pCola->lectura = (pCola->lectura + 1) % COLA;
+	pCola->cuenta--;
+	pthread_cond_signal(&pCola->noLlena);
+	pthread_mutex_unlock(&pCola->mutex);
+	return pBloque;
+}
+
+/*Marca: productor y secuencia en la cabecera, el resto derivado de ambos:*/
+static void* PRODUCTOR(void* pArg)
+{
+	uint32_t id = (uint32_t)(uintptr_t)pArg;
+
+	for (long n = 0; n < porProductor; n++) {
+		uint32_t* pBloque;
+		while ((pBloque = POOL_TOMAR(&pool)) == NULL) {
+			__atomic_add_fetch(&reintentos, 1, __ATOMIC_RELAXED);
+			sched_yield();
+		}
+
+		pBloque[0] = id;
+		pBloque[1] = (uint32_t)n;
+		for (uint32_t k = 2; k < PALABRAS; k++) pBloque[k] = id * 2654435761u ^ (uint32_t)n ^ k;
+
+		/*Una referencia por consumidor; la del productor pasa al primero:*/
+		for (int c = 1; c < consumidores; c++) POOL_RETENER(&pool, pBloque);
+		for (int c = 0; c < consumidores; c++) PONER(&colas[c], pBloque);
+	}
+	return NULL;
+}
+
+static void* CONSUMIDOR(void* pArg)
+{
+	COLA_PTR* pCola = pArg;
+
+	for (long n = 0; n < porProductor * productores; n++) {
+		uint32_t* pBloque = SACAR(pCola);
+		uint32_t id = pBloque[0], sec = pBloque[1];
+
+		for (uint32_t k = 2; k < PALABRAS; k++)
+			if (pBloque[k] != (id * 2654435761u ^ sec ^ k)) {
+				__atomic_add_fetch(&corruptos, 1, __ATOMIC_RELAXED);
+				break;
+			}
+		POOL_SOLTAR(&pool, pBloque);
+	}
+	return NULL;
+}
+
+/*------------------------------------------------------------------------------
+MAIN:
+------------------------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	pthread_t hilos[2 * MAX_HILOS];
+	int opt, fallas = 0;
+
+	while ((opt = getopt(argc, argv, "p:c:n:")) != -1) {
+		switch (opt) {
+		case 'p': productores = atoi(optarg); break;
+		case 'c': consumidores = atoi(optarg); break;
+		case 'n': porProductor = atol(optarg); break;
+		default:
+			fprintf(stderr, "uso: poolStress [-p productores] [-c consumidores] [-n bloques]\n");
+			return 2;
+		}
+	}
+	if (productores < 1 || productores > MAX_HILOS || consumidores < 1 || consumidores > MAX_HILOS) return 2;
+
+	POOL_INIT(&pool);
+	for (int c = 0; c < consumidores; c++) {
+		pthread_mutex_init(&colas[c].mutex, NULL);
+		pthread_cond_init(&colas[c].noVacia, NULL);
+		pthread_cond_init(&colas[c].noLlena, NULL);
+	}
+
+	for (int c = 0; c < consumidores; c++) pthread_create(&hilos[MAX_HILOS + c], NULL, CONSUMIDOR, &colas[c]);
+	for (int p = 0; p < productores; p++) pthread_create(&hilos[p], NULL, PRODUCTOR, (void*)(uintptr_t)p);
+	for (int p = 0; p < productores; p++) pthread_join(hilos[p], NULL);
+	for (int c = 0; c < consumidores; c++) pthread_join(hilos[MAX_HILOS + c], NULL);
+
+	/*Todos libres y cada uno una sola vez en la lista libre:*/
+	uint8_t visto[BLOQUES] = {0};
+	uint32_t libres = 0;
+	void* p;
+	for (uint32_t k = 0; k < BLOQUES; k++)
+		if (pool.pRefs[k]) fallas++;
+	while ((p = POOL_TOMAR(&pool)) != NULL) {
+		uint32_t k = (uint32_t)(((uint8_t*)p - pool.pMem) / pool.tamBloque);
+		if (visto[k]++) fallas++;
+		libres++;
+	}
+	if (libres != BLOQUES) fallas++;
+
+	printf("%d productores, %d consumidores, %ld bloques c/u (%d refs por bloque)\n",
+		   productores, consumidores, porProductor, consumidores);
+	printf("marca de agua alta  %u de %u\n", pool.maxEnUso, BLOQUES);
+	printf("sin bloques libres  %u (reintentos %ld)\n", pool.fallos - 1, reintentos);
+	printf("errores de refs     %u\n", pool.errores);
+	printf("bloques pisados     %ld\n", corruptos);
+	printf("libres al final     %u de %u, %d fallas de consistencia\n", libres, BLOQUES, fallas);
+
+	return (fallas || corruptos || pool.errores) ? 1 : 0;
+}
@@ -0,0 +1,200 @@
+/********************************************************************************
+  * @file    regsTest.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Prueba en el host de los accesos directos a registros del
+  	  	  	 firmware (src/regs.h). Cada REG_* se apunta a estructuras
+  	  	  	 TIM/GPIO/ADC/DAC/DMA en RAM (por eso reciben el periferico por
+  	  	  	 puntero) y se verifica lo que escribe con el comportamiento de
+  	  	  	 los bits del manual de referencia:
+  	  	  	   - SR de TIM y ADC son rc_w0: escribir 0 borra y 1 no cambia,
+  	  	  	     asi el borrado de UIF o JEOC no debe tocar otras banderas.
+  	  	  	   - JSWSTART lo baja el hardware al empezar; un hilo hace de ADC
+  	  	  	     y termina la conversion inyectada para REG_ADC_READ_INJ.
+  	  	  	   - DHR12RD empaca canal 2 en [27:16] y canal 1 en [11:0].
+  	  	  	   - LIFCR es de solo escritura, 1 borra: se escribe la bandera
+  	  	  	     sola, sin leer y modificar.
+
+  * COMPILACION:
+  	  *	gcc -O2 -pthread -DSTM32F42_43xxx -DUSE_STDPERIPH_DRIVER -Iemu -I../src
+  	  	    -I../Libraries/CMSIS/Include -I../Libraries/Device/ST/STM32F4xx/Include
+  	  	    -I../Libraries/STM32F4xx_StdPeriph_Driver/inc -o regsTest regsTest.c
+
+  * USO:
+  	  *	regsTest
+  	  	Sale con 1 si falla alguna verificacion.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "functions.h"
+#include "regs.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Dato que entrega el ADC simulado:*/
+#define ADC_DATO		0x0ABC
+
+#define VERIFICAR(Cond, Texto)	VERIFICAR_(Cond, Texto, __LINE__)
+
+/*------------------------------------------------------------------------------
+VARIABLES LOCALES:
+------------------------------------------------------------------------------*/
+static TIM_TypeDef tim;
+static GPIO_TypeDef gpio;
+static ADC_TypeDef adc;
+static DAC_TypeDef dac;
+static DMA_TypeDef dma;
+
+static int verificaciones = 0, fallas = 0;
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+static void VERIFICAR_(int Cond, const char* pTexto, int Linea)
+{
+	verificaciones++;
+	if (Cond) return;
+	fallas++;
+	printf("FALLA (linea %d): %s\n", Linea, pTexto);
+}
+
+/*Escritura a un registro rc_w0 ya hecha en RAM: el valor escrito queda en
+  el campo y se aplica como lo hace el hardware (solo borra los 0):*/
+static uint32_t RC_W0(uint32_t Anterior, uint32_t Escrito)
+{
+	return Anterior & Escrito;
+}
+
+/*ADC simulado: espera JSWSTART, lo baja como el hardware, deja el dato en
+  JDR1 y levanta JEOC:*/
+static void* ADC_SIMULADO(void* pArg)
+{
+	(void)pArg;
+	while ((adc.CR2 & ADC_CR2_JSWSTART) == 0);
+	adc.CR2 &= ~ADC_CR2_JSWSTART;
+	adc.JDR1 = ADC_DATO;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	adc.SR |= ADC_SR_JEOC;
+	return NULL;
+}
+
+/*------------------------------------------------------------------------------
+PRUEBAS:
+------------------------------------------------------------------------------*/
+static void PROBAR_TIM(void)
+{
+	uint32_t antes;
+
+	/*La bandera cuenta solo con la interrupcion habilitada:*/
+	tim.SR = TIM_SR_UIF;
+	tim.DIER = 0;
+	VERIFICAR(!REG_TIM_UPDATE(&tim), "REG_TIM_UPDATE con UIE en 0");
+	tim.DIER = TIM_DIER_UIE;
+	VERIFICAR(REG_TIM_UPDATE(&tim), "REG_TIM_UPDATE con UIF y UIE");
+	tim.SR = TIM_SR_CC1IF;
+	VERIFICAR(!REG_TIM_UPDATE(&tim), "REG_TIM_UPDATE sin UIF");
+
+	/*Borrado de UIF: 0 solo en UIF, CC1IF y CC2IF siguen:*/
+	antes = TIM_SR_UIF | TIM_SR_CC1IF | TIM_SR_CC2IF;
+	tim.SR = antes;
+	REG_TIM_CLEAR_UPDATE(&tim);
+	VERIFICAR(tim.SR == (uint16_t)~TIM_SR_UIF, "REG_TIM_CLEAR_UPDATE escribe ~UIF");
+	VERIFICAR(RC_W0(antes, tim.SR) == (TIM_SR_CC1IF | TIM_SR_CC2IF), "REG_TIM_CLEAR_UPDATE conserva las otras banderas");
+}
+
+static void PROBAR_GPIO(void)
+{
+	gpio.ODR = GPIO_Pin_0 | GPIO_Pin_8;
+	REG_GPIO_TOGGLE(&gpio, GPIO_Pin_8);
+	VERIFICAR(gpio.ODR == GPIO_Pin_0, "REG_GPIO_TOGGLE baja el pin");
+	REG_GPIO_TOGGLE(&gpio, GPIO_Pin_8);
+	VERIFICAR(gpio.ODR == (GPIO_Pin_0 | GPIO_Pin_8), "REG_GPIO_TOGGLE sube el pin");
+}
+
+static void PROBAR_ADC(void)
+{
+	uint32_t antes;
+	pthread_t hilo;
+
+	/*Arranque sin espera: JEOC viejo borrado, EOC intacto, JSWSTART sobre
+	  el resto de CR2:*/
+	antes = ADC_SR_JEOC | ADC_SR_EOC;
+	adc.SR = antes;
+	adc.CR2 = ADC_CR2_ADON;
+	REG_ADC_START_INJ(&adc);
+	VERIFICAR(RC_W0(antes, adc.SR) == ADC_SR_EOC, "REG_ADC_START_INJ borra solo JEOC");
+	VERIFICAR(adc.CR2 == (ADC_CR2_ADON | ADC_CR2_JSWSTART), "REG_ADC_START_INJ agrega JSWSTART a CR2");
+
+	/*Consulta y lectura con la conversion terminada:*/
+	adc.SR = 0;
+	VERIFICAR(!REG_ADC_INJ_LISTA(&adc), "REG_ADC_INJ_LISTA sin JEOC");
+	antes = ADC_SR_JEOC | ADC_SR_EOC;
+	adc.SR = antes;
+	adc.JDR1 = ADC_DATO;
+	VERIFICAR(REG_ADC_INJ_LISTA(&adc), "REG_ADC_INJ_LISTA con JEOC");
+	VERIFICAR(REG_ADC_LEER_INJ(&adc) == ADC_DATO, "REG_ADC_LEER_INJ devuelve JDR1");
+	VERIFICAR(RC_W0(antes, adc.SR) == ADC_SR_EOC, "REG_ADC_LEER_INJ borra solo JEOC");
+
+	/*Conversion completa con espera: un JEOC viejo no debe cortar la
+	  espera antes de la conversion nueva:*/
+	adc.SR = 0;
+	adc.CR2 = ADC_CR2_ADON;
+	adc.JDR1 = 0;
+	pthread_create(&hilo, NULL, ADC_SIMULADO, NULL);
+	int32_t dato = REG_ADC_READ_INJ(&adc);
+	pthread_join(hilo, NULL);
+	VERIFICAR(dato == ADC_DATO, "REG_ADC_READ_INJ espera JEOC y devuelve JDR1");
+	VERIFICAR(adc.CR2 == ADC_CR2_ADON, "REG_ADC_READ_INJ conserva el resto de CR2");
+}
+
+static void PROBAR_DAC(void)
+{
+	memset(&dac, 0, sizeof(dac));
+	REG_DAC_SET(&dac, 1, 0x123);
+	VERIFICAR(dac.DHR12R1 == 0x123 && dac.DHR12R2 == 0, "REG_DAC_SET canal 1");
+	REG_DAC_SET(&dac, 2, 0x456);
+	VERIFICAR(dac.DHR12R1 == 0x123 && dac.DHR12R2 == 0x456, "REG_DAC_SET canal 2");
+
+	/*Canal 2 arriba, canal 1 abajo, cada uno enmascarado a 12 bits:*/
+	REG_DAC_DUAL(&dac, DAC_DUAL_PALABRA(0x123, 0xABC));
+	VERIFICAR(dac.DHR12RD == 0x0ABC0123, "DHR12RD empaca canal 2 en [27:16] y canal 1 en [11:0]");
+	REG_DAC_DUAL(&dac, DAC_DUAL_PALABRA(0x1FFF, 0x0FFF));
+	VERIFICAR(dac.DHR12RD == 0x0FFF0FFF, "DAC_DUAL_PALABRA no invade el canal 2");
+	REG_DAC_DUAL(&dac, DAC_DUAL_PALABRA(0, 0x1001));
+	VERIFICAR(dac.DHR12RD == 0x00010000, "DAC_DUAL_PALABRA no pasa de [27:16]");
+}
+
+static void PROBAR_DMA(void)
+{
+	dma.LISR = DMA_LISR_HTIF0 | DMA_LISR_TCIF1;
+	VERIFICAR(REG_DMA_FLAG_LO(&dma, DMA_LISR_HTIF0), "REG_DMA_FLAG_LO con la bandera");
+	VERIFICAR(!REG_DMA_FLAG_LO(&dma, DMA_LISR_TCIF0), "REG_DMA_FLAG_LO sin la bandera");
+
+	/*LIFCR: la bandera sola (un OR con lo anterior borraria las demas):*/
+	dma.LIFCR = 0xFFFFFFFF;
+	REG_DMA_CLEAR_LO(&dma, DMA_LIFCR_CHTIF0);
+	VERIFICAR(dma.LIFCR == DMA_LIFCR_CHTIF0, "REG_DMA_CLEAR_LO escribe solo CHTIF0");
+	REG_DMA_CLEAR_LO(&dma, DMA_LIFCR_CTCIF0);
+	VERIFICAR(dma.LIFCR == DMA_LIFCR_CTCIF0, "REG_DMA_CLEAR_LO escribe solo CTCIF0");
+}
+
+/*------------------------------------------------------------------------------
+MAIN:
+------------------------------------------------------------------------------*/
+int main(void)
+{
+	PROBAR_TIM();
+	PROBAR_GPIO();
+	PROBAR_ADC();
+	PROBAR_DAC();
+	PROBAR_DMA();
+
+	printf("regs.h: %d verificaciones, %d fallas\n", verificaciones, fallas);
+	return fallas ? 1 : 0;
+}
@@ -0,0 +1,173 @@
+/********************************************************************************
+  * @file    ringBench.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Prueba y banco de rendimiento en el host de la cola SPSC del
+  	  	  	 firmware (src/ring.h). Un hilo productor y uno consumidor pasan
+  	  	  	 una secuencia de enteros de a uno (PUSH/POP), en bloques
+  	  	  	 copiados (PUSH_N/POP_N) y por tramos en el lugar; el consumidor
+  	  	  	 verifica que llegue completa y en orden. Informa millones de
+  	  	  	 elementos por segundo de cada modo y sale con 1 si hubo un
+  	  	  	 error de secuencia.
+
+  * COMPILACION:
+  	  *	gcc -O2 -pthread -I../src -o ringBench ringBench.c
+  	  *	gcc -O1 -g -fsanitize=thread -pthread -I../src -o ringBenchTsan ringBench.c
+  	  	(la segunda debe correr sin reportes de ThreadSanitizer)
+
+  * USO:
+  	  *	ringBench [-n elementos] [-b bloque]
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "ring.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+#define LARGO		1024
+#define BLOQUE_MAX	LARGO
+
+RING_TIPO(RING_BENCH, uint32_t, LARGO);
+
+enum { MODO_UNO, MODO_BLOQUE, MODO_TRAMO, MODOS };
+static const char* nombres[MODOS] = {"de a uno", "bloques", "tramos"};
+
+/*------------------------------------------------------------------------------
+VARIABLES LOCALES:
+------------------------------------------------------------------------------*/
+static RING_BENCH ring;
+static uint32_t total = 50000000;
+static uint32_t bloque = 64;
+static int modo;
+static volatile uint32_t errores;
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+static void* PRODUCTOR(void* pArg)
+{
+	uint32_t buf[BLOQUE_MAX];
+	uint32_t n = 0;
+	(void)pArg;
+
+	while (n < total) {
+		if (modo == MODO_UNO) {
+			if (RING_BENCH_PUSH(&ring, n)) n++;
+			else sched_yield();
+		}
+		else if (modo == MODO_BLOQUE) {
+			uint32_t m = (total - n < bloque) ? total - n : bloque;
+			for (uint32_t k = 0; k < m; k++) buf[k] = n + k;
+			uint32_t hechos = 0;
+			while (hechos < m) {
+				uint32_t h = RING_BENCH_PUSH_N(&ring, &buf[hechos], m - hechos);
+				if (h == 0) sched_yield();
+				hechos += h;
+			}
+			n += m;
+		}
+		else {
+			uint32_t tramo;
+			uint32_t* p = RING_BENCH_ESCRIBIR_TRAMO(&ring, &tramo);
+			if (tramo == 0) {
+				sched_yield();
+				continue;
+			}
+			if (tramo > total - n) tramo = total - n;
+			for (uint32_t k = 0; k < tramo; k++) p[k] = n + k;
+			RING_BENCH_CONFIRMAR(&ring, tramo);
+			n += tramo;
+		}
+	}
+	return NULL;
+}
+
+static void* CONSUMIDOR(void* pArg)
+{
+	uint32_t buf[BLOQUE_MAX];
+	uint32_t n = 0, v;
+	(void)pArg;
+
+	while (n < total) {
+		if (modo == MODO_UNO) {
+			if (RING_BENCH_POP(&ring, &v)) {
+				if (v != n) errores++;
+				n++;
+			}
+			else sched_yield();
+		}
+		else if (modo == MODO_BLOQUE) {
+			uint32_t h = RING_BENCH_POP_N(&ring, buf, bloque);
+			if (h == 0) sched_yield();
+			for (uint32_t k = 0; k < h; k++)
+				if (buf[k] != n + k) errores++;
+			n += h;
+		}
+		else {
+			uint32_t tramo;
+			uint32_t* p = RING_BENCH_LEER_TRAMO(&ring, &tramo);
+			if (tramo == 0) {
+				sched_yield();
+				continue;
+			}
+			for (uint32_t k = 0; k < tramo; k++)
+				if (p[k] != n + k) errores++;
+			RING_BENCH_LIBERAR(&ring, tramo);
+			n += tramo;
+		}
+	}
+	return NULL;
+}
+
+static double AHORA(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*------------------------------------------------------------------------------
+MAIN:
+------------------------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:b:")) != -1) {
+		switch (opt) {
+		case 'n': total = (uint32_t)atol(optarg); break;
+		case 'b': bloque = (uint32_t)atol(optarg); break;
+		default:
+			fprintf(stderr, "uso: ringBench [-n elementos] [-b bloque]\n");
+			return 2;
+		}
+	}
+	if (bloque == 0 || bloque > BLOQUE_MAX) bloque = 64;
+
+	printf("cola de %d x uint32, %u elementos, bloques de %u\n", LARGO, total, bloque);
+	for (modo = 0; modo < MODOS; modo++) {
+		pthread_t prod, cons;
+
+		RING_BENCH_INIT(&ring);
+		errores = 0;
+		double t0 = AHORA();
+		pthread_create(&cons, NULL, CONSUMIDOR, NULL);
+		pthread_create(&prod, NULL, PRODUCTOR, NULL);
+		pthread_join(prod, NULL);
+		pthread_join(cons, NULL);
+		double t = AHORA() - t0;
+
+		printf("%-10s %8.1f Melem/s  %u errores\n", nombres[modo], total / t / 1e6, errores);
+		if (errores || RING_BENCH_CUENTA(&ring) != 0) return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,225 @@
+/********************************************************************************
+  * @file    sosMulti.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Cascada SOS en DF2T sobre muchos canales a la vez: cada lane
+  	  	  	 del registro vectorial es un canal, con 8 canales por
+  	  	  	 instruccion en AVX2 y 16 en AVX-512. La implementacion se elige
+  	  	  	 en tiempo de ejecucion segun el CPU; la version escalar queda
+  	  	  	 para los canales sobrantes y para CPUs sin AVX2.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "sosMulti.h"
+#include <immintrin.h>
+
+/*------------------------------------------------------------------------------
+VARIABLES GLOBALES:
+------------------------------------------------------------------------------*/
+/*Ancho elegido (0 hasta la primera llamada):*/
+static uint32_t ancho = 0;
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Canales [c0, c1) de a uno. Referencia y resto de los vectoriales:*/
+static void SOS_MULTI_ESCALAR_F32(const SOS_MULTI_F32_INST* S, const float* pSrc, float* pDst,
+								  uint32_t blockSize, uint32_t c0, uint32_t c1)
+{
+	uint32_t nC = S->nCanales;
+
+	for (uint32_t c = c0; c < c1; c++) {
+		const float* pC = S->pCoeffs;
+		const float* pIn = pSrc;
+
+		for (uint32_t s = 0; s < S->nSecciones; s++, pC += 5) {
+			float b0 = pC[0], b1 = pC[1], b2 = pC[2], a1 = pC[3], a2 = pC[4];
+			float* pD = &S->pState[2 * s * nC];
+			float d1 = pD[c], d2 = pD[nC + c];
+
+			for (uint32_t k = 0; k < blockSize; k++) {
+				float x = pIn[k * nC + c];
+				float y = b0 * x + d1;
+				d1 = b1 * x - a1 * y + d2;
+				d2 = b2 * x - a2 * y;
+				pDst[k * nC + c] = y;
+			}
+
+			pD[c] = d1;
+			pD[nC + c] = d2;
+			pIn = pDst;
+		}
+	}
+}
+
+/*Grupos de 8 canales con AVX2 + FMA desde el canal c0. Devuelve el primer
+  canal sin procesar:*/
+__attribute__((target("avx2,fma")))
+static uint32_t SOS_MULTI_AVX2_F32(const SOS_MULTI_F32_INST* S, const float* pSrc, float* pDst,
+								   uint32_t blockSize, uint32_t c0)
+{
+	uint32_t nC = S->nCanales;
+	uint32_t c = c0;
+
+	for (; c + 8 <= nC; c += 8) {
+		const float* pC = S->pCoeffs;
+		const float* pIn = pSrc;
+
+		for (uint32_t s = 0; s < S->nSecciones; s++, pC += 5) {
+			__m256 b0 = _mm256_set1_ps(pC[0]), b1 = _mm256_set1_ps(pC[1]), b2 = _mm256_set1_ps(pC[2]);
+			__m256 a1 = _mm256_set1_ps(pC[3]), a2 = _mm256_set1_ps(pC[4]);
+			float* pD = &S->pState[2 * s * nC];
+			__m256 d1 = _mm256_loadu_ps(&pD[c]), d2 = _mm256_loadu_ps(&pD[nC + c]);
+
+			for (uint32_t k = 0; k < blockSize; k++) {
+				__m256 x = _mm256_loadu_ps(&pIn[k * nC + c]);
+				__m256 y = _mm256_fmadd_ps(b0, x, d1);
+				d1 = _mm256_fnmadd_ps(a1, y, _mm256_fmadd_ps(b1, x, d2));
+				d2 = _mm256_fnmadd_ps(a2, y, _mm256_mul_ps(b2, x));
+				_mm256_storeu_ps(&pDst[k * nC + c], y);
+			}
+
+			_mm256_storeu_ps(&pD[c], d1);
+			_mm256_storeu_ps(&pD[nC + c], d2);
+			pIn = pDst;
+		}
+	}
+	return c;
+}
+
+/*Grupos de 16 canales con AVX-512:*/
+__attribute__((target("avx512f")))
+static uint32_t SOS_MULTI_AVX512_F32(const SOS_MULTI_F32_INST* S, const float* pSrc, float* pDst,
+									 uint32_t blockSize, uint32_t c0)
+{
+	uint32_t nC = S->nCanales;
+	uint32_t c = c0;
+
+	for (; c + 16 <= nC; c += 16) {
+		const float* pC = S->pCoeffs;
+		const float* pIn = pSrc;
+
+		for (uint32_t s = 0; s < S->nSecciones; s++, pC += 5) {
+			__m512 b0 = _mm512_set1_ps(pC[0]), b1 = _mm512_set1_ps(pC[1]), b2 = _mm512_set1_ps(pC[2]);
+			__m512 a1 = _mm512_set1_ps(pC[3]), a2 = _mm512_set1_ps(pC[4]);
+			float* pD = &S->pState[2 * s * nC];
+			__m512 d1 = _mm512_loadu_ps(&pD[c]), d2 = _mm512_loadu_ps(&pD[nC + c]);
+
+			for (uint32_t k = 0; k < blockSize; k++) {
+				__m512 x = _mm512_loadu_ps(&pIn[k * nC + c]);
+				__m512 y = _mm512_fmadd_ps(b0, x, d1);
+				d1 = _mm512_fnmadd_ps(a1, y, _mm512_fmadd_ps(b1, x, d2));
+				d2 = _mm512_fnmadd_ps(a2, y, _mm512_mul_ps(b2, x));
+				_mm512_storeu_ps(&pDst[k * nC + c], y);
+			}
+
+			_mm512_storeu_ps(&pD[c], d1);
+			_mm512_storeu_ps(&pD[nC + c], d2);
+			pIn = pDst;
+		}
+	}
+	return c;
+}
+
+/*****************************************************************************
+SOS_MULTI_ANCHO
+
+	* @author	A. Riedinger.
+	* @brief	Detecta (una vez) la mejor implementacion que soporta el CPU.
+	* @returns
+		- Canales por instruccion: SOS_MULTI_AVX512, SOS_MULTI_AVX2 o
+		  SOS_MULTI_ESCALAR.
+	* @ej
+		- printf("%u canales por instruccion\n", SOS_MULTI_ANCHO());
+******************************************************************************/
+uint32_t SOS_MULTI_ANCHO(void)
+{
+	if (!ancho) {
+		__builtin_cpu_init();
+		if      (__builtin_cpu_supports("avx512f")) ancho = SOS_MULTI_AVX512;
+		else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ancho = SOS_MULTI_AVX2;
+		else ancho = SOS_MULTI_ESCALAR;
+	}
+	return ancho;
+}
+
+/*****************************************************************************
+SOS_MULTI_FORZAR
+
+	* @author	A. Riedinger.
+	* @brief	Fuerza una implementacion, para comparar contra la escalar. No
+				se verifica que el CPU la soporte.
+	* @returns	void
+	* @param
+		- Ancho		SOS_MULTI_AVX512, SOS_MULTI_AVX2 o SOS_MULTI_ESCALAR.
+	* @ej
+		- SOS_MULTI_FORZAR(SOS_MULTI_ESCALAR);
+******************************************************************************/
+void SOS_MULTI_FORZAR(uint32_t Ancho)
+{
+	ancho = Ancho;
+}
+
+/*****************************************************************************
+SOS_MULTI_F32_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa la cascada multicanal y limpia su estado.
+	* @returns	void
+	* @param
+		- S				Instancia del filtro.
+		- nSecciones	Cantidad de secciones.
+		- nCanales		Cantidad de canales intercalados.
+		- pCoeffs		{b0, b1, b2, a1, a2} por seccion, comunes a los canales.
+		- pState		Vector de estado (2*nSecciones*nCanales).
+	* @ej
+		- SOS_MULTI_F32_INIT(&sos, COEF_SECCIONES, 16, coef_sos, state);
+******************************************************************************/
+void SOS_MULTI_F32_INIT(SOS_MULTI_F32_INST* S, uint32_t nSecciones, uint32_t nCanales,
+						const float* pCoeffs, float* pState)
+{
+	S->nSecciones = nSecciones;
+	S->nCanales = nCanales;
+	S->pCoeffs = pCoeffs;
+	S->pState = pState;
+
+	for (uint32_t i = 0; i < 2 * nSecciones * nCanales; i++)
+		pState[i] = 0.0f;
+}
+
+/*****************************************************************************
+SOS_MULTI_F32
+
+	* @author	A. Riedinger.
+	* @brief	Proceso de la cascada sobre un bloque de muestras intercaladas.
+				Los canales se recorren de a 16 u 8 segun el CPU y los que
+				sobran con la version escalar.
+	* @returns	void
+	* @param
+		- S			Instancia del filtro.
+		- pSrc		Muestras de entrada, blockSize*nCanales intercaladas.
+		- pDst		Muestras de salida (puede ser el mismo buffer que pSrc).
+		- blockSize	Cantidad de muestras por canal.
+	* @ej
+		- SOS_MULTI_F32(&sos, bloque, bloque, 1024);
+******************************************************************************/
+void SOS_MULTI_F32(SOS_MULTI_F32_INST* S, const float* pSrc, float* pDst, uint32_t blockSize)
+{
+	uint32_t c = 0;
+
+	switch (SOS_MULTI_ANCHO()) {
+	case SOS_MULTI_AVX512:
+		c = SOS_MULTI_AVX512_F32(S, pSrc, pDst, blockSize, 0);
+		/*Todo CPU con AVX-512 tiene AVX2: un grupo de 8 sobrante va por ahi.*/
+		/* fall through */
+	case SOS_MULTI_AVX2:
+		c = SOS_MULTI_AVX2_F32(S, pSrc, pDst, blockSize, c);
+		break;
+	default:
+		break;
+	}
+
+	if (c < S->nCanales)
+		SOS_MULTI_ESCALAR_F32(S, pSrc, pDst, blockSize, c, S->nCanales);
+}
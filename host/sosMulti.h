@@ -0,0 +1,32 @@
+/* Definicion del header:*/
+#ifndef sosMulti_H
+#define sosMulti_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/*Canales por instruccion de cada implementacion:*/
+#define SOS_MULTI_ESCALAR	1
+#define SOS_MULTI_AVX2		8
+#define SOS_MULTI_AVX512	16
+
+/* Estructuras:*/
+/*Misma cascada SOS aplicada a nCanales senales independientes. Las muestras
+  van intercaladas: x[k*nCanales + canal]:*/
+typedef struct
+{
+	uint32_t nSecciones;
+	uint32_t nCanales;
+	const float* pCoeffs;						/*{b0, b1, b2, a1, a2} por seccion.*/
+	float* pState;								/*[seccion][d1|d2][canal].*/
+} SOS_MULTI_F32_INST;
+
+/* Declaracion funciones:*/
+void SOS_MULTI_F32_INIT(SOS_MULTI_F32_INST* S, uint32_t nSecciones, uint32_t nCanales,
+						const float* pCoeffs, float* pState);
+void SOS_MULTI_F32(SOS_MULTI_F32_INST* S, const float* pSrc, float* pDst, uint32_t blockSize);
+uint32_t SOS_MULTI_ANCHO(void);
+void SOS_MULTI_FORZAR(uint32_t Ancho);
+
+/* Cierre del header:*/
+#endif
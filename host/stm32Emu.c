@@ -0,0 +1,1670 @@
+/********************************************************************************
+  * @file    stm32Emu.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Emulador a nivel de registros de los perifericos del STM32F429
+  	  	  	 para correr el firmware completo en el host (Linux x86-64),
+  	  	  	 con src/functions.c y los drivers StdPeriph reales. Las
+  	  	  	 direcciones de stm32f4xx.h (0x40000000 perifericos y 0xE0000000
+  	  	  	 core) se mapean a un archivo de registros sin permisos: cada
+  	  	  	 acceso del firmware falla, el emulador actualiza el registro,
+  	  	  	 deja pasar esa sola instruccion (trap flag) y despues aplica la
+  	  	  	 semantica de la escritura (flags rc_w0, bits de arranque que se
+  	  	  	 borran solos, bits de listo, registros de solo lectura).
+
+  	  	  	 Emula RCC y PWR (osciladores, PLL, over-drive y relojes
+  	  	  	 derivados), TIM2 a TIM7 (base de tiempo, UG, preload e
+  	  	  	 interrupcion de update), ADC1 a ADC3 (conversion regular e
+  	  	  	 inyectada por software, con la duracion que dan ADCCLK, el
+  	  	  	 tiempo de muestreo y la resolucion), DAC (DHR a DOR directo o
+  	  	  	 por disparo de software), GPIO (BSRR a ODR), NVIC (habilitacion,
+  	  	  	 prioridad, agrupamiento y preempcion), PRIMASK/BASEPRI, WFI y
+  	  	  	 DWT_CYCCNT. DMA, USART, SysTick y los disparos de ADC y DAC por
+  	  	  	 timer no se emulan: sus registros son memoria y se avisa al
+  	  	  	 usarlos.
+
+  	  	  	 Tiempo virtual: avanza con un modelo de costo determinista, no
+  	  	  	 con el reloj del host. El firmware se compila con
+  	  	  	 -fsanitize-coverage=trace-pc y cada bloque basico que ejecuta
+  	  	  	 cuesta -x ciclos de HCLK; cada acceso a registro suma los ciclos
+  	  	  	 de su bus (lectura APB: HCLK/PCLK + 1, AHB: 2, escritura y PPB:
+  	  	  	 1, por el buffer de escritura) y cada interrupcion 12 de entrada
+  	  	  	 y 10 de salida. Las interrupciones entran en el bloque que cruza
+  	  	  	 su evento (sin temporizador del host), WFI salta al proximo
+  	  	  	 evento y la lectura del SR de un ADC con una conversion en curso
+  	  	  	 espera a que termine (el polling cuesta lo mismo que en el core,
+  	  	  	 con un solo acceso). Dos corridas iguales dan el mismo informe:
+  	  	  	 ocupacion, latencias y perdidas salen del modelo, no del ruido
+  	  	  	 del host. Los bloques del x86-64 no son los del Cortex-M4: -x se
+  	  	  	 calibra con -k contra la carga que mide el firmware en la placa.
+
+  	  	  	 Ademas valida la inicializacion y avisa (una vez por caso):
+  	  	  	 accesos a perifericos sin clock (la escritura se ignora, como en
+  	  	  	 el core), PLL fuera de rango, HCLK/APB/ADCCLK sobre el maximo,
+  	  	  	 wait states de flash u over-drive insuficientes y pines del ADC
+  	  	  	 o del DAC sin modo analogico.
+
+  * COMPILACION (desde host/; -DFS=... opcional para cambiar la Fs), en
+  	dos pasos: el emulador sin instrumentar y el firmware instrumentado:
+  	  *	CF="-O2 -std=gnu99 -fcommon -DSTM32F42_43xxx -DUSE_STDPERIPH_DRIVER
+  	  	    -Iemu -I../src -I../Libraries/CMSIS/Include
+  	  	    -I../Libraries/CMSIS/RTOS -I../Libraries/Device/ST/STM32F4xx/Include
+  	  	    -I../Libraries/STM32F4xx_StdPeriph_Driver/inc"
+  	  *	gcc $CF -c stm32Emu.c
+  	  *	gcc $CF -fsanitize-coverage=trace-pc stm32Emu.o -o stm32Emu
+  	  	    ../src/main.c ../src/functions.c ../src/clock.c
+  	  	    ../src/carga.c ../src/fondo.c ../src/pool.c ../src/pila.c
+  	  	    ../src/filtro.c ../src/iir.c ../src/iirpar.c ../src/notch.c
+  	  	    ../src/coef.c ../src/goertzel.c ../src/capture.c ../src/conv.c
+  	  	    ../src/cic.c ../src/interp.c ../src/interleave.c
+  	  	    ../src/system_stm32f4xx.c
+  	  	    ../Libraries/STM32F4xx_StdPeriph_Driver/src/{misc,stm32f4xx_adc,
+  	  	    stm32f4xx_tim,stm32f4xx_dac,stm32f4xx_gpio,stm32f4xx_rcc,
+  	  	    stm32f4xx_dma,stm32f4xx_usart,stm32f4xx_crc}.c -lm
+  	  	El directorio emu/ reemplaza los headers de instrucciones del core
+  	  	de CMSIS (ensamblador ARM) por sus equivalentes sobre el emulador;
+  	  	-fcommon porque functions.h define globales en cada unidad. Si
+  	  	stm32Emu.c se instrumenta el contador se llama a si mismo.
+
+  * USO:
+  	  *	stm32Emu [-t segundos] [-x ciclos] [-k carga] [-e frec:amp]...
+  	  	         [-o salida.u16] [-c canal]
+  	  	-t tiempo virtual a correr (1 s). -x ciclos de HCLK por bloque
+  	  	basico del firmware (6, sin calibrar). -k carga promedio en % que
+  	  	informa el firmware en la placa (carga.promedio) con la misma Fs:
+  	  	el informe da el -x que la reproduce (la ocupacion es lineal en -x,
+  	  	una corrida alcanza; se repite con ese -x para confirmar). -e tonos
+  	  	de la entrada analogica, amplitud en fondo de escala de 0 a 0.5
+  	  	(por defecto 1000:0.2 y 5000:0.2, el interferente en fs/4). -o
+  	  	salida del DAC como u16 crudo (el formato -b u16 de freqRes), una
+  	  	muestra por escritura del canal -c (2, PA5). Las opciones las toma el emulador antes del main del firmware. Para
+  	  	buscar la Fs maxima se recompila con -DFS=... y se miran ocupacion
+  	  	y perdidas en el informe.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <math.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "stm32f4xx.h"
+#include "carga.h"
+#include "pool.h"
+
+#if !defined(__x86_64__) || !defined(__linux__)
+#error "stm32Emu usa el trap flag y el codigo de error de falla de Linux x86-64"
+#endif
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Regiones mapeadas: perifericos APB1/APB2/AHB1 y Private Peripheral Bus:*/
+#define EMU_PER_BASE	0x40000000u
+#define EMU_PER_LARGO	0x00080000u
+#define EMU_CORE_BASE	0xE0000000u
+#define EMU_CORE_LARGO	0x00100000u
+#define EMU_PAGINA		4096u
+
+/*Trap flag de EFLAGS y bit de escritura del codigo de error de la falla:*/
+#define EMU_TF			0x100
+#define EMU_ERR_ESCRITURA	0x2
+
+/*Modelo de costo [ciclos de HCLK]: entrada y salida de una interrupcion
+  (apilado y desapilado del Cortex-M4) y bloque basico por defecto:*/
+#define EMU_CICLOS_ENTRADA	12.0
+#define EMU_CICLOS_SALIDA	10.0
+#define EMU_CICLOS_BLOQUE	6.0
+
+#define EMU_TONOS_MAX	8
+#define EMU_AVISOS_MAX	64
+#define EMU_TIMERS		6
+#define EMU_ADCS		3
+
+/*Registro visto por el emulador (alias con escritura del mismo archivo):*/
+#define EMU_REG(p)		((__typeof__(p))EMU_ALIAS((uintptr_t)(p)))
+
+/*Periferico del mapa: bloque, bit de clock en RCC y semantica de acceso.
+  Leer corre antes de una lectura (o de un read-modify-write), Escribir
+  devuelve el valor final del registro y Leido corre despues de leer:*/
+typedef struct
+{
+	const char* nombre;
+	uintptr_t base;
+	uint32_t largo;
+	uint32_t enOffset;				/*Registro de habilitacion en RCC (0: siempre con clock).*/
+	uint32_t enBit;
+	uint32_t indice;				/*Instancia dentro de su tipo.*/
+	void (*pfnLeer)(uint32_t Indice, uint32_t Off);
+	uint32_t (*pfnEscribir)(uint32_t Indice, uint32_t Off, uint32_t Previo, uint32_t Nuevo);
+	void (*pfnLeido)(uint32_t Indice, uint32_t Off);
+} EMU_PERIF;
+
+/*Base de tiempo de un timer: prescaler y auto-reload vigentes (los de los
+  registros se cargan en el update) y tiempos del periodo en curso [ns]:*/
+typedef struct
+{
+	uint8_t corriendo;
+	uint32_t pscEf;
+	uint32_t arrEf;
+	double tickNs;
+	double inicioNs;
+	double proximoNs;
+	double eventoNs;
+	uint64_t actualizaciones;
+	uint64_t perdidas;				/*Updates con UIF todavia en 1 (interrupcion sin atender).*/
+} EMU_TIM;
+
+/*Conversiones en curso de un ADC, con los resultados ya muestreados:*/
+typedef struct
+{
+	uint8_t regPendiente;
+	uint8_t injPendiente;
+	double regFinNs;
+	double injFinNs;
+	double finNs;					/*Fin de la ultima conversion (latencia de la IRQ).*/
+	uint16_t regValor;
+	uint16_t injValor[4];
+	uint32_t injN;
+	uint64_t conversiones;
+} EMU_ADC;
+
+/*Vector de interrupcion emulado, con su estadistica:*/
+typedef struct
+{
+	IRQn_Type irq;
+	void (*pfnIsr)(void);
+	const char* nombre;
+	uint64_t entradas;
+	double ciclosTotal;
+	double ciclosMax;
+	double latenciaTotalNs;
+	double latenciaMaxNs;
+} EMU_VECTOR;
+
+/*Tono de la entrada analogica:*/
+typedef struct
+{
+	double frec;
+	double amp;
+} EMU_TONO;
+
+/*Handlers del firmware (los que no esten quedan en NULL):*/
+void ADC_IRQHandler(void) __attribute__((weak));
+void TIM2_IRQHandler(void) __attribute__((weak));
+void TIM3_IRQHandler(void) __attribute__((weak));
+void TIM4_IRQHandler(void) __attribute__((weak));
+void TIM5_IRQHandler(void) __attribute__((weak));
+void TIM6_DAC_IRQHandler(void) __attribute__((weak));
+void TIM7_IRQHandler(void) __attribute__((weak));
+
+/*Variables del firmware para el informe, si existen:*/
+extern uint32_t tareasPerdidas __attribute__((weak));
+extern uint32_t ciclosTareaMax __attribute__((weak));
+extern CARGA carga __attribute__((weak));
+extern POOL poolMuestras __attribute__((weak));
+extern uint32_t latenciaMin __attribute__((weak));
+extern uint32_t latenciaMax __attribute__((weak));
+extern uint32_t latenciaProm __attribute__((weak));
+
+static void* EMU_ALIAS(uintptr_t Dir);
+static void EMU_FIN(const char* pMotivo);
+
+/*------------------------------------------------------------------------------
+VARIABLES GLOBALES:
+------------------------------------------------------------------------------*/
+/*Alias con escritura del archivo de registros (perifericos y luego core):*/
+static uint8_t* pAlias;
+
+/*Acceso en curso, de la falla al trap de la instruccion:*/
+static struct
+{
+	uintptr_t dir;
+	uint32_t previo;
+	uint8_t escritura;
+	uint8_t enCurso;
+	uint8_t sinReloj;
+	const EMU_PERIF* pPerif;
+} acceso;
+
+/*Tiempo virtual [ns], ciclos de HCLK y fin de la corrida:*/
+static double ahoraNs = 0.0;
+static double ciclos = 0.0;
+static double limiteNs = 1e9;
+
+/*Costo del firmware: ciclos por bloque basico, ciclos todavia no llevados
+  al tiempo virtual y cuantos faltan para el proximo evento o el fin:*/
+static double ciclosBloque = EMU_CICLOS_BLOQUE;
+static double pendientes = 0.0;
+static double hastaEvento = 0.0;
+static uint64_t bloques = 0;
+static double ciclosAccesos = 0.0;
+static double ciclosIrq = 0.0;
+
+/*Carga medida en la placa [%] para calibrar -x (0: sin calibrar):*/
+static double cargaPlaca = 0.0;
+static double inicioHostNs = 0.0;
+
+/*Reparto del tiempo virtual [ns]:*/
+static double ocupadoNs = 0.0;
+static double esperaAdcNs = 0.0;
+static double dormidoNs = 0.0;
+static uint64_t accesos = 0;
+
+/*El emulador esta corriendo (WFI, PRIMASK, preempcion): no se preempta:*/
+static volatile sig_atomic_t enEmulador = 0;
+
+/*Relojes [Hz]:*/
+static double hclk, pclk1, pclk2, timclk1;
+
+/*Core: PRIMASK, BASEPRI, excepcion en curso y prioridad de grupo activa:*/
+static uint32_t primask = 0;
+static uint32_t basepri = 0;
+static uint32_t ipsr = 0;
+static uint32_t grupoActivo = 0x100;
+
+/*NVIC: habilitadas, pendientes por software y activas:*/
+static uint32_t nvicHab[8], nvicPend[8], nvicActivas[8];
+
+/*DWT_CYCCNT: valor al anclar y ciclos de HCLK en ese momento:*/
+static uint8_t cyccntCorre = 0;
+static uint32_t cyccntValor = 0;
+static double cyccntBase = 0.0;
+
+/*Perifericos:*/
+static TIM_TypeDef* const emuTimRegs[EMU_TIMERS] = {TIM2, TIM3, TIM4, TIM5, TIM6, TIM7};
+static const char* const emuTimNombre[EMU_TIMERS] = {"TIM2", "TIM3", "TIM4", "TIM5", "TIM6", "TIM7"};
+static EMU_TIM emuTim[EMU_TIMERS];
+
+static ADC_TypeDef* const emuAdcRegs[EMU_ADCS] = {ADC1, ADC2, ADC3};
+static EMU_ADC emuAdc[EMU_ADCS];
+
+static uint16_t dacDhr[2];
+static uint64_t dacEscrituras[2];
+static FILE* pSalida = NULL;
+static uint32_t canalSalida = 2;
+
+/*Entrada analogica:*/
+static EMU_TONO tonos[EMU_TONOS_MAX];
+static uint32_t nTonos = 0;
+
+/*Avisos ya emitidos:*/
+static char avisos[EMU_AVISOS_MAX][128];
+static uint32_t nAvisos = 0;
+
+static EMU_VECTOR emuVector[] =
+{
+	{ADC_IRQn,      ADC_IRQHandler,      "ADC"},
+	{TIM2_IRQn,     TIM2_IRQHandler,     "TIM2"},
+	{TIM3_IRQn,     TIM3_IRQHandler,     "TIM3"},
+	{TIM4_IRQn,     TIM4_IRQHandler,     "TIM4"},
+	{TIM5_IRQn,     TIM5_IRQHandler,     "TIM5"},
+	{TIM6_DAC_IRQn, TIM6_DAC_IRQHandler, "TIM6_DAC"},
+	{TIM7_IRQn,     TIM7_IRQHandler,     "TIM7"},
+};
+#define EMU_VECTORES	(sizeof(emuVector) / sizeof(emuVector[0]))
+
+/*Pin (puerto A = 0, numero) de cada canal externo de ADC1/ADC2 y de ADC3:*/
+static const uint8_t adcPin12[16][2] =
+{
+	{0, 0}, {0, 1}, {0, 2}, {0, 3}, {0, 4}, {0, 5}, {0, 6}, {0, 7},
+	{1, 0}, {1, 1}, {2, 0}, {2, 1}, {2, 2}, {2, 3}, {2, 4}, {2, 5}
+};
+static const uint8_t adcPin3[16][2] =
+{
+	{0, 0}, {0, 1}, {0, 2}, {0, 3}, {5, 6}, {5, 7}, {5, 8}, {5, 9},
+	{5, 10}, {5, 3}, {2, 0}, {2, 1}, {2, 2}, {2, 3}, {5, 4}, {5, 5}
+};
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES - BASE:
+------------------------------------------------------------------------------*/
+/*Tiempo de CPU del hilo [ns], solo para informar la velocidad de la
+  corrida (el tiempo virtual no depende de el):*/
+static double HOST_NS(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void* EMU_ALIAS(uintptr_t Dir)
+{
+	if (Dir >= EMU_CORE_BASE) return pAlias + EMU_PER_LARGO + (Dir - EMU_CORE_BASE);
+	return pAlias + (Dir - EMU_PER_BASE);
+}
+
+static int EMU_ES_REGISTRO(uintptr_t Dir)
+{
+	return (Dir - EMU_PER_BASE < EMU_PER_LARGO) || (Dir - EMU_CORE_BASE < EMU_CORE_LARGO);
+}
+
+static void ERROR_FATAL(const char* pMsj, const char* pArg)
+{
+	fprintf(stderr, "stm32Emu: %s%s%s\n", pMsj, pArg ? " " : "", pArg ? pArg : "");
+	exit(1);
+}
+
+/*Aviso de validacion, una vez por texto:*/
+static void EMU_AVISO(const char* pFormato, ...)
+{
+	char texto[128];
+	va_list args;
+
+	va_start(args, pFormato);
+	vsnprintf(texto, sizeof(texto), pFormato, args);
+	va_end(args);
+
+	for (uint32_t k = 0; k < nAvisos; k++)
+		if (strcmp(avisos[k], texto) == 0) return;
+	if (nAvisos < EMU_AVISOS_MAX) strcpy(avisos[nAvisos++], texto);
+	fprintf(stderr, "stm32Emu: aviso (t = %.6f s): %s\n", ahoraNs * 1e-9, texto);
+}
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES - RELOJES:
+------------------------------------------------------------------------------*/
+/*Salida P del PLL principal [Hz]:*/
+static double EMU_PLL_SALIDA(uint32_t Pllcfgr)
+{
+	double fuente = (Pllcfgr & RCC_PLLCFGR_PLLSRC_HSE) ? HSE_VALUE : HSI_VALUE;
+	uint32_t m = Pllcfgr & RCC_PLLCFGR_PLLM;
+	uint32_t n = (Pllcfgr & RCC_PLLCFGR_PLLN) >> 6;
+	uint32_t p = (((Pllcfgr & RCC_PLLCFGR_PLLP) >> 16) + 1) * 2;
+
+	if (m == 0) return 0.0;
+	return fuente / m * n / p;
+}
+
+static void EMU_VALIDAR_PLL(void)
+{
+	RCC_TypeDef* pRcc = EMU_REG(RCC);
+	uint32_t pll = pRcc->PLLCFGR;
+	double fuente = (pll & RCC_PLLCFGR_PLLSRC_HSE) ? HSE_VALUE : HSI_VALUE;
+	uint32_t m = pll & RCC_PLLCFGR_PLLM;
+	uint32_t n = (pll & RCC_PLLCFGR_PLLN) >> 6;
+	double entrada = m ? fuente / m : 0.0;
+
+	if ((pll & RCC_PLLCFGR_PLLSRC_HSE) && !(pRcc->CR & RCC_CR_HSERDY))
+		EMU_AVISO("PLL encendido desde el HSE sin HSERDY");
+	if (entrada < 0.95e6 || entrada > 2.1e6)
+		EMU_AVISO("entrada del PLL %.3f MHz fuera de 1 a 2 MHz (PLLM %u)", entrada * 1e-6, m);
+	if (entrada * n < 100e6 || entrada * n > 432e6)
+		EMU_AVISO("VCO del PLL %.1f MHz fuera de 100 a 432 MHz", entrada * n * 1e-6);
+	if (EMU_PLL_SALIDA(pll) > 180e6)
+		EMU_AVISO("salida P del PLL %.1f MHz sobre 180 MHz", EMU_PLL_SALIDA(pll) * 1e-6);
+}
+
+static void EMU_TIM_ARRANCAR(uint32_t k);
+static void EMU_TIM_CONGELAR(uint32_t k);
+
+/*Relojes derivados de RCC; con un cambio, los timers en marcha se re-anclan
+  a la nueva frecuencia manteniendo la cuenta:*/
+static void EMU_RELOJES(void)
+{
+	static const uint16_t divAhb[16] = {1, 1, 1, 1, 1, 1, 1, 1, 2, 4, 8, 16, 64, 128, 256, 512};
+	static const uint8_t divApb[8] = {1, 1, 1, 1, 2, 4, 8, 16};
+	RCC_TypeDef* pRcc = EMU_REG(RCC);
+	uint32_t cfgr = pRcc->CFGR;
+	double sys;
+
+	switch ((cfgr & RCC_CFGR_SWS) >> 2) {
+	case 1:  sys = HSE_VALUE; break;
+	case 2:  sys = EMU_PLL_SALIDA(pRcc->PLLCFGR); break;
+	default: sys = HSI_VALUE; break;
+	}
+
+	double h = sys / divAhb[(cfgr & RCC_CFGR_HPRE) >> 4];
+	uint32_t d1 = divApb[(cfgr & RCC_CFGR_PPRE1) >> 10];
+	uint32_t d2 = divApb[(cfgr & RCC_CFGR_PPRE2) >> 13];
+	if (h == hclk && h / d1 == pclk1 && h / d2 == pclk2) return;
+
+	for (uint32_t k = 0; k < EMU_TIMERS; k++)
+		if (emuTim[k].corriendo) EMU_TIM_CONGELAR(k);
+
+	hclk = h;
+	pclk1 = h / d1;
+	pclk2 = h / d2;
+	timclk1 = d1 == 1 ? pclk1 : 2.0 * pclk1;
+
+	for (uint32_t k = 0; k < EMU_TIMERS; k++)
+		if (EMU_REG(emuTimRegs[k])->CR1 & TIM_CR1_CEN) EMU_TIM_ARRANCAR(k);
+
+	/*Maximos del STM32F429 a 3.3 V:*/
+	uint32_t ws = EMU_REG(FLASH)->ACR & FLASH_ACR_LATENCY;
+	if (hclk > 180e6) EMU_AVISO("HCLK %.1f MHz sobre 180 MHz", hclk * 1e-6);
+	if (pclk1 > 45e6) EMU_AVISO("PCLK1 %.1f MHz sobre 45 MHz", pclk1 * 1e-6);
+	if (pclk2 > 90e6) EMU_AVISO("PCLK2 %.1f MHz sobre 90 MHz", pclk2 * 1e-6);
+	if (hclk > (ws + 1) * 30e6)
+		EMU_AVISO("FLASH_ACR con %u wait states para HCLK %.1f MHz", ws, hclk * 1e-6);
+	if (hclk > 168e6 && !(EMU_REG(PWR)->CSR & (1u << 17)))
+		EMU_AVISO("HCLK %.1f MHz sin over-drive (PWR_CSR ODSWRDY)", hclk * 1e-6);
+}
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES - TIMERS:
+------------------------------------------------------------------------------*/
+static uint32_t EMU_TIM_CUENTA(uint32_t k)
+{
+	EMU_TIM* p = &emuTim[k];
+	double cnt = (ahoraNs - p->inicioNs) / p->tickNs;
+
+	if (cnt < 0.0) return 0;
+	if (cnt > p->arrEf) return p->arrEf;
+	return (uint32_t)cnt;
+}
+
+/*Arranca (o re-ancla) la cuenta desde el CNT del registro:*/
+static void EMU_TIM_ARRANCAR(uint32_t k)
+{
+	EMU_TIM* p = &emuTim[k];
+	uint32_t cnt = EMU_REG(emuTimRegs[k])->CNT;
+
+	if (cnt > p->arrEf) cnt = 0;
+	p->tickNs = (p->pscEf + 1.0) * 1e9 / timclk1;
+	p->inicioNs = ahoraNs - cnt * p->tickNs;
+	p->proximoNs = p->inicioNs + (p->arrEf + 1.0) * p->tickNs;
+	p->corriendo = 1;
+}
+
+static void EMU_TIM_CONGELAR(uint32_t k)
+{
+	EMU_REG(emuTimRegs[k])->CNT = EMU_TIM_CUENTA(k);
+	emuTim[k].corriendo = 0;
+}
+
+/*Updates vencidos: UIF, carga del preload y nuevo periodo:*/
+static void EMU_TIM_EVENTOS(uint32_t k)
+{
+	EMU_TIM* p = &emuTim[k];
+	TIM_TypeDef* pTim = EMU_REG(emuTimRegs[k]);
+
+	while (p->corriendo && p->proximoNs <= ahoraNs) {
+		if (!(pTim->CR1 & TIM_CR1_UDIS)) {
+			if ((pTim->SR & TIM_SR_UIF) && (pTim->DIER & TIM_DIER_UIE)) p->perdidas++;
+			pTim->SR |= TIM_SR_UIF;
+			p->actualizaciones++;
+			p->eventoNs = p->proximoNs;
+			p->pscEf = pTim->PSC;
+			p->arrEf = pTim->ARR;
+		}
+		p->inicioNs = p->proximoNs;
+		p->tickNs = (p->pscEf + 1.0) * 1e9 / timclk1;
+		p->proximoNs = p->inicioNs + (p->arrEf + 1.0) * p->tickNs;
+
+		if (pTim->CR1 & TIM_CR1_OPM) {
+			pTim->CR1 &= ~TIM_CR1_CEN;
+			pTim->CNT = 0;
+			p->corriendo = 0;
+		}
+	}
+}
+
+static void EMU_TIM_LEER(uint32_t k, uint32_t Off)
+{
+	if (Off == offsetof(TIM_TypeDef, CNT) && emuTim[k].corriendo)
+		EMU_REG(emuTimRegs[k])->CNT = EMU_TIM_CUENTA(k);
+}
+
+static uint32_t EMU_TIM_ESCRIBIR(uint32_t k, uint32_t Off, uint32_t Previo, uint32_t Nuevo)
+{
+	EMU_TIM* p = &emuTim[k];
+	TIM_TypeDef* pTim = EMU_REG(emuTimRegs[k]);
+
+	switch (Off) {
+	case offsetof(TIM_TypeDef, CR1):
+		pTim->CR1 = (uint16_t)Nuevo;
+		if ((Nuevo & TIM_CR1_CEN) && !p->corriendo) {
+			if (p->arrEf == 0) EMU_AVISO("%s arranca con ARR en 0 (no cuenta): falta un update", emuTimNombre[k]);
+			EMU_TIM_ARRANCAR(k);
+		}
+		else if (!(Nuevo & TIM_CR1_CEN) && p->corriendo)
+			EMU_TIM_CONGELAR(k);
+		break;
+
+	/*rc_w0:*/
+	case offsetof(TIM_TypeDef, SR):
+		return Previo & Nuevo;
+
+	/*UG reinicia la cuenta y carga el preload; UIF salvo con URS:*/
+	case offsetof(TIM_TypeDef, EGR):
+		if (Nuevo & TIM_EGR_UG) {
+			pTim->CNT = 0;
+			p->pscEf = pTim->PSC;
+			p->arrEf = pTim->ARR;
+			if (!(pTim->CR1 & TIM_CR1_URS)) pTim->SR |= TIM_SR_UIF;
+			if (p->corriendo) EMU_TIM_ARRANCAR(k);
+		}
+		return 0;
+
+	case offsetof(TIM_TypeDef, CNT):
+		pTim->CNT = Nuevo;
+		if (p->corriendo) EMU_TIM_ARRANCAR(k);
+		break;
+
+	/*Sin ARPE el auto-reload vale de inmediato:*/
+	case offsetof(TIM_TypeDef, ARR):
+		if (!(pTim->CR1 & TIM_CR1_ARPE)) {
+			if (p->corriendo) EMU_TIM_CONGELAR(k);
+			pTim->ARR = Nuevo;
+			p->arrEf = Nuevo;
+			if (pTim->CR1 & TIM_CR1_CEN) EMU_TIM_ARRANCAR(k);
+		}
+		break;
+	}
+	return Nuevo;
+}
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES - ADC:
+------------------------------------------------------------------------------*/
+static void EMU_PIN_ANALOGICO(uint32_t Puerto, uint32_t Pin, const char* pUso)
+{
+	GPIO_TypeDef* pGpio = EMU_REG((GPIO_TypeDef*)(uintptr_t)(GPIOA_BASE + 0x400u * Puerto));
+
+	if (((pGpio->MODER >> (2 * Pin)) & 3) != 3)
+		EMU_AVISO("%s: P%c%u sin modo analogico en GPIO_MODER", pUso, 'A' + Puerto, Pin);
+}
+
+/*Codigo de 12 bits de la entrada en el instante de muestreo. Todas las
+  entradas externas ven la misma senal; las internas son constantes:*/
+static uint16_t EMU_ADC_CODIGO(uint32_t Canal, double TNs)
+{
+	if (Canal == 16) return 943;			/*Sensor de temperatura, 25 C.*/
+	if (Canal == 17) return 1501;			/*VREFINT, 1.21 V.*/
+	if (Canal == 18) return 1861;			/*VBAT/2 con 3 V.*/
+
+	double v = 0.5;
+	for (uint32_t k = 0; k < nTonos; k++)
+		v += tonos[k].amp * sin(2.0 * M_PI * tonos[k].frec * TNs * 1e-9);
+
+	long codigo = lround(v * 4096.0);
+	return (uint16_t)(codigo < 0 ? 0 : codigo > 4095 ? 4095 : codigo);
+}
+
+/*Muestreo y conversion completa de un canal [ns]; devuelve los bits:*/
+static uint32_t EMU_ADC_TIEMPOS(ADC_TypeDef* pAdc, uint32_t Canal, double* pMuestreoNs, double* pTotalNs)
+{
+	static const uint16_t ciclosMuestreo[8] = {3, 15, 28, 56, 84, 112, 144, 480};
+	uint32_t smp = Canal < 10 ? (pAdc->SMPR2 >> (3 * Canal)) & 7 : (pAdc->SMPR1 >> (3 * (Canal - 10))) & 7;
+	uint32_t bits = 12 - 2 * ((pAdc->CR1 & ADC_CR1_RES) >> 24);
+	double adcclk = pclk2 / (2.0 * (((EMU_REG(ADC)->CCR & ADC_CCR_ADCPRE) >> 16) + 1));
+
+	*pMuestreoNs = ciclosMuestreo[smp] * 1e9 / adcclk;
+	*pTotalNs = (ciclosMuestreo[smp] + bits) * 1e9 / adcclk;
+	return bits;
+}
+
+static void EMU_ADC_PIN(uint32_t k, uint32_t Canal)
+{
+	char uso[24];
+
+	if (Canal > 15) return;
+	snprintf(uso, sizeof(uso), "ADC%u canal %u", k + 1, Canal);
+	if (k == 2) EMU_PIN_ANALOGICO(adcPin3[Canal][0], adcPin3[Canal][1], uso);
+	else        EMU_PIN_ANALOGICO(adcPin12[Canal][0], adcPin12[Canal][1], uso);
+}
+
+static void EMU_ADC_REGULAR(uint32_t k)
+{
+	EMU_ADC* p = &emuAdc[k];
+	ADC_TypeDef* pAdc = EMU_REG(emuAdcRegs[k]);
+	uint32_t canal = pAdc->SQR3 & ADC_SQR3_SQ1;
+	double muestreoNs, totalNs;
+
+	if (pAdc->SQR1 & ADC_SQR1_L)
+		EMU_AVISO("ADC%u: secuencia regular de varios canales, se emula solo SQ1", k + 1);
+	if (pAdc->CR2 & (ADC_CR2_CONT | ADC_CR2_DMA))
+		EMU_AVISO("ADC%u: modo continuo o DMA no emulado", k + 1);
+	EMU_ADC_PIN(k, canal);
+
+	uint32_t bits = EMU_ADC_TIEMPOS(pAdc, canal, &muestreoNs, &totalNs);
+	p->regValor = (uint16_t)(EMU_ADC_CODIGO(canal, ahoraNs + muestreoNs) >> (12 - bits));
+	if (pAdc->CR2 & ADC_CR2_ALIGN) p->regValor <<= 16 - bits;
+	p->regFinNs = ahoraNs + totalNs;
+	p->regPendiente = 1;
+	pAdc->SR |= ADC_SR_STRT;
+}
+
+/*Secuencia inyectada: JL+1 canales de JSQ(4-JL) a JSQ4, resultados en
+  JDR1.. con el offset de JOFRx restado:*/
+static void EMU_ADC_INYECTADA(uint32_t k)
+{
+	EMU_ADC* p = &emuAdc[k];
+	ADC_TypeDef* pAdc = EMU_REG(emuAdcRegs[k]);
+	uint32_t jsqr = pAdc->JSQR;
+	uint32_t n = ((jsqr & ADC_JSQR_JL) >> 20) + 1;
+	double t = ahoraNs;
+
+	for (uint32_t j = 0; j < n; j++) {
+		uint32_t canal = (jsqr >> (5 * (4 - n + j))) & 0x1F;
+		double muestreoNs, totalNs;
+
+		EMU_ADC_PIN(k, canal);
+		uint32_t bits = EMU_ADC_TIEMPOS(pAdc, canal, &muestreoNs, &totalNs);
+		int32_t v = (int32_t)(EMU_ADC_CODIGO(canal, t + muestreoNs) >> (12 - bits)) - (int32_t)(&pAdc->JOFR1)[j];
+		if (pAdc->CR2 & ADC_CR2_ALIGN) v *= 1 << (16 - bits);
+		p->injValor[j] = (uint16_t)v;
+		t += totalNs;
+	}
+	p->injN = n;
+	p->injFinNs = t;
+	p->injPendiente = 1;
+	pAdc->SR |= ADC_SR_JSTRT;
+}
+
+static void EMU_ADC_EVENTOS(uint32_t k)
+{
+	EMU_ADC* p = &emuAdc[k];
+	ADC_TypeDef* pAdc = EMU_REG(emuAdcRegs[k]);
+
+	if (p->regPendiente && p->regFinNs <= ahoraNs) {
+		p->regPendiente = 0;
+		pAdc->DR = p->regValor;
+		pAdc->SR |= ADC_SR_EOC;
+		p->finNs = p->regFinNs;
+		p->conversiones++;
+	}
+	if (p->injPendiente && p->injFinNs <= ahoraNs) {
+		p->injPendiente = 0;
+		for (uint32_t j = 0; j < p->injN; j++) (&pAdc->JDR1)[j] = p->injValor[j];
+		pAdc->SR |= ADC_SR_JEOC;
+		p->finNs = p->injFinNs;
+		p->conversiones += p->injN;
+	}
+}
+
+/*El SR se consulta para esperar el fin: con una conversion en curso el
+  core queda en el polling hasta que termina:*/
+static void EMU_AVANZAR(double HastaNs);
+
+static void EMU_ADC_LEER(uint32_t k, uint32_t Off)
+{
+	EMU_ADC* p = &emuAdc[k];
+
+	if (Off != offsetof(ADC_TypeDef, SR) || !(p->regPendiente || p->injPendiente)) return;
+
+	double finNs = p->regPendiente ? p->regFinNs : p->injFinNs;
+	if (p->regPendiente && p->injPendiente && p->injFinNs < finNs) finNs = p->injFinNs;
+	if (finNs > ahoraNs) {
+		esperaAdcNs += finNs - ahoraNs;
+		EMU_AVANZAR(finNs);
+	}
+}
+
+/*Leer DR borra EOC:*/
+static void EMU_ADC_LEIDO(uint32_t k, uint32_t Off)
+{
+	if (Off == offsetof(ADC_TypeDef, DR)) EMU_REG(emuAdcRegs[k])->SR &= ~ADC_SR_EOC;
+}
+
+static uint32_t EMU_ADC_ESCRIBIR(uint32_t k, uint32_t Off, uint32_t Previo, uint32_t Nuevo)
+{
+	switch (Off) {
+	case offsetof(ADC_TypeDef, SR):
+		return Previo & Nuevo;
+
+	case offsetof(ADC_TypeDef, CR2):
+		if ((Nuevo & ADC_CR2_ADON) && !(Previo & ADC_CR2_ADON)) {
+			double adcclk = pclk2 / (2.0 * (((EMU_REG(ADC)->CCR & ADC_CCR_ADCPRE) >> 16) + 1));
+			if (adcclk > 36e6) EMU_AVISO("ADCCLK %.1f MHz sobre 36 MHz (ADC_CCR ADCPRE)", adcclk * 1e-6);
+		}
+		if (Nuevo & (ADC_CR2_SWSTART | ADC_CR2_JSWSTART)) {
+			if (!(Nuevo & ADC_CR2_ADON))
+				EMU_AVISO("ADC%u: disparo por software con ADON en 0", k + 1);
+			else {
+				if (Nuevo & ADC_CR2_SWSTART) EMU_ADC_REGULAR(k);
+				if (Nuevo & ADC_CR2_JSWSTART) EMU_ADC_INYECTADA(k);
+			}
+		}
+		if (Nuevo & (ADC_CR2_EXTEN | ADC_CR2_JEXTEN))
+			EMU_AVISO("ADC%u: disparo externo no emulado", k + 1);
+		return Nuevo & ~(ADC_CR2_SWSTART | ADC_CR2_JSWSTART);
+
+	/*Resultados: solo lectura:*/
+	case offsetof(ADC_TypeDef, JDR1):
+	case offsetof(ADC_TypeDef, JDR2):
+	case offsetof(ADC_TypeDef, JDR3):
+	case offsetof(ADC_TypeDef, JDR4):
+	case offsetof(ADC_TypeDef, DR):
+		return Previo;
+	}
+	return Nuevo;
+}
+
+/*Registros comunes: CSR refleja los SR de los tres ADC:*/
+static void EMU_ADC_COMUN_LEER(uint32_t Indice, uint32_t Off)
+{
+	(void)Indice;
+	if (Off != offsetof(ADC_Common_TypeDef, CSR)) return;
+	EMU_REG(ADC)->CSR = (EMU_REG(ADC1)->SR & 0x3F) | ((EMU_REG(ADC2)->SR & 0x3F) << 8) |
+						((EMU_REG(ADC3)->SR & 0x3F) << 16);
+}
+
+static uint32_t EMU_ADC_COMUN_ESCRIBIR(uint32_t Indice, uint32_t Off, uint32_t Previo, uint32_t Nuevo)
+{
+	(void)Indice;
+	if (Off == offsetof(ADC_Common_TypeDef, CSR) || Off == offsetof(ADC_Common_TypeDef, CDR)) return Previo;
+	if (Off == offsetof(ADC_Common_TypeDef, CCR) && (Nuevo & ADC_CCR_MULTI))
+		EMU_AVISO("ADC_CCR: modo multiple no emulado");
+	return Nuevo;
+}
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES - DAC Y GPIO:
+------------------------------------------------------------------------------*/
+/*DHR a DOR del canal (0 o 1): directo sin TEN, o con el disparo de software:*/
+static void EMU_DAC_TRANSFERIR(uint32_t Canal, uint32_t PorSoftware)
+{
+	DAC_TypeDef* pDac = EMU_REG(DAC);
+	uint32_t cr = pDac->CR >> (16 * Canal);
+
+	if (!(cr & DAC_CR_EN1)) {
+		EMU_AVISO("DAC canal %u escrito con EN en 0", Canal + 1);
+		return;
+	}
+	if (cr & DAC_CR_DMAEN1) EMU_AVISO("DAC canal %u: DMA no emulado", Canal + 1);
+	if (cr & DAC_CR_TEN1) {
+		if (((cr & DAC_CR_TSEL1) >> 3) != 7) {
+			EMU_AVISO("DAC canal %u: disparo por timer no emulado", Canal + 1);
+			return;
+		}
+		if (!PorSoftware) return;
+	}
+	else if (PorSoftware) return;
+
+	(&pDac->DOR1)[Canal] = dacDhr[Canal];
+	dacEscrituras[Canal]++;
+	if (pSalida && canalSalida == Canal + 1) fwrite(&dacDhr[Canal], sizeof(uint16_t), 1, pSalida);
+}
+
+static uint32_t EMU_DAC_ESCRIBIR(uint32_t Indice, uint32_t Off, uint32_t Previo, uint32_t Nuevo)
+{
+	DAC_TypeDef* pDac = EMU_REG(DAC);
+	uint32_t canales = 0;
+	(void)Indice;
+
+	switch (Off) {
+	case offsetof(DAC_TypeDef, CR):
+		if ((Nuevo & DAC_CR_EN1) && !(Previo & DAC_CR_EN1)) EMU_PIN_ANALOGICO(0, 4, "DAC canal 1");
+		if ((Nuevo & DAC_CR_EN2) && !(Previo & DAC_CR_EN2)) EMU_PIN_ANALOGICO(0, 5, "DAC canal 2");
+		for (uint32_t c = 0; c < 2; c++) {
+			uint32_t cr = Nuevo >> (16 * c);
+			if ((cr & DAC_CR_EN1) && (cr & DAC_CR_DMAEN1))
+				EMU_AVISO("DAC canal %u: DMA no emulado", c + 1);
+			else if ((cr & DAC_CR_EN1) && (cr & DAC_CR_TEN1) && ((cr & DAC_CR_TSEL1) >> 3) != 7)
+				EMU_AVISO("DAC canal %u: disparo por timer no emulado", c + 1);
+		}
+		return Nuevo;
+
+	case offsetof(DAC_TypeDef, SWTRIGR):
+		if (Nuevo & DAC_SWTRIGR_SWTRIG1) EMU_DAC_TRANSFERIR(0, 1);
+		if (Nuevo & DAC_SWTRIGR_SWTRIG2) EMU_DAC_TRANSFERIR(1, 1);
+		return 0;
+
+	case offsetof(DAC_TypeDef, DHR12R1): dacDhr[0] = Nuevo & 0xFFF;         canales = 1; break;
+	case offsetof(DAC_TypeDef, DHR12L1): dacDhr[0] = (Nuevo >> 4) & 0xFFF;  canales = 1; break;
+	case offsetof(DAC_TypeDef, DHR8R1):  dacDhr[0] = (Nuevo & 0xFF) << 4;   canales = 1; break;
+	case offsetof(DAC_TypeDef, DHR12R2): dacDhr[1] = Nuevo & 0xFFF;         canales = 2; break;
+	case offsetof(DAC_TypeDef, DHR12L2): dacDhr[1] = (Nuevo >> 4) & 0xFFF;  canales = 2; break;
+	case offsetof(DAC_TypeDef, DHR8R2):  dacDhr[1] = (Nuevo & 0xFF) << 4;   canales = 2; break;
+	case offsetof(DAC_TypeDef, DHR12RD):
+		dacDhr[0] = Nuevo & 0xFFF;
+		dacDhr[1] = (Nuevo >> 16) & 0xFFF;
+		canales = 3;
+		break;
+	case offsetof(DAC_TypeDef, DHR12LD):
+		dacDhr[0] = (Nuevo >> 4) & 0xFFF;
+		dacDhr[1] = (Nuevo >> 20) & 0xFFF;
+		canales = 3;
+		break;
+	case offsetof(DAC_TypeDef, DHR8RD):
+		dacDhr[0] = (Nuevo & 0xFF) << 4;
+		dacDhr[1] = ((Nuevo >> 8) & 0xFF) << 4;
+		canales = 3;
+		break;
+
+	case offsetof(DAC_TypeDef, DOR1):
+	case offsetof(DAC_TypeDef, DOR2):
+		return Previo;
+
+	/*Underrun: rc_w1:*/
+	case offsetof(DAC_TypeDef, SR):
+		return Previo & ~Nuevo;
+
+	default:
+		return Nuevo;
+	}
+
+	/*Todas las vistas del holding register muestran el mismo valor:*/
+	pDac->DHR12R1 = dacDhr[0];
+	pDac->DHR12L1 = dacDhr[0] << 4;
+	pDac->DHR8R1  = dacDhr[0] >> 4;
+	pDac->DHR12R2 = dacDhr[1];
+	pDac->DHR12L2 = dacDhr[1] << 4;
+	pDac->DHR8R2  = dacDhr[1] >> 4;
+	pDac->DHR12RD = ((uint32_t)dacDhr[1] << 16) | dacDhr[0];
+	pDac->DHR12LD = ((uint32_t)dacDhr[1] << 20) | ((uint32_t)dacDhr[0] << 4);
+	pDac->DHR8RD  = ((uint32_t)(dacDhr[1] >> 4) << 8) | (dacDhr[0] >> 4);
+
+	if (canales & 1) EMU_DAC_TRANSFERIR(0, 0);
+	if (canales & 2) EMU_DAC_TRANSFERIR(1, 0);
+	return *(uint32_t*)((uint8_t*)pDac + Off);
+}
+
+/*BSRR (BSRRL/BSRRH) pone y borra bits de ODR y lee 0; IDR sigue a ODR:*/
+static uint32_t EMU_GPIO_ESCRIBIR(uint32_t Indice, uint32_t Off, uint32_t Previo, uint32_t Nuevo)
+{
+	GPIO_TypeDef* pGpio = EMU_REG((GPIO_TypeDef*)(uintptr_t)(GPIOA_BASE + 0x400u * Indice));
+
+	switch (Off) {
+	case offsetof(GPIO_TypeDef, IDR):
+		return Previo;
+	case offsetof(GPIO_TypeDef, ODR):
+		pGpio->IDR = Nuevo & 0xFFFF;
+		return Nuevo & 0xFFFF;
+	case offsetof(GPIO_TypeDef, BSRRL): {
+		uint32_t odr = (pGpio->ODR & ~(Nuevo >> 16)) | (Nuevo & 0xFFFF);
+		pGpio->ODR = odr;
+		pGpio->IDR = odr;
+		return 0;
+	}
+	}
+	return Nuevo;
+}
+
+/*DMA y USART no se emulan: sus registros son memoria. Se avisa al
+  habilitar un stream o el USART, que es cuando el firmware espera algo:*/
+static uint32_t EMU_DMA_ESCRIBIR(uint32_t Indice, uint32_t Off, uint32_t Previo, uint32_t Nuevo)
+{
+	if (Off >= 0x10 && (Off - 0x10) % 0x18 == 0 && (Nuevo & DMA_SxCR_EN) && !(Previo & DMA_SxCR_EN))
+		EMU_AVISO("DMA%u stream %u: DMA no emulado", Indice, (Off - 0x10) / 0x18);
+	return Nuevo;
+}
+
+static uint32_t EMU_USART_ESCRIBIR(uint32_t Indice, uint32_t Off, uint32_t Previo, uint32_t Nuevo)
+{
+	if (Off == offsetof(USART_TypeDef, CR1) && (Nuevo & USART_CR1_UE) && !(Previo & USART_CR1_UE))
+		EMU_AVISO("USART%u no emulado", Indice);
+	return Nuevo;
+}
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES - RCC, PWR Y FLASH:
+------------------------------------------------------------------------------*/
+static void EMU_RESET_VALORES(void);
+
+/*Reset de perifericos por los bits de xRSTR:*/
+static void EMU_RESET_PERIFERICOS(uint32_t Off, uint32_t Bits)
+{
+	if (Off == offsetof(RCC_TypeDef, APB1RSTR)) {
+		for (uint32_t k = 0; k < EMU_TIMERS; k++)
+			if (Bits & (1u << k)) {
+				memset(EMU_REG(emuTimRegs[k]), 0, sizeof(TIM_TypeDef));
+				memset(&emuTim[k], 0, sizeof(EMU_TIM));
+			}
+		if (Bits & RCC_APB1RSTR_DACRST) {
+			memset(EMU_REG(DAC), 0, sizeof(DAC_TypeDef));
+			dacDhr[0] = dacDhr[1] = 0;
+		}
+	}
+	else if (Off == offsetof(RCC_TypeDef, APB2RSTR) && (Bits & RCC_APB2RSTR_ADCRST)) {
+		for (uint32_t k = 0; k < EMU_ADCS; k++) {
+			memset(EMU_REG(emuAdcRegs[k]), 0, sizeof(ADC_TypeDef));
+			memset(&emuAdc[k], 0, sizeof(EMU_ADC));
+		}
+		memset(EMU_REG(ADC), 0, sizeof(ADC_Common_TypeDef));
+	}
+	else if (Off == offsetof(RCC_TypeDef, AHB1RSTR) && (Bits & 0x7FF))
+		EMU_AVISO("reset de GPIO por RCC_AHB1RSTR: se ignora");
+}
+
+static uint32_t EMU_RCC_ESCRIBIR(uint32_t Indice, uint32_t Off, uint32_t Previo, uint32_t Nuevo)
+{
+	RCC_TypeDef* pRcc = EMU_REG(RCC);
+	(void)Indice;
+
+	switch (Off) {
+	/*Los osciladores y PLL quedan listos al encenderse:*/
+	case offsetof(RCC_TypeDef, CR): {
+		const uint32_t listos = RCC_CR_HSIRDY | RCC_CR_HSERDY | RCC_CR_PLLRDY | RCC_CR_PLLI2SRDY | RCC_CR_PLLSAIRDY;
+		uint32_t listo = 0;
+
+		if ((pRcc->CFGR & RCC_CFGR_SWS) == RCC_CFGR_SWS_PLL && !(Nuevo & RCC_CR_PLLON)) {
+			EMU_AVISO("RCC_CR: PLL apagado mientras es el clock del sistema, se ignora");
+			Nuevo |= RCC_CR_PLLON;
+		}
+		if (Nuevo & RCC_CR_HSION) listo |= RCC_CR_HSIRDY;
+		if (Nuevo & RCC_CR_HSEON) listo |= RCC_CR_HSERDY;
+		if (Nuevo & RCC_CR_PLLON) listo |= RCC_CR_PLLRDY;
+		if (Nuevo & RCC_CR_PLLI2SON) listo |= RCC_CR_PLLI2SRDY;
+		if (Nuevo & RCC_CR_PLLSAION) listo |= RCC_CR_PLLSAIRDY;
+		Nuevo = (Nuevo & ~listos) | listo;
+		pRcc->CR = Nuevo;
+		if ((Nuevo & RCC_CR_PLLON) && !(Previo & RCC_CR_PLLON)) EMU_VALIDAR_PLL();
+		return Nuevo;
+	}
+
+	/*SWS sigue a SW si la fuente esta lista:*/
+	case offsetof(RCC_TypeDef, CFGR): {
+		uint32_t sw = Nuevo & RCC_CFGR_SW;
+		uint32_t cr = pRcc->CR;
+		uint32_t sws = Previo & RCC_CFGR_SWS;
+
+		if ((sw == 0 && (cr & RCC_CR_HSIRDY)) || (sw == 1 && (cr & RCC_CR_HSERDY)) || (sw == 2 && (cr & RCC_CR_PLLRDY)))
+			sws = sw << 2;
+		else
+			EMU_AVISO("RCC_CFGR: SW = %u con la fuente sin listo, se ignora", sw);
+		pRcc->CFGR = (Nuevo & ~RCC_CFGR_SWS) | sws;
+		EMU_RELOJES();
+		return pRcc->CFGR;
+	}
+
+	case offsetof(RCC_TypeDef, PLLCFGR):
+		if (pRcc->CR & RCC_CR_PLLON) {
+			EMU_AVISO("RCC_PLLCFGR escrito con el PLL encendido, se ignora");
+			return Previo;
+		}
+		return Nuevo;
+
+	case offsetof(RCC_TypeDef, AHB1RSTR):
+	case offsetof(RCC_TypeDef, APB1RSTR):
+	case offsetof(RCC_TypeDef, APB2RSTR):
+		EMU_RESET_PERIFERICOS(Off, Nuevo & ~Previo);
+		return Nuevo;
+	}
+	return Nuevo;
+}
+
+/*VOSRDY siempre; ODRDY con ODEN y ODSWRDY con ODSWEN sobre ODRDY:*/
+static uint32_t EMU_PWR_ESCRIBIR(uint32_t Indice, uint32_t Off, uint32_t Previo, uint32_t Nuevo)
+{
+	const uint32_t oden = 1u << 16, odswen = 1u << 17, vosrdy = 1u << 14;
+	PWR_TypeDef* pPwr = EMU_REG(PWR);
+	(void)Indice;
+
+	if (Off == offsetof(PWR_TypeDef, CSR)) return (Nuevo & ~(oden | odswen | vosrdy)) | (Previo & (oden | odswen | vosrdy));
+	if (Off != offsetof(PWR_TypeDef, CR)) return Nuevo;
+
+	if ((Nuevo & odswen) && !(Nuevo & oden)) EMU_AVISO("PWR_CR: ODSWEN sin ODEN");
+	uint32_t csr = (pPwr->CSR & ~(oden | odswen)) | vosrdy;
+	if (Nuevo & oden) csr |= oden;
+	if ((Nuevo & odswen) && (Nuevo & oden)) csr |= odswen;
+	pPwr->CSR = csr;
+	return Nuevo;
+}
+
+static uint32_t EMU_FLASH_ESCRIBIR(uint32_t Indice, uint32_t Off, uint32_t Previo, uint32_t Nuevo)
+{
+	(void)Indice;
+	(void)Previo;
+	if (Off == offsetof(FLASH_TypeDef, ACR)) {
+		uint32_t ws = Nuevo & FLASH_ACR_LATENCY;
+		if (hclk > (ws + 1) * 30e6)
+			EMU_AVISO("FLASH_ACR con %u wait states para HCLK %.1f MHz", ws, hclk * 1e-6);
+	}
+	return Nuevo;
+}
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES - CORE (NVIC, SCB, DWT):
+------------------------------------------------------------------------------*/
+/*CYCCNT corre con TRCENA y CYCCNTENA:*/
+static uint32_t EMU_CYCCNT(void)
+{
+	if (!cyccntCorre) return cyccntValor;
+	return cyccntValor + (uint32_t)(uint64_t)(ciclos - cyccntBase);
+}
+
+static void EMU_CYCCNT_ESTADO(void)
+{
+	uint8_t corre = (EMU_REG(CoreDebug)->DEMCR & CoreDebug_DEMCR_TRCENA_Msk) &&
+					(EMU_REG(DWT)->CTRL & DWT_CTRL_CYCCNTENA_Msk);
+	cyccntValor = EMU_CYCCNT();
+	cyccntBase = ciclos;
+	cyccntCorre = corre;
+}
+
+static void EMU_DWT_LEER(uint32_t Indice, uint32_t Off)
+{
+	(void)Indice;
+	if (Off != offsetof(DWT_Type, CYCCNT)) return;
+	if (!cyccntCorre && !acceso.escritura) EMU_AVISO("DWT_CYCCNT leido detenido (falta TRCENA en DEMCR o CYCCNTENA)");
+	EMU_REG(DWT)->CYCCNT = EMU_CYCCNT();
+}
+
+static uint32_t EMU_DWT_ESCRIBIR(uint32_t Indice, uint32_t Off, uint32_t Previo, uint32_t Nuevo)
+{
+	(void)Indice;
+	(void)Previo;
+	if (Off == offsetof(DWT_Type, CYCCNT)) {
+		cyccntValor = Nuevo;
+		cyccntBase = ciclos;
+	}
+	else if (Off == offsetof(DWT_Type, CTRL)) {
+		EMU_REG(DWT)->CTRL = (Nuevo & 0x0FFFFFFF) | (4u << 28);		/*NUMCOMP = 4.*/
+		EMU_CYCCNT_ESTADO();
+		return EMU_REG(DWT)->CTRL;
+	}
+	return Nuevo;
+}
+
+/*Fuente de cada vector activa (nivel) y su ultimo evento:*/
+static int EMU_NIVEL(const EMU_VECTOR* pV, double* pEventoNs)
+{
+	if (pV->irq == ADC_IRQn) {
+		int nivel = 0;
+		for (uint32_t k = 0; k < EMU_ADCS; k++) {
+			ADC_TypeDef* pAdc = EMU_REG(emuAdcRegs[k]);
+			uint32_t sr = pAdc->SR, cr1 = pAdc->CR1;
+			if (((sr & ADC_SR_EOC) && (cr1 & ADC_CR1_EOCIE)) || ((sr & ADC_SR_JEOC) && (cr1 & ADC_CR1_JEOCIE)) ||
+				((sr & ADC_SR_AWD) && (cr1 & ADC_CR1_AWDIE)) || ((sr & ADC_SR_OVR) && (cr1 & ADC_CR1_OVRIE))) {
+				nivel = 1;
+				*pEventoNs = emuAdc[k].finNs;
+			}
+		}
+		return nivel;
+	}
+	for (uint32_t k = 0; k < EMU_TIMERS; k++) {
+		static const IRQn_Type irqTim[EMU_TIMERS] = {TIM2_IRQn, TIM3_IRQn, TIM4_IRQn, TIM5_IRQn, TIM6_DAC_IRQn, TIM7_IRQn};
+		if (irqTim[k] != pV->irq) continue;
+		TIM_TypeDef* pTim = EMU_REG(emuTimRegs[k]);
+		*pEventoNs = emuTim[k].eventoNs;
+		return (pTim->SR & pTim->DIER & 0x7F) != 0;
+	}
+	return 0;
+}
+
+static uint32_t EMU_GRUPO(uint32_t Prioridad)
+{
+	uint32_t prigroup = (EMU_REG(SCB)->AIRCR & SCB_AIRCR_PRIGROUP_Msk) >> SCB_AIRCR_PRIGROUP_Pos;
+	return Prioridad >> (prigroup + 1);
+}
+
+/*Pendiente habilitada de mayor prioridad que preempta a la activa, o NULL.
+  Con Mascaras respeta BASEPRI (WFI despierta igual con PRIMASK):*/
+static EMU_VECTOR* EMU_ELEGIR(uint32_t* pGrupo, double* pEventoNs)
+{
+	EMU_VECTOR* pMejor = NULL;
+	uint32_t prioMejor = 0x100;
+
+	for (uint32_t v = 0; v < EMU_VECTORES; v++) {
+		EMU_VECTOR* pV = &emuVector[v];
+		uint32_t n = pV->irq, bit = 1u << (n & 31);
+		double eventoNs = ahoraNs;
+
+		if (!(nvicHab[n >> 5] & bit) || (nvicActivas[n >> 5] & bit)) continue;
+		if (!(nvicPend[n >> 5] & bit) && !EMU_NIVEL(pV, &eventoNs)) continue;
+
+		uint32_t prio = EMU_REG(NVIC)->IP[n];
+		uint32_t grupo = EMU_GRUPO(prio);
+		if (grupo >= grupoActivo) continue;
+		if (basepri && grupo >= EMU_GRUPO(basepri)) continue;
+		if (prio < prioMejor) {
+			prioMejor = prio;
+			pMejor = pV;
+			*pGrupo = grupo;
+			*pEventoNs = eventoNs;
+		}
+	}
+	return pMejor;
+}
+
+static void EMU_SINCRONIZAR(void);
+
+/*Entrada a la interrupcion: el handler es codigo del firmware:*/
+static void EMU_EXCEPCION(EMU_VECTOR* pV, uint32_t Grupo, double EventoNs)
+{
+	uint32_t n = pV->irq, bit = 1u << (n & 31);
+	uint32_t grupoPrevio = grupoActivo, ipsrPrevio = ipsr;
+	sig_atomic_t enEmuladorPrevio = enEmulador;
+
+	if (!pV->pfnIsr) {
+		fprintf(stderr, "stm32Emu: %s_IRQn habilitada sin handler (Default_Handler)\n", pV->nombre);
+		EMU_FIN("interrupcion sin handler");
+	}
+
+	/*El apilado es parte de la latencia:*/
+	pendientes += EMU_CICLOS_ENTRADA;
+	ciclosIrq += EMU_CICLOS_ENTRADA;
+	EMU_SINCRONIZAR();
+
+	double latenciaNs = ahoraNs - EventoNs;
+	if (latenciaNs < 0.0) latenciaNs = 0.0;
+	pV->latenciaTotalNs += latenciaNs;
+	if (latenciaNs > pV->latenciaMaxNs) pV->latenciaMaxNs = latenciaNs;
+
+	nvicPend[n >> 5] &= ~bit;
+	nvicActivas[n >> 5] |= bit;
+	grupoActivo = Grupo;
+	ipsr = n + 16;
+	double c0 = ciclos;
+
+	enEmulador = 0;
+	pV->pfnIsr();
+	enEmulador = enEmuladorPrevio;
+	pendientes += EMU_CICLOS_SALIDA;
+	ciclosIrq += EMU_CICLOS_SALIDA;
+	EMU_SINCRONIZAR();
+
+	double c = ciclos - c0;
+	pV->entradas++;
+	pV->ciclosTotal += c;
+	if (c > pV->ciclosMax) pV->ciclosMax = c;
+
+	nvicActivas[n >> 5] &= ~bit;
+	grupoActivo = grupoPrevio;
+	ipsr = ipsrPrevio;
+}
+
+/*Atiende las pendientes que preemptan, con tail-chaining:*/
+static void EMU_ATENDER(void)
+{
+	uint32_t grupo;
+	double eventoNs;
+	EMU_VECTOR* pV;
+
+	while (!primask && (pV = EMU_ELEGIR(&grupo, &eventoNs)) != NULL)
+		EMU_EXCEPCION(pV, grupo, eventoNs);
+}
+
+static void EMU_SCS_LEER(uint32_t Indice, uint32_t Off)
+{
+	NVIC_Type* pNvic = EMU_REG(NVIC);
+	(void)Indice;
+
+	/*ISPR/ICPR: pendientes por software o por nivel de la fuente:*/
+	if (Off >= 0x200 && Off < 0x300) {
+		uint32_t w = (Off & 0x7F) / 4, pend = nvicPend[w];
+		for (uint32_t v = 0; v < EMU_VECTORES; v++) {
+			double eventoNs;
+			if ((uint32_t)emuVector[v].irq >> 5 == w && EMU_NIVEL(&emuVector[v], &eventoNs))
+				pend |= 1u << (emuVector[v].irq & 31);
+		}
+		pNvic->ISPR[w] = pend;
+		pNvic->ICPR[w] = pend;
+	}
+	else if (Off == 0xD04)
+		EMU_REG(SCB)->ICSR = (EMU_REG(SCB)->ICSR & ~SCB_ICSR_VECTACTIVE_Msk) | ipsr;
+}
+
+static uint32_t EMU_SCS_ESCRIBIR(uint32_t Indice, uint32_t Off, uint32_t Previo, uint32_t Nuevo)
+{
+	NVIC_Type* pNvic = EMU_REG(NVIC);
+	uint32_t w = (Off & 0x7F) / 4;
+	(void)Indice;
+
+	/*ISER/ICER y ISPR/ICPR: escribir 1 pone o borra, ambos leen el estado:*/
+	if (Off >= 0x100 && Off < 0x120) nvicHab[w] |= Nuevo;
+	else if (Off >= 0x180 && Off < 0x1A0) nvicHab[w] &= ~Nuevo;
+	else if (Off >= 0x200 && Off < 0x220) nvicPend[w] |= Nuevo;
+	else if (Off >= 0x280 && Off < 0x2A0) nvicPend[w] &= ~Nuevo;
+	else if (Off >= 0x300 && Off < 0x320) return Previo;			/*IABR.*/
+	else if (Off == 0xF00) {										/*STIR.*/
+		nvicPend[(Nuevo & 0x1FF) >> 5] |= 1u << (Nuevo & 31);
+		return 0;
+	}
+	else if (Off == 0xD00) return Previo;							/*CPUID.*/
+	else if (Off == 0xD0C) {										/*AIRCR.*/
+		if ((Nuevo >> 16) != 0x05FA) {
+			EMU_AVISO("SCB_AIRCR escrito sin VECTKEY, se ignora");
+			return Previo;
+		}
+		if (Nuevo & SCB_AIRCR_SYSRESETREQ_Msk) EMU_FIN("reset por software (SYSRESETREQ)");
+		return 0xFA050000u | (Nuevo & SCB_AIRCR_PRIGROUP_Msk);
+	}
+	else if (Off == 0xDFC) {										/*DEMCR.*/
+		EMU_REG(CoreDebug)->DEMCR = Nuevo;
+		EMU_CYCCNT_ESTADO();
+		return Nuevo;
+	}
+	else if (Off == 0x010) {										/*SysTick CTRL.*/
+		if ((Nuevo & SysTick_CTRL_ENABLE_Msk) && (Nuevo & SysTick_CTRL_TICKINT_Msk))
+			EMU_AVISO("SysTick no emulado");
+		return Nuevo;
+	}
+	else return Nuevo;
+
+	if (Off < 0x200) {
+		pNvic->ISER[w] = nvicHab[w];
+		pNvic->ICER[w] = nvicHab[w];
+		return nvicHab[w];
+	}
+	pNvic->ISPR[w] = nvicPend[w];
+	pNvic->ICPR[w] = nvicPend[w];
+	return nvicPend[w];
+}
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES - MAPA Y TIEMPO:
+------------------------------------------------------------------------------*/
+#define EMU_GPIO_PERIF(L, n)	{"GPIO" #L, GPIO##L##_BASE, 0x400, offsetof(RCC_TypeDef, AHB1ENR), 1u << (n), n, NULL, EMU_GPIO_ESCRIBIR, NULL}
+#define EMU_TIM_PERIF(n, k)		{"TIM" #n, TIM##n##_BASE, 0x400, offsetof(RCC_TypeDef, APB1ENR), 1u << (k), k, EMU_TIM_LEER, EMU_TIM_ESCRIBIR, NULL}
+#define EMU_ADC_PERIF(n, k)		{"ADC" #n, ADC##n##_BASE, 0x100, offsetof(RCC_TypeDef, APB2ENR), RCC_APB2ENR_ADC##n##EN, k, EMU_ADC_LEER, EMU_ADC_ESCRIBIR, EMU_ADC_LEIDO}
+
+static const EMU_PERIF emuPerif[] =
+{
+	EMU_GPIO_PERIF(A, 0), EMU_GPIO_PERIF(B, 1), EMU_GPIO_PERIF(C, 2), EMU_GPIO_PERIF(D, 3),
+	EMU_GPIO_PERIF(E, 4), EMU_GPIO_PERIF(F, 5), EMU_GPIO_PERIF(G, 6), EMU_GPIO_PERIF(H, 7),
+	EMU_GPIO_PERIF(I, 8), EMU_GPIO_PERIF(J, 9), EMU_GPIO_PERIF(K, 10),
+	EMU_TIM_PERIF(2, 0), EMU_TIM_PERIF(3, 1), EMU_TIM_PERIF(4, 2),
+	EMU_TIM_PERIF(5, 3), EMU_TIM_PERIF(6, 4), EMU_TIM_PERIF(7, 5),
+	EMU_ADC_PERIF(1, 0), EMU_ADC_PERIF(2, 1), EMU_ADC_PERIF(3, 2),
+	{"ADC",   ADC_BASE,       0x100, offsetof(RCC_TypeDef, APB2ENR), RCC_APB2ENR_ADC1EN, 0, EMU_ADC_COMUN_LEER, EMU_ADC_COMUN_ESCRIBIR, NULL},
+	{"DAC",   DAC_BASE,       0x400, offsetof(RCC_TypeDef, APB1ENR), RCC_APB1ENR_DACEN,  0, NULL, EMU_DAC_ESCRIBIR, NULL},
+	{"PWR",   PWR_BASE,       0x400, offsetof(RCC_TypeDef, APB1ENR), RCC_APB1ENR_PWREN,  0, NULL, EMU_PWR_ESCRIBIR, NULL},
+	{"RCC",   RCC_BASE,       0x400, 0, 0, 0, NULL, EMU_RCC_ESCRIBIR, NULL},
+	{"FLASH", FLASH_R_BASE,   0x400, 0, 0, 0, NULL, EMU_FLASH_ESCRIBIR, NULL},
+	{"DMA1",  DMA1_BASE,      0x400, offsetof(RCC_TypeDef, AHB1ENR), RCC_AHB1ENR_DMA1EN, 1, NULL, EMU_DMA_ESCRIBIR, NULL},
+	{"DMA2",  DMA2_BASE,      0x400, offsetof(RCC_TypeDef, AHB1ENR), RCC_AHB1ENR_DMA2EN, 2, NULL, EMU_DMA_ESCRIBIR, NULL},
+	{"USART1", USART1_BASE,   0x400, offsetof(RCC_TypeDef, APB2ENR), RCC_APB2ENR_USART1EN, 1, NULL, EMU_USART_ESCRIBIR, NULL},
+	{"SCS",   SCS_BASE,       0x1000, 0, 0, 0, EMU_SCS_LEER, EMU_SCS_ESCRIBIR, NULL},
+	{"DWT",   DWT_BASE,       0x1000, 0, 0, 0, EMU_DWT_LEER, EMU_DWT_ESCRIBIR, NULL},
+};
+#define EMU_PERIFERICOS	(sizeof(emuPerif) / sizeof(emuPerif[0]))
+
+static const EMU_PERIF* EMU_PERIFERICO(uintptr_t Dir)
+{
+	for (uint32_t k = 0; k < EMU_PERIFERICOS; k++)
+		if (Dir - emuPerif[k].base < emuPerif[k].largo) return &emuPerif[k];
+	return NULL;
+}
+
+static int EMU_CON_RELOJ(const EMU_PERIF* pPerif)
+{
+	if (pPerif->enOffset == 0) return 1;
+	return (*(uint32_t*)((uint8_t*)EMU_REG(RCC) + pPerif->enOffset) & pPerif->enBit) != 0;
+}
+
+/*Proximo evento de un periferico [ns], o INFINITY:*/
+static double EMU_PROXIMO(void)
+{
+	double t = INFINITY;
+
+	for (uint32_t k = 0; k < EMU_TIMERS; k++)
+		if (emuTim[k].corriendo && emuTim[k].proximoNs < t) t = emuTim[k].proximoNs;
+	for (uint32_t k = 0; k < EMU_ADCS; k++) {
+		if (emuAdc[k].regPendiente && emuAdc[k].regFinNs < t) t = emuAdc[k].regFinNs;
+		if (emuAdc[k].injPendiente && emuAdc[k].injFinNs < t) t = emuAdc[k].injFinNs;
+	}
+	return t;
+}
+
+/*Ciclos del firmware hasta el proximo evento o el fin, para preemptar en
+  el bloque basico que lo cruza:*/
+static void EMU_PROGRAMAR(void)
+{
+	double t = EMU_PROXIMO();
+
+	if (t > limiteNs) t = limiteNs;
+	hastaEvento = (t - ahoraNs) * hclk * 1e-9;
+}
+
+static void EMU_AVANZAR(double HastaNs)
+{
+	if (HastaNs > ahoraNs) {
+		ciclos += (HastaNs - ahoraNs) * hclk * 1e-9;
+		ahoraNs = HastaNs;
+	}
+	for (uint32_t k = 0; k < EMU_TIMERS; k++) EMU_TIM_EVENTOS(k);
+	for (uint32_t k = 0; k < EMU_ADCS; k++) EMU_ADC_EVENTOS(k);
+	if (ahoraNs >= limiteNs) EMU_FIN(NULL);
+	EMU_PROGRAMAR();
+}
+
+/*Lleva el tiempo virtual al del firmware (ciclos pendientes al HCLK
+  vigente):*/
+static void EMU_SINCRONIZAR(void)
+{
+	double d = pendientes / hclk * 1e9;
+
+	pendientes = 0.0;
+	ocupadoNs += d;
+	EMU_AVANZAR(ahoraNs + d);
+}
+
+/*Ciclos de un acceso segun el bus: la lectura de APB espera el divisor
+  de su reloj mas la sincronizacion, la de AHB un ciclo de espera; las
+  escrituras las absorbe el buffer de escritura y el PPB es del core:*/
+static double EMU_CICLOS_ACCESO(uintptr_t Dir, uint8_t Escritura)
+{
+	if (Escritura || Dir >= EMU_CORE_BASE) return 1.0;
+	if (Dir < APB2PERIPH_BASE) return hclk / pclk1 + 1.0;
+	if (Dir < AHB1PERIPH_BASE) return hclk / pclk2 + 1.0;
+	return 2.0;
+}
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES - SENALES:
+------------------------------------------------------------------------------*/
+/*Falla de un acceso del firmware: actualiza el registro y deja pasar la
+  instruccion con el trap flag:*/
+static void EMU_FALLA(int Sig, siginfo_t* pInfo, void* pCtx)
+{
+	ucontext_t* pUc = pCtx;
+	uintptr_t dir = (uintptr_t)pInfo->si_addr;
+	(void)Sig;
+
+	if (!EMU_ES_REGISTRO(dir) || acceso.enCurso) {
+		signal(SIGSEGV, SIG_DFL);
+		return;
+	}
+	acceso.dir = dir & ~(uintptr_t)3;
+	acceso.escritura = (pUc->uc_mcontext.gregs[REG_ERR] & EMU_ERR_ESCRITURA) != 0;
+	acceso.enCurso = 1;
+
+	double c = EMU_CICLOS_ACCESO(acceso.dir, acceso.escritura);
+	pendientes += c;
+	ciclosAccesos += c;
+	accesos++;
+	EMU_SINCRONIZAR();
+	acceso.pPerif = EMU_PERIFERICO(acceso.dir);
+	acceso.sinReloj = acceso.pPerif && !EMU_CON_RELOJ(acceso.pPerif);
+	if (acceso.sinReloj)
+		EMU_AVISO("acceso a %s con su clock deshabilitado en RCC%s", acceso.pPerif->nombre,
+				  acceso.escritura ? " (la escritura se ignora)" : "");
+	else if (acceso.pPerif && acceso.pPerif->pfnLeer)
+		acceso.pPerif->pfnLeer(acceso.pPerif->indice, (uint32_t)(acceso.dir - acceso.pPerif->base));
+	acceso.previo = *(uint32_t*)EMU_ALIAS(acceso.dir);
+
+	mprotect((void*)(dir & ~(uintptr_t)(EMU_PAGINA - 1)), EMU_PAGINA, acceso.escritura ? PROT_READ | PROT_WRITE : PROT_READ);
+	pUc->uc_mcontext.gregs[REG_EFL] |= EMU_TF;
+}
+
+/*Paso completado: protege la pagina y aplica la semantica del acceso:*/
+static void EMU_PASO(int Sig, siginfo_t* pInfo, void* pCtx)
+{
+	ucontext_t* pUc = pCtx;
+	(void)Sig;
+	(void)pInfo;
+
+	if (!acceso.enCurso) {
+		signal(SIGTRAP, SIG_DFL);
+		return;
+	}
+	pUc->uc_mcontext.gregs[REG_EFL] &= ~EMU_TF;
+	mprotect((void*)(acceso.dir & ~(uintptr_t)(EMU_PAGINA - 1)), EMU_PAGINA, PROT_NONE);
+	acceso.enCurso = 0;
+
+	const EMU_PERIF* pPerif = acceso.pPerif;
+	uint32_t* pReg = EMU_ALIAS(acceso.dir);
+	if (acceso.escritura) {
+		if (acceso.sinReloj) *pReg = acceso.previo;
+		else if (pPerif && pPerif->pfnEscribir)
+			*pReg = pPerif->pfnEscribir(pPerif->indice, (uint32_t)(acceso.dir - pPerif->base), acceso.previo, *pReg);
+	}
+	else if (pPerif && !acceso.sinReloj && pPerif->pfnLeido)
+		pPerif->pfnLeido(pPerif->indice, (uint32_t)(acceso.dir - pPerif->base));
+
+	/*La escritura pudo arrancar un timer o una conversion:*/
+	EMU_PROGRAMAR();
+	EMU_ATENDER();
+}
+
+/*------------------------------------------------------------------------------
+CONTADOR DE BLOQUES (-fsanitize-coverage=trace-pc en el firmware):
+------------------------------------------------------------------------------*/
+/*Cada bloque basico del firmware cuesta -x ciclos; el que cruza el
+  proximo evento lo lleva al tiempo virtual y atiende lo que preempte:*/
+void __sanitizer_cov_trace_pc(void)
+{
+	bloques++;
+	pendientes += ciclosBloque;
+	if (pendientes < hastaEvento || enEmulador) return;
+
+	enEmulador = 1;
+	EMU_SINCRONIZAR();
+	EMU_ATENDER();
+	enEmulador = 0;
+}
+
+/*------------------------------------------------------------------------------
+FUNCIONES DEL CORE PARA EL FIRMWARE (emu/core_cmInstr.h, emu/core_cmFunc.h):
+------------------------------------------------------------------------------*/
+/*WFI: salta al proximo evento hasta que haya una interrupcion pendiente
+  con prioridad suficiente (despierta aun con PRIMASK, sin atenderla):*/
+void EMU_WFI(void)
+{
+	uint32_t grupo;
+	double eventoNs;
+	uint32_t primaskPrevio = primask;
+
+	enEmulador = 1;
+	EMU_SINCRONIZAR();
+
+	primask = 0;
+	while (EMU_ELEGIR(&grupo, &eventoNs) == NULL) {
+		double t = EMU_PROXIMO();
+		if (t == INFINITY) EMU_FIN("WFI sin eventos pendientes: el core no despertaria");
+		if (t > limiteNs) t = limiteNs;
+		dormidoNs += t - ahoraNs;
+		EMU_AVANZAR(t);
+	}
+	primask = primaskPrevio;
+
+	EMU_ATENDER();
+	enEmulador = 0;
+}
+
+void EMU_PRIMASK(uint32_t Valor)
+{
+	primask = Valor;
+	if (Valor || enEmulador) return;
+
+	/*Al rehabilitar se atienden las que quedaron pendientes:*/
+	enEmulador = 1;
+	EMU_SINCRONIZAR();
+	EMU_ATENDER();
+	enEmulador = 0;
+}
+
+uint32_t EMU_GET_PRIMASK(void)
+{
+	return primask;
+}
+
+void EMU_BASEPRI(uint32_t Valor)
+{
+	uint32_t previo = basepri;
+
+	basepri = Valor;
+	if (enEmulador || (Valor && (!previo || Valor <= previo))) return;
+
+	enEmulador = 1;
+	EMU_SINCRONIZAR();
+	EMU_ATENDER();
+	enEmulador = 0;
+}
+
+uint32_t EMU_GET_BASEPRI(void)
+{
+	return basepri;
+}
+
+uint32_t EMU_IPSR(void)
+{
+	return ipsr;
+}
+
+/*------------------------------------------------------------------------------
+ARRANQUE E INFORME:
+------------------------------------------------------------------------------*/
+static void EMU_INFORME(void)
+{
+	double hostS = (HOST_NS() - inicioHostNs) * 1e-9;
+	double t = ahoraNs > 0.0 ? ahoraNs : 1.0;
+	double ocupacion = (ahoraNs - dormidoNs) / t;
+
+	fprintf(stderr, "stm32Emu: %.6f s virtuales en %.2f s de CPU del host (%.3fx tiempo real)\n",
+			ahoraNs * 1e-9, hostS, ahoraNs * 1e-9 / hostS);
+	fprintf(stderr, "  HCLK %.1f MHz, PCLK1 %.1f MHz, PCLK2 %.1f MHz, %g ciclos por bloque\n",
+			hclk * 1e-6, pclk1 * 1e-6, pclk2 * 1e-6, ciclosBloque);
+	fprintf(stderr, "  %llu bloques basicos, %llu accesos a registros (%.0f ciclos), %.0f ciclos de entrada y salida de IRQ\n",
+			(unsigned long long)bloques, (unsigned long long)accesos, ciclosAccesos, ciclosIrq);
+	fprintf(stderr, "  CPU ocupada %.2f %% (firmware %.2f %%, espera de ADC %.2f %%), en WFI %.2f %%\n",
+			100.0 * ocupacion, 100.0 * ocupadoNs / t, 100.0 * esperaAdcNs / t, 100.0 * dormidoNs / t);
+
+	/*Interrupcion de muestreo: la de update mas frecuente:*/
+	double fsMax = 0.0, perdidas = 0.0;
+	for (uint32_t k = 0; k < EMU_TIMERS; k++) {
+		if (!emuTim[k].actualizaciones) continue;
+		double f = emuTim[k].actualizaciones / (ahoraNs * 1e-9);
+		fprintf(stderr, "  %s: %llu updates (%.1f Hz), %llu perdidos\n", emuTimNombre[k],
+				(unsigned long long)emuTim[k].actualizaciones, f, (unsigned long long)emuTim[k].perdidas);
+		if ((EMU_REG(emuTimRegs[k])->DIER & TIM_DIER_UIE) && f > fsMax) {
+			fsMax = f;
+			perdidas = (double)emuTim[k].perdidas;
+		}
+	}
+	for (uint32_t k = 0; k < EMU_ADCS; k++)
+		if (emuAdc[k].conversiones)
+			fprintf(stderr, "  ADC%u: %llu conversiones\n", k + 1, (unsigned long long)emuAdc[k].conversiones);
+	for (uint32_t c = 0; c < 2; c++)
+		if (dacEscrituras[c])
+			fprintf(stderr, "  DAC canal %u: %llu escrituras\n", c + 1, (unsigned long long)dacEscrituras[c]);
+	for (uint32_t v = 0; v < EMU_VECTORES; v++) {
+		EMU_VECTOR* pV = &emuVector[v];
+		if (!pV->entradas) continue;
+		fprintf(stderr, "  IRQ %s: %llu entradas, %.0f ciclos medio, %.0f max; latencia %.2f us media, %.2f max\n",
+				pV->nombre, (unsigned long long)pV->entradas, pV->ciclosTotal / pV->entradas, pV->ciclosMax,
+				pV->latenciaTotalNs / pV->entradas * 1e-3, pV->latenciaMaxNs * 1e-3);
+	}
+
+	if (&tareasPerdidas && &ciclosTareaMax)
+		fprintf(stderr, "  firmware: tareasPerdidas %u, ciclosTareaMax %u\n", tareasPerdidas, ciclosTareaMax);
+	if (&carga && carga.ventanas)
+		fprintf(stderr, "  firmware: carga %.1f %% promedio, %.1f %% pico en %u ventanas\n",
+				carga.promedio, carga.pico, carga.ventanas);
+	if (&poolMuestras && poolMuestras.nBloques)
+		fprintf(stderr, "  firmware: pool %u de %u bloques en uso, %u max, %u fallos, %u errores\n",
+				poolMuestras.enUso, poolMuestras.nBloques, poolMuestras.maxEnUso, poolMuestras.fallos,
+				poolMuestras.errores);
+	if (&latenciaMax && latenciaMax)
+		fprintf(stderr, "  firmware: latencia ADC a DAC %u ciclos min, %u promedio, %u max\n",
+				latenciaMin, latenciaProm, latenciaMax);
+
+	/*La ocupacion escala con las muestras atendidas (sin las perdidas en
+	  la interrupcion ni en la cola de la tarea):*/
+	if (&tareasPerdidas) perdidas += tareasPerdidas;
+	double atendidas = fsMax - perdidas / (ahoraNs * 1e-9);
+	if (atendidas > 0.0 && ocupacion > 0.0)
+		fprintf(stderr, "  Fs sostenible estimada: %.0f Hz (%.0f Hz atendidas / ocupacion)\n",
+				atendidas / ocupacion, atendidas);
+
+	/*Calibracion: solo los bloques escalan con -x, asi que la carga es
+	  lineal en -x (la del firmware si la mide, la del emulador si no):*/
+	if (cargaPlaca > 0.0 && bloques) {
+		double medida = (&carga && carga.ventanas) ? carga.promedio / 100.0 : ocupacion;
+		double x = ciclosBloque + (cargaPlaca / 100.0 - medida) * ciclos / (double)bloques;
+		fprintf(stderr, "  calibracion: carga %.1f %% aca, %.1f %% en la placa: -x %.3f\n",
+				100.0 * medida, cargaPlaca, x);
+	}
+	if (nAvisos) fprintf(stderr, "  %u avisos de inicializacion\n", nAvisos);
+}
+
+static void EMU_FIN(const char* pMotivo)
+{
+	if (pMotivo) fprintf(stderr, "stm32Emu: fin: %s\n", pMotivo);
+	EMU_INFORME();
+	if (pSalida) fclose(pSalida);
+	exit(pMotivo ? 3 : 0);
+}
+
+/*Valores de reset de los registros que no arrancan en 0:*/
+static void EMU_RESET_VALORES(void)
+{
+	EMU_REG(RCC)->CR = RCC_CR_HSION | RCC_CR_HSIRDY | (0x10u << 3);
+	EMU_REG(RCC)->PLLCFGR = 0x24003010u;
+	EMU_REG(RCC)->AHB1ENR = 0x00100000u;
+	EMU_REG(GPIOA)->MODER = 0xA8000000u;
+	EMU_REG(GPIOA)->OSPEEDR = 0x0C000000u;
+	EMU_REG(GPIOA)->PUPDR = 0x64000000u;
+	EMU_REG(GPIOB)->MODER = 0x00000280u;
+	EMU_REG(GPIOB)->OSPEEDR = 0x000000C0u;
+	EMU_REG(GPIOB)->PUPDR = 0x00000100u;
+	EMU_REG(PWR)->CSR = 1u << 14;
+	*(uint32_t*)&EMU_REG(SCB)->CPUID = 0x410FC241u;
+	EMU_REG(SCB)->AIRCR = 0xFA050000u;
+	EMU_REG(DWT)->CTRL = 4u << 28;
+}
+
+static void USO(void)
+{
+	fprintf(stderr,
+		"uso: stm32Emu [-t segundos] [-x ciclos] [-k carga] [-e frec:amp]...\n"
+		"              [-o salida.u16] [-c canal]\n");
+	exit(2);
+}
+
+/*Corre antes del main del firmware (glibc pasa argc/argv a los
+  constructores): mapea los registros y arma las senales:*/
+__attribute__((constructor))
+static void EMU_ARRANQUE(int argc, char** argv, char** envp)
+{
+	const char* pRutaSalida = NULL;
+	int opt;
+	(void)envp;
+
+	while ((opt = getopt(argc, argv, "t:x:k:e:o:c:")) != -1) {
+		switch (opt) {
+		case 't': limiteNs = atof(optarg) * 1e9; break;
+		case 'x': ciclosBloque = atof(optarg); break;
+		case 'k': cargaPlaca = atof(optarg); break;
+		case 'e':
+			if (nTonos == EMU_TONOS_MAX || sscanf(optarg, "%lf:%lf", &tonos[nTonos].frec, &tonos[nTonos].amp) != 2) USO();
+			nTonos++;
+			break;
+		case 'o': pRutaSalida = optarg; break;
+		case 'c': canalSalida = (uint32_t)atoi(optarg); break;
+		default: USO();
+		}
+	}
+	if (limiteNs <= 0.0 || ciclosBloque <= 0.0 || cargaPlaca < 0.0 || cargaPlaca > 100.0 ||
+		canalSalida < 1 || canalSalida > 2) USO();
+	if (nTonos == 0) {
+		tonos[0] = (EMU_TONO){1000.0, 0.2};
+		tonos[1] = (EMU_TONO){5000.0, 0.2};
+		nTonos = 2;
+	}
+	if (pRutaSalida && !(pSalida = fopen(pRutaSalida, "wb"))) ERROR_FATAL("no se puede crear", pRutaSalida);
+
+	/*Archivo de registros: alias con escritura y vistas del firmware en
+	  las direcciones del micro, sin permisos:*/
+	int fd = memfd_create("stm32Emu", 0);
+	if (fd < 0 || ftruncate(fd, EMU_PER_LARGO + EMU_CORE_LARGO) < 0) ERROR_FATAL("sin memfd", NULL);
+	pAlias = mmap(NULL, EMU_PER_LARGO + EMU_CORE_LARGO, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	void* pPer = mmap((void*)(uintptr_t)EMU_PER_BASE, EMU_PER_LARGO, PROT_NONE, MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+	void* pCore = mmap((void*)(uintptr_t)EMU_CORE_BASE, EMU_CORE_LARGO, PROT_NONE, MAP_SHARED | MAP_FIXED_NOREPLACE, fd, EMU_PER_LARGO);
+	if (pAlias == MAP_FAILED || pPer != (void*)(uintptr_t)EMU_PER_BASE || pCore != (void*)(uintptr_t)EMU_CORE_BASE)
+		ERROR_FATAL("no se pueden mapear 0x40000000 y 0xE0000000", NULL);
+	close(fd);
+
+	EMU_RESET_VALORES();
+	EMU_RELOJES();
+
+	/*Falla y paso sin bloquearse entre si (los handlers de interrupcion
+	  corren dentro del paso):*/
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_sigaction = EMU_FALLA;
+	sigaction(SIGSEGV, &sa, NULL);
+	sa.sa_sigaction = EMU_PASO;
+	sigaction(SIGTRAP, &sa, NULL);
+
+	EMU_PROGRAMAR();
+	inicioHostNs = HOST_NS();
+
+	fprintf(stderr, "stm32Emu: %.3f s virtuales, %g ciclos por bloque basico\n",
+			limiteNs * 1e-9, ciclosBloque);
+}
@@ -42,6 +42,11 @@ printf("\n  - Frecuencia superior:%d Hz\n\n",fh)
 % Coeficientes:
 [b,a] = cheby1(n,1,[fl/fm,fh/fm],"stop");
 
+% Secciones de segundo orden (src/coef.c, coef_sos):
+[sos,g] = tf2sos(b,a);
+printf("\n  - Secciones de segundo orden [b0 b1 b2 a0 a1 a2], ganancia %g:\n", g)
+disp(sos)
+
 % Grafico de la respuesta en frecuencia:
 freqz(b,a)
 % =----------------------------------------------------------------
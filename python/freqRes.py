@@ -4,6 +4,7 @@
 import numpy as np
 import matplotlib.pyplot as plt
 import pandas as pd
+import sys
 #---------------------------------------------------------------
 
 #---------------------------------------------------------------
@@ -17,8 +18,8 @@ def V_to_dB(x):
 #---------------------------------------------------------------
 # MAIN:
 #---------------------------------------------------------------
-# Importar datos .csv:
-df = pd.read_csv('scopeMeasure.csv')
+# Importar datos .csv (medicion del osciloscopio o salida de host/freqRes):
+df = pd.read_csv(sys.argv[1] if len(sys.argv) > 1 else 'scopeMeasure.csv')
 
 # Calculo de la ganancia en cada punto en dB:
 H  = V_to_dB(df.V_o/df.V_i) 
@@ -0,0 +1,248 @@
+#---------------------------------------------------------------
+# stackReport.py: peor caso estatico de la pila principal.
+#
+# Combina el frame de cada funcion (.su de -fstack-usage, en el
+# Debug/ del build) con el grafo de llamadas del listado
+# (objdump -d del .elf, Debug/teoCir2_08LAB.list) y da:
+#   - la pila de cada raiz (Reset_Handler/main y cada handler) con
+#     su camino mas profundo,
+#   - el peor caso por nivel de preempcion: un handler de cada
+#     nivel puede anidarse sobre el anterior, cada uno con su marco
+#     de excepcion (104 bytes con contexto de FPU, que con lazy
+#     stacking se reserva igual, +4 de alineacion),
+#   - el total y un _Min_Stack_Size sugerido para el .ld.
+# Las funciones sin .su (libgcc, startup) se estiman del prologo.
+# Las llamadas indirectas y la recursion no tienen cota y se avisan.
+# El valor medido en el micro es pila.maxima (src/pila.h).
+#
+# USO:
+#   python3 stackReport.py [-d ../Debug] [-l listado.list]
+#                          [-p TIM3_IRQHandler=1 ...] [--sin-fpu]
+#                          [-m 1.25] [--ld ../stm32f4_flash.ld]
+#   -p prioridad de preempcion de un handler (grupo, como
+#   NVIC_IRQChannelPreemptionPriority; menor = mas prioritario). Sin
+#   -p las IRQ quedan en 0 como en el reset del NVIC, NMI en -2 y
+#   HardFault en -1.
+#---------------------------------------------------------------
+
+#---------------------------------------------------------------
+# LIBRERIAS:
+#---------------------------------------------------------------
+import argparse
+import glob
+import os
+import re
+import sys
+#---------------------------------------------------------------
+
+#---------------------------------------------------------------
+# DEFINICIONES:
+#---------------------------------------------------------------
+# Marco de excepcion del Cortex-M4 [bytes]: 8 palabras, 26 con el
+# contexto de FPU, mas la palabra de alineacion a 8 (STKALIGN):
+MARCO_BASICO = 32
+MARCO_FPU = 104
+ALINEACION = 4
+
+# Prioridades fijas del core:
+PRIORIDAD_FIJA = {'NMI_Handler': -2, 'HardFault_Handler': -1}
+
+# Lineas del listado: cabecera de funcion e instruccion:
+RE_FUNCION = re.compile(r'^([0-9a-f]{8}) <([^>]+)>:\s*$')
+RE_INSTR = re.compile(r'^\s*([0-9a-f]+):\s+[0-9a-f]{4}(?: ?[0-9a-f]{4})?\s+(\S+)\s*([^;]*)')
+RE_DESTINO = re.compile(r'^([0-9a-f]+) <([^>+]+)>')
+RE_SALTO = re.compile(r'^b(?:eq|ne|cs|cc|hs|lo|mi|pl|vs|vc|hi|ls|ge|lt|gt|le|al)?(?:\.w|\.n)?$')
+#---------------------------------------------------------------
+
+#---------------------------------------------------------------
+# FUNCIONES:
+#---------------------------------------------------------------
+# Frames de los .su: nombre -> (bytes, calificador). Con nombres
+# repetidos (static en varios archivos) queda el mayor:
+def leer_su(directorio):
+    frames = {}
+    archivos = glob.glob(os.path.join(directorio, '**', '*.su'), recursive=True)
+    for archivo in archivos:
+        with open(archivo) as f:
+            for linea in f:
+                campos = linea.rstrip('\n').split('\t')
+                if len(campos) < 3:
+                    continue
+                nombre = campos[0].split(':')[-1]
+                bytes_ = int(campos[1])
+                if nombre not in frames or bytes_ > frames[nombre][0]:
+                    frames[nombre] = (bytes_, campos[2])
+    return frames, len(archivos)
+
+# Cantidad de registros de una lista {r4, r5, r7, lr} o {d8-d15}:
+def contar_registros(lista):
+    n = 0
+    for r in lista.strip('{} ').split(','):
+        r = r.strip()
+        m = re.match(r'([rsd])(\d+)-[rsd](\d+)', r)
+        n += int(m.group(3)) - int(m.group(2)) + 1 if m else 1
+    return n
+
+# Frame estimado del prologo (primeras instrucciones):
+def frame_prologo(instrucciones):
+    total = 0
+    for mnem, ops in instrucciones[:8]:
+        if mnem in ('push', 'push.w') or (mnem.startswith('stmdb') and ops.startswith('sp!')):
+            total += 4 * contar_registros(ops[ops.find('{'):])
+        elif mnem.startswith('vpush'):
+            tam = 8 if 'd' in ops else 4
+            total += tam * contar_registros(ops)
+        elif mnem.startswith('sub') and re.match(r'sp,\s*(sp,\s*)?#', ops):
+            total += int(ops.split('#')[1].split()[0], 0)
+        elif mnem.startswith('str') and 'sp, #-' in ops and ops.endswith('!'):
+            total += -int(ops.split('#')[1].rstrip(']!'), 0)
+    return total
+
+# Grafo de llamadas del listado: nombre -> instrucciones, llamadas
+# directas, saltos a otras funciones e indicador de llamadas indirectas:
+def leer_listado(archivo):
+    funciones = {}
+    actual = None
+    with open(archivo) as f:
+        for linea in f:
+            m = RE_FUNCION.match(linea)
+            if m:
+                actual = {'instr': [], 'llamadas': set(), 'saltos': set(), 'indirecta': False}
+                funciones[m.group(2)] = actual
+                continue
+            m = RE_INSTR.match(linea)
+            if not m or actual is None or m.group(2).startswith('.'):
+                continue
+            mnem, ops = m.group(2), m.group(3).strip()
+            actual['instr'].append((mnem, ops))
+            destino = RE_DESTINO.match(ops)
+            if mnem in ('bl', 'blx'):
+                if destino:
+                    actual['llamadas'].add(destino.group(2))
+                else:
+                    actual['indirecta'] = True
+            elif RE_SALTO.match(mnem) and destino:
+                actual['saltos'].add(destino.group(2))
+    return funciones
+
+# Peor caso desde una funcion: (bytes, camino, avisos), con memoria y
+# deteccion de ciclos:
+def peor_caso(nombre, funciones, frames, memo, en_curso):
+    if nombre in memo:
+        return memo[nombre]
+    if nombre in en_curso:
+        return 0, [nombre], {'recursion en ' + nombre}
+    if nombre not in funciones:
+        return 0, [nombre], {'sin codigo: ' + nombre}
+
+    f = funciones[nombre]
+    avisos = set()
+    if nombre in frames:
+        frame, calif = frames[nombre]
+        if calif != 'static':
+            avisos.add('frame %s en %s' % (calif, nombre))
+    else:
+        frame = frame_prologo(f['instr'])
+        if frame:
+            avisos.add('frame estimado del prologo: %s (%d)' % (nombre, frame))
+    if f['indirecta']:
+        avisos.add('llamada indirecta en ' + nombre)
+
+    # Los saltos a otra etiqueta son llamadas de cola o, en el
+    # startup, la continuacion del mismo codigo: sin frame encima:
+    hijos = [(h, frame) for h in f['llamadas']]
+    hijos += [(h, 0) for h in f['saltos'] if h != nombre]
+
+    en_curso.add(nombre)
+    mejor, camino = frame, [nombre]
+    for hijo, base in sorted(hijos):
+        b, c, a = peor_caso(hijo, funciones, frames, memo, en_curso)
+        avisos |= a
+        if base + b > mejor:
+            mejor, camino = base + b, [nombre] + c
+    en_curso.discard(nombre)
+
+    memo[nombre] = (mejor, camino, avisos)
+    return memo[nombre]
+
+# _Min_Stack_Size del linker script, si esta:
+def leer_ld(archivo):
+    try:
+        with open(archivo) as f:
+            m = re.search(r'_Min_Stack_Size\s*=\s*(0x[0-9a-fA-F]+|\d+)', f.read())
+        return int(m.group(1), 0) if m else None
+    except OSError:
+        return None
+#---------------------------------------------------------------
+
+#---------------------------------------------------------------
+# MAIN:
+#---------------------------------------------------------------
+raiz = os.path.dirname(os.path.abspath(__file__))
+parser = argparse.ArgumentParser(description='Peor caso estatico de la pila')
+parser.add_argument('-d', default=os.path.join(raiz, '..', 'Debug'), help='directorio del build con los .su')
+parser.add_argument('-l', help='listado objdump -d (por defecto el .list del build)')
+parser.add_argument('-p', action='append', default=[], metavar='HANDLER=PRIO', help='prioridad de preempcion')
+parser.add_argument('--sin-fpu', action='store_true', help='marco basico (el firmware no usa la FPU)')
+parser.add_argument('-m', type=float, default=1.25, help='margen sobre el peor caso para el .ld')
+parser.add_argument('--ld', default=os.path.join(raiz, '..', 'stm32f4_flash.ld'), help='linker script')
+args = parser.parse_args()
+
+listado = args.l or next(iter(sorted(glob.glob(os.path.join(args.d, '*.list')))), None)
+if listado is None:
+    sys.exit('stackReport: no hay listado .list en ' + args.d)
+frames, n_su = leer_su(args.d)
+funciones = leer_listado(listado)
+if not frames:
+    print('stackReport: sin archivos .su (compilar con -fstack-usage), todo estimado del prologo')
+
+prioridades = dict(PRIORIDAD_FIJA)
+for p in args.p:
+    nombre, _, valor = p.partition('=')
+    if nombre not in funciones:
+        print('stackReport: aviso: %s no esta en el listado' % nombre)
+    prioridades[nombre] = int(valor)
+
+# Raices: el hilo principal desde el reset y cada handler:
+memo = {}
+hilo = 'Reset_Handler' if 'Reset_Handler' in funciones else 'main'
+handlers = sorted(n for n in funciones if n.endswith('Handler') and n not in ('Reset_Handler', 'Default_Handler'))
+marco = (MARCO_BASICO if args.sin_fpu else MARCO_FPU) + ALINEACION
+
+print('Pila: peor caso estatico (%s, %d archivos .su)\n' % (os.path.relpath(listado), n_su))
+print('%-26s %7s %5s  %s' % ('Raiz', 'Bytes', 'Prio', 'Camino'))
+avisos = set()
+b_hilo, camino, a = peor_caso(hilo, funciones, frames, memo, set())
+avisos |= a
+print('%-26s %7d %5s  %s' % (hilo + ' (hilo)', b_hilo, '-', ' > '.join(camino)))
+
+niveles = {}
+for h in handlers:
+    b, camino, a = peor_caso(h, funciones, frames, memo, set())
+    avisos |= a
+    prio = prioridades.get(h, 0)
+    print('%-26s %7d %5d  %s' % (h, b, prio, ' > '.join(camino)))
+    if prio not in niveles or b > niveles[prio][0]:
+        niveles[prio] = (b, h)
+
+# Un handler por nivel, anidados del menos al mas prioritario:
+print('\nNiveles de preempcion (marco de excepcion de %d bytes c/u%s):' % (marco, '' if args.sin_fpu else ', con FPU'))
+total_isr = 0
+for prio in sorted(niveles, reverse=True):
+    b, h = niveles[prio]
+    total_isr += b + marco
+    print('  prioridad %3d: %-24s %5d + %d = %d' % (prio, h, b, marco, b + marco))
+
+total = b_hilo + total_isr
+sugerido = (int(total * args.m) + 0xFF) & ~0xFF
+print('\nPeor caso total: %d bytes (hilo %d + interrupciones anidadas %d)' % (total, b_hilo, total_isr))
+actual = leer_ld(args.ld)
+if actual is not None:
+    print('_Min_Stack_Size actual: 0x%X (%d bytes)' % (actual, actual))
+print('_Min_Stack_Size sugerido (x%g, multiplo de 0x100): 0x%X (%d bytes)' % (args.m, sugerido, sugerido))
+
+if avisos:
+    print('\nAvisos (la cota no cubre estos casos):')
+    for a in sorted(avisos):
+        print('  ' + a)
+#---------------------------------------------------------------
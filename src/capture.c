@@ -0,0 +1,153 @@
+/********************************************************************************
+  * @file    capture.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Tramas de captura de muestras crudas: 12 bits empaquetados,
+  	  	  	 numero de secuencia y CRC-32 de la unidad CRC del micro. El
+  	  	  	 envio se delega en un transporte (USART + DMA en la placa), asi
+  	  	  	 el mismo codigo arma las tramas en el host.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "capture.h"
+
+#ifdef USE_STDPERIPH_DRIVER
+#include "stm32f4xx.h"
+#include "stm32f4xx_crc.h"
+#include "stm32f4xx_rcc.h"
+#endif
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Escritura del encabezado de la trama en llenado:*/
+static void CAPTURE_HEADER(CAPTURE* pCap)
+{
+	uint32_t* pFrame = pCap->frame[pCap->activa];
+
+	pFrame[0] = CAPTURE_SYNC | ((uint32_t)pCap->tipo << 16) | ((uint32_t)CAPTURE_VERSION << 24);
+	pFrame[1] = pCap->secuencia | ((uint32_t)CAPTURE_VALORES << 16);
+	pCap->valores = 0;
+}
+
+/*Empaquetado de un valor de 12 bits en la carga (2 valores cada 3 bytes):*/
+static inline void CAPTURE_PACK(CAPTURE* pCap, uint16_t Valor)
+{
+	uint8_t* pCarga = (uint8_t*)&pCap->frame[pCap->activa][CAPTURE_HEADER_WORDS];
+	uint32_t k = pCap->valores;
+	uint8_t* p = pCarga + (k >> 1) * 3;
+
+	Valor &= 0x0FFF;
+	if ((k & 1) == 0) {
+		p[0] = (uint8_t) Valor;
+		p[1] = (uint8_t)(Valor >> 8);
+	} else {
+		p[1] |= (uint8_t)(Valor << 4);
+		p[2] = (uint8_t)(Valor >> 4);
+	}
+	pCap->valores = k + 1;
+}
+
+/*Cierre de la trama: CRC, entrega al transporte y cambio de buffer:*/
+static void CAPTURE_FLUSH(CAPTURE* pCap)
+{
+	uint32_t* pFrame = pCap->frame[pCap->activa];
+
+	pFrame[CAPTURE_FRAME_WORDS - 1] = CAPTURE_CRC(pFrame, CAPTURE_FRAME_WORDS - 1);
+
+	if (pCap->pfnSend(pFrame, CAPTURE_FRAME_BYTES)) {
+		pCap->tramasEnviadas++;
+		pCap->activa ^= 1;
+	} else {
+		/*El host detecta el salto de secuencia:*/
+		pCap->tramasPerdidas++;
+	}
+
+	pCap->secuencia++;
+	CAPTURE_HEADER(pCap);
+}
+
+/*****************************************************************************
+CAPTURE_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa el armado de tramas de captura.
+	* @returns	void
+	* @param
+		- pCap		Estado de la captura.
+		- Tipo		CAPTURE_ENTRADA, CAPTURE_SALIDA, CAPTURE_AMBAS o
+					CAPTURE_RAFAGA.
+		- pfnSend	Transporte de las tramas. Ej: USART_DMA_SEND.
+	* @ej
+		- CAPTURE_INIT(&capture, CAPTURE_AMBAS, USART_DMA_SEND);
+******************************************************************************/
+void CAPTURE_INIT(CAPTURE* pCap, uint8_t Tipo, CAPTURE_SEND_FN pfnSend)
+{
+#ifdef USE_STDPERIPH_DRIVER
+	/*Habilitacion del clock de la unidad CRC:*/
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_CRC, ENABLE);
+#endif
+
+	pCap->tipo = Tipo;
+	pCap->secuencia = 0;
+	pCap->activa = 0;
+	pCap->tramasEnviadas = 0;
+	pCap->tramasPerdidas = 0;
+	pCap->pfnSend = pfnSend;
+	CAPTURE_HEADER(pCap);
+}
+
+/*****************************************************************************
+CAPTURE_PUSH
+
+	* @author	A. Riedinger.
+	* @brief	Agrega una muestra (entrada y/o salida segun el tipo) a la
+				trama actual y la envia al completarse.
+	* @returns	void
+	* @param
+		- pCap		Estado de la captura.
+		- In		Muestra de entrada de 12 bits.
+		- Out		Muestra de salida de 12 bits.
+	* @ej
+		- CAPTURE_PUSH(&capture, adcValue, dacValue);
+******************************************************************************/
+void CAPTURE_PUSH(CAPTURE* pCap, uint16_t In, uint16_t Out)
+{
+	if (pCap->tipo & CAPTURE_ENTRADA) CAPTURE_PACK(pCap, In);
+	if (pCap->tipo & CAPTURE_SALIDA)  CAPTURE_PACK(pCap, Out);
+
+	if (pCap->valores >= CAPTURE_VALORES)
+		CAPTURE_FLUSH(pCap);
+}
+
+/*****************************************************************************
+CAPTURE_CRC
+
+	* @author	A. Riedinger.
+	* @brief	CRC-32 por palabras. En la placa usa la unidad CRC; en el host
+				la misma cuenta por software.
+	* @returns
+		- CRC de las palabras.
+	* @param
+		- pWords	Palabras a verificar.
+		- nWords	Cantidad de palabras.
+	* @ej
+		- crc = CAPTURE_CRC(pFrame, CAPTURE_FRAME_WORDS - 1);
+******************************************************************************/
+uint32_t CAPTURE_CRC(const uint32_t* pWords, uint32_t nWords)
+{
+#ifdef USE_STDPERIPH_DRIVER
+	CRC_ResetDR();
+	return CRC_CalcBlockCRC((uint32_t*)pWords, nWords);
+#else
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (uint32_t i = 0; i < nWords; i++) {
+		crc ^= pWords[i];
+		for (uint32_t b = 0; b < 32; b++)
+			crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+	}
+	return crc;
+#endif
+}
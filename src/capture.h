@@ -0,0 +1,63 @@
+/* Definicion del header:*/
+#ifndef capture_H
+#define capture_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+FORMATO DE TRAMA (little endian, alineada a 32 bits para la unidad CRC):
+
+	palabra 0:	sync (0xA55A, 16 bits) | tipo (8 bits) | version (8 bits)
+	palabra 1:	secuencia (16 bits)    | nMuestras (16 bits)
+	carga:		nMuestras valores de 12 bits empaquetados de a 2 en 3 bytes.
+				Con CAPTURE_AMBAS se intercalan entrada, salida, entrada, ...
+	ultima:		CRC-32 (polinomio 0x04C11DB7, valor inicial 0xFFFFFFFF, por
+				palabras, sin reflejar ni invertir: el de la unidad CRC).
+------------------------------------------------------------------------------*/
+#define CAPTURE_SYNC		0xA55A
+#define CAPTURE_VERSION		1
+
+/*Tipo de trama - senales registradas:*/
+#define CAPTURE_ENTRADA		0x01
+#define CAPTURE_SALIDA		0x02
+#define CAPTURE_AMBAS		(CAPTURE_ENTRADA | CAPTURE_SALIDA)
+
+/*Rafaga del ADC triple intercalado: las muestras van como entradas, en
+  orden temporal y ya calibradas; cada rafaga ocupa tramas enteras:*/
+#define CAPTURE_RAFAGA		(0x04 | CAPTURE_ENTRADA)
+
+/*Valores de 12 bits por trama (multiplo de 8 para alinear la carga):*/
+#ifndef CAPTURE_VALORES
+#define CAPTURE_VALORES		256
+#endif
+
+#define CAPTURE_HEADER_WORDS	2
+#define CAPTURE_PAYLOAD_BYTES(n)	((n) * 3 / 2)
+#define CAPTURE_FRAME_WORDS		(CAPTURE_HEADER_WORDS + CAPTURE_PAYLOAD_BYTES(CAPTURE_VALORES) / 4 + 1)
+#define CAPTURE_FRAME_BYTES		(CAPTURE_FRAME_WORDS * 4)
+
+/*Transporte: devuelve 1 si tomo la trama, 0 si esta ocupado con la anterior.
+  La trama debe permanecer valida hasta la siguiente llamada.*/
+typedef uint8_t (*CAPTURE_SEND_FN)(const void* pFrame, uint32_t nBytes);
+
+/* Estructuras:*/
+typedef struct
+{
+	uint8_t  tipo;
+	uint16_t secuencia;
+	uint32_t valores;							/*Valores cargados en la trama actual.*/
+	uint32_t activa;							/*Trama en llenado (la otra se transmite).*/
+	uint32_t tramasEnviadas;
+	uint32_t tramasPerdidas;					/*Transporte ocupado al cerrar la trama.*/
+	CAPTURE_SEND_FN pfnSend;
+	uint32_t frame[2][CAPTURE_FRAME_WORDS];
+} CAPTURE;
+
+/* Declaracion funciones:*/
+void CAPTURE_INIT(CAPTURE* pCap, uint8_t Tipo, CAPTURE_SEND_FN pfnSend);
+void CAPTURE_PUSH(CAPTURE* pCap, uint16_t In, uint16_t Out);
+uint32_t CAPTURE_CRC(const uint32_t* pWords, uint32_t nWords);
+
+/* Cierre del header:*/
+#endif
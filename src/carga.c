@@ -0,0 +1,86 @@
+/********************************************************************************
+  * @file    carga.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Medidor de carga de CPU por ventanas: ocupacion actual,
+  	  	  	 promedio y pico, y desglose por tarea. Ver carga.h.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "carga.h"
+
+/*****************************************************************************
+CARGA_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa el medidor con todas las cuentas en cero.
+	* @returns	void
+	* @param
+		- pCarga	Medidor a inicializar.
+		- nTareas	Cantidad de tareas medidas (max CARGA_MAX_TAREAS).
+	* @ej
+		- CARGA_INIT(&carga, 1);
+******************************************************************************/
+void CARGA_INIT(CARGA* pCarga, uint32_t nTareas)
+{
+	if (nTareas > CARGA_MAX_TAREAS) nTareas = CARGA_MAX_TAREAS;
+
+	pCarga->nTareas = nTareas;
+	for (uint32_t k = 0; k < CARGA_MAX_TAREAS; k++) {
+		pCarga->ciclosTarea[k] = 0;
+		pCarga->picoTarea[k] = 0;
+		pCarga->tareaPct[k] = 0.0f;
+	}
+	pCarga->ciclosDormido = 0;
+	pCarga->otrosPct = 0.0f;
+	pCarga->actual = 0.0f;
+	pCarga->promedio = 0.0f;
+	pCarga->pico = 0.0f;
+	pCarga->despiertoTotal = 0;
+	pCarga->total = 0;
+	pCarga->ventanas = 0;
+}
+
+/*****************************************************************************
+CARGA_CERRAR
+
+	* @author	A. Riedinger.
+	* @brief	Cierra la ventana en curso: calcula la ocupacion y el
+				desglose y reinicia los acumulados.
+	* @returns	void
+	* @param
+		- pCarga			Medidor.
+		- CiclosVentana		Duracion de la ventana [ciclos del core].
+		- CiclosContados	Avance del contador de ciclos en la ventana
+							(igual a CiclosVentana si no se frena en WFI).
+	* @ej
+		- CARGA_CERRAR(&carga, SystemCoreClock / 10, ahora - inicio);
+******************************************************************************/
+void CARGA_CERRAR(CARGA* pCarga, uint32_t CiclosVentana, uint32_t CiclosContados)
+{
+	uint32_t despierto, tareas = 0;
+
+	if (CiclosVentana == 0) return;
+
+	/*Sin contar lo dormido, acotado a la ventana por el redondeo del total:*/
+	despierto = (CiclosContados > pCarga->ciclosDormido) ? CiclosContados - pCarga->ciclosDormido : 0;
+	if (despierto > CiclosVentana) despierto = CiclosVentana;
+
+	for (uint32_t k = 0; k < pCarga->nTareas; k++) {
+		pCarga->tareaPct[k] = 100.0f * (float)pCarga->ciclosTarea[k] / (float)CiclosVentana;
+		tareas += pCarga->ciclosTarea[k];
+		pCarga->ciclosTarea[k] = 0;
+	}
+	pCarga->otrosPct = (despierto > tareas) ? 100.0f * (float)(despierto - tareas) / (float)CiclosVentana : 0.0f;
+
+	pCarga->actual = 100.0f * (float)despierto / (float)CiclosVentana;
+	if (pCarga->actual > pCarga->pico) pCarga->pico = pCarga->actual;
+
+	pCarga->despiertoTotal += despierto;
+	pCarga->total += CiclosVentana;
+	pCarga->promedio = 100.0f * (float)pCarga->despiertoTotal / (float)pCarga->total;
+
+	pCarga->ciclosDormido = 0;
+	pCarga->ventanas++;
+}
@@ -0,0 +1,61 @@
+/* Definicion del header:*/
+#ifndef carga_H
+#define carga_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+MEDIDOR DE CARGA DE CPU:
+
+	Por ventana de medicion se acumulan los ciclos de cada tarea y los
+	ciclos dormido en WFI; al cerrarla, con los ciclos totales de la ventana
+	(por tiempo, no por el contador, que puede frenarse en sleep) y los
+	contados por el contador de ciclos, se obtiene:
+
+		despierto = contados - dormido		(tareas + interrupciones + lazo)
+		ocupacion = despierto / total
+		otros     = despierto - suma de tareas
+
+	Los tiempos vienen del llamador (DWT en el micro), asi el modulo no
+	depende del hardware.
+------------------------------------------------------------------------------*/
+/*Cantidad maxima de tareas medidas:*/
+#define CARGA_MAX_TAREAS	4
+
+/* Estructuras:*/
+typedef struct
+{
+	uint32_t nTareas;							/*Tareas en uso.*/
+	uint32_t ciclosTarea[CARGA_MAX_TAREAS];		/*Acumulados de la ventana en curso.*/
+	uint32_t ciclosDormido;						/*Acumulados en WFI en la ventana en curso.*/
+	uint32_t picoTarea[CARGA_MAX_TAREAS];		/*Peor ejecucion de cada tarea [ciclos].*/
+	float tareaPct[CARGA_MAX_TAREAS];			/*Ocupacion de cada tarea en la ultima ventana [%].*/
+	float otrosPct;								/*Interrupciones y lazo en la ultima ventana [%].*/
+	float actual;								/*Ocupacion de la ultima ventana [%].*/
+	float promedio;								/*Ocupacion desde el inicio [%].*/
+	float pico;									/*Peor ventana [%].*/
+	uint64_t despiertoTotal;					/*Acumulados para el promedio.*/
+	uint64_t total;
+	uint32_t ventanas;							/*Ventanas cerradas.*/
+} CARGA;
+
+/*Suma una ejecucion de la tarea a la ventana en curso:*/
+static inline void CARGA_TAREA(CARGA* pCarga, uint32_t Tarea, uint32_t Ciclos)
+{
+	pCarga->ciclosTarea[Tarea] += Ciclos;
+	if (Ciclos > pCarga->picoTarea[Tarea]) pCarga->picoTarea[Tarea] = Ciclos;
+}
+
+/*Suma un intervalo dormido (WFI) a la ventana en curso:*/
+static inline void CARGA_DORMIDO(CARGA* pCarga, uint32_t Ciclos)
+{
+	pCarga->ciclosDormido += Ciclos;
+}
+
+/* Declaracion funciones:*/
+void CARGA_INIT(CARGA* pCarga, uint32_t nTareas);
+void CARGA_CERRAR(CARGA* pCarga, uint32_t CiclosVentana, uint32_t CiclosContados);
+
+/* Cierre del header:*/
+#endif
@@ -0,0 +1,195 @@
+/********************************************************************************
+  * @file    cic.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Decimador CIC (Hogenauer) para el ADC sobremuestreado: N
+  	  	  	 integradores a la frecuencia alta y N peines a la baja, solo
+  	  	  	 con sumas, mas un FIR corto a la frecuencia de salida que
+  	  	  	 compensa la caida sinc^N en la banda util. Sobremuestrear por R
+  	  	  	 y decimar asi agrega ~0.5*log2(R) bits efectivos.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "cic.h"
+#include <math.h>
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Puntos de la grilla del ajuste por cuadrados minimos del FIR:*/
+#define CIC_GRILLA		64
+
+#define CIC_MITAD		(CIC_FIR_TAPS / 2 + 1)
+
+/*CIC_DECIMATE tiene los integradores desenrollados:*/
+#if CIC_ETAPAS != 3
+#error "CIC_DECIMATE esta escrito para CIC_ETAPAS = 3"
+#endif
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*|H| del CIC a la frecuencia f (en fracciones de Fs salida), ganancia DC 1:*/
+static double CIC_SINC(uint32_t R, double f)
+{
+	if (f <= 0.0) return 1.0;
+	return pow(fabs(sin(M_PI * f) / (R * sin(M_PI * f / R))), CIC_ETAPAS);
+}
+
+/*FIR simetrico h[k] = h[-k] tal que FIR*CIC ~ 1 en [0, CIC_FIR_BANDA].
+  Cuadrados minimos sobre A(f) = h0 + 2*suma hk*cos(2*pi*f*k):*/
+static void CIC_FIR_DESIGN(uint32_t R, float* pFir)
+{
+	double M[CIC_MITAD][CIC_MITAD + 1] = {{0}};
+
+	for (uint32_t g = 0; g <= CIC_GRILLA; g++) {
+		double f = CIC_FIR_BANDA * g / CIC_GRILLA;
+		double v[CIC_MITAD];
+		double d = 1.0 / CIC_SINC(R, f);
+
+		v[0] = 1.0;
+		for (uint32_t k = 1; k < CIC_MITAD; k++) v[k] = 2.0 * cos(2.0 * M_PI * f * k);
+		for (uint32_t i = 0; i < CIC_MITAD; i++) {
+			for (uint32_t j = 0; j < CIC_MITAD; j++) M[i][j] += v[i] * v[j];
+			M[i][CIC_MITAD] += v[i] * d;
+		}
+	}
+
+	/*Ecuaciones normales por Gauss-Jordan (sistema chico y bien condicionado):*/
+	for (uint32_t i = 0; i < CIC_MITAD; i++) {
+		for (uint32_t r = 0; r < CIC_MITAD; r++) {
+			if (r == i) continue;
+			double factor = M[r][i] / M[i][i];
+			for (uint32_t c = i; c <= CIC_MITAD; c++) M[r][c] -= factor * M[i][c];
+		}
+	}
+
+	/*Ganancia DC exactamente 1, igual que el CIC normalizado:*/
+	double h[CIC_MITAD], suma = 0.0;
+	for (uint32_t k = 0; k < CIC_MITAD; k++) {
+		h[k] = M[k][CIC_MITAD] / M[k][k];
+		suma += k ? 2.0 * h[k] : h[k];
+	}
+	for (uint32_t k = 0; k < CIC_MITAD; k++) {
+		pFir[CIC_MITAD - 1 + k] = (float)(h[k] / suma);
+		pFir[CIC_MITAD - 1 - k] = (float)(h[k] / suma);
+	}
+}
+
+/*****************************************************************************
+CIC_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa el decimador y disena su FIR compensador.
+	* @returns	void
+	* @param
+		- pCic		Decimador.
+		- R			Relacion de decimacion (2 a CIC_R_MAX).
+	* @ej
+		- CIC_INIT(&cic, 16);
+******************************************************************************/
+void CIC_INIT(CIC_DECIM* pCic, uint32_t R)
+{
+	if (R < 2) R = 2;
+	if (R > CIC_R_MAX) R = CIC_R_MAX;
+
+	pCic->R = R;
+	pCic->fase = 0;
+	pCic->escala = 1.0f / (powf((float)R, CIC_ETAPAS) * 4096.0f);
+	pCic->firPos = 0;
+
+	for (uint32_t s = 0; s < CIC_ETAPAS; s++) {
+		pCic->integ[s] = 0;
+		pCic->comb[s] = 0;
+	}
+	for (uint32_t k = 0; k < CIC_FIR_TAPS; k++)
+		pCic->firState[k] = 0.0f;
+
+	CIC_FIR_DESIGN(R, pCic->fir);
+}
+
+/*****************************************************************************
+CIC_DECIMATE
+
+	* @author	A. Riedinger.
+	* @brief	Procesa codigos crudos del ADC a la frecuencia alta y entrega
+				una muestra compensada cada R entradas. Los integradores
+				desbordan sin problema: los peines recuperan el valor exacto
+				mientras la salida entre en 32 bits.
+	* @returns
+		- Cantidad de muestras escritas en pDst (n/R, redondeado segun la
+		  fase del decimador).
+	* @param
+		- pCic		Decimador.
+		- pSrc		Codigos del ADC (0 a 4095).
+		- n			Cantidad de codigos.
+		- pDst		Muestras de salida normalizadas (-0.5 a 0.5).
+	* @ej
+		- if (CIC_DECIMATE(&cic, &adcBuffer[0], CIC_R, &cicOut)) ...
+******************************************************************************/
+uint32_t CIC_DECIMATE(CIC_DECIM* pCic, const uint16_t* pSrc, uint32_t n, float* pDst)
+{
+	uint32_t nOut = 0;
+	uint32_t i0 = pCic->integ[0], i1 = pCic->integ[1], i2 = pCic->integ[2];
+	uint32_t fase = pCic->fase;
+
+	for (uint32_t k = 0; k < n; k++) {
+		/*Integradores a la frecuencia alta, entrada centrada en cero:*/
+		i0 += (uint32_t)((int32_t)pSrc[k] - 2048);
+		i1 += i0;
+		i2 += i1;
+
+		if (++fase < pCic->R) continue;
+		fase = 0;
+
+		/*Peines a la frecuencia baja (M = 1):*/
+		uint32_t c = i2, y;
+		for (uint32_t s = 0; s < CIC_ETAPAS; s++) {
+			y = c - pCic->comb[s];
+			pCic->comb[s] = c;
+			c = y;
+		}
+
+		/*FIR compensador sobre una linea de retardo circular:*/
+		pCic->firState[pCic->firPos] = (float)(int32_t)c * pCic->escala;
+		float acum = 0.0f;
+		uint32_t p = pCic->firPos;
+		for (uint32_t t = 0; t < CIC_FIR_TAPS; t++) {
+			acum += pCic->fir[t] * pCic->firState[p];
+			p = p ? p - 1 : CIC_FIR_TAPS - 1;
+		}
+		pCic->firPos = pCic->firPos + 1 < CIC_FIR_TAPS ? pCic->firPos + 1 : 0;
+
+		pDst[nOut++] = acum;
+	}
+
+	pCic->integ[0] = i0; pCic->integ[1] = i1; pCic->integ[2] = i2;
+	pCic->fase = fase;
+	return nOut;
+}
+
+/*****************************************************************************
+CIC_GANANCIA
+
+	* @author	A. Riedinger.
+	* @brief	Respuesta del CIC mas el compensador, para verificar la
+				planicidad de la banda util.
+	* @returns
+		- |H(f)| del conjunto.
+	* @param
+		- pCic		Decimador inicializado.
+		- f			Frecuencia en fracciones de la Fs de salida (0 a 0.5).
+	* @ej
+		- rizado = CIC_GANANCIA(&cic, 0.3f);
+******************************************************************************/
+float CIC_GANANCIA(const CIC_DECIM* pCic, float f)
+{
+	double re = 0.0, im = 0.0;
+
+	for (uint32_t t = 0; t < CIC_FIR_TAPS; t++) {
+		re += pCic->fir[t] * cos(2.0 * M_PI * f * t);
+		im -= pCic->fir[t] * sin(2.0 * M_PI * f * t);
+	}
+	return (float)(hypot(re, im) * CIC_SINC(pCic->R, f));
+}
@@ -0,0 +1,36 @@
+/* Definicion del header:*/
+#ifndef cic_H
+#define cic_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/*Etapas del CIC. Con entrada de 12 bits el registro crece 12 + N*log2(R)
+  bits, asi N = 3 admite R <= CIC_R_MAX en 32 bits:*/
+#define CIC_ETAPAS		3
+#define CIC_R_MAX		64
+
+/*FIR compensador de la caida sinc^N, simetrico, a la frecuencia de salida:*/
+#define CIC_FIR_TAPS	7
+#define CIC_FIR_BANDA	0.35f					/*Banda compensada, en fracciones de Fs salida.*/
+
+/* Estructuras:*/
+typedef struct
+{
+	uint32_t R;									/*Relacion de decimacion.*/
+	uint32_t fase;								/*Muestras de entrada desde la ultima salida.*/
+	uint32_t integ[CIC_ETAPAS];					/*Integradores (aritmetica modulo 2^32).*/
+	uint32_t comb[CIC_ETAPAS];					/*Entrada previa de cada peine.*/
+	float escala;								/*1 / (R^N * 4096): salida en -0.5 a 0.5.*/
+	float fir[CIC_FIR_TAPS];
+	float firState[CIC_FIR_TAPS];
+	uint32_t firPos;
+} CIC_DECIM;
+
+/* Declaracion funciones:*/
+void CIC_INIT(CIC_DECIM* pCic, uint32_t R);
+uint32_t CIC_DECIMATE(CIC_DECIM* pCic, const uint16_t* pSrc, uint32_t n, float* pDst);
+float CIC_GANANCIA(const CIC_DECIM* pCic, float f);
+
+/* Cierre del header:*/
+#endif
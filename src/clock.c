@@ -0,0 +1,225 @@
+/********************************************************************************
+  * @file    clock.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Perfiles de clock en tiempo de ejecucion: PLL desde el HSE,
+  	  	  	 over-drive por encima de 168 MHz, esperas de flash y
+  	  	  	 prescalers de APB1/APB2 derivados del HCLK pedido. La regulacion
+  	  	  	 queda en escala 1 (VOS), valida en todo el rango.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "clock.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Over-drive (PWR_CR / PWR_CSR), ausente en esta version de los headers:*/
+#define PWR_CR_ODEN_		((uint32_t)0x00010000)
+#define PWR_CR_ODSWEN_		((uint32_t)0x00020000)
+#define PWR_CSR_ODRDY_		((uint32_t)0x00010000)
+#define PWR_CSR_ODSWRDY_	((uint32_t)0x00020000)
+
+/*Entrada del PLL [Hz] (HSE / M) y limites del VCO:*/
+#define CLOCK_PLL_IN		2000000
+#define CLOCK_VCO_MIN		100000000
+#define CLOCK_VCO_MAX		432000000
+
+/*Limites de los buses, con y sin over-drive [Hz]:*/
+#define CLOCK_APB1_MAX		45000000
+#define CLOCK_APB1_MAX_SOD	42000000
+#define CLOCK_APB2_MAX		90000000
+#define CLOCK_APB2_MAX_SOD	84000000
+
+/*HCLK por espera de flash con 2.7 a 3.6 V [Hz]:*/
+#define CLOCK_HCLK_POR_WS	30000000
+
+/*Pasos del perfil minimo [Hz], de mayor a menor:*/
+static const uint32_t CLOCK_TABLA[] = {180000000, 168000000, 144000000, 120000000,
+									   96000000,  72000000,  48000000};
+#define CLOCK_PASOS		(sizeof(CLOCK_TABLA) / sizeof(CLOCK_TABLA[0]))
+
+/*Re-derivacion de los perifericos (functions.c):*/
+void RETIME_PERIFERICOS(void);
+
+/*------------------------------------------------------------------------------
+VARIABLES GLOBALES:
+------------------------------------------------------------------------------*/
+CLOCK_ESTADO clockEstado = {CLOCK_MAX, 1, 0, CLOCK_HCLK_MAX};
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Codigo PPREx del menor divisor (1, 2, 4, 8 o 16) con Hclk/div <= Max:*/
+static uint32_t CLOCK_PPRE(uint32_t Hclk, uint32_t Max)
+{
+	uint32_t div = 1, codigo = 0;
+
+	while (div < 16 && Hclk / div > Max) {
+		div *= 2;
+		codigo = codigo ? codigo + 1 : 4;
+	}
+	return codigo;
+}
+
+/*****************************************************************************
+CLOCK_CONFIG
+
+	* @author	A. Riedinger.
+	* @brief	Pasa el sistema a Hclk: sale al HSI, reprograma y arranca el
+				PLL, conmuta el over-drive, fija esperas de flash y
+				prescalers y vuelve al PLL. Con las interrupciones
+				deshabilitadas mientras dura. Al terminar actualiza
+				SystemCoreClock y re-deriva los perifericos.
+	* @returns
+		- 1 si se configuro, 0 si Hclk no se puede generar (queda el clock
+		  anterior).
+	* @param
+		- Hclk		Clock del core [Hz], multiplo de 1 MHz, 24 a 180 MHz.
+	* @ej
+		- CLOCK_CONFIG(168000000);
+******************************************************************************/
+uint8_t CLOCK_CONFIG(uint32_t Hclk)
+{
+	uint32_t P = 2;
+
+	if (Hclk > CLOCK_HCLK_MAX || Hclk % 1000000) return 0;
+
+	/*Menor P que deja el VCO en rango; N en pasos de CLOCK_PLL_IN:*/
+	while (P < 8 && Hclk * P < CLOCK_VCO_MIN) P += 2;
+	uint32_t vco = Hclk * P;
+	if (vco < CLOCK_VCO_MIN || vco > CLOCK_VCO_MAX) return 0;
+	uint32_t N = vco / CLOCK_PLL_IN;
+	uint32_t Q = (vco + 48000000 - 1) / 48000000;		/*USB/SDIO <= 48 MHz.*/
+	if (Q < 2) Q = 2;
+
+	uint8_t od = Hclk > CLOCK_HCLK_SIN_OD;
+	uint32_t ws = (Hclk - 1) / CLOCK_HCLK_POR_WS;
+	uint32_t ppre1 = CLOCK_PPRE(Hclk, od ? CLOCK_APB1_MAX : CLOCK_APB1_MAX_SOD);
+	uint32_t ppre2 = CLOCK_PPRE(Hclk, od ? CLOCK_APB2_MAX : CLOCK_APB2_MAX_SOD);
+
+	__disable_irq();
+
+	/*SYSCLK al HSI (16 MHz, valido con cualquier espera y prescaler):*/
+	RCC->CR |= RCC_CR_HSION;
+	while ((RCC->CR & RCC_CR_HSIRDY) == 0);
+	RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_HSI;
+	while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI);
+
+	/*PLL y over-drive apagados:*/
+	RCC->CR &= ~RCC_CR_PLLON;
+	while (RCC->CR & RCC_CR_PLLRDY);
+	RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+	PWR->CR &= ~(PWR_CR_ODSWEN_ | PWR_CR_ODEN_);
+	while (PWR->CSR & PWR_CSR_ODSWRDY_);
+
+	/*Esperas de flash, caches y prescalers para el clock nuevo:*/
+	FLASH->ACR = FLASH_ACR_PRFTEN | FLASH_ACR_ICEN | FLASH_ACR_DCEN | ws;
+	RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_HPRE | RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2))
+			  | RCC_CFGR_HPRE_DIV1 | (ppre1 << 10) | (ppre2 << 13);
+
+	/*PLL desde el HSE:*/
+	RCC->PLLCFGR = (HSE_VALUE / CLOCK_PLL_IN) | (N << 6) | ((P / 2 - 1) << 16)
+				 | RCC_PLLCFGR_PLLSRC_HSE | (Q << 24);
+	RCC->CR |= RCC_CR_PLLON;
+	while ((RCC->CR & RCC_CR_PLLRDY) == 0);
+
+	/*Over-drive: habilitacion y despues conmutacion del regulador:*/
+	if (od) {
+		PWR->CR |= PWR_CR_ODEN_;
+		while ((PWR->CSR & PWR_CSR_ODRDY_) == 0);
+		PWR->CR |= PWR_CR_ODSWEN_;
+		while ((PWR->CSR & PWR_CSR_ODSWRDY_) == 0);
+	}
+
+	RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_PLL;
+	while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL);
+
+	SystemCoreClockUpdate();
+	clockEstado.hclk = Hclk;
+	RETIME_PERIFERICOS();
+
+	__enable_irq();
+	return 1;
+}
+
+/*****************************************************************************
+CLOCK_PERFIL
+
+	* @author	A. Riedinger.
+	* @brief	Aplica un perfil. El minimo arranca en el maximo y queda
+				libre para que CLOCK_AJUSTE lo baje.
+	* @returns	void
+	* @param
+		- Perfil	CLOCK_MAX, CLOCK_BALANCEADO o CLOCK_MINIMO.
+	* @ej
+		- CLOCK_PERFIL(CLOCK_MINIMO);
+******************************************************************************/
+void CLOCK_PERFIL(uint8_t Perfil)
+{
+	clockEstado.perfil = Perfil;
+	clockEstado.fijo = Perfil != CLOCK_MINIMO;
+	clockEstado.paso = (Perfil == CLOCK_BALANCEADO) ? 1 : 0;
+	CLOCK_CONFIG(CLOCK_TABLA[clockEstado.paso]);
+}
+
+/*****************************************************************************
+CLOCK_AJUSTE
+
+	* @author	A. Riedinger.
+	* @brief	Un paso del perfil minimo con el peor caso medido de la tarea
+				en el clock actual. La tarea no escala exacto con el clock
+				(esperas de flash, conversion del ADC en tiempo fijo), asi
+				que se baja de a un paso y se vuelve a medir en vez de
+				estimar el clock final. Ademas de la carga, por muestra debe
+				quedar lugar para el peor paso de los trabajos de fondo; si
+				no, nunca correrian.
+	* @returns
+		- 1 si cambio el clock (el llamador reinicia su maximo), 0 si no.
+	* @param
+		- CiclosMax	Peor caso de la tarea en el clock actual [ciclos].
+		- Reserva	Holgura por muestra a dejar libre (FONDO_PASO_MAX) [ciclos].
+		- Fs		Frecuencia de la tarea [Hz].
+	* @ej
+		- if (CLOCK_AJUSTE(ciclosTareaMax, FONDO_PASO_MAX(&fondo), FS)) ciclosTareaMax = 0;
+******************************************************************************/
+uint8_t CLOCK_AJUSTE(uint32_t CiclosMax, uint32_t Reserva, uint32_t Fs)
+{
+	if (clockEstado.fijo) return 0;
+
+	/*Carga [%] = ciclos por muestra / presupuesto por muestra, y el
+	  presupuesto debe cubrir la tarea mas la reserva:*/
+	uint32_t carga = (uint32_t)((uint64_t)CiclosMax * Fs * 100 / clockEstado.hclk);
+	if ((uint64_t)CiclosMax + Reserva > clockEstado.hclk / Fs) carga = 100;
+
+	if (carga > CLOCK_CARGA_MAX && clockEstado.paso > 0) {
+		clockEstado.paso--;
+		clockEstado.fijo = 1;
+	}
+	else if (carga <= CLOCK_CARGA_MAX && clockEstado.paso < CLOCK_PASOS - 1)
+		clockEstado.paso++;
+	else {
+		clockEstado.fijo = 1;
+		return 0;
+	}
+
+	return CLOCK_CONFIG(CLOCK_TABLA[clockEstado.paso]);
+}
+
+/*****************************************************************************
+CLOCK_CICLOS_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Habilita el contador de ciclos del DWT (CLOCK_CICLOS).
+	* @returns	void
+	* @param	void
+	* @ej
+		- CLOCK_CICLOS_INIT();
+******************************************************************************/
+void CLOCK_CICLOS_INIT(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
@@ -0,0 +1,57 @@
+/* Definicion del header:*/
+#ifndef clock_H
+#define clock_H
+
+/* Librerias:*/
+#include "stm32f4xx.h"
+
+/*------------------------------------------------------------------------------
+PERFILES DE CLOCK:
+
+	MAX			180 MHz con over-drive.
+	BALANCEADO	168 MHz, sin over-drive (el maximo en escala 1 sin OD).
+	MINIMO		Arranca en MAX y baja por CLOCK_TABLA mientras el peor caso
+				medido de la tarea (CLOCK_AJUSTE) quede bajo CLOCK_CARGA_MAX
+				del presupuesto por muestra y deje lugar al peor paso de
+				fondo. Al primer paso que lo excede vuelve al anterior y
+				queda fijo.
+
+	Cada cambio reprograma PLL, esperas de flash y prescalers de APB y
+	re-deriva los divisores de los perifericos (RETIME_PERIFERICOS).
+------------------------------------------------------------------------------*/
+#define CLOCK_MAX			0
+#define CLOCK_BALANCEADO	1
+#define CLOCK_MINIMO		2
+
+/*Carga maxima admitida en el perfil minimo [%]:*/
+#define CLOCK_CARGA_MAX		70
+
+/*Frecuencias [Hz]:*/
+#define CLOCK_HCLK_MAX		180000000
+#define CLOCK_HCLK_SIN_OD	168000000
+
+/* Estructuras:*/
+typedef struct
+{
+	uint8_t perfil;								/*CLOCK_MAX, CLOCK_BALANCEADO o CLOCK_MINIMO.*/
+	uint8_t fijo;								/*1 si el perfil minimo ya encontro su clock.*/
+	uint8_t paso;								/*Posicion en CLOCK_TABLA.*/
+	uint32_t hclk;								/*Clock actual [Hz].*/
+} CLOCK_ESTADO;
+
+extern CLOCK_ESTADO clockEstado;
+
+/*Contador de ciclos del core (DWT), para medir la tarea por perfil:*/
+static inline uint32_t CLOCK_CICLOS(void)
+{
+	return DWT->CYCCNT;
+}
+
+/* Declaracion funciones:*/
+uint8_t CLOCK_CONFIG(uint32_t Hclk);
+void CLOCK_PERFIL(uint8_t Perfil);
+uint8_t CLOCK_AJUSTE(uint32_t CiclosMax, uint32_t Reserva, uint32_t Fs);
+void CLOCK_CICLOS_INIT(void);
+
+/* Cierre del header:*/
+#endif
@@ -0,0 +1,39 @@
+/********************************************************************************
+  * @file    coef.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Coeficientes del filtro elimina banda IIR Cheby I, n = 6,
+  	  	  	 fc = 5 kHz y fs = 20 kHz, obtenidos en GNU Octave con cheby1()
+  	  	  	 (octave/design.m). Compartidos por el firmware y las
+  	  	  	 herramientas del host.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "coef.h"
+
+/*------------------------------------------------------------------------------
+VARIABLES GLOBALES:
+------------------------------------------------------------------------------*/
+/*Coeficientes del filtro obtenidos en GNU Octave con cheby1(): */
+const float coef_b[COEF_ORDEN+1] = {0.1832424665583316, -2.4412800655459803e-16, 1.0994547993499895,
+				 -1.2206400327729901e-15, 2.7486369983749741, -2.4412800655459802e-15,
+				 3.6648493311666321, -2.4412800655459802e-15, 2.7486369983749741,
+				 -1.2206400327729901e-15, 1.0994547993499895, -2.4412800655459803e-16,
+				 0.1832424665583316};
+
+const float coef_a[COEF_ORDEN+1] = {1, -5.5511151231257827e-16, 2.8266303814860598, -1.1102230246251565e-15,
+				  3.9461521181664487, -3.5527136788005009e-15, 3.1150661053039146,
+				  -2.8310687127941492e-15, 1.6070012817944181, -6.9388939039072284e-16,
+				  0.52520012936098293, -2.0816681711721685e-16, 0.1384414456647135};
+
+/*Secciones de segundo orden con tf2sos() (octave/design.m), ordenadas por
+  radio de polo creciente; cada una con ganancia unitaria en continua y la
+  ganancia total en la primera. Los ceros del elimina banda caen en z = +-j:*/
+const float coef_sos[5*COEF_SECCIONES] = {
+				 1.0509206248588916, 0, 1.0509206248588916, 0.90162821966837237, 0.45667645052807498,
+				 0.27752411542985111, 0, 0.27752411542985111, -0.90162821966837337, 0.45667645052807554,
+				 0.56146389561517496, 0, 0.56146389561517496, -0.72242687144888673, 0.84535466267923665,
+				 1.2838907670640707, 0, 1.2838907670640707, 0.72242687144889339, 0.84535466267924786,
+				 1.286115226671245, 0, 1.286115226671245, 0.60843362328688289, 0.96379683005560723,
+				 0.6776816033843629, 0, 0.6776816033843629, -0.60843362328689088, 0.96379683005561667};
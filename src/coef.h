@@ -0,0 +1,21 @@
+/* Definicion del header:*/
+#ifndef coef_H
+#define coef_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/*Orden del prototipo - 6 (el elimina banda resultante es de orden 12):*/
+#define COEF_N      6
+#define COEF_ORDEN  (2*COEF_N)
+
+/*Secciones de segundo orden del mismo filtro, {b0, b1, b2, a1, a2} cada una:*/
+#define COEF_SECCIONES COEF_N
+
+/* Coeficientes del filtro elimina banda:*/
+extern const float coef_b[COEF_ORDEN+1];
+extern const float coef_a[COEF_ORDEN+1];
+extern const float coef_sos[5*COEF_SECCIONES];
+
+/* Cierre del header:*/
+#endif
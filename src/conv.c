@@ -0,0 +1,165 @@
+/********************************************************************************
+  * @file    conv.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Conversion de bloques de muestras entre los codigos de 12 bits
+  	  	  	 del ADC/DAC, Q15, Q31 y float. Todo en simple precision (las
+  	  	  	 constantes llevan sufijo f: un literal double en el M4 termina
+  	  	  	 en una division por software), con producto por el reciproco
+  	  	  	 en lugar de division y saturacion por hardware hacia los
+  	  	  	 enteros. Las conversiones desde float devuelven la cantidad de
+  	  	  	 muestras recortadas, para llevar un contador de saturaciones.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "conv.h"
+
+/*****************************************************************************
+CONV_I12_F32
+
+	* @author	A. Riedinger.
+	* @brief	Codigos del ADC (0 a 4095) a float -0.5 a 0.5.
+	* @returns	void
+	* @param
+		- pSrc		Codigos de 12 bits.
+		- pDst		Muestras normalizadas.
+		- n			Cantidad de muestras.
+	* @ej
+		- CONV_I12_F32(adcBuffer, muestras, 64);
+******************************************************************************/
+void CONV_I12_F32(const uint16_t* pSrc, float* pDst, uint32_t n)
+{
+	uint32_t i = 0;
+
+	for (; i + 4 <= n; i += 4) {
+		pDst[i]     = (float)((int32_t)pSrc[i]     - 2048) * CONV_I12_INV;
+		pDst[i + 1] = (float)((int32_t)pSrc[i + 1] - 2048) * CONV_I12_INV;
+		pDst[i + 2] = (float)((int32_t)pSrc[i + 2] - 2048) * CONV_I12_INV;
+		pDst[i + 3] = (float)((int32_t)pSrc[i + 3] - 2048) * CONV_I12_INV;
+	}
+	for (; i < n; i++)
+		pDst[i] = (float)((int32_t)pSrc[i] - 2048) * CONV_I12_INV;
+}
+
+/*****************************************************************************
+CONV_F32_I12
+
+	* @author	A. Riedinger.
+	* @brief	Float -0.5 a 0.5 a codigos del DAC, redondeados y saturados
+				a 0..4095 (un sobrepico satura en vez de dar la vuelta).
+	* @returns
+		- Cantidad de muestras saturadas.
+	* @param
+		- pSrc		Muestras normalizadas.
+		- pDst		Codigos de 12 bits.
+		- n			Cantidad de muestras.
+	* @ej
+		- dacClips += CONV_F32_I12(interpOut, pLibre, DAC_INTERP);
+******************************************************************************/
+uint32_t CONV_F32_I12(const float* pSrc, uint16_t* pDst, uint32_t n)
+{
+	uint32_t clip = 0;
+
+	for (uint32_t i = 0; i < n; i++)
+		pDst[i] = CONV_F32_A_I12(pSrc[i], &clip);
+	return clip;
+}
+
+/*****************************************************************************
+CONV_Q15_F32
+
+	* @author	A. Riedinger.
+	* @brief	Q15 a float -1 a 1.
+	* @returns	void
+	* @param
+		- pSrc		Muestras Q15.
+		- pDst		Muestras float.
+		- n			Cantidad de muestras.
+	* @ej
+		- CONV_Q15_F32(q15, muestras, 64);
+******************************************************************************/
+void CONV_Q15_F32(const int16_t* pSrc, float* pDst, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; i++)
+		pDst[i] = (float)pSrc[i] * CONV_Q15_INV;
+}
+
+/*****************************************************************************
+CONV_F32_Q15
+
+	* @author	A. Riedinger.
+	* @brief	Float -1 a 1 a Q15, redondeado y saturado.
+	* @returns
+		- Cantidad de muestras saturadas.
+	* @param
+		- pSrc		Muestras float.
+		- pDst		Muestras Q15.
+		- n			Cantidad de muestras.
+	* @ej
+		- clips += CONV_F32_Q15(muestras, q15, 64);
+******************************************************************************/
+uint32_t CONV_F32_Q15(const float* pSrc, int16_t* pDst, uint32_t n)
+{
+	uint32_t clip = 0;
+
+	for (uint32_t i = 0; i < n; i++) {
+		/*VCVT satura a int32, asi cualquier exceso queda del lado correcto
+		  (en el host solo dentro de +-2^31):*/
+		float x = pSrc[i] * CONV_Q15_ESCALA;
+		int32_t v = (int32_t)(x + (x >= 0.0f ? 0.5f : -0.5f));
+		int32_t s = CONV_SSAT(v, 16);
+
+		clip += (s != v);
+		pDst[i] = (int16_t)s;
+	}
+	return clip;
+}
+
+/*****************************************************************************
+CONV_Q31_F32
+
+	* @author	A. Riedinger.
+	* @brief	Q31 a float -1 a 1 (24 bits significativos).
+	* @returns	void
+	* @param
+		- pSrc		Muestras Q31.
+		- pDst		Muestras float.
+		- n			Cantidad de muestras.
+	* @ej
+		- CONV_Q31_F32(q31, muestras, 64);
+******************************************************************************/
+void CONV_Q31_F32(const int32_t* pSrc, float* pDst, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; i++)
+		pDst[i] = (float)pSrc[i] * CONV_Q31_INV;
+}
+
+/*****************************************************************************
+CONV_F32_Q31
+
+	* @author	A. Riedinger.
+	* @brief	Float -1 a 1 a Q31, saturado. La saturacion se hace en float:
+				2^31 no entra en un int32 y la conversion desbordaria.
+	* @returns
+		- Cantidad de muestras saturadas.
+	* @param
+		- pSrc		Muestras float.
+		- pDst		Muestras Q31.
+		- n			Cantidad de muestras.
+	* @ej
+		- clips += CONV_F32_Q31(muestras, q31, 64);
+******************************************************************************/
+uint32_t CONV_F32_Q31(const float* pSrc, int32_t* pDst, uint32_t n)
+{
+	uint32_t clip = 0;
+
+	for (uint32_t i = 0; i < n; i++) {
+		float x = pSrc[i];
+
+		if (x >= 1.0f)       { pDst[i] = INT32_MAX; clip++; }
+		else if (x < -1.0f)  { pDst[i] = INT32_MIN; clip++; }
+		else                 pDst[i] = (int32_t)(x * 2147483648.0f);
+	}
+	return clip;
+}
@@ -0,0 +1,58 @@
+/* Definicion del header:*/
+#ifndef conv_H
+#define conv_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/*Saturacion: instrucciones SSAT/USAT en la placa, su equivalente en C en el
+  host. El ancho debe ser constante:*/
+#ifdef USE_STDPERIPH_DRIVER
+#include "stm32f4xx.h"
+#define CONV_SSAT(x, bits)	((int32_t)__SSAT((x), (bits)))
+#define CONV_USAT(x, bits)	((int32_t)__USAT((x), (bits)))
+#else
+#define CONV_SSAT(x, bits)	((x) > (int32_t)((1u << ((bits) - 1)) - 1) ? (int32_t)((1u << ((bits) - 1)) - 1) : \
+							 (x) < -(int32_t)(1u << ((bits) - 1)) ? -(int32_t)(1u << ((bits) - 1)) : (x))
+#define CONV_USAT(x, bits)	((x) > (int32_t)((1u << (bits)) - 1) ? (int32_t)((1u << (bits)) - 1) : \
+							 (x) < 0 ? 0 : (x))
+#endif
+
+/*Escalas: codigos de 12 bits (centro 2048) <-> -0.5 a 0.5, Q15 y Q31 <-> -1 a 1:*/
+#define CONV_I12_ESCALA		4096.0f
+#define CONV_I12_INV		(1.0f / 4096.0f)
+#define CONV_Q15_ESCALA		32768.0f
+#define CONV_Q15_INV		(1.0f / 32768.0f)
+#define CONV_Q31_INV		(1.0f / 2147483648.0f)
+
+/*------------------------------------------------------------------------------
+MUESTRA A MUESTRA (para el camino de cada interrupcion):
+------------------------------------------------------------------------------*/
+/*Codigo del ADC (0 a 4095) a -0.5 a 0.5, por producto con el reciproco:*/
+static inline float CONV_I12_A_F32(int32_t Codigo)
+{
+	return (float)(Codigo - 2048) * CONV_I12_INV;
+}
+
+/*-0.5 a 0.5 a codigo del DAC, redondeado y saturado a 0..4095. Suma 1 a
+  *pClip si satura:*/
+static inline uint16_t CONV_F32_A_I12(float x, uint32_t* pClip)
+{
+	/*+4096 para truncar siempre sobre positivos (= floor) hasta -1.5:*/
+	int32_t v = (int32_t)(x * CONV_I12_ESCALA + (2048.5f + 4096.0f)) - 4096;
+	int32_t s = CONV_USAT(v, 12);
+
+	*pClip += (s != v);
+	return (uint16_t)s;
+}
+
+/* Declaracion funciones:*/
+void CONV_I12_F32(const uint16_t* pSrc, float* pDst, uint32_t n);
+uint32_t CONV_F32_I12(const float* pSrc, uint16_t* pDst, uint32_t n);
+void CONV_Q15_F32(const int16_t* pSrc, float* pDst, uint32_t n);
+uint32_t CONV_F32_Q15(const float* pSrc, int16_t* pDst, uint32_t n);
+void CONV_Q31_F32(const int32_t* pSrc, float* pDst, uint32_t n);
+uint32_t CONV_F32_Q31(const float* pSrc, int32_t* pDst, uint32_t n);
+
+/* Cierre del header:*/
+#endif
@@ -0,0 +1,84 @@
+/********************************************************************************
+  * @file    filtro.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Filtro de la aplicacion segun las opciones de compilacion de
+  	  	  	 filtro.h. El firmware y las herramientas del host pasan por aca,
+  	  	  	 asi procesan con la misma aritmetica.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "filtro.h"
+
+/*****************************************************************************
+FILTRO_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa el filtro elegido y limpia su estado. Si el
+				diseno en paralelo falla el filtro queda como un paso
+				directo (salida = entrada).
+	* @returns
+		- 1, o 0 si IIR_PAR_DESIGN no pudo disenar el filtro paralelo.
+	* @param
+		- pFiltro	Filtro a inicializar.
+		- Fs		Frecuencia de muestreo [Hz].
+	* @ej
+		- FILTRO_INIT(&filtro, FS);
+******************************************************************************/
+uint8_t FILTRO_INIT(FILTRO* pFiltro, float Fs)
+{
+#if FILTRO_ADAPTATIVO
+	NOTCH_F32_INIT(&pFiltro->notch, Fs, Fs / 4, NOTCH_RHO, NOTCH_MU);
+#elif IIR_ESTRUCTURA == IIR_DF1
+	(void)Fs;
+	IIR_F32_INIT(&pFiltro->iir, COEF_ORDEN, coef_b, coef_a, pFiltro->stateIn, pFiltro->stateOut);
+#elif IIR_ESTRUCTURA == IIR_DF2T
+	(void)Fs;
+	IIR_DF2T_F32_INIT(&pFiltro->iir, COEF_ORDEN, coef_b, coef_a, pFiltro->state);
+#elif IIR_ESTRUCTURA == IIR_PARALELO
+	/*Fracciones parciales del b[]/a[] de Octave:*/
+	float directo = 0.0f;
+	int32_t nSec;
+	(void)Fs;
+	nSec = IIR_PAR_DESIGN(COEF_ORDEN, coef_b, coef_a, pFiltro->coeffs, &directo);
+	if (nSec < 0) {
+		IIR_PAR_F32_INIT(&pFiltro->iir, 0, pFiltro->coeffs, 1.0f, pFiltro->state);
+		return 0;
+	}
+	IIR_PAR_F32_INIT(&pFiltro->iir, (uint32_t)nSec, pFiltro->coeffs, directo, pFiltro->state);
+#else
+	(void)Fs;
+	IIR_SOS_F32_INIT(&pFiltro->iir, COEF_SECCIONES, coef_sos, pFiltro->state);
+#endif
+	return 1;
+}
+
+/*****************************************************************************
+FILTRO_F32
+
+	* @author	A. Riedinger.
+	* @brief	Procesa un bloque de muestras con el filtro elegido.
+	* @returns	void
+	* @param
+		- pFiltro	Filtro.
+		- pSrc		Muestras de entrada.
+		- pDst		Muestras de salida.
+		- blockSize	Cantidad de muestras.
+	* @ej
+		- FILTRO_F32(&filtro, &iirIn, &iirOut, 1);
+******************************************************************************/
+void FILTRO_F32(FILTRO* pFiltro, const float* pSrc, float* pDst, uint32_t blockSize)
+{
+#if FILTRO_ADAPTATIVO
+	NOTCH_F32(&pFiltro->notch, pSrc, pDst, blockSize);
+#elif IIR_ESTRUCTURA == IIR_DF1
+	IIR_F32(&pFiltro->iir, pSrc, pDst, blockSize);
+#elif IIR_ESTRUCTURA == IIR_DF2T
+	IIR_DF2T_F32(&pFiltro->iir, pSrc, pDst, blockSize);
+#elif IIR_ESTRUCTURA == IIR_PARALELO
+	IIR_PAR_F32(&pFiltro->iir, pSrc, pDst, blockSize);
+#else
+	IIR_SOS_F32(&pFiltro->iir, pSrc, pDst, blockSize);
+#endif
+}
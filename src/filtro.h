@@ -0,0 +1,58 @@
+/* Definicion del header:*/
+#ifndef filtro_H
+#define filtro_H
+
+/* Librerias:*/
+#include <stdint.h>
+#include "coef.h"
+#include "iir.h"
+#include "notch.h"
+
+/*------------------------------------------------------------------------------
+OPCIONES DE COMPILACION:
+------------------------------------------------------------------------------*/
+/*Filtro: 1 notch adaptativo que sigue al interferente, 0 elimina banda fijo
+  Cheby I de orden 12 (coef.c):*/
+#ifndef FILTRO_ADAPTATIVO
+#define FILTRO_ADAPTATIVO 1
+#endif
+
+/*Estructura del elimina banda fijo - IIR_DF1, IIR_DF2T, IIR_SOS_DF2T o
+  IIR_PARALELO:*/
+#ifndef IIR_ESTRUCTURA
+#define IIR_ESTRUCTURA IIR_SOS_DF2T
+#endif
+
+/*Notch adaptativo - arranca en fs/4, ancho ~130 Hz en regimen:*/
+#define NOTCH_RHO 0.98f
+#define NOTCH_MU  0.005f
+
+/* Estructuras:*/
+/*Filtro elegido con su estado:*/
+typedef struct
+{
+#if FILTRO_ADAPTATIVO
+	NOTCH_F32_INST notch;
+#elif IIR_ESTRUCTURA == IIR_DF1
+	IIR_F32_INST iir;
+	float stateIn [COEF_ORDEN];
+	float stateOut[COEF_ORDEN];
+#elif IIR_ESTRUCTURA == IIR_DF2T
+	IIR_DF2T_F32_INST iir;
+	float state[COEF_ORDEN];
+#elif IIR_ESTRUCTURA == IIR_PARALELO
+	IIR_PAR_F32_INST iir;
+	float coeffs[4*COEF_SECCIONES];
+	float state[2*COEF_SECCIONES];
+#else
+	IIR_SOS_F32_INST iir;
+	float state[2*COEF_SECCIONES];
+#endif
+} FILTRO;
+
+/* Declaracion funciones:*/
+uint8_t FILTRO_INIT(FILTRO* pFiltro, float Fs);
+void FILTRO_F32(FILTRO* pFiltro, const float* pSrc, float* pDst, uint32_t blockSize);
+
+/* Cierre del header:*/
+#endif
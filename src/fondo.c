@@ -0,0 +1,207 @@
+/********************************************************************************
+  * @file    fondo.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Ejecutor de trabajos de fondo en la holgura entre muestras: pasos
+  	  	  	 reanudables, corte anticipado antes del proximo evento y
+  	  	  	 contabilidad de CPU por trabajo. Ver fondo.h.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "fondo.h"
+
+/*****************************************************************************
+FONDO_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa el ejecutor sin trabajos.
+	* @returns	void
+	* @param
+		- pFondo		Ejecutor.
+		- pfnCiclos		Contador de ciclos libre (CLOCK_CICLOS).
+		- pfnHolgura	Ciclos disponibles hasta el proximo evento de
+						muestreo, 0 si ya hay una muestra pendiente.
+		- Margen		Reserva sobre el peor paso (latencia de la
+						interrupcion y del propio ejecutor) [ciclos].
+	* @ej
+		- FONDO_INIT(&fondo, CLOCK_CICLOS, HOLGURA, 500);
+******************************************************************************/
+void FONDO_INIT(FONDO* pFondo, uint32_t (*pfnCiclos)(void), uint32_t (*pfnHolgura)(void), uint32_t Margen)
+{
+	pFondo->nTrabajos = 0;
+	pFondo->turno = 0;
+	pFondo->pfnCiclos = pfnCiclos;
+	pFondo->pfnHolgura = pfnHolgura;
+	pFondo->margen = Margen;
+	pFondo->cedidos = 0;
+}
+
+/*****************************************************************************
+FONDO_AGREGAR
+
+	* @author	A. Riedinger.
+	* @brief	Registra un trabajo, inactivo hasta FONDO_ACTIVAR.
+	* @returns
+		- Indice del trabajo, o -1 si no hay lugar.
+	* @param
+		- pFondo		Ejecutor.
+		- pNombre		Nombre (para el depurador).
+		- pfnPaso		Funcion de paso.
+		- pCtx			Contexto del trabajo, pasado a cada paso.
+		- PasoEstimado	Peor paso esperado [ciclos], hasta medir el real.
+	* @ej
+		- trabajoEspectro = FONDO_AGREGAR(&fondo, "espectro", ESPECTRO_PASO, &espectro, 2000);
+******************************************************************************/
+int32_t FONDO_AGREGAR(FONDO* pFondo, const char* pNombre, FONDO_PASO_FN pfnPaso, void* pCtx, uint32_t PasoEstimado)
+{
+	if (pFondo->nTrabajos >= FONDO_MAX_TRABAJOS) return -1;
+
+	FONDO_TRABAJO* pT = &pFondo->trabajo[pFondo->nTrabajos];
+	pT->pNombre = pNombre;
+	pT->pfnPaso = pfnPaso;
+	pT->pCtx = pCtx;
+	pT->activo = 0;
+	pT->pasoEstimado = PasoEstimado;
+	pT->pasoMax = PasoEstimado;
+	pT->ciclos = 0;
+	pT->pasos = 0;
+	pT->completados = 0;
+	pT->rechazados = 0;
+	pT->cedidos = 0;
+
+	return (int32_t)pFondo->nTrabajos++;
+}
+
+/*****************************************************************************
+FONDO_ACTIVAR
+
+	* @author	A. Riedinger.
+	* @brief	Encola una ejecucion del trabajo. Se puede llamar desde la
+				tarea de muestreo; si el trabajo sigue en curso la activacion
+				se rechaza (y se cuenta) en vez de pisar su contexto.
+	* @returns
+		- 1 si quedo activo, 0 si ya estaba en curso o no existe.
+	* @param
+		- pFondo		Ejecutor.
+		- Trabajo		Indice devuelto por FONDO_AGREGAR.
+	* @ej
+		- FONDO_ACTIVAR(&fondo, trabajoEspectro);
+******************************************************************************/
+uint8_t FONDO_ACTIVAR(FONDO* pFondo, int32_t Trabajo)
+{
+	if (Trabajo < 0 || (uint32_t)Trabajo >= pFondo->nTrabajos) return 0;
+
+	FONDO_TRABAJO* pT = &pFondo->trabajo[Trabajo];
+	if (pT->activo) {
+		pT->rechazados++;
+		return 0;
+	}
+	pT->activo = 1;
+	return 1;
+}
+
+/*****************************************************************************
+FONDO_EJECUTAR
+
+	* @author	A. Riedinger.
+	* @brief	Corre pasos de los trabajos activos, por turno, mientras la
+				holgura alcance para el peor paso de cada uno mas el margen.
+				Un trabajo cuyo paso no entra cede su turno al siguiente, asi
+				no bloquea a los de pasos mas cortos. Un paso que se excede
+				actualiza su peor caso, asi el proximo se corre solo con mas
+				holgura.
+	* @returns
+		- Ciclos usados (0 si no corrio ningun paso).
+	* @param
+		- pFondo		Ejecutor.
+	* @ej
+		- if (FONDO_EJECUTAR(&fondo) == 0) ... dormir ...
+******************************************************************************/
+uint32_t FONDO_EJECUTAR(FONDO* pFondo)
+{
+	uint32_t usados = 0;
+	uint32_t revisados = 0;
+
+	/*Una vuelta completa sin correr ningun paso termina:*/
+	while (revisados < pFondo->nTrabajos) {
+		FONDO_TRABAJO* pT = &pFondo->trabajo[pFondo->turno];
+
+		if (!pT->activo) {
+			pFondo->turno = (pFondo->turno + 1) % pFondo->nTrabajos;
+			revisados++;
+			continue;
+		}
+
+		/*No entra: cede y se revisa el siguiente:*/
+		if (pFondo->pfnHolgura() < pT->pasoMax + pFondo->margen) {
+			pT->cedidos++;
+			pFondo->cedidos++;
+			pFondo->turno = (pFondo->turno + 1) % pFondo->nTrabajos;
+			revisados++;
+			continue;
+		}
+
+		uint32_t inicio = pFondo->pfnCiclos();
+		uint8_t sigue = pT->pfnPaso(pT->pCtx);
+		uint32_t ciclos = pFondo->pfnCiclos() - inicio;
+
+		pT->ciclos += ciclos;
+		pT->pasos++;
+		if (ciclos > pT->pasoMax) pT->pasoMax = ciclos;
+		if (!sigue) {
+			pT->activo = 0;
+			pT->completados++;
+		}
+		usados += ciclos;
+
+		/*Siguiente trabajo en el proximo paso:*/
+		pFondo->turno = (pFondo->turno + 1) % pFondo->nTrabajos;
+		revisados = 0;
+	}
+
+	return usados;
+}
+
+/*****************************************************************************
+FONDO_PASO_MAX
+
+	* @author	A. Riedinger.
+	* @brief	Mayor peor paso de los trabajos registrados mas el margen: la
+				holgura por muestra que debe quedar para que todos corran.
+	* @returns
+		- Ciclos por muestra a reservar (0 sin trabajos).
+	* @param
+		- pFondo		Ejecutor.
+	* @ej
+		- CLOCK_AJUSTE(ciclosTareaMax, FONDO_PASO_MAX(&fondo), FS);
+******************************************************************************/
+uint32_t FONDO_PASO_MAX(const FONDO* pFondo)
+{
+	uint32_t max = 0;
+
+	for (uint32_t k = 0; k < pFondo->nTrabajos; k++)
+		if (pFondo->trabajo[k].pasoMax > max) max = pFondo->trabajo[k].pasoMax;
+
+	return pFondo->nTrabajos ? max + pFondo->margen : 0;
+}
+
+/*****************************************************************************
+FONDO_REMEDIR
+
+	* @author	A. Riedinger.
+	* @brief	Vuelve el peor paso de cada trabajo a su estimacion, para
+				medirlo de nuevo. Se llama al cambiar el clock: las esperas
+				de flash cambian los ciclos de cada paso y un maximo viejo
+				(o uno inflado por una preempcion) no baja nunca.
+	* @returns	void
+	* @param
+		- pFondo		Ejecutor.
+	* @ej
+		- if (CLOCK_AJUSTE(...)) FONDO_REMEDIR(&fondo);
+******************************************************************************/
+void FONDO_REMEDIR(FONDO* pFondo)
+{
+	for (uint32_t k = 0; k < pFondo->nTrabajos; k++)
+		pFondo->trabajo[k].pasoMax = pFondo->trabajo[k].pasoEstimado;
+}
@@ -0,0 +1,74 @@
+/* Definicion del header:*/
+#ifndef fondo_H
+#define fondo_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+TRABAJOS DE FONDO CON PRESUPUESTO DE TIEMPO:
+
+	Cada trabajo es una funcion de paso reanudable: hace una porcion acotada
+	del trabajo, guarda su avance en su contexto y devuelve 1 si le queda
+	trabajo o 0 si termino. FONDO_EJECUTAR corre pasos de los trabajos
+	activos (por turno) mientras la holgura hasta el proximo evento de
+	muestreo alcance para el peor paso medido de cada trabajo mas un margen;
+	si no alcanza, ese trabajo cede (sigue en una holgura mayor) y se revisa
+	el siguiente, asi un paso que no entra no frena a los demas.
+
+	Al cambiar el clock la holgura en ciclos cambia: FONDO_REMEDIR vuelve
+	los peores casos a la estimacion para medirlos de nuevo, y
+	FONDO_PASO_MAX da la reserva que el ajuste de clock debe dejar libre.
+
+	El tiempo y la holgura vienen del llamador (DWT y el ultimo evento en el
+	micro), asi el modulo no depende del hardware.
+------------------------------------------------------------------------------*/
+/*Cantidad maxima de trabajos:*/
+#define FONDO_MAX_TRABAJOS	4
+
+/*Funcion de paso: 1 si queda trabajo, 0 si termino:*/
+typedef uint8_t (*FONDO_PASO_FN)(void* pCtx);
+
+/* Estructuras:*/
+typedef struct
+{
+	const char* pNombre;
+	FONDO_PASO_FN pfnPaso;
+	void* pCtx;
+	volatile uint8_t activo;					/*1 mientras tenga pasos pendientes.*/
+	uint32_t pasoEstimado;						/*Peor paso esperado, hasta medirlo [ciclos].*/
+	uint32_t pasoMax;							/*Peor paso medido [ciclos].*/
+	uint32_t ciclos;							/*Ciclos de CPU acumulados.*/
+	uint32_t pasos;								/*Pasos corridos.*/
+	uint32_t completados;						/*Ejecuciones terminadas.*/
+	uint32_t rechazados;						/*Activaciones con el trabajo en curso.*/
+	uint32_t cedidos;							/*Veces que su paso no entro en la holgura.*/
+} FONDO_TRABAJO;
+
+typedef struct
+{
+	FONDO_TRABAJO trabajo[FONDO_MAX_TRABAJOS];
+	uint32_t nTrabajos;
+	uint32_t turno;								/*Proximo trabajo a revisar.*/
+	uint32_t (*pfnCiclos)(void);				/*Contador de ciclos.*/
+	uint32_t (*pfnHolgura)(void);				/*Ciclos hasta el proximo evento (0 si ya hay muestra).*/
+	uint32_t margen;							/*Reserva sobre el peor paso [ciclos].*/
+	uint32_t cedidos;							/*Pasos que no entraron en la holgura.*/
+} FONDO;
+
+/*1 mientras el trabajo tenga pasos pendientes:*/
+static inline uint8_t FONDO_ACTIVO(const FONDO* pFondo, int32_t Trabajo)
+{
+	return pFondo->trabajo[Trabajo].activo;
+}
+
+/* Declaracion funciones:*/
+void FONDO_INIT(FONDO* pFondo, uint32_t (*pfnCiclos)(void), uint32_t (*pfnHolgura)(void), uint32_t Margen);
+int32_t FONDO_AGREGAR(FONDO* pFondo, const char* pNombre, FONDO_PASO_FN pfnPaso, void* pCtx, uint32_t PasoEstimado);
+uint8_t FONDO_ACTIVAR(FONDO* pFondo, int32_t Trabajo);
+uint32_t FONDO_EJECUTAR(FONDO* pFondo);
+uint32_t FONDO_PASO_MAX(const FONDO* pFondo);
+void FONDO_REMEDIR(FONDO* pFondo);
+
+/* Cierre del header:*/
+#endif
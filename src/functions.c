@@ -1,4 +1,26 @@
 #include "functions.h"
+#include "regs.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Resultado de FIND_CHANNEL y FIND_DAC_CHANNEL para un pin sin ADC o DAC
+  (0 es un canal valido en ambos casos):*/
+#define PIN_INVALIDO		0xFF
+#define DAC_CANAL_INVALIDO	0xFFFFFFFF
+
+/*Clock maximo del ADC [Hz]:*/
+#define ADC_CLOCK_MAX		36000000
+
+/*------------------------------------------------------------------------------
+VARIABLES LOCALES:
+------------------------------------------------------------------------------*/
+/*Frecuencias pedidas a cada periferico, para re-derivar sus divisores si
+  cambia el clock (RETIME_PERIFERICOS). 0 = sin inicializar:*/
+static uint32_t freqTim2 = 0, freqTim3 = 0, freqTim6 = 0;
+static uint32_t baudUsart1 = 0;
+static ADC_TypeDef* adcDmaX = NULL;
+static uint8_t adcDmaCanal = 0;
 
 /*------------------------------------------------------------------------------
 DECLARACION DE FUNCIONES INTERNAS:
@@ -14,6 +36,19 @@ uint8_t FIND_CHANNEL(GPIO_TypeDef* Port, uint32_t Pin);
 /*Control del DAC:*/
 uint32_t FIND_DAC_CHANNEL(GPIO_TypeDef* Port, uint32_t Pin);
 
+/*Clock de los timers del bus APB1 (TIM2 a TIM7):*/
+uint32_t FIND_TIM_APB1_CLOCK(void);
+void SET_TIM_FREQ(TIM_TypeDef* TIMx, uint32_t Freq);
+
+/*Prescaler y tiempo de muestreo del ADC segun PCLK2:*/
+uint32_t FIND_ADC_PRESCALER(uint32_t* pDiv);
+uint8_t FIND_ADC_SAMPLE_TIME(uint32_t Freq, uint32_t Div);
+
+/*Salida del DAC disparada por TIM6, con o sin DMA:*/
+void INIT_TIM6_TRGO(uint32_t Freq);
+void INIT_DAC_TRIGGER(GPIO_TypeDef* Port, uint16_t Pin, uint32_t Channel, uint8_t Dma);
+void INIT_DAC_DMA_STREAM(DMA_Stream_TypeDef* Stream, uint32_t Registro, const void* pBuffer, uint32_t Largo, uint8_t Bytes);
+
 /*****************************************************************************
 INIT_DO
 
@@ -74,6 +109,9 @@ void INIT_ADC(GPIO_TypeDef* Port, uint16_t Pin)
 	uint8_t Channel;
 	Channel = FIND_CHANNEL(Port, Pin);
 
+	//Pin sin ADC: no se configura nada.
+	if (ADCX == NULL || Channel == PIN_INVALIDO) return;
+
     GPIO_InitTypeDef        GPIO_InitStructure;
     ADC_InitTypeDef         ADC_InitStructure;
     ADC_CommonInitTypeDef   ADC_CommonInitStructure;
@@ -94,7 +132,7 @@ void INIT_ADC(GPIO_TypeDef* Port, uint16_t Pin)
     //ADC Common Init:
     ADC_CommonStructInit(&ADC_CommonInitStructure);
     ADC_CommonInitStructure.ADC_Mode                = ADC_Mode_Independent;
-    ADC_CommonInitStructure.ADC_Prescaler           = ADC_Prescaler_Div4; // max 36 MHz
+    ADC_CommonInitStructure.ADC_Prescaler           = FIND_ADC_PRESCALER(NULL); // max 36 MHz
     ADC_CommonInitStructure.ADC_DMAAccessMode       = ADC_DMAAccessMode_Disabled;
     ADC_CommonInitStructure.ADC_TwoSamplingDelay    = ADC_TwoSamplingDelay_5Cycles;
     ADC_CommonInit(&ADC_CommonInitStructure);
@@ -122,27 +160,78 @@ void INIT_ADC(GPIO_TypeDef* Port, uint16_t Pin)
 READ_ADC
 
 	* @author	Catedra UTN-BHI TDII / A. Riedinger.
-	* @brief	Prende un LED por un determinado tiempo y luego lo apaga.
+	* @brief	Convierte y lee el canal inyectado del ADC del pin. Busca el
+				ADC en cada llamada: en el camino de cada muestra conviene
+				READ_ADCX con el ADC resuelto en compilacion (ver pins.h).
 	* @returns
 		- ADC_DATA	Devuelve el valor DIGITAL de la lectura en el ADCX.
 	* @param
-		- ADCX		Nombre del ADC a inicializar. Ej: ADCX.
+		- Port		Puerto del ADC. Ej: GPIOX.
+		- Pin		Pin del ADC. Ej: GPIO_Pin_X
 	* @ej
-		- READ_ADC(ADCX);
+		- READ_ADC(GPIOX, GPIO_Pin_X);
 ******************************************************************************/
 int32_t READ_ADC(GPIO_TypeDef* Port, uint16_t Pin)
 {
-    uint32_t ADC_DATA;
-
     ADC_TypeDef* ADCX;
     ADCX = FIND_ADC_TYPE(Port, Pin);
 
-    ADC_ClearFlag(ADCX, ADC_FLAG_JEOC);
-    ADC_SoftwareStartInjectedConv(ADCX);
-    while (ADC_GetFlagStatus(ADCX, ADC_FLAG_JEOC) == RESET);
+    if (ADCX == NULL) return 0;
+    return READ_ADCX(ADCX);
+}
+
+/*****************************************************************************
+READ_ADCX
+
+	* @author	A. Riedinger.
+	* @brief	Convierte y lee el canal inyectado de un ADC ya inicializado
+				con INIT_ADC, sin buscar nada.
+	* @returns
+		- Valor DIGITAL de la lectura (0 a 4095).
+	* @param
+		- ADCX		ADC del pin. Ej: PIN_ADCX(C, 0).
+	* @ej
+		- signalIn = READ_ADCX(PIN_ADCX(ADC_PUERTO, ADC_NUM)) - 2048;
+******************************************************************************/
+int32_t READ_ADCX(ADC_TypeDef* ADCX)
+{
+    return REG_ADC_READ_INJ(ADCX);
+}
+
+/*****************************************************************************
+INIT_ADC_IT
+
+	* @author	A. Riedinger.
+	* @brief	Habilita la interrupcion de fin de conversion inyectada
+				(ADC_IRQHandler, comun a los tres ADC) de un pin ya
+				inicializado con INIT_ADC. Las prioridades pasan a 4 bits de
+				preempcion sin subprioridad, asi Prioridad ordena la
+				preempcion entre todas las interrupciones.
+	* @returns	void
+	* @param
+		- Port		Puerto del ADC. Ej: GPIOX.
+		- Pin		Pin del ADC. Ej: GPIO_Pin_X
+		- Prioridad	Prioridad de preempcion (0 = la mayor).
+	* @ej
+		- INIT_ADC_IT(GPIOC, GPIO_Pin_0, 0);
+******************************************************************************/
+void INIT_ADC_IT(GPIO_TypeDef* Port, uint16_t Pin, uint8_t Prioridad)
+{
+	ADC_TypeDef* ADCX = FIND_ADC_TYPE(Port, Pin);
+
+	if (ADCX == NULL) return;
+
+	NVIC_PriorityGroupConfig(NVIC_PriorityGroup_4);
 
-    ADC_DATA = ADC_GetInjectedConversionValue(ADCX, ADC_InjectedChannel_1);
-    return ADC_DATA;
+	/*Sin pendientes viejas antes de habilitar:*/
+	ADC_ClearITPendingBit(ADCX, ADC_IT_JEOC);
+	ADC_ITConfig(ADCX, ADC_IT_JEOC, ENABLE);
+
+	NVIC_InitStructure.NVIC_IRQChannel = ADC_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = Prioridad;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
 }
 
 /*****************************************************************************
@@ -161,6 +250,8 @@ void INIT_DAC_CONT(GPIO_TypeDef* Port, uint16_t Pin)
 {
 	GPIO_InitTypeDef GPIO_InitStructure;
 
+	if (FIND_DAC_CHANNEL(Port, Pin) == DAC_CANAL_INVALIDO) return;
+
 	/* Enable GPIO clock */
 	uint32_t Clock;
 	Clock = FIND_CLOCK(Port);
@@ -201,9 +292,110 @@ DAC_CONT
 ******************************************************************************/
 void DAC_CONT(GPIO_TypeDef* Port, uint16_t Pin, int16_t MiliVolts)
 {
-	DAC_SetChannel2Data(DAC_Align_12b_R, MiliVolts);
+	uint32_t Channel = FIND_DAC_CHANNEL(Port, Pin);
+
+	if 		(Channel == DAC_Channel_1) DAC_SetChannel1Data(DAC_Align_12b_R, MiliVolts);
+	else if (Channel == DAC_Channel_2) DAC_SetChannel2Data(DAC_Align_12b_R, MiliVolts);
+}
+
+/*****************************************************************************
+INIT_DAC_DUAL_CONT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa los dos canales del DAC (PA4 y PA5) para escribirlos
+				juntos con REG_DAC_DUAL (regs.h).
+	* @returns	void
+	* @param	void
+	* @ej
+		- INIT_DAC_DUAL_CONT();
+******************************************************************************/
+void INIT_DAC_DUAL_CONT(void)
+{
+	INIT_DAC_CONT(GPIOA, GPIO_Pin_4);
+	INIT_DAC_CONT(GPIOA, GPIO_Pin_5);
+}
+
+/*****************************************************************************
+INIT_DAC_DMA
+
+	* @author	A. Riedinger.
+	* @brief	DAC disparado por TIM6 a Freq y alimentado por DMA1 desde un
+				buffer circular de codigos de 12 bits. Mientras el DMA lee una
+				mitad del buffer se escribe la otra (ver DAC_DMA_MITAD).
+	* @returns	void
+	* @param
+		- Port		Puerto del DAC. Ej: GPIOA.
+		- Pin		Pin del DAC. Ej: GPIO_Pin_5
+		- Freq		Frecuencia de actualizacion [Hz]. Ej: 20000*4.
+		- pBuffer	Buffer circular de codigos (0 a 4095).
+		- Largo		Largo del buffer (dos mitades).
+	* @ej
+		- INIT_DAC_DMA(GPIOA, GPIO_Pin_5, FS*DAC_INTERP, dacBuffer, 2*DAC_INTERP);
+******************************************************************************/
+void INIT_DAC_DMA(GPIO_TypeDef* Port, uint16_t Pin, uint32_t Freq, const uint16_t* pBuffer, uint32_t Largo)
+{
+	uint32_t Channel = FIND_DAC_CHANNEL(Port, Pin);
+
+	if (Channel == DAC_CANAL_INVALIDO) return;
+
+	/*DAC canal 1 por DMA1 Stream5, canal 2 por DMA1 Stream6 (ambos Channel 7):*/
+	if (Channel == DAC_Channel_1)
+		INIT_DAC_DMA_STREAM(DMA1_Stream5, (uint32_t)&DAC->DHR12R1, pBuffer, Largo, 2);
+	else
+		INIT_DAC_DMA_STREAM(DMA1_Stream6, (uint32_t)&DAC->DHR12R2, pBuffer, Largo, 2);
+
+	INIT_DAC_TRIGGER(Port, Pin, Channel, 1);
+	INIT_TIM6_TRGO(Freq);
+}
+
+/*****************************************************************************
+INIT_DAC_DUAL_DMA
+
+	* @author	A. Riedinger.
+	* @brief	Los dos canales del DAC disparados juntos por TIM6 a Freq, con
+				un solo DMA (el del canal 1) que copia palabras de 32 bits al
+				registro dual DHR12RD: un pedido por par de muestras y ningun
+				desfasaje entre salidas. Cada palabra se arma con
+				DAC_DUAL_PALABRA y la mitad libre se obtiene con
+				DAC_DMA_MITAD(GPIOA, GPIO_Pin_4, Largo).
+	* @returns	void
+	* @param
+		- Freq		Frecuencia de actualizacion [Hz]. Ej: 20000*4.
+		- pBuffer	Buffer circular de pares (canal 2 << 16 | canal 1).
+		- Largo		Largo del buffer en pares (dos mitades).
+	* @ej
+		- INIT_DAC_DUAL_DMA(FS*DAC_INTERP, dacBuffer, 2*DAC_INTERP);
+******************************************************************************/
+void INIT_DAC_DUAL_DMA(uint32_t Freq, const uint32_t* pBuffer, uint32_t Largo)
+{
+	INIT_DAC_DMA_STREAM(DMA1_Stream5, (uint32_t)&DAC->DHR12RD, pBuffer, Largo, 4);
+
+	INIT_DAC_TRIGGER(GPIOA, GPIO_Pin_4, DAC_Channel_1, 1);
+	INIT_DAC_TRIGGER(GPIOA, GPIO_Pin_5, DAC_Channel_2, 0);
+	INIT_TIM6_TRGO(Freq);
 }
 
+/*****************************************************************************
+DAC_DMA_MITAD
+
+	* @author	A. Riedinger.
+	* @brief	Mitad del buffer de INIT_DAC_DMA que el DMA esta leyendo.
+	* @returns
+		- 0 si lee la primera mitad, 1 si lee la segunda.
+	* @param
+		- Port		Puerto del DAC. Ej: GPIOA.
+		- Pin		Pin del DAC. Ej: GPIO_Pin_5
+		- Largo		Largo del buffer (dos mitades).
+	* @ej
+		- pLibre = &dacBuffer[DAC_DMA_MITAD(dacPort, dacPin, 2*L) ? 0 : L];
+******************************************************************************/
+uint8_t DAC_DMA_MITAD(GPIO_TypeDef* Port, uint16_t Pin, uint32_t Largo)
+{
+	DMA_Stream_TypeDef* Stream = (FIND_DAC_CHANNEL(Port, Pin) == DAC_Channel_1) ? DMA1_Stream5 : DMA1_Stream6;
+
+	/*NDTR cuenta las transferencias que faltan hasta el final del buffer:*/
+	return DMA_GetCurrDataCounter(Stream) <= Largo / 2;
+}
 
 /*****************************************************************************
 INIT_TIM3
@@ -233,20 +425,14 @@ void INIT_TIM3(uint32_t Freq)
 	TIM_ITConfig(TIM3, TIM_IT_Update, DISABLE);
 	TIM_Cmd(TIM3, DISABLE);
 
-	/*Definicion de la base de tiempo:*/
-	uint32_t TimeBase = 200e3;
-
-	/*Computar el valor del preescaler en base a la base de tiempo:*/
-	uint16_t PrescalerValue = 0;
-	PrescalerValue = (uint16_t) ((SystemCoreClock / 2) / TimeBase) - 1;
-
-	/*Configuracion del tiempo de trabajo en base a la frecuencia:*/
-	TIM_TimeBaseStructure.TIM_Period = TimeBase / Freq - 1;
-	TIM_TimeBaseStructure.TIM_Prescaler = PrescalerValue;
-	TIM_TimeBaseStructure.TIM_ClockDivision = 0;
-	TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
-
+	/*Prescaler y periodo desde el clock real de los timers de APB1 (no
+	  SystemCoreClock/2, que solo vale con APB1 = HCLK/4):*/
+	TIM_TimeBaseStructInit(&TIM_TimeBaseStructure);
 	TIM_TimeBaseInit(TIM3, &TIM_TimeBaseStructure);
+	freqTim3 = Freq;
+	SET_TIM_FREQ(TIM3, Freq);
+	TIM_GenerateEvent(TIM3, TIM_EventSource_Update);
+	TIM_ClearFlag(TIM3, TIM_FLAG_Update);
 
 	/*Habilitacion de la interrupcion:*/
 	TIM_ITConfig(TIM3, TIM_IT_Update, ENABLE);
@@ -255,12 +441,437 @@ void INIT_TIM3(uint32_t Freq)
 	TIM_Cmd(TIM3, ENABLE);
 }
 
+/*****************************************************************************
+TIM_CICLOS_CUENTA
+
+	* @author	A. Riedinger.
+	* @brief	Ciclos del core por cuenta de un timer de APB1, para pasar su
+				contador a ciclos del DWT: el ultimo update fue hace
+				CNT*TIM_CICLOS_CUENTA ciclos. Cambia con el clock.
+	* @returns
+		- Ciclos de HCLK por cuenta del contador.
+	* @param
+		- TIMx		Timer del bus APB1. Ej: TIM3.
+	* @ej
+		- ciclosCuentaTim3 = TIM_CICLOS_CUENTA(TIM3);
+******************************************************************************/
+uint32_t TIM_CICLOS_CUENTA(TIM_TypeDef* TIMx)
+{
+	SystemCoreClockUpdate();
+	return SystemCoreClock / FIND_TIM_APB1_CLOCK() * (TIMx->PSC + 1);
+}
+
+/*****************************************************************************
+INIT_ADC_DMA
+
+	* @author	A. Riedinger.
+	* @brief	ADC en conversion regular disparada por TIM2 a Freq, con los
+				resultados a un buffer circular por DMA2 Stream0. El DMA
+				interrumpe (DMA2_Stream0_IRQHandler) al llenar cada mitad.
+				El tiempo de muestreo se elige como el mas largo que entra en
+				el periodo. Freq es exacta si el clock de TIM2 (90 MHz) es
+				multiplo de ella.
+	* @returns	void
+	* @param
+		- Port		Puerto del ADC. Ej: GPIOX.
+		- Pin		Pin del ADC. Ej: GPIO_Pin_X
+		- Freq		Frecuencia de muestreo [Hz]. Ej: 20000*16.
+		- pBuffer	Buffer circular de muestras.
+		- Largo		Largo del buffer (dos mitades).
+	* @ej
+		- INIT_ADC_DMA(GPIOC, GPIO_Pin_0, FS*ADC_CIC, adcBuffer, 2*ADC_CIC);
+******************************************************************************/
+void INIT_ADC_DMA(GPIO_TypeDef* Port, uint16_t Pin, uint32_t Freq, uint16_t* pBuffer, uint32_t Largo)
+{
+	ADC_TypeDef* ADCX = FIND_ADC_TYPE(Port, Pin);
+	uint8_t Channel = FIND_CHANNEL(Port, Pin);
+
+	GPIO_InitTypeDef        GPIO_InitStructure;
+	ADC_InitTypeDef         ADC_InitStructure;
+	ADC_CommonInitTypeDef   ADC_CommonInitStructure;
+	DMA_InitTypeDef         DMA_InitStructure;
+
+	if (ADCX == NULL || Channel == PIN_INVALIDO) return;
+
+	/*Clocks del puerto, ADC, DMA2 y TIM2:*/
+	RCC_AHB1PeriphClockCmd(FIND_CLOCK(Port) | RCC_AHB1Periph_DMA2, ENABLE);
+	RCC_APB2PeriphClockCmd(FIND_RCC_APB(ADCX), ENABLE);
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
+
+	/*Pin como entrada ANALOGICA:*/
+	GPIO_StructInit(&GPIO_InitStructure);
+	GPIO_InitStructure.GPIO_Pin  = Pin;
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AN;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
+	GPIO_Init(Port, &GPIO_InitStructure);
+
+	/*DMA2 Stream0 (ADC1 en el canal 0, ADC3 en el canal 2), circular, de
+	  media palabra, con interrupcion en la mitad y al final:*/
+	DMA_DeInit(DMA2_Stream0);
+	DMA_InitStructure.DMA_Channel = (ADCX == ADC3) ? DMA_Channel_2 : DMA_Channel_0;
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&ADCX->DR;
+	DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)pBuffer;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+	DMA_InitStructure.DMA_BufferSize = Largo;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+	DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+	DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_HalfFull;
+	DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+	DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+	DMA_Init(DMA2_Stream0, &DMA_InitStructure);
+	DMA_ITConfig(DMA2_Stream0, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+	NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream0_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+	DMA_Cmd(DMA2_Stream0, ENABLE);
+
+	/*Prescaler del ADC segun PCLK2 y el tiempo de muestreo mas largo que
+	  entra en el periodo:*/
+	uint32_t div;
+	uint32_t prescaler = FIND_ADC_PRESCALER(&div);
+
+	ADC_CommonStructInit(&ADC_CommonInitStructure);
+	ADC_CommonInitStructure.ADC_Mode             = ADC_Mode_Independent;
+	ADC_CommonInitStructure.ADC_Prescaler        = prescaler;
+	ADC_CommonInitStructure.ADC_DMAAccessMode    = ADC_DMAAccessMode_Disabled;
+	ADC_CommonInitStructure.ADC_TwoSamplingDelay = ADC_TwoSamplingDelay_5Cycles;
+	ADC_CommonInit(&ADC_CommonInitStructure);
+
+	/*Conversion regular por flanco de TRGO de TIM2:*/
+	ADC_StructInit(&ADC_InitStructure);
+	ADC_InitStructure.ADC_Resolution           = ADC_Resolution_12b;
+	ADC_InitStructure.ADC_ScanConvMode         = DISABLE;
+	ADC_InitStructure.ADC_ContinuousConvMode   = DISABLE;
+	ADC_InitStructure.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_Rising;
+	ADC_InitStructure.ADC_ExternalTrigConv     = ADC_ExternalTrigConv_T2_TRGO;
+	ADC_InitStructure.ADC_DataAlign            = ADC_DataAlign_Right;
+	ADC_InitStructure.ADC_NbrOfConversion      = 1;
+	ADC_Init(ADCX, &ADC_InitStructure);
+	ADC_RegularChannelConfig(ADCX, Channel, 1, FIND_ADC_SAMPLE_TIME(Freq, div));
+	adcDmaX = ADCX;
+	adcDmaCanal = Channel;
+
+	ADC_DMARequestAfterLastTransferCmd(ADCX, ENABLE);
+	ADC_DMACmd(ADCX, ENABLE);
+	ADC_Cmd(ADCX, ENABLE);
+
+	/*TIM2 con TRGO en cada update:*/
+	TIM_TimeBaseStructInit(&TIM_TimeBaseStructure);
+	TIM_TimeBaseInit(TIM2, &TIM_TimeBaseStructure);
+	freqTim2 = Freq;
+	SET_TIM_FREQ(TIM2, Freq);
+	TIM_GenerateEvent(TIM2, TIM_EventSource_Update);
+	TIM_SelectOutputTrigger(TIM2, TIM_TRGOSource_Update);
+	TIM_Cmd(TIM2, ENABLE);
+}
+
+/*****************************************************************************
+INIT_ADC_TRIPLE
+
+	* @author	A. Riedinger.
+	* @brief	ADC1, ADC2 y ADC3 en modo triple intercalado sobre el mismo
+				canal, en conversion continua desfasados 5 ciclos, con DMA2
+				Stream4 en modo 2 (de a dos muestras por palabra). El buffer
+				queda ordenado en el tiempo: ADC1, ADC2, ADC3, ADC1, ...
+				Solo configura: cada rafaga se lanza con ADC_TRIPLE_DISPARAR.
+	* @returns
+		- Frecuencia de muestreo efectiva [Hz] (4.5 MHz con PCLK2 = 90 MHz)
+		  o 0 si el pin no va a los tres ADC.
+	* @param
+		- Port		Puerto del ADC. Solo GPIOA (Pin 0 a 3) o GPIOC (Pin 0 a 3).
+		- Pin		Pin del ADC. Ej: GPIO_Pin_0
+		- pBuffer	Buffer de la rafaga.
+		- Largo		Largo de la rafaga (par).
+	* @ej
+		- fsRafaga = INIT_ADC_TRIPLE(GPIOC, GPIO_Pin_0, rafaga, ADC_RAFAGA);
+******************************************************************************/
+uint32_t INIT_ADC_TRIPLE(GPIO_TypeDef* Port, uint16_t Pin, uint16_t* pBuffer, uint32_t Largo)
+{
+	uint8_t Channel = FIND_CHANNEL(Port, Pin);
+
+	GPIO_InitTypeDef        GPIO_InitStructure;
+	ADC_InitTypeDef         ADC_InitStructure;
+	ADC_CommonInitTypeDef   ADC_CommonInitStructure;
+	DMA_InitTypeDef         DMA_InitStructure;
+	RCC_ClocksTypeDef       Clocks;
+
+	/*Solo los canales ADC123_IN0..3 (PA0..3) y ADC123_IN10..13 (PC0..3):*/
+	if (!((Port == GPIOA && Channel <= ADC_Channel_3) ||
+		  (Port == GPIOC && Channel >= ADC_Channel_10 && Channel <= ADC_Channel_13)))
+		return 0;
+
+	/*Clocks del puerto, DMA2 y los tres ADC:*/
+	RCC_AHB1PeriphClockCmd(FIND_CLOCK(Port) | RCC_AHB1Periph_DMA2, ENABLE);
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC1 | RCC_APB2Periph_ADC2 | RCC_APB2Periph_ADC3, ENABLE);
+
+	/*Pin como entrada ANALOGICA:*/
+	GPIO_StructInit(&GPIO_InitStructure);
+	GPIO_InitStructure.GPIO_Pin  = Pin;
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AN;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
+	GPIO_Init(Port, &GPIO_InitStructure);
+
+	/*DMA2 Stream4 Channel0 desde el registro comun, de a palabra y sin
+	  circular: se detiene al completar la rafaga:*/
+	DMA_DeInit(DMA2_Stream4);
+	DMA_InitStructure.DMA_Channel = DMA_Channel_0;
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&ADC->CDR;
+	DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)pBuffer;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+	DMA_InitStructure.DMA_BufferSize = Largo / 2;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Word;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_VeryHigh;
+	DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+	DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_HalfFull;
+	DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+	DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+	DMA_Init(DMA2_Stream4, &DMA_InitStructure);
+
+	/*Cada ADC convierte en 3 + 12 = 15 ciclos y el siguiente arranca 5
+	  ciclos despues: una muestra cada 5 ciclos de ADCCLK:*/
+	uint32_t div;
+	ADC_CommonStructInit(&ADC_CommonInitStructure);
+	ADC_CommonInitStructure.ADC_Mode             = ADC_TripleMode_Interl;
+	ADC_CommonInitStructure.ADC_Prescaler        = FIND_ADC_PRESCALER(&div);
+	ADC_CommonInitStructure.ADC_DMAAccessMode    = ADC_DMAAccessMode_2;
+	ADC_CommonInitStructure.ADC_TwoSamplingDelay = ADC_TwoSamplingDelay_5Cycles;
+	ADC_CommonInit(&ADC_CommonInitStructure);
+
+	ADC_StructInit(&ADC_InitStructure);
+	ADC_InitStructure.ADC_Resolution           = ADC_Resolution_12b;
+	ADC_InitStructure.ADC_ScanConvMode         = DISABLE;
+	ADC_InitStructure.ADC_ContinuousConvMode   = ENABLE;
+	ADC_InitStructure.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_None;
+	ADC_InitStructure.ADC_DataAlign            = ADC_DataAlign_Right;
+	ADC_InitStructure.ADC_NbrOfConversion      = 1;
+	ADC_Init(ADC1, &ADC_InitStructure);
+	ADC_Init(ADC2, &ADC_InitStructure);
+	ADC_Init(ADC3, &ADC_InitStructure);
+	ADC_RegularChannelConfig(ADC1, Channel, 1, ADC_SampleTime_3Cycles);
+	ADC_RegularChannelConfig(ADC2, Channel, 1, ADC_SampleTime_3Cycles);
+	ADC_RegularChannelConfig(ADC3, Channel, 1, ADC_SampleTime_3Cycles);
+
+	RCC_GetClocksFreq(&Clocks);
+	return Clocks.PCLK2_Frequency / div / 5;
+}
+
+/*****************************************************************************
+ADC_TRIPLE_DISPARAR
+
+	* @author	A. Riedinger.
+	* @brief	Lanza una rafaga de INIT_ADC_TRIPLE. Los ADC arrancan de cero
+				en cada rafaga, asi la primera muestra es siempre de ADC1.
+	* @returns	void
+	* @param
+		- Largo		Largo de la rafaga (el mismo de INIT_ADC_TRIPLE).
+	* @ej
+		- ADC_TRIPLE_DISPARAR(ADC_RAFAGA);
+******************************************************************************/
+void ADC_TRIPLE_DISPARAR(uint32_t Largo)
+{
+	DMA_Cmd(DMA2_Stream4, DISABLE);
+	while (DMA_GetCmdStatus(DMA2_Stream4) == ENABLE);
+	DMA_ClearFlag(DMA2_Stream4, DMA_FLAG_TCIF4 | DMA_FLAG_HTIF4 | DMA_FLAG_TEIF4 |
+								DMA_FLAG_DMEIF4 | DMA_FLAG_FEIF4);
+	DMA_SetCurrDataCounter(DMA2_Stream4, Largo / 2);
+	DMA_Cmd(DMA2_Stream4, ENABLE);
+
+	/*El pedido de DMA del modo multiple se rearma reescribiendo sus bits:*/
+	ADC->CCR &= ~ADC_CCR_DMA;
+	ADC->CCR |= ADC_DMAAccessMode_2;
+	ADC_ClearFlag(ADC1, ADC_FLAG_OVR);
+	ADC_ClearFlag(ADC2, ADC_FLAG_OVR);
+	ADC_ClearFlag(ADC3, ADC_FLAG_OVR);
+
+	ADC_Cmd(ADC1, ENABLE);
+	ADC_Cmd(ADC2, ENABLE);
+	ADC_Cmd(ADC3, ENABLE);
+
+	/*tSTAB del ADC (~3us) antes de arrancar el maestro:*/
+	for (volatile uint32_t k = 0; k < 600; k++);
+	ADC_SoftwareStartConv(ADC1);
+}
+
+/*****************************************************************************
+ADC_TRIPLE_LISTA
+
+	* @author	A. Riedinger.
+	* @brief	Verifica si termino la rafaga y, en ese caso, apaga los ADC
+				para cortar la conversion continua.
+	* @returns
+		- 1 si la rafaga esta completa en el buffer, 0 si sigue en curso.
+	* @param	void
+	* @ej
+		- while (!ADC_TRIPLE_LISTA());
+******************************************************************************/
+uint8_t ADC_TRIPLE_LISTA(void)
+{
+	if (DMA_GetFlagStatus(DMA2_Stream4, DMA_FLAG_TCIF4) == RESET)
+		return 0;
+
+	ADC_Cmd(ADC1, DISABLE);
+	ADC_Cmd(ADC2, DISABLE);
+	ADC_Cmd(ADC3, DISABLE);
+	return 1;
+}
+
+/*****************************************************************************
+RETIME_PERIFERICOS
+
+	* @author	A. Riedinger.
+	* @brief	Re-deriva los divisores de todo lo inicializado en este modulo
+				despues de un cambio de clock (ver CLOCK_CONFIG): periodos de
+				TIM2, TIM3 y TIM6, prescaler y tiempo de muestreo del ADC y
+				baudrate del USART1. Las frecuencias pedidas se mantienen.
+	* @returns	void
+	* @param	void
+	* @ej
+		- RETIME_PERIFERICOS();
+******************************************************************************/
+void RETIME_PERIFERICOS(void)
+{
+	RCC_ClocksTypeDef Clocks;
+	uint32_t div;
+
+	if (freqTim2) SET_TIM_FREQ(TIM2, freqTim2);
+	if (freqTim3) SET_TIM_FREQ(TIM3, freqTim3);
+	if (freqTim6) SET_TIM_FREQ(TIM6, freqTim6);
+
+	/*ADCPRE se cambia con los ADC apagados. Cada ADC se toca solo si tiene
+	  su clock (sin clock los registros no responden), y CCR si alguno lo
+	  tiene:*/
+	uint32_t adcEn = RCC->APB2ENR & (RCC_APB2ENR_ADC1EN | RCC_APB2ENR_ADC2EN | RCC_APB2ENR_ADC3EN);
+	if (adcEn) {
+		uint32_t prescaler = FIND_ADC_PRESCALER(&div);
+		uint32_t on1 = (adcEn & RCC_APB2ENR_ADC1EN) ? ADC1->CR2 & ADC_CR2_ADON : 0;
+		uint32_t on2 = (adcEn & RCC_APB2ENR_ADC2EN) ? ADC2->CR2 & ADC_CR2_ADON : 0;
+		uint32_t on3 = (adcEn & RCC_APB2ENR_ADC3EN) ? ADC3->CR2 & ADC_CR2_ADON : 0;
+		if (on1) ADC1->CR2 &= ~ADC_CR2_ADON;
+		if (on2) ADC2->CR2 &= ~ADC_CR2_ADON;
+		if (on3) ADC3->CR2 &= ~ADC_CR2_ADON;
+		ADC->CCR = (ADC->CCR & ~ADC_CCR_ADCPRE) | prescaler;
+		if (adcDmaX) ADC_RegularChannelConfig(adcDmaX, adcDmaCanal, 1, FIND_ADC_SAMPLE_TIME(freqTim2, div));
+		if (on1) ADC1->CR2 |= on1;
+		if (on2) ADC2->CR2 |= on2;
+		if (on3) ADC3->CR2 |= on3;
+	}
+
+	/*BRR con sobremuestreo x16: PCLK2 / baudrate, redondeado a 1/16:*/
+	if (baudUsart1) {
+		RCC_GetClocksFreq(&Clocks);
+		USART1->BRR = (uint16_t)((Clocks.PCLK2_Frequency + baudUsart1 / 2) / baudUsart1);
+	}
+}
+
+/*****************************************************************************
+INIT_USART_DMA
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa el USART1 (TX en PA9) para transmitir bloques por
+				DMA2 Stream7 Channel4, sin intervencion de la CPU.
+	* @returns	void
+	* @param
+		- Baudrate	Velocidad del puerto. Ej: 921600.
+	* @ej
+		- INIT_USART_DMA(921600);
+******************************************************************************/
+void INIT_USART_DMA(uint32_t Baudrate)
+{
+	GPIO_InitTypeDef  GPIO_InitStructure;
+	USART_InitTypeDef USART_InitStructure;
+
+	/*Habilitacion de los clocks del puerto, USART1 y DMA2:*/
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOA | RCC_AHB1Periph_DMA2, ENABLE);
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_USART1, ENABLE);
+
+	/*PA9 como funcion alternativa USART1_TX:*/
+	GPIO_PinAFConfig(GPIOA, GPIO_PinSource9, GPIO_AF_USART1);
+	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_9;
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF;
+	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_InitStructure.GPIO_OType = GPIO_OType_PP;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_UP;
+	GPIO_Init(GPIOA, &GPIO_InitStructure);
+
+	/*USART1 8N1, solo transmision:*/
+	USART_InitStructure.USART_BaudRate = Baudrate;
+	baudUsart1 = Baudrate;
+	USART_InitStructure.USART_WordLength = USART_WordLength_8b;
+	USART_InitStructure.USART_StopBits = USART_StopBits_1;
+	USART_InitStructure.USART_Parity = USART_Parity_No;
+	USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+	USART_InitStructure.USART_Mode = USART_Mode_Tx;
+	USART_Init(USART1, &USART_InitStructure);
+
+	/*Pedidos de DMA en transmision:*/
+	USART_DMACmd(USART1, USART_DMAReq_Tx, ENABLE);
+	USART_Cmd(USART1, ENABLE);
+}
+
+/*****************************************************************************
+USART_DMA_SEND
+
+	* @author	A. Riedinger.
+	* @brief	Lanza la transmision de un bloque por DMA si el anterior ya
+				termino. El bloque debe seguir valido hasta la proxima llamada.
+	* @returns
+		- 1 si se lanzo la transmision, 0 si el DMA sigue ocupado.
+	* @param
+		- pData		Bloque a transmitir.
+		- nBytes	Largo del bloque.
+	* @ej
+		- USART_DMA_SEND(pFrame, CAPTURE_FRAME_BYTES);
+******************************************************************************/
+uint8_t USART_DMA_SEND(const void* pData, uint32_t nBytes)
+{
+	DMA_InitTypeDef DMA_InitStructure;
+
+	/*El stream se deshabilita solo al completar la transferencia:*/
+	if (DMA_GetCmdStatus(DMA2_Stream7) == ENABLE)
+		return 0;
+
+	DMA_ClearFlag(DMA2_Stream7, DMA_FLAG_TCIF7 | DMA_FLAG_HTIF7 | DMA_FLAG_TEIF7 |
+								DMA_FLAG_DMEIF7 | DMA_FLAG_FEIF7);
+
+	DMA_InitStructure.DMA_Channel = DMA_Channel_4;
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&USART1->DR;
+	DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)pData;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+	DMA_InitStructure.DMA_BufferSize = nBytes;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_Low;
+	DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+	DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_Full;
+	DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+	DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+	DMA_Init(DMA2_Stream7, &DMA_InitStructure);
+
+	DMA_Cmd(DMA2_Stream7, ENABLE);
+	return 1;
+}
+
 /*------------------------------------------------------------------------------
  FUNCIONES INTERNAS:
 ------------------------------------------------------------------------------*/
 uint32_t FIND_CLOCK(GPIO_TypeDef* Port)
 {
-	uint32_t Clock;
+	uint32_t Clock = 0;
 
 	if		(Port == GPIOA) Clock = RCC_AHB1Periph_GPIOA;
 	else if (Port == GPIOB) Clock = RCC_AHB1Periph_GPIOB;
@@ -269,6 +880,8 @@ uint32_t FIND_CLOCK(GPIO_TypeDef* Port)
 	else if (Port == GPIOE) Clock = RCC_AHB1Periph_GPIOE;
 	else if (Port == GPIOF) Clock = RCC_AHB1Periph_GPIOF;
 	else if (Port == GPIOG) Clock = RCC_AHB1Periph_GPIOG;
+	else if (Port == GPIOH) Clock = RCC_AHB1Periph_GPIOH;
+	else if (Port == GPIOI) Clock = RCC_AHB1Periph_GPIOI;
 	return Clock;
 }
 
@@ -324,13 +937,145 @@ uint8_t FIND_CHANNEL(GPIO_TypeDef* Port, uint32_t Pin)
 	else if (Port == GPIOF && Pin == GPIO_Pin_5)  Channel = ADC_Channel_15;	else if (Port == GPIOF && Pin == GPIO_Pin_6)  Channel = ADC_Channel_4;
 	else if (Port == GPIOF && Pin == GPIO_Pin_7)  Channel = ADC_Channel_5;	else if (Port == GPIOF && Pin == GPIO_Pin_8)  Channel = ADC_Channel_6;
 	else if (Port == GPIOF && Pin == GPIO_Pin_9)  Channel = ADC_Channel_7;	else if (Port == GPIOF && Pin == GPIO_Pin_10) Channel = ADC_Channel_8;
-	else 										  Channel = 0;
+	else 										  Channel = PIN_INVALIDO;
 
 	return Channel;
 }
 
+uint32_t FIND_TIM_APB1_CLOCK(void)
+{
+	RCC_ClocksTypeDef Clocks;
+	RCC_GetClocksFreq(&Clocks);
+
+	/*Los timers van al doble de PCLK1 si el prescaler de APB1 no es 1:*/
+	if (Clocks.PCLK1_Frequency != Clocks.HCLK_Frequency)
+		return 2 * Clocks.PCLK1_Frequency;
+	return Clocks.PCLK1_Frequency;
+}
+
+void SET_TIM_FREQ(TIM_TypeDef* TIMx, uint32_t Freq)
+{
+	uint32_t cuentas = FIND_TIM_APB1_CLOCK() / Freq;
+
+	/*TIM2 y TIM5 cuentan en 32 bits, el resto en 16:*/
+	uint32_t max = (TIMx == TIM2 || TIMx == TIM5) ? 0xFFFFFFFF : 0x10000;
+	uint32_t psc = (cuentas - 1) / max;
+
+	/*PSC se carga en el proximo update; ARR sin precarga, asi que si la
+	  cuenta ya lo paso se reinicia para no esperar la vuelta completa:*/
+	TIMx->PSC = psc;
+	TIMx->ARR = cuentas / (psc + 1) - 1;
+	if (TIMx->CNT > TIMx->ARR) TIMx->CNT = 0;
+}
+
+uint32_t FIND_ADC_PRESCALER(uint32_t* pDiv)
+{
+	static const uint32_t prescalers[] = {ADC_Prescaler_Div2, ADC_Prescaler_Div4,
+										  ADC_Prescaler_Div6, ADC_Prescaler_Div8};
+	RCC_ClocksTypeDef Clocks;
+	uint32_t k = 0;
+
+	/*El menor divisor que deja ADCCLK dentro de los 36 MHz:*/
+	RCC_GetClocksFreq(&Clocks);
+	while (k < 3 && Clocks.PCLK2_Frequency / (2 * (k + 1)) > ADC_CLOCK_MAX)
+		k++;
+
+	if (pDiv) *pDiv = 2 * (k + 1);
+	return prescalers[k];
+}
+
+uint8_t FIND_ADC_SAMPLE_TIME(uint32_t Freq, uint32_t Div)
+{
+	/*Tiempos de muestreo posibles, en ciclos del ADC:*/
+	static const uint8_t  sampleTimes[] = {ADC_SampleTime_480Cycles, ADC_SampleTime_144Cycles,
+										   ADC_SampleTime_112Cycles, ADC_SampleTime_84Cycles,
+										   ADC_SampleTime_56Cycles,  ADC_SampleTime_28Cycles,
+										   ADC_SampleTime_15Cycles,  ADC_SampleTime_3Cycles};
+	static const uint16_t sampleCiclos[] = {480, 144, 112, 84, 56, 28, 15, 3};
+	RCC_ClocksTypeDef Clocks;
+
+	/*El mas largo que, con los 12 ciclos de conversion, entra en el periodo:*/
+	RCC_GetClocksFreq(&Clocks);
+	uint32_t ciclos = (Clocks.PCLK2_Frequency / Div) / Freq;
+	uint32_t st = 0;
+	while (st < sizeof(sampleCiclos) / sizeof(sampleCiclos[0]) - 1 && sampleCiclos[st] + 12 > ciclos)
+		st++;
+
+	return sampleTimes[st];
+}
+
 uint32_t FIND_DAC_CHANNEL(GPIO_TypeDef* Port, uint32_t Pin)
 {
-	if(Port == GPIOA && Pin == GPIO_Pin_5) return DAC_Channel_2;
-	else return 0;
+	uint32_t Channel;
+
+	/*DAC_OUT1 en PA4 y DAC_OUT2 en PA5:*/
+	if 		(Port == GPIOA && Pin == GPIO_Pin_4) Channel = DAC_Channel_1;
+	else if (Port == GPIOA && Pin == GPIO_Pin_5) Channel = DAC_Channel_2;
+	else 										 Channel = DAC_CANAL_INVALIDO;
+
+	return Channel;
+}
+
+void INIT_TIM6_TRGO(uint32_t Freq)
+{
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM6, ENABLE);
+
+	/*TIM6 con TRGO en cada update:*/
+	TIM_TimeBaseStructInit(&TIM_TimeBaseStructure);
+	TIM_TimeBaseInit(TIM6, &TIM_TimeBaseStructure);
+	freqTim6 = Freq;
+	SET_TIM_FREQ(TIM6, Freq);
+	TIM_GenerateEvent(TIM6, TIM_EventSource_Update);
+	TIM_SelectOutputTrigger(TIM6, TIM_TRGOSource_Update);
+	TIM_Cmd(TIM6, ENABLE);
+}
+
+void INIT_DAC_TRIGGER(GPIO_TypeDef* Port, uint16_t Pin, uint32_t Channel, uint8_t Dma)
+{
+	GPIO_InitTypeDef GPIO_InitStructure;
+
+	/*Clocks del puerto y del DAC:*/
+	RCC_AHB1PeriphClockCmd(FIND_CLOCK(Port), ENABLE);
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_DAC, ENABLE);
+
+	/*Pin como salida ANALOGICA:*/
+	GPIO_InitStructure.GPIO_Pin = Pin;
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AN;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
+	GPIO_Init(Port, &GPIO_InitStructure);
+
+	/*Canal disparado por TIM6, con pedido de DMA en cada disparo si Dma:*/
+	DAC_InitStructure.DAC_Trigger = DAC_Trigger_T6_TRGO;
+	DAC_InitStructure.DAC_WaveGeneration = DAC_WaveGeneration_None;
+	DAC_InitStructure.DAC_OutputBuffer = DAC_OutputBuffer_Enable;
+	DAC_Init(Channel, &DAC_InitStructure);
+	DAC_Cmd(Channel, ENABLE);
+	DAC_DMACmd(Channel, Dma ? ENABLE : DISABLE);
+}
+
+void INIT_DAC_DMA_STREAM(DMA_Stream_TypeDef* Stream, uint32_t Registro, const void* pBuffer, uint32_t Largo, uint8_t Bytes)
+{
+	DMA_InitTypeDef DMA_InitStructure;
+
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1, ENABLE);
+
+	/*DMA circular, memoria a periferico, de media palabra o palabra:*/
+	DMA_DeInit(Stream);
+	DMA_InitStructure.DMA_Channel = DMA_Channel_7;
+	DMA_InitStructure.DMA_PeripheralBaseAddr = Registro;
+	DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)pBuffer;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+	DMA_InitStructure.DMA_BufferSize = Largo;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize = (Bytes == 4) ? DMA_PeripheralDataSize_Word : DMA_PeripheralDataSize_HalfWord;
+	DMA_InitStructure.DMA_MemoryDataSize = (Bytes == 4) ? DMA_MemoryDataSize_Word : DMA_MemoryDataSize_HalfWord;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+	DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+	DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_HalfFull;
+	DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+	DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+	DMA_Init(Stream, &DMA_InitStructure);
+	DMA_Cmd(Stream, ENABLE);
 }
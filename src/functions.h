@@ -13,6 +13,7 @@
 #include "stm32f4xx_syscfg.h"
 #include "stm32f4xx_dac.h"
 #include "stm32f4xx_dma.h"
+#include "stm32f4xx_usart.h"
 
 /* Estructuras:*/
 TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
@@ -21,14 +22,32 @@ EXTI_InitTypeDef   		EXTI_InitStructure;
 DAC_InitTypeDef 		DAC_InitStructure;
 NVIC_InitTypeDef 		NVIC_InitStructure;
 
+/*Palabra del registro dual del DAC: canal 2 en [27:16], canal 1 en [11:0].
+  Se enmascara para que un codigo fuera de rango no invada el otro canal:*/
+#define DAC_DUAL_PALABRA(Ch1, Ch2)	((((uint32_t)(Ch2) & 0xFFF) << 16) | ((uint32_t)(Ch1) & 0xFFF))
+
 /* Declaracion funciones:*/
 void INIT_DO(GPIO_TypeDef* Port, uint32_t Pin);
 void INIT_ADC(GPIO_TypeDef* Port, uint16_t Pin);
 int32_t READ_ADC(GPIO_TypeDef* Port, uint16_t Pin);
+int32_t READ_ADCX(ADC_TypeDef* ADCX);
+void INIT_ADC_IT(GPIO_TypeDef* Port, uint16_t Pin, uint8_t Prioridad);
 void INIT_DAC_CONT(GPIO_TypeDef* Port, uint16_t Pin);
 void DAC_CONT(GPIO_TypeDef* Port, uint16_t Pin, int16_t MiliVolts);
+void INIT_DAC_DUAL_CONT(void);
+void INIT_DAC_DMA(GPIO_TypeDef* Port, uint16_t Pin, uint32_t Freq, const uint16_t* pBuffer, uint32_t Largo);
+void INIT_DAC_DUAL_DMA(uint32_t Freq, const uint32_t* pBuffer, uint32_t Largo);
+uint8_t DAC_DMA_MITAD(GPIO_TypeDef* Port, uint16_t Pin, uint32_t Largo);
 void INIT_TIM3();
+uint32_t TIM_CICLOS_CUENTA(TIM_TypeDef* TIMx);
 void SET_TIM3(uint32_t TimeBase, uint32_t Freq);
+void INIT_ADC_DMA(GPIO_TypeDef* Port, uint16_t Pin, uint32_t Freq, uint16_t* pBuffer, uint32_t Largo);
+uint32_t INIT_ADC_TRIPLE(GPIO_TypeDef* Port, uint16_t Pin, uint16_t* pBuffer, uint32_t Largo);
+void ADC_TRIPLE_DISPARAR(uint32_t Largo);
+uint8_t ADC_TRIPLE_LISTA(void);
+void RETIME_PERIFERICOS(void);
+void INIT_USART_DMA(uint32_t Baudrate);
+uint8_t USART_DMA_SEND(const void* pData, uint32_t nBytes);
 
 /* Cierre del header:*/
 #endif
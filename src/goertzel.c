@@ -0,0 +1,121 @@
+/********************************************************************************
+  * @file    goertzel.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Banco de detectores de tono por el algoritmo de Goertzel. Mide la
+  	  	  	 energia en unas pocas frecuencias (centro del elimina banda y
+  	  	  	 frecuencias de guarda) con 1 MAC por muestra y por tono.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "goertzel.h"
+#include <math.h>
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Piso de potencia para evitar log10(0):*/
+#define GOERTZEL_PISO 1e-12f
+
+/*****************************************************************************
+GOERTZEL_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa un banco de detectores de Goertzel.
+	* @returns	void
+	* @param
+		- pBank			Banco a inicializar.
+		- Fs			Frecuencia de muestreo [Hz].
+		- pFreqs		Arreglo con las frecuencias de los tonos [Hz].
+		- nTonos		Cantidad de tonos (max GOERTZEL_MAX_TONOS).
+		- largoBloque	Muestras por bloque de medicion.
+	* @ej
+		- GOERTZEL_INIT(&bank, 20000, freqs, 3, 400);
+******************************************************************************/
+void GOERTZEL_INIT(GOERTZEL_BANK* pBank, float Fs, const float* pFreqs, uint32_t nTonos, uint32_t largoBloque)
+{
+	if (nTonos > GOERTZEL_MAX_TONOS) nTonos = GOERTZEL_MAX_TONOS;
+	if (largoBloque == 0) largoBloque = 1;
+
+	pBank->nTonos = nTonos;
+	pBank->largoBloque = largoBloque;
+	pBank->cuenta = 0;
+
+	/*Un seno de amplitud A da |X(k)| = A*N/2 al final del bloque:*/
+	pBank->escala = 4.0f / ((float)largoBloque * (float)largoBloque);
+
+	for (uint32_t k = 0; k < nTonos; k++) {
+		pBank->coef[k] = 2.0f * cosf(2.0f * (float)M_PI * pFreqs[k] / Fs);
+		pBank->s1[k] = 0.0f;
+		pBank->s2[k] = 0.0f;
+		pBank->potencia[k] = 0.0f;
+		pBank->potenciaDb[k] = 10.0f * log10f(GOERTZEL_PISO);
+	}
+}
+
+/*****************************************************************************
+GOERTZEL_UPDATE
+
+	* @author	A. Riedinger.
+	* @brief	Procesa una muestra en todos los tonos del banco. Al completar
+				el bloque actualiza potencia[] y potenciaDb[] y reinicia.
+	* @returns
+		- 1 si se completo un bloque, 0 en otro caso.
+	* @param
+		- pBank		Banco de detectores.
+		- Sample	Muestra de entrada.
+	* @ej
+		- if (GOERTZEL_UPDATE(&bank, iirIn)) ...
+******************************************************************************/
+uint8_t GOERTZEL_UPDATE(GOERTZEL_BANK* pBank, float Sample)
+{
+	float s;
+
+	/*Recursion s(n) = x(n) + coef*s(n-1) - s(n-2):*/
+	for (uint32_t k = 0; k < pBank->nTonos; k++) {
+		s = Sample + pBank->coef[k] * pBank->s1[k] - pBank->s2[k];
+		pBank->s2[k] = pBank->s1[k];
+		pBank->s1[k] = s;
+	}
+
+	if (++pBank->cuenta < pBank->largoBloque)
+		return 0;
+
+	/*Fin de bloque: |X(k)|^2 = s1^2 + s2^2 - coef*s1*s2:*/
+	for (uint32_t k = 0; k < pBank->nTonos; k++) {
+		float s1 = pBank->s1[k];
+		float s2 = pBank->s2[k];
+		float p  = (s1 * s1 + s2 * s2 - pBank->coef[k] * s1 * s2) * pBank->escala;
+
+		if (p < GOERTZEL_PISO) p = GOERTZEL_PISO;
+		pBank->potencia[k] = p;
+		pBank->potenciaDb[k] = 10.0f * log10f(p);
+
+		pBank->s1[k] = 0.0f;
+		pBank->s2[k] = 0.0f;
+	}
+	pBank->cuenta = 0;
+
+	return 1;
+}
+
+/*****************************************************************************
+GOERTZEL_RECHAZO_DB
+
+	* @author	A. Riedinger.
+	* @brief	Relacion de rechazo de un tono entre la entrada y la salida del
+				filtro, a partir del ultimo bloque de ambos bancos.
+	* @returns
+		- Rechazo en dB (positivo = el filtro atenua el tono).
+	* @param
+		- pIn	Banco aplicado a la entrada del filtro.
+		- pOut	Banco aplicado a la salida del filtro.
+		- Tono	Indice del tono a comparar.
+	* @ej
+		- rechazoDb = GOERTZEL_RECHAZO_DB(&bankIn, &bankOut, 0);
+******************************************************************************/
+float GOERTZEL_RECHAZO_DB(const GOERTZEL_BANK* pIn, const GOERTZEL_BANK* pOut, uint32_t Tono)
+{
+	return pIn->potenciaDb[Tono] - pOut->potenciaDb[Tono];
+}
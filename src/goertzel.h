@@ -0,0 +1,31 @@
+/* Definicion del header:*/
+#ifndef goertzel_H
+#define goertzel_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/* Cantidad maxima de tonos por banco:*/
+#define GOERTZEL_MAX_TONOS 4
+
+/* Estructuras:*/
+typedef struct
+{
+	uint32_t nTonos;							/*Cantidad de tonos en uso.*/
+	uint32_t largoBloque;						/*Muestras por bloque de medicion.*/
+	uint32_t cuenta;							/*Muestras acumuladas del bloque actual.*/
+	float escala;								/*Normalizacion: (2/N)^2.*/
+	float coef[GOERTZEL_MAX_TONOS];				/*2*cos(2*pi*f/fs) de cada tono.*/
+	float s1[GOERTZEL_MAX_TONOS];				/*Estado s(n-1).*/
+	float s2[GOERTZEL_MAX_TONOS];				/*Estado s(n-2).*/
+	float potencia[GOERTZEL_MAX_TONOS];			/*Potencia del ultimo bloque (amplitud^2).*/
+	float potenciaDb[GOERTZEL_MAX_TONOS];		/*Potencia del ultimo bloque en dB.*/
+} GOERTZEL_BANK;
+
+/* Declaracion funciones:*/
+void GOERTZEL_INIT(GOERTZEL_BANK* pBank, float Fs, const float* pFreqs, uint32_t nTonos, uint32_t largoBloque);
+uint8_t GOERTZEL_UPDATE(GOERTZEL_BANK* pBank, float Sample);
+float GOERTZEL_RECHAZO_DB(const GOERTZEL_BANK* pIn, const GOERTZEL_BANK* pOut, uint32_t Tono);
+
+/* Cierre del header:*/
+#endif
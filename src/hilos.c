@@ -0,0 +1,191 @@
+/********************************************************************************
+  * @file    hilos.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Cadena de procesamiento en hilos de CMSIS-RTOS: filtro en el
+  	  	  	 hilo de mayor prioridad y espectro, control y telemetria en
+  	  	  	 hilos de menor prioridad unidos por colas de mensajes. Ver
+  	  	  	 hilos.h.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "hilos.h"
+#include <string.h>
+#include "filtro.h"
+#include "goertzel.h"
+#include "capture.h"
+#include "conv.h"
+
+/*Sin kernel en la placa no se compila (no hay implementacion de cmsis_os):*/
+#if MODO_RTOS || !defined(USE_STDPERIPH_DRIVER)
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Par de codigos en un mensaje:*/
+#define HILOS_PAR(In, Out)		(((uint32_t)(In) << 16) | (uint32_t)(Out))
+#define HILOS_IN(Par)			((uint16_t)((Par) >> 16))
+#define HILOS_OUT(Par)			((uint16_t)((Par) & 0xFFFF))
+
+static void HILO_DSP(void const* pArg);
+static void HILO_ESPECTRO(void const* pArg);
+static void HILO_CONTROL(void const* pArg);
+static void HILO_TELEMETRIA(void const* pArg);
+
+osThreadDef(HILO_DSP,        osPriorityRealtime,    1, 1024);
+osThreadDef(HILO_ESPECTRO,   osPriorityNormal,      1, 1024);
+osThreadDef(HILO_CONTROL,    osPriorityBelowNormal, 1, 512);
+osThreadDef(HILO_TELEMETRIA, osPriorityLow,         1, 512);
+
+osMessageQDef(colaEspectro,   HILOS_COLA_MUESTRAS, uint32_t);
+osMessageQDef(colaTelemetria, HILOS_COLA_MUESTRAS, uint32_t);
+osMessageQDef(colaControl,    HILOS_COLA_CONTROL,  float);
+
+/*------------------------------------------------------------------------------
+VARIABLES LOCALES:
+------------------------------------------------------------------------------*/
+static HILOS_IO io;
+static osThreadId idDsp = NULL;
+static osMessageQId qEspectro, qTelemetria, qControl;
+
+/*Estado de cada hilo, solo tocado por su hilo:*/
+static FILTRO filtro;
+static GOERTZEL_BANK goertzelIn, goertzelOut;
+static CAPTURE capture;
+
+HILOS_ESTADO hilosEstado;
+
+/*------------------------------------------------------------------------------
+HILOS:
+------------------------------------------------------------------------------*/
+/*Una muestra por senal. Las senales no se acumulan: si llegan dos antes de
+  despertar se procesa una, y la diferencia con los disparos del timer es
+  la medida de muestras perdidas:*/
+static void HILO_DSP(void const* pArg)
+{
+	uint32_t clips = 0;
+	(void)pArg;
+
+	while (1) {
+		osSignalWait(HILOS_SENAL_MUESTRA, osWaitForever);
+
+		float iirIn = io.pfnLeer();
+		float iirOut;
+		FILTRO_F32(&filtro, &iirIn, &iirOut, 1);
+		io.pfnEscribir(iirOut);
+
+		uint32_t par = HILOS_PAR(CONV_F32_A_I12(iirIn, &clips), CONV_F32_A_I12(iirOut, &clips));
+		hilosEstado.dacClips = clips;
+		hilosEstado.muestras++;
+
+		if (osMessagePut(qEspectro, par, 0) != osOK) hilosEstado.perdidasEspectro++;
+		if (io.pfnEnviar && osMessagePut(qTelemetria, par, 0) != osOK) hilosEstado.perdidasTelemetria++;
+	}
+}
+
+static void HILO_ESPECTRO(void const* pArg)
+{
+	(void)pArg;
+
+	while (1) {
+		osEvent ev = osMessageGet(qEspectro, osWaitForever);
+		if (ev.status != osEventMessage) continue;
+
+		GOERTZEL_UPDATE(&goertzelIn, CONV_I12_A_F32(HILOS_IN(ev.value.v)));
+		if (GOERTZEL_UPDATE(&goertzelOut, CONV_I12_A_F32(HILOS_OUT(ev.value.v)))) {
+			float rechazo = GOERTZEL_RECHAZO_DB(&goertzelIn, &goertzelOut, 0);
+			uint32_t bits;
+			memcpy(&bits, &rechazo, sizeof(bits));
+			if (osMessagePut(qControl, bits, 0) != osOK) hilosEstado.perdidasControl++;
+		}
+	}
+}
+
+static void HILO_CONTROL(void const* pArg)
+{
+	(void)pArg;
+
+	while (1) {
+		osEvent ev = osMessageGet(qControl, osWaitForever);
+		if (ev.status != osEventMessage) continue;
+
+		float rechazo;
+		memcpy(&rechazo, &ev.value.v, sizeof(rechazo));
+		hilosEstado.rechazoDb = rechazo;
+		hilosEstado.bloques++;
+		if (io.pfnControl) io.pfnControl(rechazo);
+	}
+}
+
+static void HILO_TELEMETRIA(void const* pArg)
+{
+	(void)pArg;
+
+	while (1) {
+		osEvent ev = osMessageGet(qTelemetria, osWaitForever);
+		if (ev.status == osEventMessage)
+			CAPTURE_PUSH(&capture, HILOS_IN(ev.value.v), HILOS_OUT(ev.value.v));
+	}
+}
+
+/*****************************************************************************
+HILOS_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa filtro, monitor y captura y crea colas e hilos.
+				Se llama despues de osKernelInitialize; el DSP queda
+				esperando la primera HILOS_MUESTRA.
+	* @returns
+		- osOK, osErrorParameter si el filtro no se pudo disenar u
+		  osErrorResource si no se pudo crear algun objeto.
+	* @param
+		- pIo		Acceso al hardware (se copia).
+	* @ej
+		- HILOS_INIT(&hilosIo);
+******************************************************************************/
+osStatus HILOS_INIT(const HILOS_IO* pIo)
+{
+	/*Centro del elimina banda (fs/4) y guardas, como el lazo principal:*/
+	const float freqs[HILOS_GOERTZEL_TONOS] = {pIo->fs / 4, pIo->fs / 10, 2 * pIo->fs / 5};
+
+	io = *pIo;
+	memset(&hilosEstado, 0, sizeof(hilosEstado));
+
+	if (!FILTRO_INIT(&filtro, io.fs)) return osErrorParameter;
+	GOERTZEL_INIT(&goertzelIn,  io.fs, freqs, HILOS_GOERTZEL_TONOS, HILOS_GOERTZEL_BLOQUE);
+	GOERTZEL_INIT(&goertzelOut, io.fs, freqs, HILOS_GOERTZEL_TONOS, HILOS_GOERTZEL_BLOQUE);
+	if (io.pfnEnviar) CAPTURE_INIT(&capture, io.tipoCaptura, io.pfnEnviar);
+
+	qEspectro = osMessageCreate(osMessageQ(colaEspectro), NULL);
+	qTelemetria = osMessageCreate(osMessageQ(colaTelemetria), NULL);
+	qControl = osMessageCreate(osMessageQ(colaControl), NULL);
+	if (!qEspectro || !qTelemetria || !qControl) return osErrorResource;
+
+	/*Los consumidores primero, asi estan esperando cuando el DSP arranca:*/
+	if (!osThreadCreate(osThread(HILO_CONTROL), NULL)) return osErrorResource;
+	if (!osThreadCreate(osThread(HILO_ESPECTRO), NULL)) return osErrorResource;
+	if (io.pfnEnviar && !osThreadCreate(osThread(HILO_TELEMETRIA), NULL)) return osErrorResource;
+	idDsp = osThreadCreate(osThread(HILO_DSP), NULL);
+	if (!idDsp) return osErrorResource;
+
+	return osOK;
+}
+
+/*****************************************************************************
+HILOS_MUESTRA
+
+	* @author	A. Riedinger.
+	* @brief	Despierta al hilo DSP. Se llama desde la interrupcion que
+				marca cada muestra (TIM3 o DMA del ADC).
+	* @returns	void
+	* @param	void
+	* @ej
+		- HILOS_MUESTRA();
+******************************************************************************/
+void HILOS_MUESTRA(void)
+{
+	if (idDsp && osKernelRunning()) osSignalSet(idDsp, HILOS_SENAL_MUESTRA);
+}
+
+#endif
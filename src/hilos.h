@@ -0,0 +1,74 @@
+/* Definicion del header:*/
+#ifndef hilos_H
+#define hilos_H
+
+/* Librerias:*/
+#include <stdint.h>
+#include "cmsis_os.h"
+
+/*Modo de ejecucion en la placa - 0 lazo principal de main.c, 1 hilos de
+  CMSIS-RTOS. Se define para todo el proyecto, junto con un kernel que
+  implemente cmsis_os.h (p.ej. RTX); en el host el modulo se compila
+  siempre:*/
+#ifndef MODO_RTOS
+#define MODO_RTOS 0
+#endif
+
+/*------------------------------------------------------------------------------
+PROCESAMIENTO EN HILOS (CMSIS-RTOS):
+
+	DSP         osPriorityRealtime	Despertado por HILOS_MUESTRA (ISR del
+									TIM3 o del DMA): lee, filtra y escribe
+									una muestra y la reparte por colas.
+	Espectro    osPriorityNormal	Goertzel de entrada y salida; por bloque
+									envia el rechazo al control.
+	Control     osPriorityBelowNormal	Guarda el rechazo y llama a la
+									accion de control del llamador.
+	Telemetria  osPriorityLow		Tramas de captura (capture.h).
+
+	Las colas llevan el par de codigos de 12 bits (entrada << 16 | salida).
+	El DSP nunca espera: si una cola esta llena la muestra se descarta para
+	ese hilo y se cuenta. El hardware queda del lado del llamador (HILOS_IO),
+	asi el mismo modulo corre en la placa y en el host (host/cmsis_os_posix.c).
+------------------------------------------------------------------------------*/
+/*Senal del hilo DSP y largo de las colas [muestras]:*/
+#define HILOS_SENAL_MUESTRA		0x0001
+#define HILOS_COLA_MUESTRAS		256
+#define HILOS_COLA_CONTROL		8
+
+/*Monitor de Goertzel del hilo de espectro:*/
+#define HILOS_GOERTZEL_BLOQUE	400
+#define HILOS_GOERTZEL_TONOS	3
+
+/* Estructuras:*/
+/*Acceso al hardware, provisto por el llamador:*/
+typedef struct
+{
+	float (*pfnLeer)(void);						/*Muestra de entrada, -0.5 a 0.5.*/
+	void (*pfnEscribir)(float Muestra);			/*Muestra de salida, -0.5 a 0.5.*/
+	uint8_t (*pfnEnviar)(const void* pFrame, uint32_t nBytes);	/*Transporte de telemetria, o NULL.*/
+	void (*pfnControl)(float RechazoDb);		/*Accion por bloque de Goertzel, o NULL.*/
+	uint8_t tipoCaptura;						/*CAPTURE_ENTRADA / SALIDA / AMBAS.*/
+	float fs;									/*Frecuencia de muestreo [Hz].*/
+} HILOS_IO;
+
+/*Estadisticas del procesamiento:*/
+typedef struct
+{
+	volatile uint32_t muestras;					/*Muestras procesadas por el DSP.*/
+	volatile uint32_t perdidasEspectro;			/*Descartadas por cola llena.*/
+	volatile uint32_t perdidasTelemetria;
+	volatile uint32_t perdidasControl;
+	volatile uint32_t bloques;					/*Bloques de Goertzel completos.*/
+	volatile uint32_t dacClips;					/*Salidas saturadas.*/
+	volatile float rechazoDb;					/*Ultimo rechazo medido [dB].*/
+} HILOS_ESTADO;
+
+extern HILOS_ESTADO hilosEstado;
+
+/* Declaracion funciones:*/
+osStatus HILOS_INIT(const HILOS_IO* pIo);
+void HILOS_MUESTRA(void);
+
+/* Cierre del header:*/
+#endif
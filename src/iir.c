@@ -0,0 +1,222 @@
+/********************************************************************************
+  * @file    iir.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Nucleos de filtrado IIR en punto flotante de simple precision.
+  	  	  	 Sin dependencias del micro: se compilan igual en el host.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "iir.h"
+
+/*****************************************************************************
+IIR_F32_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa un filtro IIR en Forma Directa I y limpia su estado.
+	* @returns	void
+	* @param
+		- S			Instancia del filtro.
+		- nCoef		Orden del filtro.
+		- pCoeff_b	Coeficientes del numerador (nCoef+1).
+		- pCoeff_a	Coeficientes del denominador (nCoef+1, a[0] = 1).
+		- pStateIn	Historia de entrada (nCoef).
+		- pStateOut	Historia de salida (nCoef).
+	* @ej
+		- IIR_F32_INIT(&iir, 12, coef_b, coef_a, stateIn, stateOut);
+******************************************************************************/
+void IIR_F32_INIT(IIR_F32_INST* S, uint32_t nCoef, const float* pCoeff_b, const float* pCoeff_a,
+				  float* pStateIn, float* pStateOut)
+{
+	S->nCoef = nCoef;
+	S->pCoeff_b = pCoeff_b;
+	S->pCoeff_a = pCoeff_a;
+	S->pStateIn = pStateIn;
+	S->pStateOut = pStateOut;
+
+	for (uint32_t i = 0; i < nCoef; i++) {
+		pStateIn[i] = 0.0f;
+		pStateOut[i] = 0.0f;
+	}
+}
+
+/*****************************************************************************
+IIR_F32
+
+	* @author	A. Riedinger.
+	* @brief	Proceso del IIR en Forma Directa I:
+				Y(n) = B0*X(n) + B1*X(n-1) + ... - A1*Y(n-1) - A2*Y(n-2) - ...
+	* @returns	void
+	* @param
+		- S			Instancia del filtro.
+		- pSrc		Muestras de entrada.
+		- pDst		Muestras de salida.
+		- blockSize	Cantidad de muestras.
+	* @ej
+		- IIR_F32(&iir, &iirIn, &iirOut, 1);
+******************************************************************************/
+void IIR_F32(IIR_F32_INST* S, const float* pSrc, float* pDst, uint32_t blockSize)
+{
+	const float* pCoeff_b = S->pCoeff_b;
+	const float* pCoeff_a = S->pCoeff_a;
+	float* pStateIn = S->pStateIn;
+	float* pStateOut = S->pStateOut;
+	uint32_t N_COEF = S->nCoef;
+
+	for (uint32_t k = 0; k < blockSize; k++) {
+		float ACUM;
+
+		/*Senal de Entrada:*/
+		ACUM = pSrc[k] * pCoeff_b[0];
+
+		/*Diseño del filtro:*/
+		for (uint32_t i = 0; i < N_COEF; i++) {
+			ACUM += pStateIn [i] * pCoeff_b[i+1];
+			ACUM -= pStateOut[i] * pCoeff_a[i+1];
+		}
+
+		/*Se desplazan las historias una muestra:*/
+		for (uint32_t i = N_COEF - 1; i > 0; i--) {
+			pStateIn[i]  = pStateIn [i-1];
+			pStateOut[i] = pStateOut[i-1];
+		}
+
+		pStateIn [0] = pSrc[k];
+		pStateOut[0] = ACUM;
+
+		/*Senal de salida:*/
+		pDst[k] = ACUM;
+	}
+}
+
+/*****************************************************************************
+IIR_DF2T_F32_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa un filtro IIR en Forma Directa II Transpuesta.
+	* @returns	void
+	* @param
+		- S			Instancia del filtro.
+		- nCoef		Orden del filtro.
+		- pCoeff_b	Coeficientes del numerador (nCoef+1).
+		- pCoeff_a	Coeficientes del denominador (nCoef+1, a[0] = 1).
+		- pState	Vector de estado (nCoef).
+	* @ej
+		- IIR_DF2T_F32_INIT(&iir, 12, coef_b, coef_a, state);
+******************************************************************************/
+void IIR_DF2T_F32_INIT(IIR_DF2T_F32_INST* S, uint32_t nCoef, const float* pCoeff_b, const float* pCoeff_a,
+					   float* pState)
+{
+	S->nCoef = nCoef;
+	S->pCoeff_b = pCoeff_b;
+	S->pCoeff_a = pCoeff_a;
+	S->pState = pState;
+
+	for (uint32_t i = 0; i < nCoef; i++)
+		pState[i] = 0.0f;
+}
+
+/*****************************************************************************
+IIR_DF2T_F32
+
+	* @author	A. Riedinger.
+	* @brief	Proceso del IIR en Forma Directa II Transpuesta, en una pasada
+				por muestra y sin desplazar historias:
+				Y(n) = B0*X(n) + S0
+				Si   = Si+1 + Bi+1*X(n) - Ai+1*Y(n)
+	* @returns	void
+	* @param
+		- S			Instancia del filtro.
+		- pSrc		Muestras de entrada.
+		- pDst		Muestras de salida.
+		- blockSize	Cantidad de muestras.
+	* @ej
+		- IIR_DF2T_F32(&iir, &iirIn, &iirOut, 1);
+******************************************************************************/
+void IIR_DF2T_F32(IIR_DF2T_F32_INST* S, const float* pSrc, float* pDst, uint32_t blockSize)
+{
+	const float* pB = S->pCoeff_b;
+	const float* pA = S->pCoeff_a;
+	float* pState = S->pState;
+	uint32_t N_COEF = S->nCoef;
+
+	for (uint32_t k = 0; k < blockSize; k++) {
+		float x = pSrc[k];
+		float y = pB[0] * x + pState[0];
+
+		for (uint32_t i = 0; i < N_COEF - 1; i++)
+			pState[i] = pState[i+1] + pB[i+1] * x - pA[i+1] * y;
+		pState[N_COEF-1] = pB[N_COEF] * x - pA[N_COEF] * y;
+
+		pDst[k] = y;
+	}
+}
+
+/*****************************************************************************
+IIR_SOS_F32_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa una cascada de secciones de segundo orden en DF2T.
+	* @returns	void
+	* @param
+		- S				Instancia del filtro.
+		- nSecciones	Cantidad de secciones.
+		- pCoeffs		{b0, b1, b2, a1, a2} por seccion.
+		- pState		Vector de estado (2*nSecciones).
+	* @ej
+		- IIR_SOS_F32_INIT(&iir, COEF_SECCIONES, coef_sos, state);
+******************************************************************************/
+void IIR_SOS_F32_INIT(IIR_SOS_F32_INST* S, uint32_t nSecciones, const float* pCoeffs, float* pState)
+{
+	S->nSecciones = nSecciones;
+	S->pCoeffs = pCoeffs;
+	S->pState = pState;
+
+	for (uint32_t i = 0; i < 2 * nSecciones; i++)
+		pState[i] = 0.0f;
+}
+
+/*****************************************************************************
+IIR_SOS_F32
+
+	* @author	A. Riedinger.
+	* @brief	Proceso de la cascada de secciones DF2T. Cada seccion procesa
+				todo el bloque con su estado en registros:
+				Y(n) = B0*X(n) + D1
+				D1   = B1*X(n) - A1*Y(n) + D2
+				D2   = B2*X(n) - A2*Y(n)
+	* @returns	void
+	* @param
+		- S			Instancia del filtro.
+		- pSrc		Muestras de entrada.
+		- pDst		Muestras de salida (puede ser el mismo buffer que pSrc).
+		- blockSize	Cantidad de muestras.
+	* @ej
+		- IIR_SOS_F32(&iir, &iirIn, &iirOut, 1);
+******************************************************************************/
+void IIR_SOS_F32(IIR_SOS_F32_INST* S, const float* pSrc, float* pDst, uint32_t blockSize)
+{
+	const float* pC = S->pCoeffs;
+	float* pState = S->pState;
+	const float* pIn = pSrc;
+
+	for (uint32_t s = 0; s < S->nSecciones; s++, pC += 5, pState += 2) {
+		float b0 = pC[0], b1 = pC[1], b2 = pC[2], a1 = pC[3], a2 = pC[4];
+		float d1 = pState[0], d2 = pState[1];
+
+		for (uint32_t k = 0; k < blockSize; k++) {
+			float x = pIn[k];
+			float y = b0 * x + d1;
+			d1 = b1 * x - a1 * y + d2;
+			d2 = b2 * x - a2 * y;
+			pDst[k] = y;
+		}
+
+		pState[0] = d1;
+		pState[1] = d2;
+
+		/*Las secciones siguientes trabajan sobre la salida:*/
+		pIn = pDst;
+	}
+}
@@ -0,0 +1,71 @@
+/* Definicion del header:*/
+#ifndef iir_H
+#define iir_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/*Estructuras disponibles para el elimina banda fijo (opcion de compilacion):*/
+#define IIR_DF1			0						/*Forma Directa I, 2*nCoef estados.*/
+#define IIR_DF2T		1						/*Forma Directa II Transpuesta, nCoef estados.*/
+#define IIR_SOS_DF2T	2						/*Cascada de secciones DF2T, 2 estados c/u.*/
+#define IIR_PARALELO	3						/*Suma de secciones independientes.*/
+
+/*Orden maximo que acepta el diseno en forma paralela:*/
+#define IIR_PAR_MAX_ORDEN	16
+
+/* Estructuras:*/
+/*Forma Directa I: historias separadas de entrada y salida de nCoef valores:*/
+typedef struct
+{
+	uint32_t nCoef;								/*Orden del filtro.*/
+	const float* pCoeff_b;						/*b[0..nCoef].*/
+	const float* pCoeff_a;						/*a[0..nCoef], con a[0] = 1.*/
+	float* pStateIn;							/*x(n-1) .. x(n-nCoef).*/
+	float* pStateOut;							/*y(n-1) .. y(n-nCoef).*/
+} IIR_F32_INST;
+
+/*Forma Directa II Transpuesta: un unico vector de nCoef estados:*/
+typedef struct
+{
+	uint32_t nCoef;
+	const float* pCoeff_b;
+	const float* pCoeff_a;
+	float* pState;
+} IIR_DF2T_F32_INST;
+
+/*Cascada de secciones de segundo orden en DF2T:*/
+typedef struct
+{
+	uint32_t nSecciones;
+	const float* pCoeffs;						/*{b0, b1, b2, a1, a2} por seccion.*/
+	float* pState;								/*{d1, d2} por seccion.*/
+} IIR_SOS_F32_INST;
+
+/*Forma paralela: Y = C*X + suma de secciones de segundo orden que solo
+  dependen de la entrada, sin cadena de dependencias entre ellas:*/
+typedef struct
+{
+	uint32_t nSecciones;
+	float directo;								/*Termino directo C.*/
+	const float* pCoeffs;						/*{b0, b1, a1, a2} por seccion.*/
+	float* pState;								/*{d1, d2} por seccion.*/
+} IIR_PAR_F32_INST;
+
+/* Declaracion funciones:*/
+void IIR_F32_INIT(IIR_F32_INST* S, uint32_t nCoef, const float* pCoeff_b, const float* pCoeff_a,
+				  float* pStateIn, float* pStateOut);
+void IIR_F32(IIR_F32_INST* S, const float* pSrc, float* pDst, uint32_t blockSize);
+void IIR_DF2T_F32_INIT(IIR_DF2T_F32_INST* S, uint32_t nCoef, const float* pCoeff_b, const float* pCoeff_a,
+					   float* pState);
+void IIR_DF2T_F32(IIR_DF2T_F32_INST* S, const float* pSrc, float* pDst, uint32_t blockSize);
+void IIR_SOS_F32_INIT(IIR_SOS_F32_INST* S, uint32_t nSecciones, const float* pCoeffs, float* pState);
+void IIR_SOS_F32(IIR_SOS_F32_INST* S, const float* pSrc, float* pDst, uint32_t blockSize);
+int32_t IIR_PAR_DESIGN(uint32_t nCoef, const float* pCoeff_b, const float* pCoeff_a,
+					   float* pCoeffs, float* pDirecto);
+void IIR_PAR_F32_INIT(IIR_PAR_F32_INST* S, uint32_t nSecciones, const float* pCoeffs, float Directo,
+					  float* pState);
+void IIR_PAR_F32(IIR_PAR_F32_INST* S, const float* pSrc, float* pDst, uint32_t blockSize);
+
+/* Cierre del header:*/
+#endif
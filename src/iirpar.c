@@ -0,0 +1,244 @@
+/********************************************************************************
+  * @file    iirpar.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Realizacion en forma paralela (fracciones parciales) de un IIR
+  	  	  	 dado por b[]/a[]. Las secciones no dependen unas de otras, asi el
+  	  	  	 FPU del Cortex-M4 (o el SIMD del host) solapa sus cuentas y solo
+  	  	  	 se suman al final.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "iir.h"
+#include <complex.h>
+#include <math.h>
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+#define PAR_ITERACIONES	500
+#define PAR_TOLERANCIA	1e-13
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Polos: raices de z^N + a1 z^(N-1) + ... + aN por Durand-Kerner; -1 si
+  dos estimaciones coinciden o si no converge en PAR_ITERACIONES:*/
+static int32_t PAR_POLOS(uint32_t N, const float* pA, double complex* pPolos)
+{
+	double complex semilla = 0.4 + 0.9 * I;
+
+	pPolos[0] = 1.0;
+	for (uint32_t k = 1; k < N; k++) pPolos[k] = pPolos[k-1] * semilla;
+
+	for (uint32_t it = 0; it < PAR_ITERACIONES; it++) {
+		double delta = 0.0;
+
+		for (uint32_t k = 0; k < N; k++) {
+			double complex num = 1.0, den = 1.0;
+
+			for (uint32_t i = 1; i <= N; i++) num = num * pPolos[k] + pA[i];
+			for (uint32_t j = 0; j < N; j++) if (j != k) den *= pPolos[k] - pPolos[j];
+			if (cabs(den) == 0.0) return -1;
+
+			double complex paso = num / den;
+			pPolos[k] -= paso;
+			if (cabs(paso) > delta) delta = cabs(paso);
+		}
+		if (delta < PAR_TOLERANCIA) return 0;
+	}
+	return -1;
+}
+
+/*B(q) con q = z^-1:*/
+static double complex PAR_NUMERADOR(uint32_t N, const float* pB, double complex q)
+{
+	double complex acum = 0.0;
+
+	for (int32_t i = (int32_t)N; i >= 0; i--) acum = acum * q + pB[i];
+	return acum;
+}
+
+/*****************************************************************************
+IIR_PAR_DESIGN
+
+	* @author	A. Riedinger.
+	* @brief	Convierte b[]/a[] a forma paralela:
+				H(z) = C + suma r_k / (1 - p_k z^-1)
+				con r_k = B(1/p_k) / prod_{j!=k} (1 - p_j/p_k), agrupando polos
+				conjugados (o dos reales) en secciones {b0, b1, a1, a2}.
+				Calculo en doble precision, pensado para la inicializacion.
+	* @returns
+		- Cantidad de secciones, o -1 si el orden no es valido, hay polos
+		  repetidos o su calculo no converge.
+	* @param
+		- nCoef		Orden del filtro (<= IIR_PAR_MAX_ORDEN).
+		- pCoeff_b	Coeficientes del numerador (nCoef+1).
+		- pCoeff_a	Coeficientes del denominador (nCoef+1, a[0] = 1).
+		- pCoeffs	Salida: 4 coeficientes por seccion ((nCoef+1)/2 secciones).
+		- pDirecto	Salida: termino directo C.
+	* @ej
+		- nSec = IIR_PAR_DESIGN(COEF_ORDEN, coef_b, coef_a, parCoeffs, &parC);
+******************************************************************************/
+int32_t IIR_PAR_DESIGN(uint32_t nCoef, const float* pCoeff_b, const float* pCoeff_a,
+					   float* pCoeffs, float* pDirecto)
+{
+	double complex polos[IIR_PAR_MAX_ORDEN];
+	double complex residuos[IIR_PAR_MAX_ORDEN];
+	uint8_t usado[IIR_PAR_MAX_ORDEN] = {0};
+	uint32_t N = nCoef;
+	int32_t nSec = 0;
+
+	if (N == 0 || N > IIR_PAR_MAX_ORDEN || pCoeff_a[N] == 0.0f) return -1;
+	if (PAR_POLOS(N, pCoeff_a, polos) < 0) return -1;
+
+	/*Residuos de cada polo:*/
+	for (uint32_t k = 0; k < N; k++) {
+		double complex den = 1.0;
+		for (uint32_t j = 0; j < N; j++)
+			if (j != k) den *= 1.0 - polos[j] / polos[k];
+		if (cabs(den) < 1e-12) return -1;
+		residuos[k] = PAR_NUMERADOR(N, pCoeff_b, 1.0 / polos[k]) / den;
+	}
+
+	/*Termino directo: H(z -> infinito) = b0 = C + suma r_k:*/
+	double complex c = pCoeff_b[0];
+	for (uint32_t k = 0; k < N; k++) c -= residuos[k];
+	*pDirecto = (float)creal(c);
+
+	/*Pares conjugados:*/
+	for (uint32_t k = 0; k < N; k++) {
+		if (usado[k] || fabs(cimag(polos[k])) < 1e-9) continue;
+
+		uint32_t m = k;
+		double dist = INFINITY;
+		for (uint32_t j = 0; j < N; j++)
+			if (j != k && !usado[j] && cabs(polos[j] - conj(polos[k])) < dist) {
+				dist = cabs(polos[j] - conj(polos[k]));
+				m = j;
+			}
+		if (m == k) return -1;
+		usado[k] = usado[m] = 1;
+
+		double complex p = polos[k], r = residuos[k];
+		float* pC = &pCoeffs[4 * nSec++];
+		pC[0] = (float)(2.0 * creal(r));
+		pC[1] = (float)(-2.0 * creal(r * conj(p)));
+		pC[2] = (float)(-2.0 * creal(p));
+		pC[3] = (float)(cabs(p) * cabs(p));
+	}
+
+	/*Polos reales, de a dos (el ultimo puede quedar solo):*/
+	for (uint32_t k = 0; k < N; k++) {
+		if (usado[k]) continue;
+		usado[k] = 1;
+
+		double p1 = creal(polos[k]), r1 = creal(residuos[k]);
+		double p2 = 0.0, r2 = 0.0;
+		for (uint32_t j = k + 1; j < N; j++)
+			if (!usado[j]) {
+				usado[j] = 1;
+				p2 = creal(polos[j]);
+				r2 = creal(residuos[j]);
+				break;
+			}
+
+		float* pC = &pCoeffs[4 * nSec++];
+		pC[0] = (float)(r1 + r2);
+		pC[1] = (float)(-(r1 * p2 + r2 * p1));
+		pC[2] = (float)(-(p1 + p2));
+		pC[3] = (float)(p1 * p2);
+	}
+
+	return nSec;
+}
+
+/*****************************************************************************
+IIR_PAR_F32_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa un IIR en forma paralela y limpia su estado.
+	* @returns	void
+	* @param
+		- S				Instancia del filtro.
+		- nSecciones	Cantidad de secciones (de IIR_PAR_DESIGN).
+		- pCoeffs		{b0, b1, a1, a2} por seccion.
+		- Directo		Termino directo C.
+		- pState		Vector de estado (2*nSecciones).
+	* @ej
+		- IIR_PAR_F32_INIT(&iir, nSec, parCoeffs, parC, state);
+******************************************************************************/
+void IIR_PAR_F32_INIT(IIR_PAR_F32_INST* S, uint32_t nSecciones, const float* pCoeffs, float Directo,
+					  float* pState)
+{
+	S->nSecciones = nSecciones;
+	S->directo = Directo;
+	S->pCoeffs = pCoeffs;
+	S->pState = pState;
+
+	for (uint32_t i = 0; i < 2 * nSecciones; i++)
+		pState[i] = 0.0f;
+}
+
+/*****************************************************************************
+IIR_PAR_F32
+
+	* @author	A. Riedinger.
+	* @brief	Proceso del IIR en forma paralela. Las secciones se evaluan de
+				a dos con acumuladores separados para que sus cuentas se
+				intercalen en el pipeline del FPU:
+				Yk(n) = B0k*X(n) + D1k
+				D1k   = B1k*X(n) - A1k*Yk(n) + D2k
+				D2k   = -A2k*Yk(n)
+				Y(n)  = C*X(n) + suma Yk(n)
+	* @returns	void
+	* @param
+		- S			Instancia del filtro.
+		- pSrc		Muestras de entrada.
+		- pDst		Muestras de salida.
+		- blockSize	Cantidad de muestras.
+	* @ej
+		- IIR_PAR_F32(&iir, &iirIn, &iirOut, 1);
+******************************************************************************/
+void IIR_PAR_F32(IIR_PAR_F32_INST* S, const float* pSrc, float* pDst, uint32_t blockSize)
+{
+	const float* pC = S->pCoeffs;
+	float* pState = S->pState;
+	uint32_t nSec = S->nSecciones;
+
+	for (uint32_t k = 0; k < blockSize; k++) {
+		float x = pSrc[k];
+		float acum0 = S->directo * x;
+		float acum1 = 0.0f;
+		uint32_t s = 0;
+
+		for (; s + 1 < nSec; s += 2) {
+			const float* c0 = &pC[4 * s];
+			const float* c1 = &pC[4 * s + 4];
+			float* d0 = &pState[2 * s];
+			float* d1 = &pState[2 * s + 2];
+
+			float y0 = c0[0] * x + d0[0];
+			float y1 = c1[0] * x + d1[0];
+			d0[0] = c0[1] * x - c0[2] * y0 + d0[1];
+			d1[0] = c1[1] * x - c1[2] * y1 + d1[1];
+			d0[1] = -c0[3] * y0;
+			d1[1] = -c1[3] * y1;
+			acum0 += y0;
+			acum1 += y1;
+		}
+
+		/*Seccion impar sobrante:*/
+		if (s < nSec) {
+			const float* c0 = &pC[4 * s];
+			float* d0 = &pState[2 * s];
+			float y0 = c0[0] * x + d0[0];
+			d0[0] = c0[1] * x - c0[2] * y0 + d0[1];
+			d0[1] = -c0[3] * y0;
+			acum0 += y0;
+		}
+
+		pDst[k] = acum0 + acum1;
+	}
+}
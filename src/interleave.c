@@ -0,0 +1,119 @@
+/********************************************************************************
+  * @file    interleave.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Calibracion de offset y ganancia entre los ADC de una captura
+  	  	  	 intercalada. Cada ADC tiene su propio offset y ganancia, y la
+  	  	  	 diferencia aparece como espurias en k*Fs/3 (offset) y en
+  	  	  	 k*Fs/3 +- f0 (ganancia). Con una rafaga de calibracion cuya
+  	  	  	 estadistica sea la misma para los tres (continua, o un tono que
+  	  	  	 no sea multiplo de Fs/3) se igualan media y desvio de cada ADC
+  	  	  	 a los del conjunto. El desfasaje entre ADC no se corrige.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "interleave.h"
+#include <math.h>
+
+/*****************************************************************************
+INTERLEAVE_CAL_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Calibracion neutra (sin correccion).
+	* @returns	void
+	* @param
+		- pCal		Calibracion.
+	* @ej
+		- INTERLEAVE_CAL_INIT(&cal);
+******************************************************************************/
+void INTERLEAVE_CAL_INIT(INTERLEAVE_CAL* pCal)
+{
+	for (uint32_t k = 0; k < INTERLEAVE_ADCS; k++) {
+		pCal->offset[k] = 0.0f;
+		pCal->ganancia[k] = 1.0f;
+		pCal->a[k] = 1.0f;
+		pCal->b[k] = 0.0f;
+	}
+}
+
+/*****************************************************************************
+INTERLEAVE_CALIBRAR
+
+	* @author	A. Riedinger.
+	* @brief	Estima offset y ganancia de cada ADC sobre una rafaga de
+				calibracion, tomando como referencia el promedio de los tres.
+	* @returns	void
+	* @param
+		- pCal		Calibracion resultante.
+		- pSrc		Rafaga cruda, ordenada en el tiempo (ADC1, ADC2, ...).
+		- n			Largo de la rafaga (multiplo de INTERLEAVE_ADCS).
+	* @ej
+		- INTERLEAVE_CALIBRAR(&cal, rafaga, ADC_RAFAGA);
+******************************************************************************/
+void INTERLEAVE_CALIBRAR(INTERLEAVE_CAL* pCal, const uint16_t* pSrc, uint32_t n)
+{
+	uint32_t suma[INTERLEAVE_ADCS] = {0};
+	uint64_t suma2[INTERLEAVE_ADCS] = {0};
+	float media[INTERLEAVE_ADCS], desvio[INTERLEAVE_ADCS];
+	float mediaRef = 0.0f, desvioRef = 0.0f;
+	uint32_t nAdc = n / INTERLEAVE_ADCS;
+
+	INTERLEAVE_CAL_INIT(pCal);
+	if (nAdc < 2) return;
+
+	/*Sumas enteras exactas (codigos de 12 bits):*/
+	for (uint32_t i = 0; i < nAdc * INTERLEAVE_ADCS; i += INTERLEAVE_ADCS)
+		for (uint32_t k = 0; k < INTERLEAVE_ADCS; k++) {
+			suma[k]  += pSrc[i + k];
+			suma2[k] += (uint32_t)pSrc[i + k] * pSrc[i + k];
+		}
+
+	for (uint32_t k = 0; k < INTERLEAVE_ADCS; k++) {
+		double m = (double)suma[k] / nAdc;
+		double v = (double)suma2[k] / nAdc - m * m;
+		media[k]  = (float)m;
+		desvio[k] = (float)sqrt(v > 0.0 ? v : 0.0);
+		mediaRef  += media[k] / INTERLEAVE_ADCS;
+		desvioRef += desvio[k] / INTERLEAVE_ADCS;
+	}
+
+	/*y = (x - media_k) * ganancia_k + mediaRef:*/
+	for (uint32_t k = 0; k < INTERLEAVE_ADCS; k++) {
+		pCal->offset[k] = media[k] - mediaRef;
+		if (desvioRef >= INTERLEAVE_DESVIO_MIN && desvio[k] > 0.0f)
+			pCal->ganancia[k] = desvioRef / desvio[k];
+		pCal->a[k] = pCal->ganancia[k];
+		pCal->b[k] = mediaRef - media[k] * pCal->ganancia[k];
+	}
+}
+
+/*****************************************************************************
+INTERLEAVE_CORREGIR
+
+	* @author	A. Riedinger.
+	* @brief	Aplica la calibracion a una rafaga, redondeando y saturando
+				a 12 bits. Puede trabajar sobre el mismo buffer.
+	* @returns	void
+	* @param
+		- pCal		Calibracion.
+		- pSrc		Rafaga cruda, empezando por ADC1.
+		- n			Largo de la rafaga.
+		- pDst		Rafaga corregida (0 a 4095).
+	* @ej
+		- INTERLEAVE_CORREGIR(&cal, rafaga, ADC_RAFAGA, rafaga);
+******************************************************************************/
+void INTERLEAVE_CORREGIR(const INTERLEAVE_CAL* pCal, const uint16_t* pSrc, uint32_t n, uint16_t* pDst)
+{
+	uint32_t k = 0;
+
+	for (uint32_t i = 0; i < n; i++) {
+		int32_t y = (int32_t)(pCal->a[k] * pSrc[i] + pCal->b[k] + 0.5f);
+
+		if (y < 0) y = 0;
+		if (y > 4095) y = 4095;
+		pDst[i] = (uint16_t)y;
+
+		if (++k == INTERLEAVE_ADCS) k = 0;
+	}
+}
@@ -0,0 +1,30 @@
+/* Definicion del header:*/
+#ifndef interleave_H
+#define interleave_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/*ADC intercalados: la muestra k de la rafaga es del ADC k % INTERLEAVE_ADCS:*/
+#define INTERLEAVE_ADCS		3
+
+/*Desvio minimo [LSB] para estimar ganancias; por debajo (entrada continua)
+  solo se corrige el offset:*/
+#define INTERLEAVE_DESVIO_MIN	1.0f
+
+/* Estructuras:*/
+typedef struct
+{
+	float offset[INTERLEAVE_ADCS];				/*Media de cada ADC menos la media comun [LSB].*/
+	float ganancia[INTERLEAVE_ADCS];			/*Desvio comun / desvio de cada ADC.*/
+	float a[INTERLEAVE_ADCS];					/*Correccion y = a*x + b de cada ADC.*/
+	float b[INTERLEAVE_ADCS];
+} INTERLEAVE_CAL;
+
+/* Declaracion funciones:*/
+void INTERLEAVE_CAL_INIT(INTERLEAVE_CAL* pCal);
+void INTERLEAVE_CALIBRAR(INTERLEAVE_CAL* pCal, const uint16_t* pSrc, uint32_t n);
+void INTERLEAVE_CORREGIR(const INTERLEAVE_CAL* pCal, const uint16_t* pSrc, uint32_t n, uint16_t* pDst);
+
+/* Cierre del header:*/
+#endif
@@ -0,0 +1,112 @@
+/********************************************************************************
+  * @file    interp.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Interpolador polifasico x2, x4 u x8 para la salida al DAC. El
+  	  	  	 pasabajos se disena al inicializar (sinc con ventana de Kaiser,
+  	  	  	 corte en Fs/2 de la entrada) y se reparte en L fases: cada
+  	  	  	 muestra de salida usa solo los coeficientes que caen sobre
+  	  	  	 muestras reales, sin multiplicar los ceros intercalados.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "interp.h"
+#include <math.h>
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Beta de Kaiser - ~60 dB de rechazo de imagenes:*/
+#define INTERP_BETA		5.65
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Bessel modificada de orden 0 por su serie:*/
+static double INTERP_I0(double x)
+{
+	double suma = 1.0, termino = 1.0;
+
+	for (uint32_t k = 1; k < 32; k++) {
+		termino *= (x / (2.0 * k)) * (x / (2.0 * k));
+		suma += termino;
+	}
+	return suma;
+}
+
+/*****************************************************************************
+INTERP_F32_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Disena el pasabajos de L*INTERP_TAPS_FASE coeficientes, con
+				ganancia L para compensar los ceros intercalados, y lo
+				reparte por fases.
+	* @returns	void
+	* @param
+		- S			Instancia del interpolador.
+		- L			Factor de interpolacion (2, 4 u 8).
+	* @ej
+		- INTERP_F32_INIT(&interp, 4);
+******************************************************************************/
+void INTERP_F32_INIT(INTERP_F32_INST* S, uint32_t L)
+{
+	uint32_t N;
+	double centro;
+
+	if (L < 2) L = 2;
+	if (L > INTERP_L_MAX) L = INTERP_L_MAX;
+
+	S->L = L;
+	S->pos = 0;
+	N = L * INTERP_TAPS_FASE;
+	centro = (N - 1) / 2.0;
+
+	for (uint32_t n = 0; n < N; n++) {
+		double t = (n - centro) / L;						/*En periodos de entrada.*/
+		double sinc = (t == 0.0) ? 1.0 : sin(M_PI * t) / (M_PI * t);
+		double r = (n - centro) / centro;
+		double ventana = INTERP_I0(INTERP_BETA * sqrt(1.0 - r * r)) / INTERP_I0(INTERP_BETA);
+
+		/*sinc(t) ya tiene ganancia L en la frecuencia alta:*/
+		S->coef[n % L][n / L] = (float)(sinc * ventana);
+	}
+
+	for (uint32_t t = 0; t < 2 * INTERP_TAPS_FASE; t++)
+		S->state[t] = 0.0f;
+}
+
+/*****************************************************************************
+INTERP_F32
+
+	* @author	A. Riedinger.
+	* @brief	Recibe una muestra a Fs y entrega L muestras a L*Fs, con
+				INTERP_TAPS_FASE MACs por muestra de salida:
+				y(nL + p) = suma_t h[tL + p] x(n - t)
+	* @returns	void
+	* @param
+		- S			Instancia del interpolador.
+		- Sample	Muestra de entrada.
+		- pDst		L muestras de salida.
+	* @ej
+		- INTERP_F32(&interp, iirOut, interpOut);
+******************************************************************************/
+void INTERP_F32(INTERP_F32_INST* S, float Sample, float* pDst)
+{
+	/*Linea de retardo circular escrita dos veces: x(n-t) = pX[t]:*/
+	S->pos = S->pos ? S->pos - 1 : INTERP_TAPS_FASE - 1;
+	S->state[S->pos] = Sample;
+	S->state[S->pos + INTERP_TAPS_FASE] = Sample;
+	const float* pX = &S->state[S->pos];
+
+	for (uint32_t p = 0; p < S->L; p++) {
+		const float* h = S->coef[p];
+		float acum0 = 0.0f, acum1 = 0.0f;
+
+		for (uint32_t t = 0; t < INTERP_TAPS_FASE; t += 2) {
+			acum0 += h[t]     * pX[t];
+			acum1 += h[t + 1] * pX[t + 1];
+		}
+		pDst[p] = acum0 + acum1;
+	}
+}
@@ -0,0 +1,28 @@
+/* Definicion del header:*/
+#ifndef interp_H
+#define interp_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/*Factor de interpolacion maximo y coeficientes por fase. El FIR completo
+  tiene L*INTERP_TAPS_FASE coeficientes, pero cada muestra de salida usa
+  solo los INTERP_TAPS_FASE de su fase:*/
+#define INTERP_L_MAX		8
+#define INTERP_TAPS_FASE	16
+
+/* Estructuras:*/
+typedef struct
+{
+	uint32_t L;									/*Factor de interpolacion (2, 4 u 8).*/
+	float coef[INTERP_L_MAX][INTERP_TAPS_FASE];	/*h[t*L + fase], por fase.*/
+	float state[2*INTERP_TAPS_FASE];			/*Entradas previas, duplicadas para leer sin modulo.*/
+	uint32_t pos;
+} INTERP_F32_INST;
+
+/* Declaracion funciones:*/
+void INTERP_F32_INIT(INTERP_F32_INST* S, uint32_t L);
+void INTERP_F32(INTERP_F32_INST* S, float Sample, float* pDst);
+
+/* Cierre del header:*/
+#endif
@@ -13,60 +13,393 @@
 /*------------------------------------------------------------------------------
 LIBRERIAS:
 ------------------------------------------------------------------------------*/
+#include <math.h>
 #include "functions.h"
+#include "pins.h"
+#include "regs.h"
+#include "goertzel.h"
+#include "capture.h"
+#include "filtro.h"
+#include "cic.h"
+#include "interp.h"
+#include "interleave.h"
+#include "conv.h"
+#include "clock.h"
+#include "carga.h"
+#include "hilos.h"
+#include "fondo.h"
+#include "pool.h"
+#include "ring.h"
+#include "pila.h"
 
 /*------------------------------------------------------------------------------
 DEFINICIONES LOCALES:
 ------------------------------------------------------------------------------*/
-/*Pines del ADC - PC0:*/
-#define adcPort GPIOC
-#define adcPin  GPIO_Pin_0
+/*Pines del ADC - PC0 (puerto y numero, resueltos en compilacion por pins.h):*/
+#define ADC_PUERTO  C
+#define ADC_NUM     0
+#define adcPort     PIN_GPIO(ADC_PUERTO, ADC_NUM)
+#define adcPin      PIN_GPIO_PIN(ADC_PUERTO, ADC_NUM)
 
 /*Pines del DAC - PA5:*/
-#define dacPort GPIOA
-#define dacPin  GPIO_Pin_5
-
-/*Frecuencia de muestreo - 20kHz:*/
+#define DAC_PUERTO  A
+#define DAC_NUM     5
+#define dacPort     PIN_GPIO(DAC_PUERTO, DAC_NUM)
+#define dacPin      PIN_GPIO_PIN(DAC_PUERTO, DAC_NUM)
+
+#if !PIN_ADC_NUM(ADC_PUERTO, ADC_NUM)
+#error "ADC_PUERTO/ADC_NUM no es una entrada analogica"
+#endif
+#if !PIN_DAC_NUM(DAC_PUERTO, DAC_NUM)
+#error "DAC_PUERTO/DAC_NUM no es una salida del DAC (PA4 o PA5)"
+#endif
+
+/*Frecuencia de muestreo - 20kHz (se puede redefinir al compilar, por
+  ejemplo para buscar la maxima con host/stm32Emu.c):*/
+#ifndef FS
 #define FS  20000 //[kHz]
-
-/*Numero de coeficientes - 6:*/
-#define n 6
+#endif
+
+/*Decimacion CIC del ADC sobremuestreado - 0 deshabilitada (una conversion
+  por interrupcion de TIM3) o la relacion R (ADC a R*FS por DMA). Con TIM2
+  a 90 MHz la frecuencia es exacta si R divide a 4500: 10, 15, 20, 36, 45...*/
+#ifndef ADC_CIC
+#define ADC_CIC   0
+#endif
+
+/*Interpolacion polifasica de la salida - 1 deshabilitada (DAC escrito una
+  vez por muestra) o L = 2, 4 u 8 (DAC disparado por TIM6 a L*FS por DMA):*/
+#ifndef DAC_INTERP
+#define DAC_INTERP   1
+#endif
+
+/*Salida dual - 0 solo la salida del filtro en PA5, 1 ademas la entrada
+  como monitor en PA4 (DAC_OUT1), ambas con una sola escritura por par:*/
+#ifndef DAC_MONITOR
+#define DAC_MONITOR   0
+#endif
+
+/*Modo captura por rafagas del ADC triple intercalado (4.5 MHz) - 0
+  deshabilitado o el largo de cada rafaga, multiplo de CAPTURE_VALORES y de
+  3. Reemplaza al filtro: la primera rafaga calibra offset y ganancia entre
+  ADC (con un tono de calibracion a la entrada) y las siguientes se envian
+  corregidas por USART1 como tramas CAPTURE_RAFAGA (ver host/burstRead.c):*/
+#ifndef ADC_RAFAGA
+#define ADC_RAFAGA   0
+#endif
+
+/*Perfil de clock - CLOCK_MAX (180 MHz con over-drive), CLOCK_BALANCEADO
+  (168 MHz) o CLOCK_MINIMO (baja por pasos mientras la carga medida de la
+  tarea quede bajo CLOCK_CARGA_MAX, ver clock.h):*/
+#ifndef CLOCK_MODO
+#define CLOCK_MODO   CLOCK_MAX
+#endif
+
+/*Donde corre la tarea de cada muestra - 0 en el lazo principal (TIM3 solo
+  encola el evento y la tarea espera la conversion) o 1 en la interrupcion
+  de fin de conversion del ADC (TIM3 arranca la conversion y ADC_IRQHandler
+  procesa y escribe el DAC apenas termina). La latencia del ADC al DAC se
+  mide en ambos (latenciaProm/latenciaMax) para elegir en cada caso:*/
+#ifndef MODO_ISR
+#define MODO_ISR   0
+#endif
+
+/*Prioridades de preempcion en MODO_ISR: el fin de conversion primero, asi
+  ninguna otra interrupcion demora la salida:*/
+#define PRIORIDAD_ADC   0
+#define PRIORIDAD_TIM3  1
+
+/*Ventana del medidor de carga [muestras] - 100ms:*/
+#define CARGA_MUESTRAS  (FS/10)
+
+/*Tareas medidas por el medidor de carga:*/
+#define TAREA_ADC       0
+#define TAREA_FONDO     1
+#define TAREAS          2
+
+/*Evento de muestreo de la interrupcion a la tarea: ciclo del DWT y, con
+  ADC_CIC, la muestra decimada. Con ADC_CIC la cola absorbe hasta 8
+  muestras de atraso de la tarea antes de perder alguna; sin ADC_CIC la
+  conversion se hace al atender el evento y solo vale el mas reciente:*/
+typedef struct
+{
+	uint32_t ciclo;
+	float muestra;
+} EVENTO_MUESTRA;
+
+RING_TIPO(RING_EVENTOS, EVENTO_MUESTRA, 8);
+
+/*Reserva de los trabajos de fondo antes de la proxima muestra [ciclos]:*/
+#define FONDO_MARGEN    300
+
+/*Espectro de la salida como trabajo de fondo - bloques de 256 muestras,
+  32 bins de 0 a fs/2, 64 muestras de un bin por paso (un paso entra en la
+  holgura aun con el clock minimo):*/
+#define ESPECTRO_N      256
+#define ESPECTRO_BINS   32
+#define ESPECTRO_TRAMO  64
+
+/*Bloques de muestras del pool estatico (el heap queda en 0, ver el .ld):
+  uno en llenado y hasta uno por trabajo que lo lee, con uno de sobra:*/
+#define POOL_BLOQUES    4
+
+/*Monitor de energia en banda por Goertzel - bloque de 20ms:*/
+#define GOERTZEL_BLOQUE 400
+#define GOERTZEL_TONOS  3
+
+/*Captura de muestras crudas por USART1 (PA9) - 0 deshabilitada o
+  CAPTURE_ENTRADA / CAPTURE_SALIDA / CAPTURE_AMBAS:*/
+#ifndef CAPTURA
+#define CAPTURA   0
+#endif
+#define CAPTURA_BAUDRATE 921600
+
+#if ADC_RAFAGA && CAPTURA
+#error "ADC_RAFAGA y CAPTURA comparten el USART1"
+#endif
+#if ADC_RAFAGA % CAPTURE_VALORES || ADC_RAFAGA % 3
+#error "ADC_RAFAGA debe ser multiplo de CAPTURE_VALORES y de 3"
+#endif
+#if ADC_RAFAGA && !PIN_ADC123(ADC_PUERTO, ADC_NUM)
+#error "ADC_RAFAGA necesita un pin de los tres ADC (PA0 a PA3 o PC0 a PC3)"
+#endif
+#if MODO_RTOS && (ADC_RAFAGA || DAC_INTERP > 1)
+#error "MODO_RTOS procesa muestra a muestra: sin ADC_RAFAGA ni DAC_INTERP"
+#endif
+#if MODO_ISR && (ADC_CIC || ADC_RAFAGA || MODO_RTOS)
+#error "MODO_ISR procesa en el fin de conversion inyectada: sin ADC_CIC, ADC_RAFAGA ni MODO_RTOS"
+#endif
+#if DAC_MONITOR && PIN_DAC_NUM(DAC_PUERTO, DAC_NUM) != 2
+#error "DAC_MONITOR usa PA4 para el monitor: la salida debe ir en PA5"
+#endif
+#if ESPECTRO_N % ESPECTRO_TRAMO
+#error "ESPECTRO_N debe ser multiplo de ESPECTRO_TRAMO"
+#endif
 
 /*Funcion para procesar los datos del ADC:*/
-void ADC_PROCESSING(void);
+void ADC_PROCESSING(float Muestra);
 
-/*Funcion de proceso del IIR:*/
-void IIR_F32(float* pSrc, float* pDst, uint32_t N_COEF, float* pCoeff_b, float* pCoeff_a);
+/*Medicion de cada ejecucion de la tarea:*/
+static void MUESTRA_MEDIR(uint32_t Ciclos);
+
+/*Trabajos de fondo:*/
+static uint32_t HOLGURA(void);
+static uint8_t ESPECTRO_PASO(void* pCtx);
+static uint8_t NIVEL_PASO(void* pCtx);
 
 /*------------------------------------------------------------------------------
 VARIABLES GLOBALES:
 ------------------------------------------------------------------------------*/
 uint32_t i = 0;
 
-/*Declaracion del arreglo de la Señal de Estado:*/
-float iirStateIn_f32 [2*n];
-float iirStateOut_f32[2*n];
+/*Filtro elegido en filtro.h:*/
+FILTRO filtro;
+
+/*Eventos de muestreo para el Task Scheduler (interrupcion -> tarea):*/
+RING_EVENTOS eventos;
+
+/*Medicion de la tarea con el DWT: ultima y peor duracion [ciclos] y
+  muestras perdidas (cola de eventos llena o eventos atrasados):*/
+uint32_t ciclosTarea = 0;
+uint32_t ciclosTareaMax = 0;
+uint32_t tareasPerdidas = 0;
+
+/*Carga de CPU por ventanas de CARGA_MUESTRAS (actual, promedio, pico y
+  por tarea) y cuenta de ventanas para el ajuste de clock (1 s):*/
+CARGA carga;
+uint32_t cargaInicio = 0;
+uint32_t tareasVentana = 0;
+uint32_t ventanasAjuste = 0;
+
+/*Paso del ajuste de clock y barrido de la pila pedidos al lazo principal
+  (cada segundo, al cerrar la ventana):*/
+volatile uint8_t ajustePendiente = 0;
+
+/*Ciclos de la tarea en la interrupcion (MODO_ISR), para descontarlos de
+  los trabajos de fondo que preempta:*/
+volatile uint32_t ciclosIsr = 0;
+
+/*Latencia del instante de muestreo (update de TIM3) a la escritura del DAC
+  [ciclos]: ultima, minima, maxima y promedio de la ultima ventana de
+  carga. Con DAC_INTERP la escritura es al buffer del DMA; con ADC_CIC se
+  mide desde la interrupcion del DMA:*/
+uint32_t ciclosCuentaTim3 = 0;
+uint32_t latencia = 0;
+uint32_t latenciaMin = UINT32_MAX;
+uint32_t latenciaMax = 0;
+uint32_t latenciaProm = 0;
+uint32_t latenciaSuma = 0;
+
+/*Trabajos de fondo y ciclo del ultimo evento atendido (para la holgura):*/
+FONDO fondo;
+uint32_t ultimoEvento = 0;
+
+/*Marca de agua de la pila, medida por un trabajo de fondo cada segundo
+  (pila.h; el peor caso estatico lo da python/stackReport.py):*/
+PILA pila;
+int32_t trabajoPila = -1;
+
+/*Pool de bloques de muestras, compartidos entre tareas sin copiarlos:*/
+POOL_DEF(poolMuestras, POOL_BLOQUES, ESPECTRO_N * sizeof(float));
+
+/*Espectro de fondo: bloque en llenado, bloque en analisis, bin en curso
+  (muestra y estado de Goertzel) y resultado [dB]:*/
+int32_t trabajoEspectro = -1;
+float* pEspectroLlenado = NULL;
+float* pEspectroBloque = NULL;
+uint32_t espectroCuenta = 0;
+uint32_t espectroBin = 0;
+uint32_t espectroMuestra = 0;
+float espectroS1 = 0.0f, espectroS2 = 0.0f;
+float espectroDb[ESPECTRO_BINS];
+
+/*Nivel de salida de fondo, sobre el mismo bloque que el espectro:
+  bloque retenido, muestra en curso, acumulados y resultado (RMS [dBFS]
+  y pico, 1.0 = fondo de escala):*/
+int32_t trabajoNivel = -1;
+float* pNivelBloque = NULL;
+uint32_t nivelMuestra = 0;
+float nivelSuma = 0.0f, nivelMax = 0.0f;
+float nivelDb = -120.0f;
+float nivelPico = 0.0f;
+
+/*Ultimos codigos de entrada y salida:*/
+int32_t signalIn = 0;
+int32_t signalOut = 0;
 
-/*Coeficientes del filtro obtenidos en GNU Octave con cheby1(): */
-float b[2*n+1] = {0.1832424665583316, -2.4412800655459803e-16, 1.0994547993499895,
-				 -1.2206400327729901e-15, 2.7486369983749741, -2.4412800655459802e-15,
-				 3.6648493311666321, -2.4412800655459802e-15, 2.7486369983749741,
-				 -1.2206400327729901e-15, 1.0994547993499895, -2.4412800655459803e-16,
-				 0.1832424665583316};
+/*Muestras de salida saturadas al convertir al DAC:*/
+uint32_t dacClips = 0;
+
+/*0 si el diseno del filtro fallo (IIR_PARALELO sin converger): la salida
+  es la entrada sin filtrar:*/
+uint8_t filtroOk = 0;
+
+/*Bancos de Goertzel a la entrada y salida del filtro: centro (fs/4) y guardas:*/
+const float goertzelFreqs[GOERTZEL_TONOS] = {FS/4, FS/10, 2*FS/5};
+GOERTZEL_BANK goertzelIn;
+GOERTZEL_BANK goertzelOut;
+
+/*Rechazo medido del interferente en fs/4 [dB]:*/
+float rechazoDb = 0.0f;
+
+#if CAPTURA
+/*Tramas de captura en curso:*/
+CAPTURE capture;
+#endif
+
+#if ADC_CIC
+/*Decimador y buffer circular del DMA (dos mitades de R muestras). No va
+  por la cola: lo escribe el DMA y cada mitad se decima en la misma
+  interrupcion que la avisa; a la tarea pasa la muestra decimada:*/
+CIC_DECIM cic;
+uint16_t adcBuffer[2*ADC_CIC];
+#endif
+
+#if ADC_RAFAGA
+/*Rafaga, calibracion entre ADC y tramas de envio:*/
+uint16_t rafaga[ADC_RAFAGA];
+INTERLEAVE_CAL rafagaCal;
+CAPTURE capture;
+uint32_t fsRafaga = 0;
+
+/*Transporte bloqueante: la rafaga se envia entera, sin perder tramas:*/
+static uint8_t RAFAGA_SEND(const void* pFrame, uint32_t nBytes)
+{
+	while (!USART_DMA_SEND(pFrame, nBytes));
+	return 1;
+}
+#endif
+
+#if DAC_INTERP > 1
+/*Interpolador, buffer circular del DMA del DAC (dos mitades de L codigos)
+  y salida interpolada. El buffer no va por la cola: lo lee el DMA y la
+  mitad libre la da su puntero (DAC_DMA_MITAD), sin copia intermedia:*/
+INTERP_F32_INST interp;
+#if DAC_MONITOR
+uint32_t dacBuffer[2*DAC_INTERP];				/*Pares DAC_DUAL_PALABRA(monitor, salida).*/
+#else
+uint16_t dacBuffer[2*DAC_INTERP];
+#endif
+float interpOut[DAC_INTERP];
+#endif
+
+/*Vacia la cola hasta el evento mas reciente; los anteriores cuentan como
+  perdidos. Devuelve 0 si no habia ninguno:*/
+static inline uint32_t EVENTO_ULTIMO(EVENTO_MUESTRA* pEv)
+{
+	uint32_t n = 0;
+	while (RING_EVENTOS_POP(&eventos, pEv)) n++;
+	if (n > 1) tareasPerdidas += n - 1;
+	return n;
+}
 
-float a[2*n+1] = {1, -5.5511151231257827e-16, 2.8266303814860598, -1.1102230246251565e-15,
-				  3.9461521181664487, -3.5527136788005009e-15, 3.1150661053039146,
-				  -2.8310687127941492e-15, 1.6070012817944181, -6.9388939039072284e-16,
-				  0.52520012936098293, -2.0816681711721685e-16, 0.1384414456647135};
+#if MODO_RTOS
+/*Acceso al hardware del hilo DSP (hilos.h), con el ADC y el DAC resueltos
+  en compilacion como en ADC_PROCESSING:*/
+static float RTOS_LEER(void)
+{
+	/*Las senales no se acumulan: se atiende el evento mas reciente:*/
+	EVENTO_MUESTRA ev = {0, 0.0f};
+	EVENTO_ULTIMO(&ev);
+
+#if ADC_CIC
+	signalIn = (int32_t)(ev.muestra * 4096.0f);
+	return ev.muestra;
+#else
+	signalIn = REG_ADC_READ_INJ(PIN_ADCX(ADC_PUERTO, ADC_NUM)) - 2048;
+	return CONV_I12_A_F32(signalIn + 2048);
+#endif
+}
 
-/*Variable para organizar el Task Scheduler:*/
-uint8_t adcReady = 0;
+static void RTOS_ESCRIBIR(float Muestra)
+{
+	signalOut = CONV_F32_A_I12(Muestra, &dacClips);
+#if DAC_MONITOR
+	REG_DAC_DUAL(DAC, DAC_DUAL_PALABRA(signalIn + 2048, signalOut));
+#else
+	REG_DAC_SET(DAC, PIN_DAC_NUM(DAC_PUERTO, DAC_NUM), (uint16_t) signalOut);
+#endif
+}
 
-/*Variables de para crear el filtro FIR:*/
-float iirIn = 0.0f;
-float iirOut = 0.0f;
-int32_t signalIn = 0;
-int32_t signalOut = 0;
+static void RTOS_CONTROL(float RechazoDb)
+{
+	rechazoDb = RechazoDb;
+}
+
+#if CAPTURA
+const HILOS_IO hilosIo = {RTOS_LEER, RTOS_ESCRIBIR, USART_DMA_SEND, RTOS_CONTROL, CAPTURA, FS};
+#else
+const HILOS_IO hilosIo = {RTOS_LEER, RTOS_ESCRIBIR, NULL, RTOS_CONTROL, 0, FS};
+#endif
+#endif
+
+/*Ciclo del DWT del ultimo update de TIM3: el contador sigue desde el
+  update, asi la entrada a la interrupcion tambien cuenta en la latencia:*/
+static inline uint32_t TIM3_CICLO_UPDATE(void)
+{
+	return CLOCK_CICLOS() - TIM3->CNT * ciclosCuentaTim3;
+}
+
+/*Fin de la escritura al DAC de la muestra tomada en ultimoEvento:*/
+static inline void LATENCIA_MEDIR(void)
+{
+	latencia = CLOCK_CICLOS() - ultimoEvento;
+	if (latencia < latenciaMin) latenciaMin = latencia;
+	if (latencia > latenciaMax) latenciaMax = latencia;
+	latenciaSuma += latencia;
+}
+
+/*Aviso de muestra lista desde la interrupcion de cada muestra (Ciclo:
+  instante de muestreo):*/
+static inline void MUESTRA_LISTA(uint32_t Ciclo, float Muestra)
+{
+	EVENTO_MUESTRA ev = {Ciclo, Muestra};
+
+	if (!RING_EVENTOS_PUSH(&eventos, ev)) tareasPerdidas++;
+#if MODO_RTOS
+	HILOS_MUESTRA();
+#endif
+}
 
 int main(void)
 {
@@ -75,25 +408,170 @@ CONFIGURACION DEL MICRO:
 ------------------------------------------------------------------------------*/
 	SystemInit();
 
-	/*Inicializacion del ADC:*/
-	INIT_ADC(adcPort, adcPin);
+	/*Perfil de clock y contador de ciclos para medirlo:*/
+	CLOCK_PERFIL(CLOCK_MODO);
+	CLOCK_CICLOS_INIT();
+
+#if ADC_RAFAGA
+	/*Modo captura: ADC triple intercalado y envio por USART + DMA:*/
+	fsRafaga = INIT_ADC_TRIPLE(adcPort, adcPin, rafaga, ADC_RAFAGA);
+	INIT_USART_DMA(CAPTURA_BAUDRATE);
+	CAPTURE_INIT(&capture, CAPTURE_RAFAGA, RAFAGA_SEND);
+
+	/*Rafaga de calibracion:*/
+	ADC_TRIPLE_DISPARAR(ADC_RAFAGA);
+	while (!ADC_TRIPLE_LISTA());
+	INTERLEAVE_CALIBRAR(&rafagaCal, rafaga, ADC_RAFAGA);
 
+	while(1)
+	{
+		ADC_TRIPLE_DISPARAR(ADC_RAFAGA);
+		while (!ADC_TRIPLE_LISTA());
+
+		INTERLEAVE_CORREGIR(&rafagaCal, rafaga, ADC_RAFAGA, rafaga);
+		for (i = 0; i < ADC_RAFAGA; i++)
+			CAPTURE_PUSH(&capture, rafaga[i], 0);
+	}
+#endif
+
+#if DAC_INTERP > 1
+	/*DAC a L*FS por DMA con la salida interpolada:*/
+	INTERP_F32_INIT(&interp, DAC_INTERP);
+#if DAC_MONITOR
+	for (i = 0; i < 2*DAC_INTERP; i++) dacBuffer[i] = DAC_DUAL_PALABRA(2048, 2048);
+	INIT_DAC_DUAL_DMA(FS*DAC_INTERP, dacBuffer, 2*DAC_INTERP);
+#else
+	for (i = 0; i < 2*DAC_INTERP; i++) dacBuffer[i] = 2048;
+	INIT_DAC_DMA(dacPort, dacPin, FS*DAC_INTERP, dacBuffer, 2*DAC_INTERP);
+#endif
+#elif DAC_MONITOR
+	/*Inicializacion de los dos canales del DAC:*/
+	INIT_DAC_DUAL_CONT();
+#else
 	/*Inicializacion del DAC:*/
 	INIT_DAC_CONT(dacPort, dacPin);
+#endif
+
+	/*Cola de eventos vacia antes de habilitar la interrupcion de muestreo:*/
+	RING_EVENTOS_INIT(&eventos);
+
+#if ADC_CIC
+	/*ADC a R*FS por DMA y decimacion CIC a FS:*/
+	CIC_INIT(&cic, ADC_CIC);
+	INIT_ADC_DMA(adcPort, adcPin, FS*ADC_CIC, adcBuffer, 2*ADC_CIC);
+#else
+	/*Inicializacion del ADC:*/
+	INIT_ADC(adcPort, adcPin);
+
+#if MODO_ISR
+	/*Tarea en la interrupcion de fin de conversion, por encima de TIM3.
+	  Lazy stacking del FPU (ASPEN y LSPEN, los del reset, explicitos): la
+	  entrada reserva el marco del FPU pero solo lo guarda si la tarea usa
+	  el FPU con contexto de FPU activo en lo interrumpido. Sin stacking
+	  automatico la tarea pisaria los registros de los trabajos de fondo:*/
+	FPU->FPCCR |= FPU_FPCCR_ASPEN_Msk | FPU_FPCCR_LSPEN_Msk;
+	INIT_ADC_IT(adcPort, adcPin, PRIORIDAD_ADC);
+#endif
 
 	/*Inicialización del TIM3:*/
 	INIT_TIM3(FS);
+	ciclosCuentaTim3 = TIM_CICLOS_CUENTA(TIM3);
+#if MODO_ISR
+	NVIC_SetPriority(TIM3_IRQn, PRIORIDAD_TIM3);
+#endif
+#endif
 
 	INIT_DO(GPIOC, GPIO_Pin_8);
 
+	/*Inicializacion del filtro:*/
+	filtroOk = FILTRO_INIT(&filtro, FS);
+
+	/*Inicializacion del monitor de energia en banda:*/
+	GOERTZEL_INIT(&goertzelIn,  FS, goertzelFreqs, GOERTZEL_TONOS, GOERTZEL_BLOQUE);
+	GOERTZEL_INIT(&goertzelOut, FS, goertzelFreqs, GOERTZEL_TONOS, GOERTZEL_BLOQUE);
+
+#if CAPTURA
+	/*Inicializacion de la captura por USART + DMA:*/
+	INIT_USART_DMA(CAPTURA_BAUDRATE);
+	CAPTURE_INIT(&capture, CAPTURA, USART_DMA_SEND);
+#endif
+
+#if MODO_RTOS
+	/*Procesamiento en hilos: el DSP lo despierta la interrupcion de cada
+	  muestra y main, ya sin trabajo, termina su hilo:*/
+	osKernelInitialize();
+	HILOS_INIT(&hilosIo);
+	osKernelStart();
+	osThreadTerminate(osThreadGetId());
+#endif
+
+	/*Inicializacion del medidor de carga y de los trabajos de fondo:*/
+	CARGA_INIT(&carga, TAREAS);
+	POOL_INIT(&poolMuestras);
+	FONDO_INIT(&fondo, CLOCK_CICLOS, HOLGURA, FONDO_MARGEN);
+	trabajoEspectro = FONDO_AGREGAR(&fondo, "espectro", ESPECTRO_PASO, NULL, 4*ESPECTRO_TRAMO);
+	trabajoNivel = FONDO_AGREGAR(&fondo, "nivel", NIVEL_PASO, NULL, 4*ESPECTRO_TRAMO);
+	PILA_INIT(&pila);
+	trabajoPila = FONDO_AGREGAR(&fondo, "pila", PILA_PASO, &pila, 4*PILA_PALABRAS_PASO);
+	cargaInicio = CLOCK_CICLOS();
+
 /*------------------------------------------------------------------------------
 BUCLE PRINCIPAL:
 ------------------------------------------------------------------------------*/
 	while(1)
 	{
-		/*Task Scheduler:*/
-		if (adcReady == 1)
-			ADC_PROCESSING();
+		/*Trabajos de fondo en la holgura hasta la proxima muestra, sin los
+		  ciclos de la tarea que los haya preemptado:*/
+		uint32_t isrAntes = ciclosIsr;
+		uint32_t ciclosFondo = FONDO_EJECUTAR(&fondo);
+		uint32_t isrFondo = ciclosIsr - isrAntes;
+
+		/*Idle, si no corrio ningun paso: la consulta y el WFI van con
+		  PRIMASK en 1, asi una interrupcion entre ambos no se pierde (queda
+		  pendiente, despierta al core y se atiende al rehabilitar). Las
+		  sumas a la carga tambien, porque en MODO_ISR la ventana se cierra
+		  en la interrupcion:*/
+		__disable_irq();
+		if (ciclosFondo)
+			CARGA_TAREA(&carga, TAREA_FONDO, ciclosFondo > isrFondo ? ciclosFondo - isrFondo : 0);
+		else if (RING_EVENTOS_CUENTA(&eventos) == 0) {
+			uint32_t dormido = CLOCK_CICLOS();
+			__WFI();
+			CARGA_DORMIDO(&carga, CLOCK_CICLOS() - dormido);
+		}
+		__enable_irq();
+
+		/*Task Scheduler: con ADC_CIC un evento por muestra, en orden. Sin
+		  ADC_CIC la muestra se convierte aca: los eventos atrasados se
+		  convertirian seguidos y fuera de su instante, asi se atiende el
+		  mas reciente y el resto cuenta como perdido:*/
+		EVENTO_MUESTRA ev = {0, 0.0f};
+#if ADC_CIC
+		uint32_t hayEvento = RING_EVENTOS_POP(&eventos, &ev);
+#else
+		uint32_t hayEvento = EVENTO_ULTIMO(&ev);
+#endif
+		if (hayEvento) {
+			ultimoEvento = ev.ciclo;
+			uint32_t inicio = CLOCK_CICLOS();
+			ADC_PROCESSING(ev.muestra);
+			MUESTRA_MEDIR(CLOCK_CICLOS() - inicio);
+		}
+
+		/*Cada segundo, en el perfil minimo, un paso del ajuste dejando lugar
+		  al peor paso de fondo (con los maximos reiniciados si cambia el
+		  clock) y un barrido de la pila:*/
+		if (ajustePendiente) {
+			ajustePendiente = 0;
+			if (CLOCK_AJUSTE(ciclosTareaMax, FONDO_PASO_MAX(&fondo), FS)) {
+				ciclosCuentaTim3 = TIM_CICLOS_CUENTA(TIM3);
+				FONDO_REMEDIR(&fondo);
+				ciclosTareaMax = 0;
+				latenciaMin = UINT32_MAX;
+				latenciaMax = 0;
+			}
+			FONDO_ACTIVAR(&fondo, trabajoPila);
+		}
 	}
 }
 /*------------------------------------------------------------------------------
@@ -101,67 +579,249 @@ INTERRUPCIONES:
 ------------------------------------------------------------------------------*/
 /*Interrupcion al vencimiento de cuenta de TIM3 cada 1/FS:*/
 void TIM3_IRQHandler(void) {
-	if (TIM_GetITStatus(TIM3, TIM_IT_Update) != RESET) {
+	if (REG_TIM_UPDATE(TIM3)) {
+#if MODO_ISR
+        /*Instante de muestreo y arranque de la conversion; la tarea la
+          corre ADC_IRQHandler al terminar:*/
+        ultimoEvento = TIM3_CICLO_UPDATE();
+        REG_ADC_START_INJ(PIN_ADCX(ADC_PUERTO, ADC_NUM));
+#else
         /*Set de la variable del TS:*/
-        adcReady = 1;
+        MUESTRA_LISTA(TIM3_CICLO_UPDATE(), 0.0f);
+#endif
+
+        REG_GPIO_TOGGLE(GPIOC, GPIO_Pin_8);
 
-        GPIO_ToggleBits(GPIOC, GPIO_Pin_8);
+        REG_TIM_CLEAR_UPDATE(TIM3);
+	}
+}
 
-        TIM_ClearITPendingBit(TIM3, TIM_IT_Update);
+#if ADC_CIC
+/*Interrupcion del DMA del ADC: cada mitad del buffer son R muestras que el
+  CIC reduce a una, asi la tarea corre a FS igual que con TIM3:*/
+void DMA2_Stream0_IRQHandler(void) {
+	float muestra;
+
+	if (REG_DMA_FLAG_LO(DMA2, DMA_LISR_HTIF0)) {
+		CIC_DECIMATE(&cic, &adcBuffer[0], ADC_CIC, &muestra);
+		MUESTRA_LISTA(CLOCK_CICLOS(), muestra);
+		REG_GPIO_TOGGLE(GPIOC, GPIO_Pin_8);
+		REG_DMA_CLEAR_LO(DMA2, DMA_LIFCR_CHTIF0);
+	}
+	if (REG_DMA_FLAG_LO(DMA2, DMA_LISR_TCIF0)) {
+		CIC_DECIMATE(&cic, &adcBuffer[ADC_CIC], ADC_CIC, &muestra);
+		MUESTRA_LISTA(CLOCK_CICLOS(), muestra);
+		REG_GPIO_TOGGLE(GPIOC, GPIO_Pin_8);
+		REG_DMA_CLEAR_LO(DMA2, DMA_LIFCR_CTCIF0);
+	}
+}
+#endif
+
+#if MODO_ISR
+/*Interrupcion de fin de conversion inyectada (la arranca TIM3): la tarea
+  corre aca mismo, sin pasar por la cola ni por el lazo principal:*/
+void ADC_IRQHandler(void) {
+	if (REG_ADC_INJ_LISTA(PIN_ADCX(ADC_PUERTO, ADC_NUM))) {
+		uint32_t inicio = CLOCK_CICLOS();
+		ADC_PROCESSING(0.0f);
+		MUESTRA_MEDIR(CLOCK_CICLOS() - inicio);
+		ciclosIsr += CLOCK_CICLOS() - inicio;
 	}
 }
+#endif
 
 /*------------------------------------------------------------------------------
 TAREAS:
 ------------------------------------------------------------------------------*/
-/*Procesamiento de los datos del ADC:*/
-void ADC_PROCESSING()
+/*Procesamiento de los datos del ADC (Muestra: la decimada con ADC_CIC):*/
+void ADC_PROCESSING(float Muestra)
 {
-    /*Reset de la variable del TS:*/
-    adcReady = 0;
-
-	/*Conversion del dato del AD:*/
-	signalIn = READ_ADC(adcPort, adcPin) - 2048;
+	float iirIn, iirOut;
+
+#if ADC_CIC
+	/*Muestra decimada, ya normalizada -0.5 a 0.5:*/
+	iirIn = Muestra;
+	signalIn = (int32_t)(iirIn * 4096.0f);
+#else
+#if MODO_ISR
+	/*Dato del AD ya convertido (interrupcion de JEOC):*/
+	signalIn = REG_ADC_LEER_INJ(PIN_ADCX(ADC_PUERTO, ADC_NUM)) - 2048;
+#else
+	/*Conversion del dato del AD, con el ADC resuelto en compilacion:*/
+	signalIn = REG_ADC_READ_INJ(PIN_ADCX(ADC_PUERTO, ADC_NUM)) - 2048;
+#endif
 
 	/*Normalizado 0.0 a 1.0. */		/*	-0.5 a 0.5	*/
-	iirIn = ((float)signalIn) / 4096.0;
-
-	/*Llamado a la función de proceso FIR:*/
-	IIR_F32(&iirIn, &iirOut, 2*n, b, a);
-
-	/*Desnormalizado 0 a 4096:*/
-	signalOut = (iirOut * 4096) + 2048;
-
+	iirIn = CONV_I12_A_F32(signalIn + 2048);
+#endif
+
+	/*Llamado a la función de proceso del filtro:*/
+	FILTRO_F32(&filtro, &iirIn, &iirOut, 1);
+
+	/*Desnormalizado 0 a 4095, saturado. Con interpolacion el contador
+	  lleva las saturaciones de las muestras interpoladas:*/
+#if DAC_INTERP > 1
+	uint32_t clipSinUso = 0;
+	signalOut = CONV_F32_A_I12(iirOut, &clipSinUso);
+#else
+	signalOut = CONV_F32_A_I12(iirOut, &dacClips);
+#endif
+
+#if DAC_INTERP > 1
+	/*L muestras interpoladas a la mitad del buffer que el DMA no esta leyendo:*/
+	INTERP_F32(&interp, iirOut, interpOut);
+#if DAC_MONITOR
+	/*El monitor (entrada) se repite en las L posiciones del par:*/
+	uint32_t* pLibre = &dacBuffer[DAC_DMA_MITAD(GPIOA, GPIO_Pin_4, 2*DAC_INTERP) ? 0 : DAC_INTERP];
+	for (uint32_t k = 0; k < DAC_INTERP; k++)
+		pLibre[k] = DAC_DUAL_PALABRA(signalIn + 2048, CONV_F32_A_I12(interpOut[k], &dacClips));
+#else
+	uint16_t* pLibre = &dacBuffer[DAC_DMA_MITAD(dacPort, dacPin, 2*DAC_INTERP) ? 0 : DAC_INTERP];
+	dacClips += CONV_F32_I12(interpOut, pLibre, DAC_INTERP);
+#endif
+#elif DAC_MONITOR
+	/*Monitor de la entrada en PA4 y salida en PA5, en la misma escritura:*/
+	REG_DAC_DUAL(DAC, DAC_DUAL_PALABRA(signalIn + 2048, signalOut));
+#else
 	/*Conversion del dato del DA:*/
-	DAC_CONT(dacPort, dacPin, (uint16_t) signalOut);
+	REG_DAC_SET(DAC, PIN_DAC_NUM(DAC_PUERTO, DAC_NUM), (uint16_t) signalOut);
+#endif
+	LATENCIA_MEDIR();
+
+	/*Monitor de rechazo del interferente:*/
+	GOERTZEL_UPDATE(&goertzelIn, iirIn);
+	if (GOERTZEL_UPDATE(&goertzelOut, iirOut))
+		rechazoDb = GOERTZEL_RECHAZO_DB(&goertzelIn, &goertzelOut, 0);
+
+#if CAPTURA
+	/*Envio de las muestras crudas al host:*/
+	CAPTURE_PUSH(&capture, (uint16_t)(signalIn + 2048), (uint16_t)signalOut);
+#endif
+
+	/*Bloque de salida para el espectro y el nivel de fondo: se llena un
+	  bloque del pool y lo comparten los dos trabajos, sin copiar. Cada
+	  trabajo libre lo retiene y la referencia del llenado se suelta al
+	  final: vuelve al pool con el ultimo que termina, o enseguida si los
+	  dos siguen con el anterior:*/
+	if (pEspectroLlenado == NULL)
+		pEspectroLlenado = POOL_TOMAR(&poolMuestras);
+	if (pEspectroLlenado) {
+		pEspectroLlenado[espectroCuenta++] = iirOut;
+		if (espectroCuenta == ESPECTRO_N) {
+			espectroCuenta = 0;
+			if (!FONDO_ACTIVO(&fondo, trabajoEspectro)) {
+				POOL_RETENER(&poolMuestras, pEspectroLlenado);
+				pEspectroBloque = pEspectroLlenado;
+				espectroBin = 0;
+				espectroMuestra = 0;
+				FONDO_ACTIVAR(&fondo, trabajoEspectro);
+			}
+			if (!FONDO_ACTIVO(&fondo, trabajoNivel)) {
+				POOL_RETENER(&poolMuestras, pEspectroLlenado);
+				pNivelBloque = pEspectroLlenado;
+				nivelMuestra = 0;
+				FONDO_ACTIVAR(&fondo, trabajoNivel);
+			}
+			POOL_SOLTAR(&poolMuestras, pEspectroLlenado);
+			pEspectroLlenado = NULL;
+		}
+	}
+}
+
+/*Duracion, peor caso y carga de la tarea; cierre de la ventana, con su
+  duracion por tiempo (FS es exacta), y pedido del ajuste cada segundo:*/
+static void MUESTRA_MEDIR(uint32_t Ciclos)
+{
+	ciclosTarea = Ciclos;
+	if (ciclosTarea > ciclosTareaMax) ciclosTareaMax = ciclosTarea;
+	CARGA_TAREA(&carga, TAREA_ADC, ciclosTarea);
+
+	if (++tareasVentana == CARGA_MUESTRAS) {
+		uint32_t ahora = CLOCK_CICLOS();
+		CARGA_CERRAR(&carga, (uint32_t)((uint64_t)SystemCoreClock * CARGA_MUESTRAS / FS), ahora - cargaInicio);
+		tareasVentana = 0;
+		latenciaProm = latenciaSuma / CARGA_MUESTRAS;
+		latenciaSuma = 0;
+
+		if (++ventanasAjuste == FS / CARGA_MUESTRAS) {
+			ventanasAjuste = 0;
+			ajustePendiente = 1;
+		}
+		cargaInicio = CLOCK_CICLOS();
+	}
 }
 
 /*------------------------------------------------------------------------------
-FUNCIONES LOCALES:
+TRABAJOS DE FONDO:
 ------------------------------------------------------------------------------*/
-/*Proceso del IIR: Y(n) = B0*X(n) + B1*X(n-1) + B2*X(n-2) + A1*Y(n-1) + A2*Y(n-2):*/
-void IIR_F32(float* pSrc, float* pDst, uint32_t N_COEF, float* pCoeff_b, float* pCoeff_a)
+/*Ciclos hasta la proxima muestra, contando desde el ultimo evento (TIM3 o
+  DMA del ADC, ambos a FS); 0 si ya hay una pendiente. En MODO_ISR la tarea
+  preempta a los trabajos y no hace falta dejarle lugar:*/
+static uint32_t HOLGURA(void)
 {
-	float ACUM = 0.0f;
-
-	/*Senal de Entrada:*/
-	ACUM = *pSrc * pCoeff_b[0];
+#if MODO_ISR
+	return UINT32_MAX / 2;
+#else
+	uint32_t periodo = SystemCoreClock / FS;
+	uint32_t transcurrido = CLOCK_CICLOS() - ultimoEvento;
+
+	if (RING_EVENTOS_CUENTA(&eventos) || transcurrido >= periodo) return 0;
+	return periodo - transcurrido;
+#endif
+}
 
-	/*Diseño del filtro:*/
-	for (uint32_t i = 0; i < N_COEF; i++) {
-		ACUM += iirStateIn_f32 [i] * pCoeff_b[i+1];
-		ACUM -= iirStateOut_f32[i] * pCoeff_a[i+1];
-	}
-    
-    /*Se restan los coeficientes de forma recursiva*/
-	for (uint32_t i = N_COEF - 1; i > 0; i--){
-		iirStateIn_f32[i]  = iirStateIn_f32 [i-1];
-		iirStateOut_f32[i] = iirStateOut_f32[i-1];
+/*ESPECTRO_TRAMO muestras de un bin por paso, por Goertzel sobre el bloque
+  completo; el estado queda entre pasos:*/
+static uint8_t ESPECTRO_PASO(void* pCtx)
+{
+	float coef = 2.0f * cosf((float)M_PI * (float)espectroBin / ESPECTRO_BINS);
+	float s1 = espectroS1, s2 = espectroS2;
+	uint32_t n0 = espectroMuestra;
+	(void)pCtx;
+
+	if (n0 == 0) s1 = s2 = 0.0f;
+	for (uint32_t n = n0; n < n0 + ESPECTRO_TRAMO; n++) {
+		float s = pEspectroBloque[n] + coef * s1 - s2;
+		s2 = s1;
+		s1 = s;
 	}
+	espectroS1 = s1;
+	espectroS2 = s2;
+	espectroMuestra = n0 + ESPECTRO_TRAMO;
+	if (espectroMuestra < ESPECTRO_N) return 1;
+	espectroMuestra = 0;
+
+	/*Amplitud^2 normalizada como GOERTZEL_UPDATE:*/
+	float p = (s1 * s1 + s2 * s2 - coef * s1 * s2) * (4.0f / ((float)ESPECTRO_N * ESPECTRO_N));
+	espectroDb[espectroBin] = 10.0f * log10f(p + 1e-12f);
+
+	/*Con el ultimo bin se suelta la referencia al bloque:*/
+	if (++espectroBin < ESPECTRO_BINS) return 1;
+	POOL_SOLTAR(&poolMuestras, pEspectroBloque);
+	return 0;
+}
 
-	iirStateIn_f32 [0] = *pSrc;
-	iirStateOut_f32[0] = ACUM;
-
-	/*Senal de salida:*/
-	*pDst = ACUM;
+/*ESPECTRO_TRAMO muestras por paso de la potencia y el pico del bloque:*/
+static uint8_t NIVEL_PASO(void* pCtx)
+{
+	float suma = nivelSuma, max = nivelMax;
+	uint32_t n0 = nivelMuestra;
+	(void)pCtx;
+
+	if (n0 == 0) suma = max = 0.0f;
+	for (uint32_t n = n0; n < n0 + ESPECTRO_TRAMO; n++) {
+		float x = pNivelBloque[n];
+		suma += x * x;
+		if (fabsf(x) > max) max = fabsf(x);
+	}
+	nivelSuma = suma;
+	nivelMax = max;
+	nivelMuestra = n0 + ESPECTRO_TRAMO;
+	if (nivelMuestra < ESPECTRO_N) return 1;
+
+	/*Fin del bloque: resultado y se suelta la referencia:*/
+	nivelDb = 10.0f * log10f(suma / ESPECTRO_N + 1e-12f);
+	nivelPico = max;
+	POOL_SOLTAR(&poolMuestras, pNivelBloque);
+	return 0;
 }
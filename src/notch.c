@@ -0,0 +1,127 @@
+/********************************************************************************
+  * @file    notch.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Filtro notch adaptativo de segundo orden. Sigue la frecuencia
+  	  	  	 del interferente minimizando la potencia de salida por gradiente
+  	  	  	 simplificado normalizado, con ~10 MACs por muestra en lugar del
+  	  	  	 elimina banda fijo de orden 12.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "notch.h"
+#include <math.h>
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Radio inicial de los polos: notch ancho para enganchar rapido:*/
+#define NOTCH_RHO_INICIAL	0.80f
+
+/*Velocidad con que el radio tiende a rhoFinal (por muestra):*/
+#define NOTCH_RHO_PASO		0.0005f
+
+/*Constante del promedio de potencia del gradiente:*/
+#define NOTCH_LAMBDA		0.99f
+
+/*Evita la division por cero sin senal:*/
+#define NOTCH_EPS			1e-9f
+
+/*Limite del coeficiente: |cos(w0)| < 1:*/
+#define NOTCH_A_MAX			1.999f
+
+/*****************************************************************************
+NOTCH_F32_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Inicializa el notch adaptativo.
+	* @returns	void
+	* @param
+		- S			Instancia del filtro.
+		- Fs		Frecuencia de muestreo [Hz].
+		- F0		Frecuencia inicial del notch [Hz].
+		- RhoFinal	Radio de los polos en regimen (0.95 a 0.995). El ancho de
+					banda a -3 dB es aprox. (1 - RhoFinal) * Fs / pi.
+		- Mu		Paso de adaptacion normalizado. Ej: 0.005.
+	* @ej
+		- NOTCH_F32_INIT(&notch, 20000, 5000, 0.98f, 0.005f);
+******************************************************************************/
+void NOTCH_F32_INIT(NOTCH_F32_INST* S, float Fs, float F0, float RhoFinal, float Mu)
+{
+	S->a = -2.0f * cosf(2.0f * (float)M_PI * F0 / Fs);
+	S->rho = NOTCH_RHO_INICIAL < RhoFinal ? NOTCH_RHO_INICIAL : RhoFinal;
+	S->rhoFinal = RhoFinal;
+	S->mu = Mu;
+	S->potencia = 0.0f;
+	S->x1 = S->x2 = 0.0f;
+	S->y1 = S->y2 = 0.0f;
+}
+
+/*****************************************************************************
+NOTCH_F32
+
+	* @author	A. Riedinger.
+	* @brief	Filtra y adapta:
+				y(n) = x(n) + a x(n-1) + x(n-2) - rho a y(n-1) - rho^2 y(n-2)
+				g(n) = x(n-1) - rho y(n-1)		(aprox. de dy/da)
+				a   <- a - mu y(n) g(n) / P(g)
+	* @returns	void
+	* @param
+		- S			Instancia del filtro.
+		- pSrc		Muestras de entrada.
+		- pDst		Muestras de salida (sin el interferente).
+		- blockSize	Cantidad de muestras.
+	* @ej
+		- NOTCH_F32(&notch, &iirIn, &iirOut, 1);
+******************************************************************************/
+void NOTCH_F32(NOTCH_F32_INST* S, const float* pSrc, float* pDst, uint32_t blockSize)
+{
+	float a = S->a, rho = S->rho, p = S->potencia;
+	float x1 = S->x1, x2 = S->x2, y1 = S->y1, y2 = S->y2;
+
+	for (uint32_t k = 0; k < blockSize; k++) {
+		float x = pSrc[k];
+		float rhoA = rho * a;
+
+		/*Salida del notch:*/
+		float y = x + a * x1 + x2 - rhoA * y1 - rho * rho * y2;
+
+		/*Gradiente simplificado y su potencia:*/
+		float g = x1 - rho * y1;
+		p = NOTCH_LAMBDA * p + (1.0f - NOTCH_LAMBDA) * g * g;
+
+		/*Paso de adaptacion normalizado:*/
+		a -= S->mu * y * g / (p + NOTCH_EPS);
+		if (a >  NOTCH_A_MAX) a =  NOTCH_A_MAX;
+		if (a < -NOTCH_A_MAX) a = -NOTCH_A_MAX;
+
+		/*El notch se angosta a medida que engancha:*/
+		rho += (S->rhoFinal - rho) * NOTCH_RHO_PASO;
+
+		x2 = x1; x1 = x;
+		y2 = y1; y1 = y;
+		pDst[k] = y;
+	}
+
+	S->a = a; S->rho = rho; S->potencia = p;
+	S->x1 = x1; S->x2 = x2; S->y1 = y1; S->y2 = y2;
+}
+
+/*****************************************************************************
+NOTCH_F32_FREQ
+
+	* @author	A. Riedinger.
+	* @brief	Frecuencia a la que esta enganchado el notch.
+	* @returns
+		- Frecuencia del notch [Hz].
+	* @param
+		- S			Instancia del filtro.
+		- Fs		Frecuencia de muestreo [Hz].
+	* @ej
+		- fInterferente = NOTCH_F32_FREQ(&notch, FS);
+******************************************************************************/
+float NOTCH_F32_FREQ(const NOTCH_F32_INST* S, float Fs)
+{
+	return acosf(-0.5f * S->a) * Fs / (2.0f * (float)M_PI);
+}
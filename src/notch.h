@@ -0,0 +1,28 @@
+/* Definicion del header:*/
+#ifndef notch_H
+#define notch_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/* Estructuras:*/
+/*Notch adaptativo de segundo orden con polos restringidos:
+  H(z) = (1 + a z^-1 + z^-2) / (1 + rho a z^-1 + rho^2 z^-2), a = -2 cos(w0).*/
+typedef struct
+{
+	float a;									/*Coeficiente adaptado.*/
+	float rho;									/*Radio de los polos actual.*/
+	float rhoFinal;								/*Radio al que converge (ancho del notch).*/
+	float mu;									/*Paso normalizado del gradiente.*/
+	float potencia;								/*Potencia media del gradiente.*/
+	float x1, x2;								/*x(n-1), x(n-2).*/
+	float y1, y2;								/*y(n-1), y(n-2).*/
+} NOTCH_F32_INST;
+
+/* Declaracion funciones:*/
+void NOTCH_F32_INIT(NOTCH_F32_INST* S, float Fs, float F0, float RhoFinal, float Mu);
+void NOTCH_F32(NOTCH_F32_INST* S, const float* pSrc, float* pDst, uint32_t blockSize);
+float NOTCH_F32_FREQ(const NOTCH_F32_INST* S, float Fs);
+
+/* Cierre del header:*/
+#endif
@@ -0,0 +1,107 @@
+/********************************************************************************
+  * @file    pila.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Marca de agua de la pila principal sobre el pintado del
+  	  	  	 arranque: barrido por pasos para el ejecutor de fondo y consulta
+  	  	  	 del maximo usado. Ver pila.h.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include <stddef.h>
+#include "pila.h"
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Limites del linker script (stm32f4_flash.ld); weak para el host, donde
+  no existen y valen NULL:*/
+extern uint32_t _ebss __attribute__((weak));
+extern uint32_t _estack __attribute__((weak));
+
+/*****************************************************************************
+PILA_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Toma los limites de la zona pintada en el arranque. Sin
+				barrido todavia, la marca de agua es 0.
+	* @returns	void
+	* @param
+		- pPila		Estado de la medicion.
+	* @ej
+		- PILA_INIT(&pila);
+******************************************************************************/
+void PILA_INIT(PILA* pPila)
+{
+	pPila->pFondo = &_ebss;
+	pPila->pTope = &_estack;
+	if (pPila->pFondo == NULL || pPila->pTope == NULL || pPila->pTope <= pPila->pFondo)
+		pPila->pFondo = pPila->pTope = NULL;
+
+	pPila->pBarrido = pPila->pFondo;
+	pPila->tamano = (uint32_t)((uint8_t*)pPila->pTope - (uint8_t*)pPila->pFondo);
+	pPila->maxima = 0;
+	pPila->barridos = 0;
+	pPila->desborde = 0;
+}
+
+/*****************************************************************************
+PILA_PASO
+
+	* @author	A. Riedinger.
+	* @brief	Paso de fondo (fondo.h): barre hasta PILA_PALABRAS_PASO
+				palabras desde el fondo. Al encontrar la primera tocada
+				actualiza la marca de agua y termina; el proximo barrido
+				empieza otra vez desde el fondo.
+	* @returns
+		- 1 si el barrido sigue, 0 si termino.
+	* @param
+		- pCtx		Estado de la medicion (PILA*).
+	* @ej
+		- trabajoPila = FONDO_AGREGAR(&fondo, "pila", PILA_PASO, &pila, 4*PILA_PALABRAS_PASO);
+******************************************************************************/
+uint8_t PILA_PASO(void* pCtx)
+{
+	PILA* pPila = (PILA*)pCtx;
+	uint32_t* p = pPila->pBarrido;
+	uint32_t* pFin = p + PILA_PALABRAS_PASO;
+
+	if (pPila->pTope == NULL) return 0;
+	if (pFin > pPila->pTope) pFin = pPila->pTope;
+
+	/*Zona intacta: todavia con el patron:*/
+	while (p < pFin && *p == PILA_PATRON) p++;
+	if (p == pFin && p < pPila->pTope) {
+		pPila->pBarrido = p;
+		return 1;
+	}
+
+	/*Primera palabra tocada (o el tope, si la pila nunca se uso):*/
+	uint32_t usada = (uint32_t)((uint8_t*)pPila->pTope - (uint8_t*)p);
+	if (usada > pPila->maxima) pPila->maxima = usada;
+	if (p == pPila->pFondo) pPila->desborde = 1;
+	pPila->pBarrido = pPila->pFondo;
+	pPila->barridos++;
+	return 0;
+}
+
+/*****************************************************************************
+PILA_MEDIR
+
+	* @author	A. Riedinger.
+	* @brief	Barrido completo en el momento (largo: usar fuera del lazo de
+				muestreo o con la interrupcion de muestreo apagada).
+	* @returns
+		- Marca de agua [bytes].
+	* @param
+		- pPila		Estado de la medicion.
+	* @ej
+		- uint32_t usada = PILA_MEDIR(&pila);
+******************************************************************************/
+uint32_t PILA_MEDIR(PILA* pPila)
+{
+	pPila->pBarrido = pPila->pFondo;
+	while (PILA_PASO(pPila));
+	return pPila->maxima;
+}
@@ -0,0 +1,55 @@
+/* Definicion del header:*/
+#ifndef pila_H
+#define pila_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+MARCA DE AGUA DE LA PILA:
+
+	El Reset_Handler (startup_stm32f429x.s) pinta con PILA_PATRON toda la
+	RAM libre entre el fin del .bss (_ebss, heap en 0) y el tope de la pila
+	(_estack) antes de llamar a SystemInit. La pila crece hacia abajo, asi
+	las palabras del fondo que siguen con el patron nunca se usaron: la
+	marca de agua es el tamano menos esa zona intacta.
+
+	El barrido va de abajo hacia arriba hasta la primera palabra tocada y
+	es largo (toda la RAM libre), por eso PILA_PASO es un trabajo de fondo
+	(fondo.h) que barre PILA_PALABRAS_PASO palabras por paso; PILA_MEDIR lo
+	corre entero, para usar fuera del lazo de muestreo.
+
+	Sin el linker script del micro (host) no hay simbolos: la pila queda
+	con tamano 0 y las consultas devuelven 0.
+------------------------------------------------------------------------------*/
+/*Patron del pintado (el mismo literal en startup_stm32f429x.s):*/
+#define PILA_PATRON			0xA5A5A5A5u
+
+/*Palabras barridas por paso de fondo (unos 3 ciclos por palabra):*/
+#define PILA_PALABRAS_PASO	256
+
+/* Estructuras:*/
+typedef struct
+{
+	uint32_t* pFondo;					/*Limite inferior pintado (_ebss).*/
+	uint32_t* pTope;					/*Tope de la pila (_estack).*/
+	uint32_t* pBarrido;					/*Avance del barrido en curso.*/
+	uint32_t tamano;					/*Bytes pintados.*/
+	volatile uint32_t maxima;			/*Marca de agua: bytes usados como maximo.*/
+	uint32_t barridos;					/*Barridos completos.*/
+	uint8_t desborde;					/*1 si la pila llego al fondo (pisa el .bss).*/
+} PILA;
+
+/*Bytes nunca usados, segun el ultimo barrido completo:*/
+static inline uint32_t PILA_LIBRE(const PILA* pPila)
+{
+	return pPila->tamano - pPila->maxima;
+}
+
+/* Declaracion funciones:*/
+void PILA_INIT(PILA* pPila);
+uint8_t PILA_PASO(void* pCtx);
+uint32_t PILA_MEDIR(PILA* pPila);
+
+/* Cierre del header:*/
+#endif
@@ -0,0 +1,87 @@
+/* Definicion del header:*/
+#ifndef pins_H
+#define pins_H
+
+/*------------------------------------------------------------------------------
+DESCRIPTORES DE PINES RESUELTOS EN COMPILACION:
+
+	Un pin se nombra por su puerto y numero (P = A..G, N = 0..15) y cada
+	descriptor se arma pegando tokens, sin comparaciones en tiempo de
+	ejecucion. Las tablas dan 0 (identificador indefinido en #if) para los
+	pines que no sirven, asi un pin invalido se rechaza con #error:
+
+		#if !PIN_ADC_NUM(C, 0)
+		#error "PC0 no es una entrada analogica"
+		#endif
+
+	Solo se resuelve aca lo que corre en cada muestra (la instancia del ADC
+	y el canal del DAC) y lo que se valida con #error; el clock y el canal
+	de la inicializacion los buscan las funciones INIT_* una sola vez.
+------------------------------------------------------------------------------*/
+/*El prefijo va pegado dentro de cada macro (ADC ya es una macro de los
+  headers de ST y no debe expandirse antes del pegado); el nivel extra
+  expande los argumentos:*/
+#define PIN_CAT3(a, b, c)		PIN_CAT3_(a, b, c)
+#define PIN_CAT3_(a, b, c)		a##b##c
+#define PIN_EXP(m, x)			m(x)
+
+/*GPIO:*/
+#define PIN_GPIO(P, N)			PIN_EXP(PIN_GPIO_, P)
+#define PIN_GPIO_(P)			GPIO##P
+#define PIN_GPIO_PIN(P, N)		PIN_EXP(PIN_GPIO_PIN_, N)
+#define PIN_GPIO_PIN_(N)		GPIO_Pin_##N
+
+/*ADC: instancia y soporte del modo triple:*/
+#define PIN_ADC_NUM(P, N)		PIN_CAT3(PIN_ADC_, P, N)
+#define PIN_ADCX(P, N)			PIN_EXP(PIN_ADCX_, PIN_ADC_NUM(P, N))
+#define PIN_ADCX_(n)			ADC##n
+#define PIN_ADC123(P, N)		PIN_CAT3(PIN_ADC123_, P, N)
+
+/*DAC: canal (1 o 2):*/
+#define PIN_DAC_NUM(P, N)		PIN_CAT3(PIN_DAC_, P, N)
+
+/*------------------------------------------------------------------------------
+TABLAS (STM32F429):
+------------------------------------------------------------------------------*/
+/*ADC que convierte cada pin (ADC1, tambien en ADC2; PF solo en ADC3):*/
+#define PIN_ADC_A0		1
+#define PIN_ADC_A1		1
+#define PIN_ADC_A2		1
+#define PIN_ADC_A3		1
+#define PIN_ADC_A4		1
+#define PIN_ADC_A5		1
+#define PIN_ADC_A6		1
+#define PIN_ADC_A7		1
+#define PIN_ADC_B0		1
+#define PIN_ADC_B1		1
+#define PIN_ADC_C0		1
+#define PIN_ADC_C1		1
+#define PIN_ADC_C2		1
+#define PIN_ADC_C3		1
+#define PIN_ADC_C4		1
+#define PIN_ADC_C5		1
+#define PIN_ADC_F3		3
+#define PIN_ADC_F4		3
+#define PIN_ADC_F5		3
+#define PIN_ADC_F6		3
+#define PIN_ADC_F7		3
+#define PIN_ADC_F8		3
+#define PIN_ADC_F9		3
+#define PIN_ADC_F10		3
+
+/*Pines ADC123_INx, que admiten el modo triple intercalado:*/
+#define PIN_ADC123_A0	1
+#define PIN_ADC123_A1	1
+#define PIN_ADC123_A2	1
+#define PIN_ADC123_A3	1
+#define PIN_ADC123_C0	1
+#define PIN_ADC123_C1	1
+#define PIN_ADC123_C2	1
+#define PIN_ADC123_C3	1
+
+/*Salidas del DAC:*/
+#define PIN_DAC_A4		1
+#define PIN_DAC_A5		2
+
+/* Cierre del header:*/
+#endif
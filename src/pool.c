@@ -0,0 +1,201 @@
+/********************************************************************************
+  * @file    pool.c
+  * @author  A. Riedinger & G. Stang.
+  * @brief   Pool estatico de bloques de tamano fijo con cuenta de
+  	  	  	 referencias, libre de bloqueo y seguro en interrupciones.
+  	  	  	 Ver pool.h.
+********************************************************************************/
+
+/*------------------------------------------------------------------------------
+LIBRERIAS:
+------------------------------------------------------------------------------*/
+#include "pool.h"
+#include <stddef.h>
+
+/*------------------------------------------------------------------------------
+DEFINICIONES LOCALES:
+------------------------------------------------------------------------------*/
+#define POOL_CAS(p, pEsperado, nuevo) \
+	__atomic_compare_exchange_n((p), (pEsperado), (nuevo), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+/*------------------------------------------------------------------------------
+FUNCIONES LOCALES:
+------------------------------------------------------------------------------*/
+/*Indice del bloque, o POOL_NULO si el puntero no es el inicio de un bloque:*/
+static uint32_t POOL_INDICE(const POOL* pPool, const void* pBloque)
+{
+	uintptr_t desp = (uintptr_t)pBloque - (uintptr_t)pPool->pMem;
+
+	if ((const uint8_t*)pBloque < pPool->pMem || desp % pPool->tamBloque) return POOL_NULO;
+	desp /= pPool->tamBloque;
+	return (desp < pPool->nBloques) ? (uint32_t)desp : POOL_NULO;
+}
+
+/*Un bloque a la cabeza de la lista libre:*/
+static void POOL_APILAR(POOL* pPool, uint32_t Indice)
+{
+	uint32_t cabeza = __atomic_load_n(&pPool->cabeza, __ATOMIC_ACQUIRE);
+	uint32_t nueva;
+
+	do {
+		__atomic_store_n(&pPool->pSiguiente[Indice], (uint16_t)(cabeza & 0xFFFF), __ATOMIC_RELAXED);
+		nueva = (((cabeza >> 16) + 1) << 16) | Indice;
+	} while (!POOL_CAS(&pPool->cabeza, &cabeza, nueva));
+}
+
+/*****************************************************************************
+POOL_INIT
+
+	* @author	A. Riedinger.
+	* @brief	Encadena todos los bloques en la lista libre y reinicia las
+				estadisticas. No es reentrante: se llama antes de usar el
+				pool.
+	* @returns	void
+	* @param
+		- pPool		Pool definido con POOL_DEF.
+	* @ej
+		- POOL_INIT(&poolMuestras);
+******************************************************************************/
+void POOL_INIT(POOL* pPool)
+{
+	if (pPool->nBloques > POOL_NULO) pPool->nBloques = POOL_NULO;
+
+	for (uint32_t k = 0; k < pPool->nBloques; k++) {
+		pPool->pSiguiente[k] = (k + 1 < pPool->nBloques) ? (uint16_t)(k + 1) : POOL_NULO;
+		pPool->pRefs[k] = 0;
+	}
+	pPool->cabeza = pPool->nBloques ? 0 : POOL_NULO;
+	pPool->enUso = 0;
+	pPool->maxEnUso = 0;
+	pPool->fallos = 0;
+	pPool->errores = 0;
+}
+
+/*****************************************************************************
+POOL_TOMAR
+
+	* @author	A. Riedinger.
+	* @brief	Saca un bloque de la lista libre con una referencia.
+	* @returns
+		- Puntero al bloque, o NULL si no hay libres (se cuenta en fallos).
+	* @param
+		- pPool		Pool.
+	* @ej
+		- float* pBloque = POOL_TOMAR(&poolMuestras);
+******************************************************************************/
+void* POOL_TOMAR(POOL* pPool)
+{
+	uint32_t cabeza = __atomic_load_n(&pPool->cabeza, __ATOMIC_ACQUIRE);
+	uint32_t indice, nueva;
+
+	/*La marca cambia en cada operacion: si otro saco y devolvio el mismo
+	  bloque entre la lectura y el CAS, el CAS falla:*/
+	do {
+		indice = cabeza & 0xFFFF;
+		if (indice == POOL_NULO) {
+			__atomic_add_fetch(&pPool->fallos, 1, __ATOMIC_RELAXED);
+			return NULL;
+		}
+		nueva = (((cabeza >> 16) + 1) << 16) | __atomic_load_n(&pPool->pSiguiente[indice], __ATOMIC_RELAXED);
+	} while (!POOL_CAS(&pPool->cabeza, &cabeza, nueva));
+
+	__atomic_store_n(&pPool->pRefs[indice], 1, __ATOMIC_RELEASE);
+
+	/*Marca de agua alta:*/
+	uint32_t enUso = __atomic_add_fetch(&pPool->enUso, 1, __ATOMIC_RELAXED);
+	uint32_t max = __atomic_load_n(&pPool->maxEnUso, __ATOMIC_RELAXED);
+	while (enUso > max && !__atomic_compare_exchange_n(&pPool->maxEnUso, &max, enUso, 0,
+													   __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	return pPool->pMem + indice * pPool->tamBloque;
+}
+
+/*****************************************************************************
+POOL_RETENER
+
+	* @author	A. Riedinger.
+	* @brief	Suma una referencia a un bloque tomado, para pasarlo a otro
+				consumidor sin copiarlo.
+	* @returns	void
+	* @param
+		- pPool		Pool.
+		- pBloque	Bloque devuelto por POOL_TOMAR.
+	* @ej
+		- POOL_RETENER(&poolMuestras, pBloque);
+******************************************************************************/
+void POOL_RETENER(POOL* pPool, void* pBloque)
+{
+	uint32_t indice = POOL_INDICE(pPool, pBloque);
+	uint32_t refs;
+
+	if (indice == POOL_NULO) {
+		__atomic_add_fetch(&pPool->errores, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	/*Solo sobre un bloque tomado (un libre no se revive):*/
+	refs = __atomic_load_n(&pPool->pRefs[indice], __ATOMIC_ACQUIRE);
+	do {
+		if (refs == 0) {
+			__atomic_add_fetch(&pPool->errores, 1, __ATOMIC_RELAXED);
+			return;
+		}
+	} while (!POOL_CAS(&pPool->pRefs[indice], &refs, refs + 1));
+}
+
+/*****************************************************************************
+POOL_SOLTAR
+
+	* @author	A. Riedinger.
+	* @brief	Resta una referencia; con la ultima el bloque vuelve al pool.
+	* @returns	void
+	* @param
+		- pPool		Pool.
+		- pBloque	Bloque devuelto por POOL_TOMAR.
+	* @ej
+		- POOL_SOLTAR(&poolMuestras, pBloque);
+******************************************************************************/
+void POOL_SOLTAR(POOL* pPool, void* pBloque)
+{
+	uint32_t indice = POOL_INDICE(pPool, pBloque);
+	uint32_t refs;
+
+	if (indice == POOL_NULO) {
+		__atomic_add_fetch(&pPool->errores, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	/*Sin bajar de cero si se suelta un bloque libre:*/
+	refs = __atomic_load_n(&pPool->pRefs[indice], __ATOMIC_ACQUIRE);
+	do {
+		if (refs == 0) {
+			__atomic_add_fetch(&pPool->errores, 1, __ATOMIC_RELAXED);
+			return;
+		}
+	} while (!POOL_CAS(&pPool->pRefs[indice], &refs, refs - 1));
+
+	if (refs == 1) {
+		__atomic_sub_fetch(&pPool->enUso, 1, __ATOMIC_RELAXED);
+		POOL_APILAR(pPool, indice);
+	}
+}
+
+/*****************************************************************************
+POOL_REFS
+
+	* @author	A. Riedinger.
+	* @brief	Referencias actuales de un bloque.
+	* @returns
+		- Cantidad de referencias (0 si esta libre o no es del pool).
+	* @param
+		- pPool		Pool.
+		- pBloque	Bloque.
+	* @ej
+		- if (POOL_REFS(&poolMuestras, pBloque) == 1) ...
+******************************************************************************/
+uint32_t POOL_REFS(const POOL* pPool, const void* pBloque)
+{
+	uint32_t indice = POOL_INDICE(pPool, pBloque);
+
+	return (indice == POOL_NULO) ? 0 : __atomic_load_n(&pPool->pRefs[indice], __ATOMIC_ACQUIRE);
+}
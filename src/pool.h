@@ -0,0 +1,59 @@
+/* Definicion del header:*/
+#ifndef pool_H
+#define pool_H
+
+/* Librerias:*/
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+POOL ESTATICO DE BLOQUES CON CUENTA DE REFERENCIAS:
+
+	Bloques de tamano fijo en memoria estatica (sin heap). Un bloque se toma
+	con una referencia; cada consumidor que lo comparte suma una
+	(POOL_RETENER) y la suelta al terminar (POOL_SOLTAR). Con la ultima
+	vuelve al pool, asi un mismo bloque se filtra, analiza y envia sin
+	copiarlo.
+
+	Tomar, retener y soltar son libres de bloqueo (LDREX/STREX en el micro,
+	atomicas en el host): se pueden llamar desde interrupciones y desde
+	varios hilos. La lista libre lleva una marca de 16 bits contra el
+	problema ABA.
+
+	Definicion e inicializacion:
+		POOL_DEF(poolMuestras, 4, 256*sizeof(float));
+		POOL_INIT(&poolMuestras);
+------------------------------------------------------------------------------*/
+/*Indice nulo de la lista libre (maximo 65535 bloques):*/
+#define POOL_NULO		0xFFFF
+
+/* Estructuras:*/
+typedef struct
+{
+	uint8_t* pMem;								/*nBloques * tamBloque bytes.*/
+	uint32_t tamBloque;							/*Bytes por bloque (multiplo de 4).*/
+	uint32_t nBloques;
+	uint16_t* pSiguiente;						/*Lista libre.*/
+	uint32_t* pRefs;							/*Referencias de cada bloque.*/
+	uint32_t cabeza;							/*Marca << 16 | primer bloque libre.*/
+	uint32_t enUso;								/*Bloques tomados.*/
+	uint32_t maxEnUso;							/*Marca de agua alta.*/
+	uint32_t fallos;							/*POOL_TOMAR sin bloques libres.*/
+	uint32_t errores;							/*Retener o soltar un bloque libre o ajeno.*/
+} POOL;
+
+/*Memoria estatica e instancia de un pool:*/
+#define POOL_DEF(nombre, Bloques, Bytes)											\
+	static uint8_t  nombre##Mem[(Bloques) * (((Bytes) + 3) & ~3u)] __attribute__((aligned(8)));	\
+	static uint16_t nombre##Siguiente[Bloques];									\
+	static uint32_t nombre##Refs[Bloques];										\
+	POOL nombre = {nombre##Mem, ((Bytes) + 3) & ~3u, (Bloques), nombre##Siguiente, nombre##Refs, 0, 0, 0, 0, 0}
+
+/* Declaracion funciones:*/
+void POOL_INIT(POOL* pPool);
+void* POOL_TOMAR(POOL* pPool);
+void POOL_RETENER(POOL* pPool, void* pBloque);
+void POOL_SOLTAR(POOL* pPool, void* pBloque);
+uint32_t POOL_REFS(const POOL* pPool, const void* pBloque);
+
+/* Cierre del header:*/
+#endif
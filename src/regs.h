@@ -0,0 +1,96 @@
+/* Definicion del header:*/
+#ifndef regs_H
+#define regs_H
+
+/*------------------------------------------------------------------------------
+ACCESO DIRECTO A REGISTROS PARA EL CAMINO DE CADA MUESTRA:
+
+	Equivalentes inline de las llamadas de StdPeriph que corren en cada
+	interrupcion, sin asserts de parametros ni aritmetica de direcciones.
+	Con el periferico constante (TIM3, PIN_ADCX(...)) cada una compila a
+	una o dos instrucciones de carga/almacenamiento. Todas reciben el
+	periferico por puntero, asi pueden apuntarse a estructuras en RAM.
+------------------------------------------------------------------------------*/
+
+/* Librerias:*/
+#include "stm32f4xx.h"
+
+#define REG_INLINE	static inline __attribute__((always_inline))
+
+/*TIM_GetITStatus(TIMx, TIM_IT_Update) != RESET:*/
+REG_INLINE uint32_t REG_TIM_UPDATE(TIM_TypeDef* TIMx)
+{
+	return (TIMx->SR & TIM_SR_UIF) && (TIMx->DIER & TIM_DIER_UIE);
+}
+
+/*TIM_ClearITPendingBit(TIMx, TIM_IT_Update) - SR es rc_w0:*/
+REG_INLINE void REG_TIM_CLEAR_UPDATE(TIM_TypeDef* TIMx)
+{
+	TIMx->SR = (uint16_t)~TIM_SR_UIF;
+}
+
+/*GPIO_ToggleBits(GPIOx, Pin):*/
+REG_INLINE void REG_GPIO_TOGGLE(GPIO_TypeDef* GPIOx, uint16_t Pin)
+{
+	GPIOx->ODR ^= Pin;
+}
+
+/*ADC_ClearFlag(JEOC) + ADC_SoftwareStartInjectedConv + espera de JEOC +
+  ADC_GetInjectedConversionValue(ADC_InjectedChannel_1):*/
+REG_INLINE int32_t REG_ADC_READ_INJ(ADC_TypeDef* ADCx)
+{
+	ADCx->SR = ~(uint32_t)ADC_SR_JEOC;
+	ADCx->CR2 |= ADC_CR2_JSWSTART;
+	while ((ADCx->SR & ADC_SR_JEOC) == 0);
+	return (int32_t)ADCx->JDR1;
+}
+
+/*ADC_ClearFlag(JEOC) + ADC_SoftwareStartInjectedConv, sin esperar: el fin
+  lo avisa la interrupcion de JEOC:*/
+REG_INLINE void REG_ADC_START_INJ(ADC_TypeDef* ADCx)
+{
+	ADCx->SR = ~(uint32_t)ADC_SR_JEOC;
+	ADCx->CR2 |= ADC_CR2_JSWSTART;
+}
+
+/*ADC_GetFlagStatus(JEOC):*/
+REG_INLINE uint32_t REG_ADC_INJ_LISTA(ADC_TypeDef* ADCx)
+{
+	return ADCx->SR & ADC_SR_JEOC;
+}
+
+/*ADC_GetInjectedConversionValue(ADC_InjectedChannel_1) + ADC_ClearFlag(JEOC),
+  con la conversion ya terminada:*/
+REG_INLINE int32_t REG_ADC_LEER_INJ(ADC_TypeDef* ADCx)
+{
+	ADCx->SR = ~(uint32_t)ADC_SR_JEOC;
+	return (int32_t)ADCx->JDR1;
+}
+
+/*DAC_SetChannel1Data / DAC_SetChannel2Data (12 bits a derecha). Con Canal
+  constante (1 o 2) el if desaparece:*/
+REG_INLINE void REG_DAC_SET(DAC_TypeDef* DACx, uint32_t Canal, uint16_t Codigo)
+{
+	if (Canal == 1) DACx->DHR12R1 = Codigo;
+	else            DACx->DHR12R2 = Codigo;
+}
+
+/*DAC_SetDualChannelData con la palabra ya armada (DAC_DUAL_PALABRA):*/
+REG_INLINE void REG_DAC_DUAL(DAC_TypeDef* DACx, uint32_t Palabra)
+{
+	DACx->DHR12RD = Palabra;
+}
+
+/*DMA_GetFlagStatus / DMA_ClearFlag de los streams 0 a 3 (LISR/LIFCR):*/
+REG_INLINE uint32_t REG_DMA_FLAG_LO(DMA_TypeDef* DMAx, uint32_t Flag)
+{
+	return DMAx->LISR & Flag;
+}
+
+REG_INLINE void REG_DMA_CLEAR_LO(DMA_TypeDef* DMAx, uint32_t Flag)
+{
+	DMAx->LIFCR = Flag;
+}
+
+/* Cierre del header:*/
+#endif
@@ -0,0 +1,160 @@
+/* Definicion del header:*/
+#ifndef ring_H
+#define ring_H
+
+/* Librerias:*/
+#include <stdint.h>
+#include <string.h>
+
+/*------------------------------------------------------------------------------
+COLA CIRCULAR SPSC SIN BLOQUEO (un productor, un consumidor):
+
+	RING_TIPO(Nombre, Tipo, Largo) define el tipo Nombre y sus funciones
+	inline Nombre_INIT, _PUSH, _POP, _PUSH_N, _POP_N, _CUENTA, _LIBRE y las
+	de tramos contiguos (_ESCRIBIR_TRAMO / _CONFIRMAR y _LEER_TRAMO /
+	_LIBERAR) para llenar o vaciar en el lugar, sin copia intermedia.
+
+	Largo es potencia de dos; los indices corren libres en 32 bits y se
+	enmascaran al acceder. Cada lado publica su indice con release y lee el
+	del otro con acquire (DMB en el micro), y guarda una copia del indice
+	ajeno para no leerlo en cada operacion. Productor y consumidor pueden
+	ser interrupcion y tarea, o dos hilos en el host.
+
+	Los indices de cada lado van en lineas de cache separadas en el host
+	(el M4 no tiene cache de datos, ahi la separacion no aporta).
+------------------------------------------------------------------------------*/
+#ifdef USE_STDPERIPH_DRIVER
+#define RING_LINEA		4
+#else
+#define RING_LINEA		64
+#endif
+
+#define RING_INLINE		static inline __attribute__((always_inline))
+
+#define RING_TIPO(Nombre, Tipo, Largo)												\
+_Static_assert((Largo) >= 2 && ((Largo) & ((Largo) - 1)) == 0,						\
+			   #Nombre ": el largo debe ser potencia de dos");						\
+																					\
+typedef struct																		\
+{																					\
+	/*Lado del productor:*/															\
+	uint32_t cabeza __attribute__((aligned(RING_LINEA)));							\
+	uint32_t colaVista;																\
+	/*Lado del consumidor:*/														\
+	uint32_t cola __attribute__((aligned(RING_LINEA)));								\
+	uint32_t cabezaVista;															\
+	Tipo datos[Largo] __attribute__((aligned(RING_LINEA)));							\
+} Nombre;																			\
+																					\
+RING_INLINE void Nombre##_INIT(Nombre* r)											\
+{																					\
+	r->cabeza = r->colaVista = r->cola = r->cabezaVista = 0;						\
+}																					\
+																					\
+/*Elementos disponibles para el consumidor:*/										\
+RING_INLINE uint32_t Nombre##_CUENTA(Nombre* r)										\
+{																					\
+	return __atomic_load_n(&r->cabeza, __ATOMIC_ACQUIRE)							\
+		 - __atomic_load_n(&r->cola, __ATOMIC_ACQUIRE);								\
+}																					\
+																					\
+/*Lugar libre para el productor:*/													\
+RING_INLINE uint32_t Nombre##_LIBRE(Nombre* r)										\
+{																					\
+	return (Largo) - Nombre##_CUENTA(r);											\
+}																					\
+																					\
+/*Tramo contiguo libre desde la cabeza (hasta el fin del arreglo):*/				\
+RING_INLINE Tipo* Nombre##_ESCRIBIR_TRAMO(Nombre* r, uint32_t* pN)					\
+{																					\
+	uint32_t cabeza = r->cabeza;													\
+	uint32_t hastaFin = (Largo) - (cabeza & ((Largo) - 1));							\
+	if ((Largo) - (cabeza - r->colaVista) < hastaFin)								\
+		r->colaVista = __atomic_load_n(&r->cola, __ATOMIC_ACQUIRE);					\
+	uint32_t libre = (Largo) - (cabeza - r->colaVista);								\
+	*pN = libre < hastaFin ? libre : hastaFin;										\
+	return &r->datos[cabeza & ((Largo) - 1)];										\
+}																					\
+																					\
+/*Publica n elementos escritos en el tramo:*/										\
+RING_INLINE void Nombre##_CONFIRMAR(Nombre* r, uint32_t n)							\
+{																					\
+	__atomic_store_n(&r->cabeza, r->cabeza + n, __ATOMIC_RELEASE);					\
+}																					\
+																					\
+/*Tramo contiguo con datos desde la cola:*/										\
+RING_INLINE Tipo* Nombre##_LEER_TRAMO(Nombre* r, uint32_t* pN)						\
+{																					\
+	uint32_t cola = r->cola;														\
+	uint32_t hastaFin = (Largo) - (cola & ((Largo) - 1));							\
+	if (r->cabezaVista - cola < hastaFin)											\
+		r->cabezaVista = __atomic_load_n(&r->cabeza, __ATOMIC_ACQUIRE);				\
+	uint32_t hay = r->cabezaVista - cola;											\
+	*pN = hay < hastaFin ? hay : hastaFin;											\
+	return &r->datos[cola & ((Largo) - 1)];											\
+}																					\
+																					\
+/*Devuelve n elementos leidos del tramo al productor:*/							\
+RING_INLINE void Nombre##_LIBERAR(Nombre* r, uint32_t n)							\
+{																					\
+	__atomic_store_n(&r->cola, r->cola + n, __ATOMIC_RELEASE);						\
+}																					\
+																					\
+/*De a uno, releyendo el indice ajeno solo si la cola parece llena/vacia:*/		\
+RING_INLINE uint8_t Nombre##_PUSH(Nombre* r, Tipo Valor)							\
+{																					\
+	uint32_t cabeza = r->cabeza;													\
+	if (cabeza - r->colaVista == (Largo)) {											\
+		r->colaVista = __atomic_load_n(&r->cola, __ATOMIC_ACQUIRE);					\
+		if (cabeza - r->colaVista == (Largo)) return 0;								\
+	}																				\
+	r->datos[cabeza & ((Largo) - 1)] = Valor;										\
+	__atomic_store_n(&r->cabeza, cabeza + 1, __ATOMIC_RELEASE);						\
+	return 1;																		\
+}																					\
+																					\
+RING_INLINE uint8_t Nombre##_POP(Nombre* r, Tipo* pValor)							\
+{																					\
+	uint32_t cola = r->cola;														\
+	if (r->cabezaVista == cola) {													\
+		r->cabezaVista = __atomic_load_n(&r->cabeza, __ATOMIC_ACQUIRE);				\
+		if (r->cabezaVista == cola) return 0;										\
+	}																				\
+	*pValor = r->datos[cola & ((Largo) - 1)];										\
+	__atomic_store_n(&r->cola, cola + 1, __ATOMIC_RELEASE);							\
+	return 1;																		\
+}																					\
+																					\
+/*Hasta n elementos, en uno o dos tramos; devuelve los copiados:*/					\
+RING_INLINE uint32_t Nombre##_PUSH_N(Nombre* r, const Tipo* pSrc, uint32_t n)		\
+{																					\
+	uint32_t hechos = 0;															\
+	for (uint32_t k = 0; k < 2 && hechos < n; k++) {								\
+		uint32_t tramo;																\
+		Tipo* p = Nombre##_ESCRIBIR_TRAMO(r, &tramo);								\
+		if (tramo == 0) break;														\
+		if (tramo > n - hechos) tramo = n - hechos;									\
+		memcpy(p, &pSrc[hechos], tramo * sizeof(Tipo));								\
+		Nombre##_CONFIRMAR(r, tramo);												\
+		hechos += tramo;															\
+	}																				\
+	return hechos;																	\
+}																					\
+																					\
+RING_INLINE uint32_t Nombre##_POP_N(Nombre* r, Tipo* pDst, uint32_t n)				\
+{																					\
+	uint32_t hechos = 0;															\
+	for (uint32_t k = 0; k < 2 && hechos < n; k++) {								\
+		uint32_t tramo;																\
+		Tipo* p = Nombre##_LEER_TRAMO(r, &tramo);									\
+		if (tramo == 0) break;														\
+		if (tramo > n - hechos) tramo = n - hechos;									\
+		memcpy(&pDst[hechos], p, tramo * sizeof(Tipo));								\
+		Nombre##_LIBERAR(r, tramo);													\
+		hechos += tramo;															\
+	}																				\
+	return hechos;																	\
+}
+
+/* Cierre del header:*/
+#endif
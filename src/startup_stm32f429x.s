@@ -100,6 +100,17 @@ LoopFillZerobss:
   cmp  r2, r3
   bcc  FillZerobss
 
+/* Paint the free RAM below the stack (from _ebss to sp) with the pattern
+   PILA_PATRON of pila.h, so the high watermark can be measured later. */
+  ldr  r3, =0xA5A5A5A5
+  b  LoopPaintStack
+PaintStack:
+  str  r3, [r2], #4
+
+LoopPaintStack:
+  cmp  r2, sp
+  bcc  PaintStack
+
 /* Call the clock system intitialization function.*/
   bl  SystemInit   
 /* Call static constructors */